@@ -0,0 +1,285 @@
+/**
+ * \file      benchmark-suite.hpp
+ * \brief     Minimal harness for the micro-benchmarks: runs functors,
+ *            gathers the duration statistics of each run and writes the
+ *            results in CSV and JSON formats.
+ *
+ *
+ *
+ */
+
+#ifndef STATEOBSERVATIONBENCHMARKSUITE
+#define STATEOBSERVATIONBENCHMARKSUITE
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+#include <state-observation/tools/definitions.hpp>
+#include <state-observation/tools/stage-timings.hpp>
+
+namespace stateObservation
+{
+  namespace benchmark
+  {
+    ///result of one benchmark, the durations are in nanoseconds per call.
+    ///The budget and the number of samples exceeding it are only given by
+    ///the benchmarks having a deadline (the budget is zero otherwise)
+    struct Result
+    {
+      std::string name;
+      std::string parameters;
+      TimeSize samples;
+      TimeSize batch;
+      double min;
+      double mean;
+      double p50;
+      double p99;
+      double max;
+      double budget;
+      TimeSize misses;
+    };
+
+    /**
+     * \class  Suite
+     * \brief  Runs the benchmarks and keeps their results. A benchmark is
+     *         a functor with an operator()() which is called "batch" times
+     *         per sample, the duration of a sample is divided by the batch
+     *         size to give the duration per call.
+     *
+     *         The command line options are
+     *          --samples N : number of samples of each benchmark
+     *          --warmup N  : number of samples run before measuring
+     *          --filter S  : runs only the benchmarks whose name contains S
+     *          --csv F     : writes the results in the CSV file F
+     *          --json F    : writes the results in the JSON file F
+     *         any other "--name value" pair is kept and can be read by the
+     *         benchmarks with getOption()
+     *
+     */
+    class Suite
+    {
+    public:
+      Suite(int argc, char * argv[]):
+        samples_(defaultSamples),
+        warmup_(defaultWarmup)
+      {
+        for (int i=1; i<argc; ++i)
+        {
+          std::string arg(argv[i]);
+          if (i+1>=argc)
+          {
+            throw std::invalid_argument("Benchmark: missing value for the option "+arg);
+          }
+          std::string value(argv[++i]);
+
+          if (arg=="--samples")
+            samples_=TimeSize(std::atol(value.c_str()));
+          else if (arg=="--warmup")
+            warmup_=TimeSize(std::atol(value.c_str()));
+          else if (arg=="--filter")
+            filter_=value;
+          else if (arg=="--csv")
+            csvFile_=value;
+          else if (arg=="--json")
+            jsonFile_=value;
+          else if (arg.compare(0,2,"--")==0 && arg.size()>2)
+            options_[arg.substr(2)]=value;
+          else
+            throw std::invalid_argument("Benchmark: unknown option "+arg);
+        }
+
+        if (samples_==0)
+        {
+          throw std::invalid_argument("Benchmark: the number of samples must be positive");
+        }
+      }
+
+      static const TimeSize defaultSamples=1000;
+      static const TimeSize defaultWarmup=50;
+
+      ///gets a benchmark specific option, or the default value if it is
+      ///not given in the command line
+      std::string getOption(const std::string & name, const std::string & defaultValue) const
+      {
+        std::map<std::string,std::string>::const_iterator i=options_.find(name);
+        if (i==options_.end())
+          return defaultValue;
+        return i->second;
+      }
+
+      double getOption(const std::string & name, double defaultValue) const
+      {
+        std::map<std::string,std::string>::const_iterator i=options_.find(name);
+        if (i==options_.end())
+          return defaultValue;
+        return std::atof(i->second.c_str());
+      }
+
+      TimeSize getSamples() const
+      {
+        return samples_;
+      }
+
+      ///false if the benchmark is excluded by the filter option
+      bool isSelected(const std::string & name) const
+      {
+        return filter_.empty() || name.find(filter_)!=std::string::npos;
+      }
+
+      ///runs f() batch times per sample and records the statistics
+      template <typename F>
+      void run(const std::string & name, const std::string & parameters,
+               F & f, TimeSize batch=1)
+      {
+        if (!isSelected(name))
+          return;
+
+        for (TimeSize i=0; i<warmup_*batch; ++i)
+          f();
+
+        tools::DurationStatistics stats(samples_);
+        tools::SimplestStopwatch stopwatch(CLOCK_MONOTONIC);
+        for (TimeSize s=0; s<samples_; ++s)
+        {
+          stopwatch.start();
+          for (TimeSize i=0; i<batch; ++i)
+            f();
+          stats.add(stopwatch.stop()/double(batch));
+        }
+
+        add(name,parameters,stats,batch);
+      }
+
+      ///adds the statistics of a benchmark which measures itself
+      void add(const std::string & name, const std::string & parameters,
+               const tools::DurationStatistics & stats, TimeSize batch=1,
+               double budget=0, TimeSize misses=0)
+      {
+        Result r;
+        r.name=name;
+        r.parameters=parameters;
+        r.samples=stats.getCount();
+        r.batch=batch;
+        r.min=stats.getMin();
+        r.mean=stats.getMean();
+        r.p50=stats.getPercentile(50);
+        r.p99=stats.getPercentile(99);
+        r.max=stats.getMax();
+        r.budget=budget;
+        r.misses=misses;
+        results_.push_back(r);
+
+        std::cout << name << " [" << parameters << "] mean " << r.mean
+                  << " ns, p99 " << r.p99 << " ns";
+        if (budget>0)
+          std::cout << ", " << misses << " misses of the " << budget << " ns budget";
+        std::cout << std::endl;
+      }
+
+      const std::vector<Result> & getResults() const
+      {
+        return results_;
+      }
+
+      ///the durations are written with all their significant digits
+      void writeCSV(std::ostream & os) const
+      {
+        std::streamsize precision=os.precision(std::numeric_limits<double>::max_digits10);
+        os << "name,parameters,samples,batch,min_ns,mean_ns,p50_ns,p99_ns,max_ns,budget_ns,misses"
+           << std::endl;
+        for (size_t i=0; i<results_.size(); ++i)
+        {
+          const Result & r=results_[i];
+          os << r.name << ",\"" << r.parameters << "\"," << r.samples << "," << r.batch
+             << "," << r.min << "," << r.mean << "," << r.p50 << "," << r.p99
+             << "," << r.max << "," << r.budget << "," << r.misses << std::endl;
+        }
+        os.precision(precision);
+      }
+
+      void writeJSON(std::ostream & os) const
+      {
+        std::streamsize precision=os.precision(std::numeric_limits<double>::max_digits10);
+        os << "{\n  \"unit\": \"ns\",\n  \"benchmarks\": [";
+        for (size_t i=0; i<results_.size(); ++i)
+        {
+          const Result & r=results_[i];
+          os << (i==0 ? "\n" : ",\n")
+             << "    {\"name\": \"" << r.name << "\", \"parameters\": \"" << r.parameters
+             << "\", \"samples\": " << r.samples << ", \"batch\": " << r.batch
+             << ", \"min\": " << r.min << ", \"mean\": " << r.mean
+             << ", \"p50\": " << r.p50 << ", \"p99\": " << r.p99
+             << ", \"max\": " << r.max << ", \"budget\": " << r.budget
+             << ", \"misses\": " << r.misses << "}";
+        }
+        os << "\n  ]\n}" << std::endl;
+        os.precision(precision);
+      }
+
+      ///writes the result files given in the command line
+      void save() const
+      {
+        if (!csvFile_.empty())
+        {
+          std::ofstream f(csvFile_.c_str());
+          if (!f.is_open())
+            throw std::runtime_error("Benchmark: File "+csvFile_+" could not be created/opened.");
+          writeCSV(f);
+        }
+        if (!jsonFile_.empty())
+        {
+          std::ofstream f(jsonFile_.c_str());
+          if (!f.is_open())
+            throw std::runtime_error("Benchmark: File "+jsonFile_+" could not be created/opened.");
+          writeJSON(f);
+        }
+      }
+
+    protected:
+      TimeSize samples_;
+      TimeSize warmup_;
+      std::string filter_;
+      std::string csvFile_;
+      std::string jsonFile_;
+      std::map<std::string,std::string> options_;
+
+      std::vector<Result> results_;
+    };
+
+    ///builds the parameter string "key1=v1 key2=v2"
+    inline std::string parameters(const std::string & key1, unsigned v1,
+                                  const std::string & key2="", unsigned v2=0)
+    {
+      std::stringstream ss;
+      ss << key1 << "=" << v1;
+      if (!key2.empty())
+        ss << " " << key2 << "=" << v2;
+      return ss.str();
+    }
+
+    ///prevents the compiler from removing the benchmarked computations:
+    ///the value is seen as read by an opaque statement
+    template <typename T>
+    inline void doNotOptimize(const T & value)
+    {
+#if defined(__GNUC__)
+      asm volatile("" : : "g"(&value) : "memory");
+#else
+      static const void * volatile sink;
+      sink = &value;
+      (void) sink;
+#endif
+    }
+  }
+}
+
+#endif //STATEOBSERVATIONBENCHMARKSUITE
@@ -0,0 +1,513 @@
+/**
+ * \file      filter-core-benchmark.cpp
+ * \brief     Micro-benchmarks of the filter core: Kalman filters, finite
+ *            differences Jacobians, the IMU elastic dynamical system and
+ *            its estimator, the kinematics conversions and the indexed
+ *            arrays.
+ *
+ *            Usage: filter-core-benchmark [--samples N] [--warmup N]
+ *                   [--filter S] [--csv file] [--json file]
+ *
+ */
+
+#include <iostream>
+
+#include <state-observation/observer/linear-kalman-filter.hpp>
+#include <state-observation/observer/extended-kalman-filter.hpp>
+#include <state-observation/observer/compile-time/compile-time-kalman-filter.hpp>
+#include <state-observation/flexibility-estimation/imu-elastic-local-frame-dynamical-system.hpp>
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-imu.hpp>
+#include <state-observation/tools/rigid-body-kinematics.hpp>
+
+#include "benchmark-suite.hpp"
+
+using namespace stateObservation;
+using benchmark::doNotOptimize;
+
+namespace
+{
+  ///one estimation step of the runtime linear Kalman filter
+  class LinearKalmanStep
+  {
+  public:
+    LinearKalmanStep(unsigned n, unsigned m):
+      f_(n,m),
+      k_(0)
+    {
+      f_.setA(Matrix::Identity(n,n)*0.9);
+      f_.setB(Matrix::Zero(n,0));
+      f_.setC(Matrix::Random(m,n));
+      f_.setD(Matrix::Zero(m,0));
+      f_.setQ(Matrix::Identity(n,n)*1e-4);
+      f_.setR(Matrix::Identity(m,m)*1e-2);
+      f_.setState(Vector::Zero(n),k_);
+      f_.setStateCovariance(Matrix::Identity(n,n));
+      y_=Vector::Random(m);
+    }
+
+    void operator()()
+    {
+      f_.setMeasurement(y_,++k_);
+      doNotOptimize(f_.getEstimatedState(k_)[0]);
+    }
+
+  protected:
+    LinearKalmanFilter f_;
+    Vector y_;
+    TimeIndex k_;
+  };
+
+  ///one estimation step of the compile-time linear Kalman filter
+  template <unsigned n, unsigned m>
+  class CompileTimeKalmanStep
+  {
+  public:
+    typedef compileTime::KalmanFilter<n,m> filter;
+
+    CompileTimeKalmanStep():
+      k_(0)
+    {
+      f_.setA(filter::Amatrix::Identity()*0.9);
+      f_.setC(filter::Cmatrix::Random());
+      f_.setQ(filter::Qmatrix::Identity()*1e-4);
+      f_.setR(filter::Rmatrix::Identity()*1e-2);
+      f_.setState(filter::StateVector::Zero(),k_);
+      f_.setStateCovariance(filter::Pmatrix::Identity());
+      y_=filter::MeasureVector::Random();
+    }
+
+    void operator()()
+    {
+      f_.setMeasurement(y_,++k_);
+      doNotOptimize(f_.getEstimatedState(k_)[0]);
+    }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  protected:
+    filter f_;
+    typename filter::MeasureVector y_;
+    unsigned k_;
+  };
+
+  ///a nonlinear dynamics of any size for the extended Kalman filter
+  class NonlinearFunctor:
+    public DynamicalSystemFunctorBase
+  {
+  public:
+    NonlinearFunctor(unsigned n, unsigned m):
+      n_(n),
+      m_(m)
+    {
+      a_=Matrix::Random(n,n)*(0.6/n);
+      c_=Matrix::Random(m,n);
+    }
+
+    virtual Vector stateDynamics(const Vector& x, const Vector& , TimeIndex )
+    {
+      Vector xk1=a_*x;
+      xk1.array()+=cos(x.array());
+      return xk1;
+    }
+
+    virtual Vector measureDynamics(const Vector& x, const Vector& , TimeIndex )
+    {
+      Vector y=c_*x;
+      y.array()+=sin(y.array());
+      return y;
+    }
+
+    virtual unsigned getStateSize() const
+    {
+      return n_;
+    }
+
+    virtual unsigned getInputSize() const
+    {
+      return 0;
+    }
+
+    virtual unsigned getMeasurementSize() const
+    {
+      return m_;
+    }
+
+  protected:
+    unsigned n_;
+    unsigned m_;
+    Matrix a_;
+    Matrix c_;
+  };
+
+  ///one estimation step of the extended Kalman filter, with finite
+  ///differences Jacobians
+  class ExtendedKalmanStep
+  {
+  public:
+    ExtendedKalmanStep(unsigned n, unsigned m):
+      functor_(n,m),
+      f_(n,m),
+      k_(0)
+    {
+      f_.setFunctor(&functor_);
+      f_.setQ(Matrix::Identity(n,n)*1e-4);
+      f_.setR(Matrix::Identity(m,m)*1e-2);
+      f_.setState(Vector::Zero(n),k_);
+      f_.setStateCovariance(Matrix::Identity(n,n));
+      dx_=Vector::Constant(n,1e-8);
+      y_=Vector::Random(m);
+    }
+
+    void operator()()
+    {
+      f_.setMeasurement(y_,++k_);
+      f_.setA(f_.getAMatrixFD(dx_));
+      f_.setC(f_.getCMatrixFD(dx_));
+      doNotOptimize(f_.getEstimatedState(k_)[0]);
+    }
+
+  protected:
+    NonlinearFunctor functor_;
+    ExtendedKalmanFilter f_;
+    Vector dx_;
+    Vector y_;
+    TimeIndex k_;
+  };
+
+  ///finite differences state Jacobian alone
+  class AMatrixFD:
+    public ExtendedKalmanStep
+  {
+  public:
+    AMatrixFD(unsigned n, unsigned m):
+      ExtendedKalmanStep(n,m)
+    {
+      f_.setMeasurement(y_,1);
+    }
+
+    void operator()()
+    {
+      doNotOptimize(f_.getAMatrixFD(dx_)(0,0));
+    }
+  };
+
+  ///the IMU elastic dynamical system in a double support configuration
+  class IMUElasticDynamics
+  {
+  public:
+    IMUElasticDynamics(unsigned contacts):
+      imu_(5e-3)
+    {
+      imu_.setContactModel(flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::
+                           contactModel::elasticContact);
+      imu_.setContactsNumber(contacts);
+
+      x_=Vector::Zero(imu_.getStateSize());
+      x_.segment(flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::state::ori,3)
+                                                              << 0.01, -0.02, 0.005;
+
+      u_=Vector::Zero(imu_.getInputSize());
+      u_.head<3>() << 0.0135672, 0.001536, 0.80771;
+      u_.segment<6>(9) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.59487, -0.0402246;
+      for (unsigned i=0; i<contacts; ++i)
+      {
+        u_.segment<3>(flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::
+                      input::contacts+12*i) << 0.0094904, (i==0 ? 0.095 : -0.095), 0;
+      }
+
+      imu_.setFDstep(Vector::Constant(imu_.getStateSize(),1e-8));
+    }
+
+  protected:
+    flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem imu_;
+    Vector x_;
+    Vector u_;
+  };
+
+  class IMUElasticStateDynamics:
+    public IMUElasticDynamics
+  {
+  public:
+    IMUElasticStateDynamics(unsigned contacts):
+      IMUElasticDynamics(contacts)
+    {
+    }
+
+    void operator()()
+    {
+      doNotOptimize(imu_.stateDynamics(x_,u_,0)[0]);
+    }
+  };
+
+  class IMUElasticStateDynamicsJacobian:
+    public IMUElasticDynamics
+  {
+  public:
+    IMUElasticStateDynamicsJacobian(unsigned contacts):
+      IMUElasticDynamics(contacts)
+    {
+      imu_.stateDynamics(x_,u_,0);
+    }
+
+    void operator()()
+    {
+      doNotOptimize(imu_.stateDynamicsJacobian()(0,0));
+    }
+  };
+
+  ///one step of the model based estimator with a given number of active
+  ///contacts, the filter keeps the dimension of all the modeled contacts
+  class FlexEstimatorStep
+  {
+  public:
+    FlexEstimatorStep(unsigned contacts,
+                      unsigned contactsMax=hrp2::contact::nbModeledMax):
+      est_(5e-3,contactsMax),
+      k_(0)
+    {
+      typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+
+      est_.setRobotMass(56.8679920);
+      est_.setContactModel(flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU::
+                           contactModel::elasticContact);
+      est_.setContactsNumber(contacts);
+
+      u_=Vector::Zero(est_.getInputSize());
+      u_.head<3>() << 0.0135672, 0.001536, 0.80771;
+      u_.segment<6>(9) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.59487, -0.0402246;
+      for (unsigned i=0; i<contacts; ++i)
+      {
+        u_.segment<3>(input::contacts+12*i) << 0.0094904+0.1*(i/2), (i%2==0 ? 0.095 : -0.095), 0;
+      }
+
+      y_=Vector::Zero(est_.getMeasurementSize());
+      y_[2]=cst::gravityConstant;
+
+      est_.setInput(u_);
+      est_.setMeasurementInput(u_);
+    }
+
+    void operator()()
+    {
+      y_[0]=1e-3*double(++k_%10);
+      est_.setMeasurement(y_);
+      est_.setMeasurementInput(u_);
+      doNotOptimize(est_.getFlexibilityVector()[0]);
+    }
+
+  protected:
+    flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU est_;
+    Vector u_;
+    Vector y_;
+    unsigned k_;
+  };
+
+  ///rotation vector -> matrix -> rotation vector
+  class RotationMatrixConversions
+  {
+  public:
+    RotationMatrixConversions():
+      v_(0.1,-0.2,0.3)
+    {
+    }
+
+    void operator()()
+    {
+      v_=kine::rotationMatrixToRotationVector(kine::rotationVectorToRotationMatrix(v_));
+      doNotOptimize(v_[0]);
+    }
+
+  protected:
+    Vector3 v_;
+  };
+
+  ///rotation vector -> quaternion -> rotation vector
+  class QuaternionConversions
+  {
+  public:
+    QuaternionConversions():
+      v_(0.1,-0.2,0.3)
+    {
+    }
+
+    void operator()()
+    {
+      v_=kine::quaternionToRotationVector(kine::rotationVectorToQuaternion(v_));
+      doNotOptimize(v_[0]);
+    }
+
+  protected:
+    Vector3 v_;
+  };
+
+  ///roll pitch yaw -> matrix -> roll pitch yaw
+  class RollPitchYawConversions
+  {
+  public:
+    RollPitchYawConversions():
+      v_(0.1,-0.2,0.3)
+    {
+    }
+
+    void operator()()
+    {
+      v_=kine::rotationMatrixToRollPitchYaw(kine::rollPitchYawToRotationMatrix(v_));
+      doNotOptimize(v_[0]);
+    }
+
+  protected:
+    Vector3 v_;
+  };
+
+  ///sliding window of an indexed array: one pushBack and one popFront
+  class IndexedArrayPushPop
+  {
+  public:
+    IndexedArrayPushPop(unsigned size, unsigned window)
+    {
+      v_=Vector::Random(size);
+      array_.setValue(v_,0);
+      for (unsigned i=1; i<window; ++i)
+        array_.pushBack(v_);
+    }
+
+    void operator()()
+    {
+      array_.pushBack(v_);
+      array_.popFront();
+      doNotOptimize(array_.getLastIndex());
+    }
+
+  protected:
+    IndexedVectorArray array_;
+    Vector v_;
+  };
+
+  void linearKalmanFilters(benchmark::Suite & suite)
+  {
+    const unsigned n[]={4,12,24,48};
+    const unsigned m[]={3,12};
+    for (unsigned i=0; i<4; ++i)
+    {
+      for (unsigned j=0; j<2; ++j)
+      {
+        LinearKalmanStep step(n[i],m[j]);
+        suite.run("LinearKalmanFilter",benchmark::parameters("n",n[i],"m",m[j]),step);
+      }
+    }
+  }
+
+  template <unsigned n, unsigned m>
+  void compileTimeVsRuntime(benchmark::Suite & suite)
+  {
+    CompileTimeKalmanStep<n,m> compileTimeStep;
+    suite.run("compileTime::KalmanFilter",benchmark::parameters("n",n,"m",m),compileTimeStep);
+
+    LinearKalmanStep runtimeStep(n,m);
+    suite.run("LinearKalmanFilter/runtime",benchmark::parameters("n",n,"m",m),runtimeStep);
+  }
+
+  void extendedKalmanFilters(benchmark::Suite & suite)
+  {
+    const unsigned n[]={4,12,24,48};
+    const unsigned m[]={3,12};
+    for (unsigned i=0; i<4; ++i)
+    {
+      for (unsigned j=0; j<2; ++j)
+      {
+        ExtendedKalmanStep step(n[i],m[j]);
+        suite.run("ExtendedKalmanFilter",benchmark::parameters("n",n[i],"m",m[j]),step);
+
+        AMatrixFD jacobian(n[i],m[j]);
+        suite.run("ExtendedKalmanFilter::getAMatrixFD",
+                  benchmark::parameters("n",n[i],"m",m[j]),jacobian);
+      }
+    }
+  }
+
+  void imuElasticDynamics(benchmark::Suite & suite)
+  {
+    for (unsigned contacts=0; contacts<=hrp2::contact::nbModeledMax; ++contacts)
+    {
+      IMUElasticStateDynamics dynamics(contacts);
+      suite.run("IMUElasticLocalFrameDynamicalSystem::stateDynamics",
+                benchmark::parameters("contacts",contacts),dynamics);
+
+      IMUElasticStateDynamicsJacobian jacobian(contacts);
+      suite.run("IMUElasticLocalFrameDynamicalSystem::stateDynamicsJacobian",
+                benchmark::parameters("contacts",contacts),jacobian);
+    }
+  }
+
+  void flexEstimator(benchmark::Suite & suite)
+  {
+    for (unsigned contacts=1; contacts<=hrp2::contact::nbModeledMax; ++contacts)
+    {
+      FlexEstimatorStep step(contacts);
+      suite.run("ModelBaseEKFFlexEstimatorIMU::step",
+                benchmark::parameters("contacts",contacts),step);
+    }
+
+    ///the filter only estimates the slots of the active contacts, the
+    ///cost of the step grows with their number
+    for (unsigned contacts=1; contacts<=hrp2::contact::nbMax; ++contacts)
+    {
+      FlexEstimatorStep step(contacts,hrp2::contact::nbMax);
+      suite.run("ModelBaseEKFFlexEstimatorIMU::step",
+                benchmark::parameters("contacts",contacts,"max",hrp2::contact::nbMax),step);
+    }
+  }
+
+  void kinematics(benchmark::Suite & suite)
+  {
+    ///these calls are too short for a single measurement
+    const TimeSize batch=100;
+
+    RotationMatrixConversions matrices;
+    suite.run("kine::rotationVector<->rotationMatrix","",matrices,batch);
+
+    QuaternionConversions quaternions;
+    suite.run("kine::rotationVector<->quaternion","",quaternions,batch);
+
+    RollPitchYawConversions rpy;
+    suite.run("kine::rollPitchYaw<->rotationMatrix","",rpy,batch);
+  }
+
+  void indexedArrays(benchmark::Suite & suite)
+  {
+    const unsigned size[]={3,35,100};
+    for (unsigned i=0; i<3; ++i)
+    {
+      IndexedArrayPushPop pushPop(size[i],10);
+      suite.run("IndexedMatrixArrayT::pushBack/popFront",
+                benchmark::parameters("size",size[i],"window",10),pushPop,10);
+    }
+  }
+}
+
+int main(int argc, char * argv[])
+{
+  try
+  {
+    benchmark::Suite suite(argc,argv);
+
+    linearKalmanFilters(suite);
+    compileTimeVsRuntime<4,3>(suite);
+    compileTimeVsRuntime<12,6>(suite);
+    compileTimeVsRuntime<24,12>(suite);
+    extendedKalmanFilters(suite);
+    imuElasticDynamics(suite);
+    flexEstimator(suite);
+    kinematics(suite);
+    indexedArrays(suite);
+
+    suite.save();
+  }
+  catch (const std::exception & e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * \file      flex-estimator-latency-benchmark.cpp
+ * \brief     End-to-end latency of ModelBaseEKFFlexEstimatorIMU replaying
+ *            the HRP-2 logs of unit-testings/inputFIles. The latency of a
+ *            sample is the time from setting its measurement to the return
+ *            of getFlexibilityVector().
+ *
+ *            Usage: flex-estimator-latency-benchmark [--filter S]
+ *                   [--csv file] [--json file] [--data directory]
+ *                   [--budget ns] [--realtime 0|1]
+ *
+ *            --budget   : deadline of each sample in nanoseconds, the
+ *                         default is the sampling period
+ *            --realtime : when 1 (default) the samples are given to the
+ *                         estimator at the real sampling period
+ *
+ */
+
+#include <iostream>
+#include <time.h>
+
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-imu.hpp>
+
+#include "benchmark-suite.hpp"
+
+using namespace stateObservation;
+
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+
+namespace
+{
+  ///sampling period of the logs
+  const double dt=5e-3;
+
+  ///mass of the robot in the logs
+  const double robotMass=56.8679920;
+
+  ///number of contacts in the logs
+  const unsigned contactsNumber=2;
+
+  ///layout of the input vectors in the logs, they have no additional
+  ///forces and only the position and orientation of the contacts
+  const unsigned logInputSizeBase=42;
+  const unsigned logContactSize=6;
+
+  ///converts an input of the logs to the current input layout
+  Vector convertInput(const Vector & logInput)
+  {
+    Vector u=Vector::Zero(input::sizeBase+12*contactsNumber);
+    u.head(logInputSizeBase)=logInput.head(logInputSizeBase);
+    for (unsigned i=0; i<contactsNumber; ++i)
+    {
+      u.segment(input::contacts+12*i,logContactSize)=
+        logInput.segment(logInputSizeBase+logContactSize*i,logContactSize);
+    }
+    return u;
+  }
+
+  struct Configuration
+  {
+    bool withForcesMeasurements;
+    bool withComBias;
+    bool withUnmodeledForces;
+  };
+
+  class LatencyReplay
+  {
+  public:
+    LatencyReplay(const IndexedVectorArray & y, const IndexedVectorArray & u,
+                  double budget, bool realTime):
+      y_(y),
+      u_(u),
+      budget_(budget),
+      realTime_(realTime)
+    {
+    }
+
+    ///replays the whole log and gives the latency statistics and the number
+    ///of samples exceeding the budget
+    TimeSize run(const Configuration & c, tools::DurationStatistics & stats)
+    {
+      flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU est(dt);
+      est.setSamplingPeriod(dt);
+      est.setRobotMass(robotMass);
+      est.setKfe(40000*Matrix3::Identity());
+      est.setKte(600*Matrix3::Identity());
+      est.setKfv(600*Matrix3::Identity());
+      est.setKtv(60*Matrix3::Identity());
+      est.setContactModel(flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU::
+                          contactModel::elasticContact);
+      est.setContactsNumber(contactsNumber);
+      est.setWithForcesMeasurements(c.withForcesMeasurements);
+      est.setWithComBias(c.withComBias);
+      est.setWithUnmodeledForces(c.withUnmodeledForces);
+
+      ///the logs have no force sensors, each contact is assumed to carry
+      ///the same part of the weight
+      Vector measurement=Vector::Zero(est.getMeasurementSize());
+      if (c.withForcesMeasurements)
+      {
+        for (unsigned i=0; i<contactsNumber; ++i)
+        {
+          measurement[6+6*i+2]=robotMass*cst::gravityConstant/contactsNumber;
+        }
+      }
+
+      TimeIndex k0=std::max(y_.getFirstIndex(),u_.getFirstIndex());
+      TimeIndex k1=std::min(y_.getLastIndex(),u_.getLastIndex());
+
+      ///the conversions are done before the replay
+      std::vector<Vector> inputs;
+      std::vector<Vector> measurements;
+      for (TimeIndex k=k0; k<=k1; ++k)
+      {
+        inputs.push_back(convertInput(u_[k]));
+        measurement.head<6>()=y_[k];
+        measurements.push_back(measurement);
+      }
+
+      est.setInput(inputs[0]);
+      est.setMeasurementInput(inputs[0]);
+
+      tools::SimplestStopwatch stopwatch(CLOCK_MONOTONIC);
+      TimeSize misses=0;
+
+      timespec next;
+      clock_gettime(CLOCK_MONOTONIC,&next);
+
+      for (size_t i=0; i<measurements.size(); ++i)
+      {
+        if (realTime_)
+        {
+          next.tv_nsec+=long(dt*1e9);
+          while (next.tv_nsec>=1000000000)
+          {
+            next.tv_nsec-=1000000000;
+            ++next.tv_sec;
+          }
+          clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&next,0x0);
+        }
+
+        stopwatch.start();
+
+        est.setMeasurement(measurements[i]);
+        est.setMeasurementInput(inputs[i]);
+        const Vector & x=est.getFlexibilityVector();
+
+        double latency=stopwatch.stop();
+
+        benchmark::doNotOptimize(x[0]);
+
+        stats.add(latency);
+        if (latency>budget_)
+          ++misses;
+      }
+
+      return misses;
+    }
+
+  protected:
+    const IndexedVectorArray & y_;
+    const IndexedVectorArray & u_;
+    double budget_;
+    bool realTime_;
+  };
+}
+
+int main(int argc, char * argv[])
+{
+  try
+  {
+    benchmark::Suite suite(argc,argv);
+
+    std::string data=suite.getOption("data",std::string(STATEOBSERVATION_BENCHMARK_DATA_DIR));
+    double budget=suite.getOption("budget",dt*1e9);
+    bool realTime=(suite.getOption("realtime",1.)!=0);
+
+    IndexedVectorArray y;
+    IndexedVectorArray u;
+    y.readVectorsFromFile(data+"/source_measurement.dat");
+    u.readVectorsFromFile(data+"/source_input.dat");
+
+    LatencyReplay replay(y,u,budget,realTime);
+
+    for (unsigned i=0; i<8; ++i)
+    {
+      Configuration c;
+      c.withForcesMeasurements=((i & 1)!=0);
+      c.withComBias=((i & 2)!=0);
+      c.withUnmodeledForces=((i & 4)!=0);
+
+      std::stringstream parameters;
+      parameters << "forces=" << c.withForcesMeasurements
+                 << " comBias=" << c.withComBias
+                 << " unmodeledForces=" << c.withUnmodeledForces;
+
+      const std::string name("ModelBaseEKFFlexEstimatorIMU::latency");
+      if (!suite.isSelected(name))
+        continue;
+
+      tools::DurationStatistics stats(y.size());
+      TimeSize misses=replay.run(c,stats);
+      suite.add(name,parameters.str(),stats,1,budget,misses);
+    }
+
+    suite.save();
+  }
+  catch (const std::exception & e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,287 @@
+/**
+ * \file      kinetics-dynamical-system.hpp
+ * \brief     Dynamical system of a floating base in contact with its
+ *            environment through visco-elastic contacts, measured by IMUs
+ *            and force sensors
+ *
+ * \details
+ *
+ *
+ */
+
+#ifndef KINETICSOBSERVER_KINETICSDYNAMICALSYSTEM_H
+#define KINETICSOBSERVER_KINETICSDYNAMICALSYSTEM_H
+
+#include <vector>
+
+#include <state-observation/dynamical-system/dynamical-system-functor-base.hpp>
+#include <state-observation/tools/rigid-body-kinematics.hpp>
+
+namespace stateObservation
+{
+namespace kineticsObserver
+{
+
+    /**
+    * \class  KineticsDynamicalSystem
+    * \brief  The dynamics of a floating base (e.g. the waist of a humanoid)
+    *         whose mass, center of mass and inertia are given in its frame,
+    *         in contact with the environment through visco-elastic contacts.
+    *
+    *         The state has a fixed size: the kinematics of the base, an
+    *         unmodeled external wrench and a slot of fixed size for each of
+    *         the maxContacts contacts (rest pose of the contact and its
+    *         wrench). The slots of the contacts which are not set keep their
+    *         values, so that adding or removing a contact does not change
+    *         the sizes of the state nor of the input. Everything is
+    *         expressed in the world frame but the input, which gives the
+    *         kinematics of the center of mass, of the contacts and of the
+    *         IMUs in the frame of the base.
+    *
+    *         The orientations of the state are rotation vectors which are
+    *         summed on the left (see stateSum) and the jacobians are given
+    *         in closed form for these sums. They are sparse by blocks and
+    *         only the blocks of the set contacts are computed.
+    *
+    *         The measurements are the accelerometers and gyrometers of up to
+    *         maxIMUs IMUs and the wrench sensors of the contacts, they are
+    *         ordered by IMU then by contact and only the ones that are set
+    *         are in the measurement vector.
+    *
+    */
+    class KineticsDynamicalSystem :
+      public DynamicalSystemFunctorBase
+    {
+    public:
+      struct state
+      {
+        ///indexes of the components of the state vector
+        static const unsigned pos = 0;
+        static const unsigned ori = 3;
+        static const unsigned linVel = 6;
+        static const unsigned angVel = 9;
+        static const unsigned unmodeledForce = 12;
+        static const unsigned unmodeledTorque = 15;
+        static const unsigned contacts = 18;
+
+        ///size of the kinematics of the base
+        static const unsigned kinematicsSize = 12;
+
+        ///indexes of the components of a contact from the beginning of its
+        ///slot: rest pose in the world frame and wrench applied to the base
+        ///at the contact point in the world frame
+        static const unsigned contactPos = 0;
+        static const unsigned contactOri = 3;
+        static const unsigned contactForce = 6;
+        static const unsigned contactTorque = 9;
+        static const unsigned contactSize = 12;
+
+        static inline unsigned contactIndex(unsigned i)
+        {
+          return contacts+contactSize*i;
+        }
+
+        static inline unsigned getSize(unsigned maxContacts)
+        {
+          return contacts+contactSize*maxContacts;
+        }
+      };
+
+      struct input
+      {
+        ///indexes of the components of the input vector, in the frame of
+        ///the base. The inertia matrix is at the center of mass (Ixx, Iyy,
+        ///Izz, Ixy, Ixz, Iyz), the angular momentum is the one of the
+        ///motion of the body around its center of mass and the additional
+        ///wrench is known and applied at the center of mass in the world frame
+        static const unsigned com = 0;
+        static const unsigned comVel = 3;
+        static const unsigned comAcc = 6;
+        static const unsigned inertia = 9;
+        static const unsigned angMomentum = 15;
+        static const unsigned dotAngMomentum = 18;
+        static const unsigned additionalForce = 21;
+        static const unsigned additionalTorque = 24;
+        static const unsigned contacts = 27;
+
+        ///indexes of the components of the kinematics of a contact
+        static const unsigned contactPos = 0;
+        static const unsigned contactOri = 3;
+        static const unsigned contactLinVel = 6;
+        static const unsigned contactAngVel = 9;
+        static const unsigned contactSize = 12;
+
+        ///indexes of the components of the kinematics of an IMU
+        static const unsigned imuPos = 0;
+        static const unsigned imuOri = 3;
+        static const unsigned imuLinVel = 6;
+        static const unsigned imuAngVel = 9;
+        static const unsigned imuLinAcc = 12;
+        static const unsigned imuSize = 15;
+
+        static inline unsigned contactIndex(unsigned i)
+        {
+          return contacts+contactSize*i;
+        }
+
+        static inline unsigned imuIndex(unsigned maxContacts, unsigned j)
+        {
+          return contacts+contactSize*maxContacts+imuSize*j;
+        }
+
+        static inline unsigned getSize(unsigned maxContacts, unsigned maxIMUs)
+        {
+          return contacts+contactSize*maxContacts+imuSize*maxIMUs;
+        }
+      };
+
+      ///constructor with the sampling period, the number of contact slots
+      ///and the number of IMUs
+      KineticsDynamicalSystem(double dt, unsigned maxContacts, unsigned maxIMUs);
+
+      ///virtual destructor
+      virtual ~KineticsDynamicalSystem();
+
+      ///Description of the state dynamics
+      virtual Vector stateDynamics(const Vector& x, const Vector& u, TimeIndex k);
+
+      ///Description of the sensor's dynamics
+      virtual Vector measureDynamics(const Vector& x, const Vector& u, TimeIndex k);
+
+      ///Description of the state dynamics, written in xk1
+      virtual void computeStateDynamics(const Vector& x, const Vector& u, TimeIndex k, Vector& xk1);
+
+      ///Description of the sensor's dynamics, written in y
+      virtual void computeMeasureDynamics(const Vector& x, const Vector& u, TimeIndex k, Vector& y);
+
+      ///writes in A (resized if needed) the jacobian of the state dynamics
+      ///at the last call of stateDynamics
+      void stateDynamicsJacobian(Matrix & A);
+
+      ///writes in C (resized if needed) the jacobian of the measurements
+      ///at the last call of measureDynamics
+      void measureDynamicsJacobian(Matrix & C);
+
+      ///computes the linear and angular accelerations of the base in the
+      ///world frame
+      void computeAccelerations(const Vector& x, const Vector& u,
+                                Vector3 & linAcc, Vector3 & angAcc);
+
+      ///computes the wrench of the visco-elastic model of the contact i
+      void computeContactWrench(const Vector& x, const Vector& u, unsigned i,
+                                Vector3 & force, Vector3 & torque) const;
+
+      ///sum of a state and a tangent vector, the orientations are composed
+      static void stateSum(const Vector& stateVector, const Vector& tangentVector, Vector& sum);
+
+      ///difference of two states in the tangent space
+      static void stateDifference(const Vector& stateVector1, const Vector& stateVector2,
+                                  Vector& difference);
+
+      ///Sets the period of the time discretization
+      void setSamplingPeriod(double dt);
+      double getSamplingPeriod() const;
+
+      void setMass(double m);
+      double getMass() const;
+
+      ///sets whether the contact i is set
+      void setContact(unsigned i, bool b);
+      bool getContact(unsigned i) const;
+
+      ///sets whether the wrench of the contact i is measured
+      void setContactWrenchSensor(unsigned i, bool b);
+      bool getContactWrenchSensor(unsigned i) const;
+
+      ///sets whether the accelerometer and the gyrometer of the IMU j
+      ///are measured
+      void setIMUSensors(unsigned j, bool accelerometer, bool gyrometer);
+      bool getAccelerometer(unsigned j) const;
+      bool getGyrometer(unsigned j) const;
+
+      ///sets the stiffness and damping matrices of the contact i, in the
+      ///world frame
+      void setContactStiffnessAndDamping(unsigned i,
+                                         const Matrix3 & linStiffness, const Matrix3 & linDamping,
+                                         const Matrix3 & angStiffness, const Matrix3 & angDamping);
+      const Matrix3 & getContactLinStiffness(unsigned i) const;
+      const Matrix3 & getContactLinDamping(unsigned i) const;
+      const Matrix3 & getContactAngStiffness(unsigned i) const;
+      const Matrix3 & getContactAngDamping(unsigned i) const;
+
+      inline unsigned getMaxContacts() const
+      {
+        return maxContacts_;
+      }
+
+      inline unsigned getMaxIMUs() const
+      {
+        return maxIMUs_;
+      }
+
+      ///number of contacts which are set
+      unsigned getContactsNumber() const;
+
+      ///Gets the state size
+      virtual unsigned getStateSize() const;
+
+      ///Gets the input size
+      virtual unsigned getInputSize() const;
+
+      ///Gets the size of the measurements which are set
+      virtual unsigned getMeasurementSize() const;
+
+      ///Gets the largest size of the measurements
+      unsigned getMaxMeasurementSize() const;
+
+    protected:
+      ///computes the accelerations in acc_ and, if jacobian is true, their
+      ///jacobian with respect to the state in jAcc_ (linear then angular)
+      void computeAccelerations_(const Vector& x, const Vector& u, bool jacobian);
+
+      ///the accelerations of the base and its orientation matrix
+      struct Accelerations
+      {
+        Matrix3 orientation;
+        Vector3 linAcc;
+        Vector3 angAcc;
+      };
+
+      double dt_;
+      double mass_;
+
+      unsigned maxContacts_;
+      unsigned maxIMUs_;
+      unsigned stateSize_;
+      unsigned inputSize_;
+
+      std::vector<bool> contacts_;
+      std::vector<bool> wrenchSensors_;
+      std::vector<bool> accelerometers_;
+      std::vector<bool> gyrometers_;
+
+      std::vector<Matrix3> linStiffness_;
+      std::vector<Matrix3> linDamping_;
+      std::vector<Matrix3> angStiffness_;
+      std::vector<Matrix3> angDamping_;
+
+      Accelerations acc_;
+      Matrix jAcc_;
+
+      ///the points of the last evaluations of the dynamics
+      Vector lastX_;
+      Vector lastU_;
+      Vector lastXMeasurement_;
+      Vector lastUMeasurement_;
+
+      ///jacobian of the kinematics at k+1
+      Matrix aKine_;
+
+    public:
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+}
+}
+
+#endif // KINETICSOBSERVER_KINETICSDYNAMICALSYSTEM_H
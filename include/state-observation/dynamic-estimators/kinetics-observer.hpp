@@ -1,5 +1,5 @@
 /**
- * \file      kinetics-observer-base.hpp
+ * \file      kinetics-observer.hpp
  * \author    Mehdi Benallegue
  * \date      2018
  * \brief     Unified Kinetics estimator
@@ -9,14 +9,15 @@
  *
  */
 
-#ifndef FLEXIBILITYESTIMATION_EKFFLEXIBILITYESTIMATORBASE_H
-#define FLEXIBILITYESTIMATION_EKFFLEXIBILITYESTIMATORBASE_H
+#ifndef KINETICSOBSERVER_KINETICSOBSERVER_H
+#define KINETICSOBSERVER_KINETICSOBSERVER_H
+
+#include <vector>
 
 #include <boost/utility.hpp>
 
 #include <state-observation/observer/extended-kalman-filter.hpp>
-
-#include <state-observation/flexibility-estimation/flexibility-estimator-base.hpp>
+#include <state-observation/dynamic-estimators/kinetics-dynamical-system.hpp>
 
 
 namespace stateObservation
@@ -24,230 +25,418 @@ namespace stateObservation
 namespace  kineticsObserver
 {
    /**
-    * \class  EKFFlexibilityEstimatorBase
-    * \brief  This class is the base class of the flexibility estimators that
-    *         use an extended Kalman Filter. Several methods require to be overloaded
-    *         to derive an implementation from this base class.
+    * \class  KineticsObserver
+    * \brief  Estimates the kinematics of a floating base, the wrenches of its
+    *         contacts and an unmodeled external wrench with an extended
+    *         Kalman filter, using IMUs and the wrench sensors of the contacts
+    *         (see KineticsDynamicalSystem for the model).
+    *
+    *         All the containers are sized at the construction for maxContacts
+    *         contacts and maxIMUs IMUs: setting the sensors, adding or
+    *         removing contacts and changing the set of measurements do not
+    *         allocate memory, so that update() can run in a real-time loop.
+    *
+    *         Before each update(), the kinematics of the contacts and of
+    *         the IMUs in the frame of the base are given with the sensor
+    *         measurements of the step. The IMU and wrench measurements are
+    *         used only once, the kinematics and the center of mass are kept
+    *         until they are set again.
     *
     */
-
-    class KineticsObserver
+    class KineticsObserver : private boost::noncopyable
     {
     public:
-        ///virtual destructor
-        virtual ~KineticsObserver();
+        typedef KineticsDynamicalSystem::state state;
+        typedef KineticsDynamicalSystem::input input;
 
         /// The constructor.
         ///  \li maxContacts : maximum number of contacts,
-        ///  \li dx gives the derivation step for a finite differences derivation method
-        KineticsObserver(int maxContacts=4, const Vector & dx=Vector::Zero(0));
-
+        ///  \li maxIMUs : maximum number of IMUs
+        explicit KineticsObserver(unsigned maxContacts=4, unsigned maxIMUs=2);
 
+        ///virtual destructor
+        virtual ~KineticsObserver();
 
 
         /// ///////////////////////////////////////////////////////////
         /// Getting, setting the current time and running the estimation
         /// //////////////////////////////////////////////////////////
 
-        /// gets the time
-        double getTime() const;
+        ///sets the sampling period (1 ms by default)
+        void setSamplingTime(double dt);
+        double getSamplingTime() const;
 
-        /// sets the time
-        void setTime(double) ;
+        /// gets the time index of the current estimation
+        TimeIndex getCurrentTime() const;
 
-        /// this function triggers the estimation itself
-        void update();
+        /// gets the time of the current estimation in seconds
+        double getTime() const;
 
+        /// sets the time of the current estimation in seconds (rounded to
+        /// a time index), the inputs and measurements of the filter are
+        /// cleared
+        void setTime(double t);
 
+        /// runs the estimation of the next step with the sensors which are
+        /// set and gives the state, the estimation is only a prediction if
+        /// no sensor is set
+        const Vector & update();
 
 
         /// ////////////////////////////////
         /// Getting and setting the state
         /// ////////////////////////////////
 
-        /// Gets an estimation of the state in the form of a state vector $\hat{x_{k+1}}$
-        virtual Vector getState() const;
-
-        /// Get the kinematics of a given frame
-        /// the input is the state of the desired frame  expressed in local cordinates
-        /// the output is the state of the frame expressed in global cordinates
-        /// the type of the vector and the output depends on its size
-        /// if size == 0 then the kinematic state is provided up to 2nd order
-        ///              (position, velocity and acceleration)
-        /// if size == 3 it is a position and the output will be the estimated global pos
-        /// if size == 6 then it is a position/orientation and
-        ///              the output will be the global position/orientation
-        /// if size == 9 then it is a position/orientation/linVelocity
-        ///               the output will be the global value accordingly
-        /// if size == 12 then it is a position/orientation/linVelocity/angVelocity
-        ///               the output will be the global value accordingly
-        /// if size == 15 if the acceleration is estimated then it is a
-        ///                 position/orientation/linVelocity/angVelocity/linacc
-        ///                 the output will be the global value accordingly
-        ///               otherwise
-        ///                 it acts as size == 12
-        /// if size == 15 if the acceleration is estimated then it is a
-        ///                 position/orientation/linVelocity/angVelocity/linacc/angacc
-        ///                 the output will be the global value accordingly
-        ///               otherwise
-        ///                 it acts as size == 12
-        virtual Vector getKinematics(const Vector &) const;
-
-
-        virtual Vector getExternalForces() const;
-
-        ///This function allows to estimate the acceleration even if
-        /// withAccelerationEstimation is not set
-        virtual void estimateAcceleration();
+        /// Gets the current estimation of the state
+        const Vector & getState() const;
 
         /// Gets the state size
-        virtual unsigned getStateSize() const;
-
+        unsigned getStateSize() const;
 
-        ///Sets a value of the state x_k provided from another source
-        /// can be used for initialization of the estimator
-        ///can be a 4x4 homogenous matrix or a vector of size stateSize
-        virtual void setState(const Matrix &, bool resetCovariance=true);
+        Vector3 getPosition() const;
+        Matrix3 getOrientation() const;
+        Vector3 getLinearVelocity() const;
+        Vector3 getAngularVelocity() const;
 
+        ///gets the unmodeled external wrench (force then torque at the
+        ///center of mass)
+        Vector6 getUnmodeledWrench() const;
 
-        ///Sets a value for the kinematics part of the state
-        virtual void setKinematics(const Matrix &, bool resetForces=true,
-                                   bool resetCovariance=true);
+        ///gets the wrench of the contact num in the world frame
+        Vector6 getContactWrench(unsigned num) const;
 
+        ///computes the linear and angular accelerations of the base from
+        ///the estimated state and the last input
+        void estimateAccelerations(Vector3 & linAcc, Vector3 & angAcc);
 
+        ///computes and stores the accelerations of the base used by
+        ///getKinematics, even if withAccelerationEstimation is not set
+        void estimateAcceleration();
 
-        /// /////////////////////////////////////////////////////
-        /// Setting and getting the state of the estimation
-        /// ////////////////////////////////////////////////////
+        /// Get the kinematics of a given frame
+        /// the input is the kinematics of the frame in the frame of the base
+        /// (orientations are rotation vectors), the output is its kinematics
+        /// in the world frame, the type depends on the size
+        /// if size == 0 then the kinematics of the base are provided up to
+        ///              the 2nd order if the accelerations are estimated
+        /// if size == 3 it is a position
+        /// if size == 6 it is a position/orientation
+        /// if size == 9 it is a position/orientation/linVelocity
+        /// if size == 12 it is a position/orientation/linVelocity/angVelocity
+        /// if size == 15 it is a position/orientation/linVelocity/angVelocity/linAcc
+        ///               if the accelerations are estimated, otherwise it
+        ///               acts as size == 12
+        /// if size == 18 it is a position/orientation/linVelocity/angVelocity/linAcc/angAcc
+        ///               if the accelerations are estimated, otherwise it
+        ///               acts as size == 12
+        Vector getKinematics(const Vector & localKinematics=Vector::Zero(0)) const;
+
+        ///gets the unmodeled external wrench followed by the wrenches of
+        ///the contacts (zero for the contacts which are not set)
+        Vector getExternalForces() const;
+
+        ///Sets the state x_k, e.g. for the initialization, the covariance
+        ///is reset to its initial value if resetCovariance is set
+        void setState(const Vector & x, bool resetCovariance=true);
+
+        ///Sets the kinematics part of the state
+        void setKinematics(const Vector3 & position, const Matrix3 & orientation,
+                           const Vector3 & linVel, const Vector3 & angVel,
+                           bool resetCovariance=true);
+
+        ///sets whether the unmodeled external wrench is estimated, when
+        ///it is not it remains zero
+        void setWithUnmodeledWrench(bool b = true);
+        bool getWithUnmodeledWrench() const;
+
+        ///same as setWithUnmodeledWrench
         void setWithExternalForces(bool b = true);
 
+        ///sets whether update() estimates the accelerations of the base
         void setWithAccelerationEstimation(bool b = true);
+        bool getWithAccelerationEstimation() const;
 
+        ///sets whether update() computes the filtered measurements
         void setWithFilteringMeasurements(bool b = true);
+        bool getWithFilteringMeasurements() const;
+
+        ///computes the filtered measurements: the measurements of the
+        ///sensors which are set, predicted from the estimated state, even if
+        ///withFilteringMeasurements is not set. update() calls it after the
+        ///estimation, before the measurements are cleared
+        void filterMeasurements();
 
+        ///gets the last filtered measurements
+        const Vector & getFilteredMeasurements() const;
 
 
         /// ///////////////////////////////////////////////
         /// Getting and setting input data and measurements
         /// /////////////////////////////////////////////
 
-        /// sets the measurement of the IMU (gyrometer, accelerometer,)
-        virtual void setIMU(const Vector3 & accelero, const  Vector3 & gyrometer, const Vector3 & position,
-                            const Matrix & orientation, const  Vector3 & linearVel= Vector::Zero(0),
-                                      Vector3 angularVel= Vector::Zero(0),int num=0);
+        void setMass(double m);
+        double getMass() const;
 
-        /// Gets an estimation of the state in the form of a state vector $\hat{x_{k+1}}$
-        /// if the IMU contains both
-        virtual void setGyrometer(Vector3 measurement, Vector3 position,
-                                      Matrix orientation, Vector3 linearVel= Vector::Zero(0),
-                                      Vector3 angularVel= Vector::Zero(0),int num=0);
+        ///sets the position, velocity and acceleration of the center of
+        ///mass in the frame of the base
+        void setCenterOfMass(const Vector3 & com, const Vector3 & comVel=Vector3::Zero(),
+                             const Vector3 & comAcc=Vector3::Zero());
 
-        /// Gets an estimation of the state in the form of a state vector $\hat{x_{k+1}}$
-        virtual void setAccelerometer(Vector3 measurement, Vector3 position,
-                                      Matrix orientation, Vector3 linearVel= Vector::Zero(0),
-                                      Vector3 angularVel= Vector::Zero(0),
-                                      Vector3 linearAcc=Vector::Zero(0),int num=0);
+        ///sets the inertia matrix at the center of mass in the frame of
+        ///the base
+        void setCoMInertiaTensor(const Matrix3 & inertia);
 
-        ///this function allows to compute the filtered sensors even if
-        /// WithFilteringMeasurements is not set
-        virtual void filterMeasurements();
+        ///sets the angular momentum of the internal motions around the
+        ///center of mass and its derivative in the frame of the base
+        void setCoMAngularMomentum(const Vector3 & sigma,
+                                   const Vector3 & sigmaDot=Vector3::Zero());
 
+        ///sets a known wrench applied at the center of mass, in the world
+        ///frame
+        void setAdditionalWrench(const Vector3 & force, const Vector3 & torque);
 
+        /// sets the measurement of the IMU num (accelerometer and gyrometer)
+        /// and its kinematics in the frame of the base
+        void setIMU(const Vector3 & accelero, const Vector3 & gyrometer,
+                    const Vector3 & position, const Matrix3 & orientation,
+                    const Vector3 & linVel=Vector3::Zero(), const Vector3 & angVel=Vector3::Zero(),
+                    const Vector3 & linAcc=Vector3::Zero(), unsigned num=0);
 
-        ///Sets the covariance matrix of the flexibility Guess
-        virtual void setStateCovariance(const Matrix & P);
+        /// same as above without the acceleration of the IMU
+        void setIMU(const Vector3 & accelero, const Vector3 & gyrometer,
+                    const Vector3 & position, const Matrix & orientation,
+                    const Vector3 & linearVel=Vector3::Zero(),
+                    Vector3 angularVel=Vector3::Zero(), int num=0);
 
-        ///Gets the covariance matrix of the flexibility
-        virtual Matrix getStateCovariance() const;
+        /// sets the measurement of the gyrometer of the IMU num only
+        void setGyrometer(const Vector3 & measurement, const Vector3 & position,
+                          const Matrix3 & orientation, const Vector3 & angVel=Vector3::Zero(),
+                          unsigned num=0);
 
-        ///Sets the covariance matrices for the process noises
-        /// \li Q process noise
-        virtual void setProcessNoiseCovariance(const Matrix & Q);
+        /// sets the measurement of the accelerometer of the IMU num only
+        void setAccelerometer(const Vector3 & measurement, const Vector3 & position,
+                              const Matrix3 & orientation, const Vector3 & linVel=Vector3::Zero(),
+                              const Vector3 & angVel=Vector3::Zero(),
+                              const Vector3 & linAcc=Vector3::Zero(), unsigned num=0);
 
-        ///Sets the covariance matrices for the sensor noises
-        /// \li R sensor noise
-        virtual void setMeasurementNoiseCovariance(const Matrix & R);
+        ///sets the covariance matrices of the measurements of the IMUs
+        void setIMUCovariance(const Matrix3 & accelero, const Matrix3 & gyrometer);
 
-        ///gets the covariance matrices for the process noises
-        virtual Matrix getProcessNoiseCovariance() const ;
+        ///sets the covariance matrix of the measurements of the wrench sensors
+        void setContactWrenchSensorCovariance(const Matrix6 & wrench);
 
-        ///gets the covariance matrices for the sensor noises
-        virtual Matrix getMeasurementNoiseCovariance() const ;
+        ///sets the covariance matrices of the sensors from the 12x12
+        ///covariance of an accelerometer, a gyrometer and a wrench sensor,
+        ///only the diagonal blocks are used
+        void setMeasurementNoiseCovariance(const Matrix & R);
 
-        /// Sets the value of the next sensor measurement y_{k+1}
-        virtual void setMeasurement(const Vector & y);
+        ///gets the 12x12 covariance of an accelerometer, a gyrometer and a
+        ///wrench sensor
+        Matrix getMeasurementNoiseCovariance() const;
 
-        virtual Vector getMeasurement();
 
-        /// Sets the value of the next input for the state process dynamics
-        /// i.e. : gives u_k such that x_{k+1} = f(x_k,u_k)
-        virtual void setInput(const Vector & u);
+        /// ///////////////////////////////////////////////
+        /// Contacts
+        /// /////////////////////////////////////////////
 
-        /// Sets the value of the next  measurement
-        /// i.e. : gives u_{k+1} such that y_{k+1}=h(x_{k+1},u_{k+1})
-        virtual void setMeasurementInput(const Vector & u);
+        ///adds the contact num with its rest pose in the world frame,
+        ///its wrench starts at zero with the initial covariance
+        void addContact(unsigned num, const Vector3 & restPosition,
+                        const Matrix3 & restOrientation);
 
-        virtual Vector getInput();
+        ///removes the contact num, its slot of the state is frozen
+        void removeContact(unsigned num);
 
-        virtual Vector getMeasurementInput();
+        bool getContact(unsigned num) const;
 
+        unsigned getContactsNumber() const;
 
+        unsigned getMaxContacts() const;
 
-        /// Gets a const reference on the extended Kalman filter
-        virtual const stateObservation::ExtendedKalmanFilter & getEKF() const;
+        unsigned getMaxIMUs() const;
 
-        /// Gets a reference on the extended Kalman filter
-        virtual stateObservation::ExtendedKalmanFilter & getEKF();
+        ///sets the stiffness and the damping of the contact num
+        void setContactStiffnessAndDamping(unsigned num,
+                                           const Matrix3 & linStiffness, const Matrix3 & linDamping,
+                                           const Matrix3 & angStiffness, const Matrix3 & angDamping);
 
+        ///sets the kinematics of the contact num in the frame of the base
+        void updateContactWithNoSensor(unsigned num, const Vector3 & position,
+                                       const Matrix3 & orientation,
+                                       const Vector3 & linVel=Vector3::Zero(),
+                                       const Vector3 & angVel=Vector3::Zero());
 
+        ///sets the kinematics of the contact num in the frame of the base
+        ///and the measurement of its wrench sensor in the frame of the
+        ///contact (force then torque)
+        void updateContactWithWrenchSensor(unsigned num, const Vector6 & wrench,
+                                           const Vector3 & position, const Matrix3 & orientation,
+                                           const Vector3 & linVel=Vector3::Zero(),
+                                           const Vector3 & angVel=Vector3::Zero());
 
-        /// Gets the measurements size
-        /// this method is pure virtual and reauires to be overloaded in implementation
-        virtual unsigned getMeasurementSize() const =0;
 
-        /// Gets the input size
-        /// this method is pure virtual and reauires to be overloaded in implementation
-        virtual unsigned getInputSize() const =0;
+        /// ///////////////////////////////////////////////
+        /// Covariances and filter
+        /// /////////////////////////////////////////////
 
-        /// Gets a simulation of the
-        virtual Vector getSimulatedMeasurement();
+        ///Sets the covariance matrix of the state
+        void setStateCovariance(const Matrix & P);
 
-        ///Resets the covariance matrices to their original values
-        virtual void resetCovarianceMatrices()=0;
+        ///Gets the covariance matrix of the state
+        const Matrix & getStateCovariance() const;
 
-        ///Get the last vector of inovation of the Kalman filter
-        virtual Vector getInovation();
+        ///Sets the covariance matrix of the process noise, the blocks of
+        ///the contacts which are not set are not used
+        void setProcessNoiseCovariance(const Matrix & Q);
 
-        ///Get the simulated measurement of the predicted state
-        virtual Vector getPredictedMeasurement();
+        const Matrix & getProcessNoiseCovariance() const;
 
-        ///Get the predicted state
-        virtual Vector getPrediction();
+        ///Resets the covariance matrices to their default values
+        void resetCovarianceMatrices();
 
-        ///Get the last simulated measurement
-        virtual Vector getLastPredictedMeasurement();
+        ///default covariance of the process noise
+        static Matrix getDefaultQ(unsigned maxContacts);
 
-        ///Get the last predicted state
-        virtual Vector getLastPrediction();
+        ///default initial covariance of the state
+        static Matrix getDefaultStateCovariance(unsigned maxContacts);
+
+        /// Gets the size of the measurements which are set
+        unsigned getMeasurementSize() const;
+
+        /// Gets the input size
+        unsigned getInputSize() const;
+
+        /// Gets the input of the next update
+        const Vector & getInput() const;
+
+        ///sets whether the jacobians are computed with finite differences
+        ///instead of the closed form (slower, for the validation)
+        void setFiniteDifferencesJacobians(bool b);
+
+        ///sets whether the sensors are fused one after the other instead of
+        ///in one stacked update. The covariance of the measurements being
+        ///block diagonal, the estimation is the same but the cost grows
+        ///linearly with the number of IMUs and wrench sensors instead of
+        ///inverting the covariance of the whole measurement vector
+        void setSequentialUpdate(bool b = true);
+        bool getSequentialUpdate() const;
+
+        /// Gets a const reference on the extended Kalman filter
+        const ExtendedKalmanFilter & getEKF() const;
+
+        /// Gets a reference on the extended Kalman filter
+        ExtendedKalmanFilter & getEKF();
+
+        /// Gets the dynamical system
+        const KineticsDynamicalSystem & getDynamicalSystem() const;
 
     protected:
-        virtual void setJacobians(const Matrix & A, const Matrix & C);
+        ///swaps the containers of the filter for the measurement size m
+        void switchMeasurementWorkspace_(unsigned m);
 
-        virtual void useFiniteDifferencesJacobians(Vector dx);
+        ///sets the process noise of the filter, zero for the slots of the
+        ///contacts which are not set
+        void updateProcessNoise_();
 
-        stateObservation::ExtendedKalmanFilter ekf_;
+        ///resets the covariance of the slot of the contact i
+        void resetContactCovariance_(unsigned i);
 
-        bool finiteDifferencesJacobians_;
+        ///predicts the state in xbar_ and its covariance in pk1_ with the
+        ///input of the previous step
+        void predict_();
 
-        Vector dx_;
+        ///fuses the measurement block of one sensor (size rows from index)
+        ///in dxUpdate_ and pk1_
+        void fuseMeasurementBlock_(const Vector & y, const Vector & yp,
+                                   const Matrix & c, const Matrix & r,
+                                   unsigned index, unsigned size);
+
+        ///fuses all the measurements at once in dxUpdate_ and pk1_
+        void fuseMeasurements_(const Vector & y, const Vector & yp,
+                               const Matrix & c, const Matrix & r);
+
+        unsigned maxContacts_;
+        unsigned maxIMUs_;
 
-        Vector lastX_;
+        KineticsDynamicalSystem functor_;
+        ExtendedKalmanFilter ekf_;
 
         TimeIndex k_;
 
-    private:
+        Vector x_;
+        Vector u_;
+
+        ///measurements of the step
+        Vector imuMeasurements_;
+        Vector wrenchMeasurements_;
+
+        Matrix3 acceleroCovariance_;
+        Matrix3 gyroCovariance_;
+        Matrix6 wrenchCovariance_;
+
+        ///containers of the filter for each measurement size (multiple of
+        ///3) and the index of the workspace which keeps the ones of a size
+        std::vector<ExtendedKalmanFilter::MeasurementWorkspace> measurementWorkspaces_;
+        std::vector<unsigned> workspaceIndexes_;
+        unsigned activeWorkspace_;
 
+        ///measurement vector, its covariance and jacobian for each
+        ///measurement size
+        std::vector<Vector> y_;
+        std::vector<Matrix> r_;
+        std::vector<Matrix> c_;
+
+        Matrix a_;
+        Matrix p_;
+        Matrix pk1_;
+        Matrix q_;
+        Matrix activeQ_;
+
+        Vector dx_;
+        bool finiteDifferencesJacobians_;
+        bool withUnmodeledWrench_;
+
+        ///containers of the sequential update, the predicted measurements
+        ///for each measurement size and the sizes of the blocks of the
+        ///sensors of the step
+        bool sequentialUpdate_;
+        std::vector<Vector> yp_;
+        Vector xbar_;
+        Vector dxUpdate_;
+        Matrix pct_;
+        Matrix gain_;
+        std::vector<unsigned> measurementBlocks_;
+        unsigned blocksNumber_;
+
+        ///containers of the stacked update for each measurement size, the
+        ///innovation, the product of the covariance with the transposed
+        ///jacobian, the innovation covariance with its factorization and
+        ///the transposed gain
+        std::vector<Vector> innovations_;
+        std::vector<Matrix> stackedPct_;
+        std::vector<Matrix> innovationCovariances_;
+        std::vector<Eigen::LLT<Matrix> > innovationCovarianceLLTs_;
+        std::vector<Matrix> gainsTranspose_;
+
+        ///input of the previous step, used by the prediction
+        Vector uk_;
+        bool withPreviousInput_;
+
+        ///accelerations of the base given by estimateAcceleration()
+        bool withAccelerationEstimation_;
+        bool withAccelerations_;
+        Vector3 linAcc_;
+        Vector3 angAcc_;
+
+        ///filtered measurements for each measurement size and the size of
+        ///the last ones
+        bool withFilteringMeasurements_;
+        std::vector<Vector> filteredMeasurements_;
+        unsigned filteredSize_;
+
+    public:
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     };
 }
 }
-#endif // FLEXIBILITYESTIMATION_EKFFLEXIBILITYESTIMATORBASE_H
+#endif // KINETICSOBSERVER_KINETICSOBSERVER_H
@@ -42,6 +42,34 @@ namespace stateObservation
         virtual Vector measureDynamics
         (const Vector& x, const Vector& u, TimeIndex k)=0;
 
+        ///Writes the next state in xk1 (resized if needed) instead of
+        ///returning a new vector. The default implementation calls
+        ///stateDynamics, the functors overload it to avoid the allocation.
+        ///It has its own name so that the functors overloading only
+        ///stateDynamics do not hide it
+        virtual void computeStateDynamics
+        (const Vector& x, const Vector& u, TimeIndex k, Vector& xk1);
+
+        ///Writes the measurements in y (resized if needed) instead of
+        ///returning a new vector. The default implementation calls
+        ///measureDynamics, the functors overload it to avoid the allocation
+        virtual void computeMeasureDynamics
+        (const Vector& x, const Vector& u, TimeIndex k, Vector& y);
+
+        ///Evaluates the state dynamics on each column of x and writes the
+        ///results in the columns of xk1 (resized if needed). u has either one
+        ///column shared by all the states or one column per state.
+        ///The default implementation calls stateDynamics on each column
+        virtual void stateDynamicsBatch
+        (const Matrix& x, const Matrix& u, TimeIndex k, Matrix& xk1);
+
+        ///Evaluates the measurement dynamics on each column of x and writes
+        ///the results in the columns of y (resized if needed). u has either one
+        ///column shared by all the states or one column per state.
+        ///The default implementation calls measureDynamics on each column
+        virtual void measureDynamicsBatch
+        (const Matrix& x, const Matrix& u, TimeIndex k, Matrix& y);
+
         ///The method to overload if the functor needs to be reset when the
         ///Exteded Kalman filter is reset itself
         virtual void reset(){}
@@ -71,7 +99,27 @@ namespace stateObservation
             BOOST_ASSERT(checkInputvector(v) && "ERROR: The input vector has the wrong size");
         }
 
+        inline void assertBatch_(const Matrix & x, const Matrix & u)
+        {
+            (void)x;(void)u;//avoid warning
+            BOOST_ASSERT(unsigned(x.rows())==getStateSize() &&
+                         "ERROR: The states have the wrong size");
+            BOOST_ASSERT(unsigned(u.rows())==getInputSize() &&
+                         (u.cols()==1 || u.cols()==x.cols()) &&
+                         "ERROR: The inputs have the wrong size");
+        }
+
+        ///gives the column of the input batch u used for the state i
+        inline unsigned batchInputColumn_(const Matrix & u, unsigned i) const
+        {
+            return (u.cols()==1) ? 0 : i;
+        }
+
     private:
+        ///copies of the columns given to the default batch evaluations
+        Vector batchX_;
+        Vector batchU_;
+        Vector batchY_;
     };
 }
 
@@ -15,6 +15,7 @@
 
 #include <state-observation/dynamical-system/dynamical-system-functor-base.hpp>
 #include <state-observation/tools/rigid-body-kinematics.hpp>
+#include <state-observation/tools/rotation-cache.hpp>
 #include <state-observation/sensors-simulation/accelerometer-gyrometer.hpp>
 #include <state-observation/noise/noise-base.hpp>
 
@@ -47,6 +48,19 @@ namespace stateObservation
         virtual Vector measureDynamics
         (const Vector& x, const Vector& u, TimeIndex k);
 
+        ///Description of the state dynamics, written in xk1
+        virtual void computeStateDynamics
+        (const Vector& x, const Vector& u, TimeIndex k, Vector& xk1);
+
+        ///Description of the sensor's dynamics, written in y
+        virtual void computeMeasureDynamics
+        (const Vector& x, const Vector& u, TimeIndex k, Vector& y);
+
+        ///Description of the state dynamics of several states, the
+        ///translations are integrated for all the columns at once
+        virtual void stateDynamicsBatch
+        (const Matrix& x, const Matrix& u, TimeIndex k, Matrix& xk1);
+
         ///Sets a noise which disturbs the state dynamics
         virtual void setProcessNoise( NoiseBase * );
         ///Removes the process noise
@@ -71,6 +85,9 @@ namespace stateObservation
         ///Gets the measurement size
         virtual unsigned getMeasurementSize() const;
 
+        ///Gets the cache of the rotations and its hit rate
+        const kine::RotationCache & getRotationCache() const;
+
     protected:
         typedef kine::indexes<kine::rotationVector> indexes;
 
@@ -80,11 +97,15 @@ namespace stateObservation
 
         double dt_;
 
-        Vector3Unaligned orientationVector_;
-        QuaternionUnaligned quaternion_;
+        ///conversions of the orientation vector (slot 0) and of the
+        ///rotation increment of the integration (slot 1)
+        kine::RotationCache rotationCache_;
 
         Quaternion computeQuaternion_(const Vector3 & x);
 
+        ///state given to the sensor
+        Vector sensorState_;
+
         static const unsigned stateSize_=18;
         static const unsigned inputSize_=6;
         static const unsigned measurementSize_=6;
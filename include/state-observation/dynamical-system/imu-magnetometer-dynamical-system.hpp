@@ -16,6 +16,7 @@
 
 #include <state-observation/dynamical-system/dynamical-system-functor-base.hpp>
 #include <state-observation/tools/rigid-body-kinematics.hpp>
+#include <state-observation/tools/rotation-cache.hpp>
 #include <state-observation/sensors-simulation/accelerometer-gyrometer-magnetometer.hpp>
 #include <state-observation/noise/noise-base.hpp>
 
@@ -73,6 +74,9 @@ namespace stateObservation
         ///Gets the measurement size
         virtual unsigned getMeasurementSize() const;
 
+        ///Gets the cache of the rotations and its hit rate
+        const kine::RotationCache & getRotationCache() const;
+
     protected:
 
         typedef kine::indexes<kine::rotationVector> indexes;
@@ -83,8 +87,8 @@ namespace stateObservation
 
         double dt_;
 
-        Vector3Unaligned orientationVector_;
-        QuaternionUnaligned quaternion_;
+        ///conversions of the orientation vector
+        kine::RotationCache rotationCache_;
 
         Quaternion computeQuaternion_(const Vector3 & x);
 
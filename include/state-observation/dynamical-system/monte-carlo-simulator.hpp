@@ -0,0 +1,263 @@
+/**
+ * \file      monte-carlo-simulator.hpp
+ * \brief      Runs many noisy trajectories of a dynamical system in parallel
+ *             to evaluate the statistics of an estimator.
+ *
+ * \details
+ *
+ *
+ */
+
+#ifndef STATEOBSERVATIONMONTECARLOSIMULATOR_H
+#define STATEOBSERVATIONMONTECARLOSIMULATOR_H
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <Eigen/Cholesky>
+
+#include <state-observation/dynamical-system/dynamical-system-functor-base.hpp>
+
+namespace stateObservation
+{
+    /**
+    * \class  MonteCarloSimulator
+    * \brief
+    *        Simulates trajectories of a dynamics functor (as
+    *        DynamicalSystemSimulator does) on a pool of threads and runs an
+    *        estimator on the measurements of each trajectory.
+    *
+    *        Each thread runs a copy of a Worker, which owns its functor, its
+    *        noises and its estimator. The errors, the NEES and the NIS of
+    *        each trajectory are written in arrays allocated before the
+    *        simulation. The statistics (RMSE, average NEES and NIS) are
+    *        summed once all the trajectories are done, in the order of the
+    *        trajectories rather than in the order in which the threads
+    *        finish them, so that the sums are rounded the same way for any
+    *        number of threads.
+    *
+    *        When the worker draws the noises of a trajectory from random
+    *        streams given by the seed of the simulator and the index of the
+    *        trajectory (see tools::RandomStream), the results do not depend
+    *        on the number of threads or on their scheduling.
+    *
+    */
+    class MonteCarloSimulator : private boost::noncopyable
+    {
+    public:
+        /**
+        * \class  Worker
+        * \brief  The objects which simulate and estimate one trajectory at a
+        *         time. A copy is given to each thread with clone(), it must
+        *         not share the functor, the noises or the estimator with the
+        *         original.
+        *
+        */
+        class Worker
+        {
+        public:
+            virtual ~Worker(){}
+
+            ///gives a new copy of the worker
+            virtual Worker * clone() const=0;
+
+            ///the functor of the simulated system, with its noises
+            virtual DynamicalSystemFunctorBase & getFunctor()=0;
+
+            ///starts the trajectory: sets the random streams of the noises
+            ///from the seed and the trajectory, gives the initial state x_0
+            ///and resets the estimator
+            virtual void initialize(boost::uint64_t seed, unsigned trajectory, Vector & x0)=0;
+
+            ///estimates the state x_{k+1} from the measurement y_{k+1} and
+            ///the input u_k, gives the estimated state, the covariance of
+            ///its error and the NIS of the measurement
+            virtual void estimate(const Vector & y, const Vector & u, TimeIndex k,
+                                  Vector & xHat, Matrix & covariance, double & nis)=0;
+
+            ///gives the error between the estimated and the actual state,
+            ///with the size of the covariance. The default is the difference
+            virtual void stateError(const Vector & xHat, const Vector & x, Vector & error)
+            {
+                error=xHat-x;
+            }
+
+            ///gives the size of the error, the state size by default
+            virtual unsigned getErrorSize()
+            {
+                return getFunctor().getStateSize();
+            }
+        };
+
+        ///Constructor, by default there is a worker thread per core but the
+        ///calling thread
+        MonteCarloSimulator();
+
+        ///Virtual destructor
+        virtual ~MonteCarloSimulator();
+
+        ///sets the number of worker threads, the calling thread runs
+        ///trajectories too. Zero runs all of them in the calling thread.
+        void setThreadsNumber(unsigned n);
+
+        unsigned getThreadsNumber() const
+        {
+            return threadsNumber_;
+        }
+
+        ///sets the seed given to the workers for the random streams of the
+        ///trajectories, zero by default
+        void setSeed(boost::uint64_t seed);
+
+        boost::uint64_t getSeed() const
+        {
+            return seed_;
+        }
+
+        ///sets the inputs, the column k is u_k. The last column is kept for
+        ///the following time indexes, a single column is a constant input
+        void setInputs(const Matrix & u);
+
+        const Matrix & getInputs() const
+        {
+            return inputs_;
+        }
+
+        ///simulates and estimates the given number of trajectories from the
+        ///time 0 to the time duration, with copies of the prototype
+        void run(const Worker & prototype, unsigned trajectories, TimeSize duration);
+
+        unsigned getTrajectoriesNumber() const
+        {
+            return unsigned(squaredErrors_.cols());
+        }
+
+        TimeSize getDuration() const
+        {
+            return TimeSize(squaredErrors_.rows());
+        }
+
+        ///squared norms of the estimation errors of each trajectory: the
+        ///column i is the trajectory i and the row k is the time k+1
+        const Matrix & getSquaredErrors() const
+        {
+            return squaredErrors_;
+        }
+
+        ///normalized estimation errors squared, same layout
+        const Matrix & getNEES() const
+        {
+            return nees_;
+        }
+
+        ///normalized innovations squared, same layout
+        const Matrix & getNIS() const
+        {
+            return nis_;
+        }
+
+        ///root mean squared norm of the errors over the trajectories, for
+        ///each time
+        const Vector & getRMSE() const
+        {
+            return rmse_;
+        }
+
+        ///root mean squared error of each component of the state, over the
+        ///trajectories and the time
+        const Vector & getComponentsRMSE() const
+        {
+            return componentsRMSE_;
+        }
+
+        ///NEES and NIS averaged over the trajectories, for each time
+        const Vector & getAverageNEES() const
+        {
+            return averageNEES_;
+        }
+
+        const Vector & getAverageNIS() const
+        {
+            return averageNIS_;
+        }
+
+        ///NEES and NIS averaged over the trajectories and the time
+        double getMeanNEES() const
+        {
+            return meanNEES_;
+        }
+
+        double getMeanNIS() const
+        {
+            return meanNIS_;
+        }
+
+    protected:
+        ///containers of the trajectories of one thread
+        struct Slot
+        {
+            Slot():worker(0x0){}
+
+            Worker * worker;
+            Vector x;
+            Vector xk1;
+            Vector u;
+            Vector uy;
+            Vector y;
+            Vector xHat;
+            Matrix covariance;
+            Vector error;
+            Vector normalizedError;
+            Eigen::LLT<Matrix> llt;
+        };
+
+        ///copies the input of the time k in u, O(1) instead of the lookup
+        ///in the map of DynamicalSystemSimulator
+        void getInput_(TimeIndex k, Vector & u) const;
+
+        ///simulates and estimates the trajectory i with the slot s
+        void simulate_(unsigned i, Slot & s);
+
+        ///loop of a thread, takes the next trajectory until there is none
+        void work_(unsigned slot);
+
+        ///computes the statistics from the results of the trajectories,
+        ///after the simulation, in the order of the trajectories
+        void aggregate_();
+
+        void deleteWorkers_();
+
+        unsigned threadsNumber_;
+        boost::uint64_t seed_;
+
+        Matrix inputs_;
+
+        std::vector<Slot> slots_;
+
+        ///the next trajectory to simulate and the error of a thread
+        boost::mutex mutex_;
+        unsigned nextTrajectory_;
+        unsigned trajectories_;
+        std::string error_;
+
+        Matrix squaredErrors_;
+        Matrix nees_;
+        Matrix nis_;
+        ///squared errors of each component summed over the time, the column
+        ///i is the trajectory i
+        Matrix componentsErrors_;
+
+        Vector rmse_;
+        Vector componentsRMSE_;
+        Vector averageNEES_;
+        Vector averageNIS_;
+        double meanNEES_;
+        double meanNIS_;
+    };
+}
+#endif // STATEOBSERVATIONMONTECARLOSIMULATOR_H
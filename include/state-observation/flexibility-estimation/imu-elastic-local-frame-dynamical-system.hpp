@@ -15,6 +15,7 @@
 #include <state-observation/noise/noise-base.hpp>
 #include <state-observation/sensors-simulation/accelerometer-gyrometer.hpp>
 #include <state-observation/tools/rigid-body-kinematics.hpp>
+#include <state-observation/tools/rotation-cache.hpp>
 #include <state-observation/tools/hrp2.hpp>
 
 #include <Eigen/Cholesky>
@@ -70,9 +71,209 @@ namespace stateObservation
         static const unsigned comBias = 30;
         static const unsigned drift = 32;
 
+        ///size of the state with hrp2::contact::nbModeledMax modeled contacts
         static const unsigned size =35;
+
+        ///index of the forces and moments of the contact i, the contacts
+        ///beyond hrp2::contact::nbModeledMax are appended after the drift
+        ///so that the other indexes do not depend on the number of contacts
+        static inline unsigned fcIndex(unsigned i)
+        {
+          return (i<hrp2::contact::nbModeledMax) ? fc+6*i :
+                 size+6*(i-hrp2::contact::nbModeledMax);
+        }
+
+        ///size of the state for a maximum number of modeled contacts
+        static inline unsigned getSize(unsigned contactsMaxNumber)
+        {
+          return (contactsMaxNumber>hrp2::contact::nbModeledMax) ?
+                 size+6*(contactsMaxNumber-hrp2::contact::nbModeledMax) : size;
+        }
+      };
+
+
+      ///read-only views on the components of a state vector, they are
+      ///fixed-size maps on the data of the vector and do not copy it
+      class StateView
+      {
+      public:
+        explicit StateView(const Vector & x):
+          data_(x.data())
+        {}
+
+        ///view on a column of a batch of states
+        explicit StateView(const double * x):
+          data_(x)
+        {}
+
+        inline const double * data() const
+        {
+          return data_;
+        }
+
+        inline Eigen::Map<const Vector3> position() const
+        {
+          return Eigen::Map<const Vector3>(data_+state::pos);
+        }
+
+        inline Eigen::Map<const Vector3> orientation() const
+        {
+          return Eigen::Map<const Vector3>(data_+state::ori);
+        }
+
+        inline Eigen::Map<const Vector3> linVelocity() const
+        {
+          return Eigen::Map<const Vector3>(data_+state::linVel);
+        }
+
+        inline Eigen::Map<const Vector3> angVelocity() const
+        {
+          return Eigen::Map<const Vector3>(data_+state::angVel);
+        }
+
+        ///forces and moments of the contact i
+        inline Eigen::Map<const Vector6> contactWrench(unsigned i) const
+        {
+          return Eigen::Map<const Vector6>(data_+state::fcIndex(i));
+        }
+
+        inline Eigen::Map<const Vector3> unmodeledForce() const
+        {
+          return Eigen::Map<const Vector3>(data_+state::unmodeledForces);
+        }
+
+        inline Eigen::Map<const Vector3> unmodeledMoment() const
+        {
+          return Eigen::Map<const Vector3>(data_+state::unmodeledForces+3);
+        }
+
+        ///the bias of the CoM is along the x and y axes only
+        inline Eigen::Map<const Eigen::Vector2d> comBias() const
+        {
+          return Eigen::Map<const Eigen::Vector2d>(data_+state::comBias);
+        }
+
+        inline Eigen::Map<const Vector3> drift() const
+        {
+          return Eigen::Map<const Vector3>(data_+state::drift);
+        }
+
+      protected:
+        const double * data_;
       };
 
+      ///read-only views on the components of an input vector, they are
+      ///fixed-size maps on the data of the vector and do not copy it
+      class InputView
+      {
+      public:
+        explicit InputView(const Vector & u):
+          data_(u.data())
+        {}
+
+        ///view on a column of a batch of inputs
+        explicit InputView(const double * u):
+          data_(u)
+        {}
+
+        inline const double * data() const
+        {
+          return data_;
+        }
+
+        inline Eigen::Map<const Vector3> positionCom() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::posCom);
+        }
+
+        inline Eigen::Map<const Vector3> velocityCom() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::velCom);
+        }
+
+        inline Eigen::Map<const Vector3> accelerationCom() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::accCom);
+        }
+
+        inline Eigen::Map<const Vector6> inertia() const
+        {
+          return Eigen::Map<const Vector6>(data_+input::inertia);
+        }
+
+        inline Eigen::Map<const Vector3> angMomentum() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::angMoment);
+        }
+
+        inline Eigen::Map<const Vector6> dotInertia() const
+        {
+          return Eigen::Map<const Vector6>(data_+input::dotInertia);
+        }
+
+        inline Eigen::Map<const Vector3> dotAngMomentum() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::dotAngMoment);
+        }
+
+        inline Eigen::Map<const Vector3> positionIMU() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::posIMU);
+        }
+
+        inline Eigen::Map<const Vector3> orientationIMU() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::oriIMU);
+        }
+
+        inline Eigen::Map<const Vector3> linVelocityIMU() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::linVelIMU);
+        }
+
+        inline Eigen::Map<const Vector3> angVelocityIMU() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::angVelIMU);
+        }
+
+        inline Eigen::Map<const Vector3> linAccelerationIMU() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::linAccIMU);
+        }
+
+        inline Eigen::Map<const Vector3> additionalForce() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::additionalForces);
+        }
+
+        inline Eigen::Map<const Vector3> additionalMoment() const
+        {
+          return Eigen::Map<const Vector3>(data_+input::additionalForces+3);
+        }
+
+        inline Eigen::Map<const Vector3> contactPosition(unsigned i) const
+        {
+          return Eigen::Map<const Vector3>(data_+input::contacts+12*i);
+        }
+
+        inline Eigen::Map<const Vector3> contactOrientation(unsigned i) const
+        {
+          return Eigen::Map<const Vector3>(data_+input::contacts+12*i+3);
+        }
+
+        inline Eigen::Map<const Vector3> contactVelocity(unsigned i) const
+        {
+          return Eigen::Map<const Vector3>(data_+input::contacts+12*i+6);
+        }
+
+        inline Eigen::Map<const Vector3> contactAngVelocity(unsigned i) const
+        {
+          return Eigen::Map<const Vector3>(data_+input::contacts+12*i+9);
+        }
+
+      protected:
+        const double * data_;
+      };
 
       struct contactModel
       {
@@ -83,11 +284,25 @@ namespace stateObservation
 
       };
 
+      struct integrator
+      {
+        ///integration schemes of the state dynamics
+        static const unsigned euler= 0;
+        static const unsigned semiImplicitEuler= 1;
+        static const unsigned rk4= 2;
+        ///semi-implicit Euler with a number of substeps chosen from the
+        ///stiffness and the damping of the contacts
+        static const unsigned adaptive= 3;
+      };
+
 
       typedef Eigen::LLT<Matrix3> LLTMatrix3;
 
-      ///constructor
-      explicit IMUElasticLocalFrameDynamicalSystem(double dt);
+      ///constructor, contactsMaxNumber is the number of contacts modeled in
+      ///the state, at least hrp2::contact::nbModeledMax and at most
+      ///hrp2::contact::nbMax
+      explicit IMUElasticLocalFrameDynamicalSystem
+      (double dt, unsigned contactsMaxNumber=hrp2::contact::nbModeledMax);
 
       ///virtual destructor
       virtual ~IMUElasticLocalFrameDynamicalSystem();
@@ -103,8 +318,13 @@ namespace stateObservation
 
       stateObservation::Vector computeAccelerations(const Vector& x,const Vector& u);
 
+      ///The computations of the accelerations, of the contact forces and
+      ///the integration steps below are not virtual: the state dynamics
+      ///use their specializations for the contact model (see
+      ///selectContactModel_), so an override would not be taken into account
+
       // computation of the acceleration linear
-      virtual void computeAccelerations
+      void computeAccelerations
       (const Vector3& positionCom, const Vector3& velocityCom,
        const Vector3& accelerationCom, const Vector3& AngMomentum,
        const Vector3& dotAngMomentum,
@@ -134,12 +354,38 @@ namespace stateObservation
       ///sets the finite differences derivation step vector
       void setFDstep(const stateObservation::Vector & dx);
 
+      ///compute the jacobien of the state dynamics at the last computed value
+      ///with finite differences
+      stateObservation::Matrix stateDynamicsJacobianFD();
+
 
       ///Description of the sensor's dynamics
       virtual stateObservation::Vector measureDynamics
       (const stateObservation::Vector& x, const stateObservation::Vector& u,
        TimeIndex k);
 
+      ///Description of the state dynamics, written in xk1
+      virtual void computeStateDynamics
+      (const stateObservation::Vector& x, const stateObservation::Vector& u,
+       TimeIndex k, stateObservation::Vector& xk1);
+
+      ///Description of the sensor's dynamics, written in y
+      virtual void computeMeasureDynamics
+      (const stateObservation::Vector& x, const stateObservation::Vector& u,
+       TimeIndex k, stateObservation::Vector& y);
+
+      ///Description of the state dynamics of several states, a shared input
+      ///is read only once. The jacobians remain computed at the last call of
+      ///stateDynamics
+      virtual void stateDynamicsBatch
+      (const Matrix& x, const Matrix& u, TimeIndex k, Matrix& xk1);
+
+      ///Description of the sensor's dynamics for several states, a shared
+      ///input is read only once. The jacobians remain computed at the last
+      ///call of measureDynamics
+      virtual void measureDynamicsBatch
+      (const Matrix& x, const Matrix& u, TimeIndex k, Matrix& y);
+
       ///compute the Jacobien of the measurements dynamics at the last computed value
       stateObservation::Matrix measureDynamicsJacobian();
 
@@ -147,6 +393,16 @@ namespace stateObservation
       stateObservation::Matrix measureDynamicsJacobian(const stateObservation::Vector& x, const stateObservation::Vector& u,
        TimeIndex k);
 
+      ///compute the Jacobien of the measurements dynamics at the last computed value
+      ///with finite differences
+      stateObservation::Matrix measureDynamicsJacobianFD();
+
+      ///sets whether the jacobians are computed in closed form (default) or with
+      ///finite differences. The closed form is available for the elastic contact
+      ///model only, the finite differences are used for the other models.
+      void setAnalyticalJacobians(bool b);
+      bool getAnalyticalJacobians() const;
+
       ///Sets a noise which disturbs the state dynamics
       virtual void setProcessNoise( stateObservation::NoiseBase * );
 
@@ -168,6 +424,9 @@ namespace stateObservation
       ///Set the period of the time discretization
       virtual void setSamplingPeriod(double dt);
 
+      ///Gets the period of the time discretization
+      double getSamplingPeriod() const;
+
       ///Gets the state size
       virtual unsigned getStateSize() const;
 
@@ -188,11 +447,22 @@ namespace stateObservation
       ///Sets the number of contacts
       virtual void setContactsNumber(unsigned);
 
+      ///Gets the number of contacts modeled in the state
+      inline unsigned getContactsMaxNumber() const
+      {
+        return contactsMaxNumber_;
+      }
+
       virtual void setPe(stateObservation::Vector3 Pe)
       {
           pe=Pe;
       }
 
+      inline const Vector3 & getPe() const
+      {
+          return pe;
+      }
+
       ///Gets the nimber of contacts
       inline unsigned getContactsNumber(void) const
       {
@@ -201,12 +471,21 @@ namespace stateObservation
 
       virtual void setContactModel(unsigned nb);
 
+      inline unsigned getContactModel() const
+      {
+        return contactModel_;
+      }
+
+      ///number of contact force slots of the state used by the contact model,
+      ///the forces of the other slots are zero and are skipped
+      unsigned getForceSlotsNumber() const;
+
       virtual void setPrinted(bool b)
       {
           printed_ = b;
       }
 
-      virtual void computeElastContactForcesAndMoments
+      void computeElastContactForcesAndMoments
       (const IndexedVectorArray& contactPosArray,
        const IndexedVectorArray& contactOriArray,
        const IndexedVectorArray& contactVelArray,
@@ -216,7 +495,7 @@ namespace stateObservation
        const Vector3& angVel,
        Vector& fc, Vector& tc);
 
-      virtual void computeElastPendulumForcesAndMoments
+      void computeElastPendulumForcesAndMoments
       (const IndexedVectorArray& PrArray,
        const Vector3& position, const Vector3& linVelocity,
        const Vector3& oriVector, const Matrix3& orientation,
@@ -233,7 +512,7 @@ namespace stateObservation
        const Vector3& angVel,
        Vector& fc, Vector& tc);
 
-      virtual void computeForcesAndMoments
+      void computeForcesAndMoments
       (const Vector& x,
        const Vector& u);
 
@@ -246,7 +525,7 @@ namespace stateObservation
       virtual Vector getMomentaDotFromForces(const Vector& x, const Vector& u);
       virtual Vector getMomentaDotFromKinematics(const Vector& x, const Vector& u);
 
-      virtual void iterateDynamicsEuler
+      void iterateDynamicsEuler
       (const Vector3& positionCom, const Vector3& velocityCom,
        const Vector3& accelerationCom, const Vector3& AngMomentum,
        const Vector3& dotAngMomentum,
@@ -260,7 +539,7 @@ namespace stateObservation
        double dt
       );
 
-      virtual void iterateDynamicsRK4
+      void iterateDynamicsSemiImplicitEuler
       (const Vector3& positionCom, const Vector3& velocityCom,
        const Vector3& accelerationCom, const Vector3& AngMomentum,
        const Vector3& dotAngMomentum,
@@ -274,6 +553,46 @@ namespace stateObservation
        double dt
       );
 
+      void iterateDynamicsRK4
+      (const Vector3& positionCom, const Vector3& velocityCom,
+       const Vector3& accelerationCom, const Vector3& AngMomentum,
+       const Vector3& dotAngMomentum,
+       const Matrix3& Inertia, const Matrix3& dotInertia,
+       const IndexedVectorArray& contactPos,
+       const IndexedVectorArray& contactOri,
+       Vector3& position, Vector3& linVelocity, Vector& fc1,
+       Vector3 &oriVector, Vector3& angularVel, Vector& fc2,
+       const Vector3 & fm, const Vector3& tm,
+       const Vector3 & addForces, const Vector3& addMoments,
+       double dt
+      );
+
+      ///sets the integration scheme of the state dynamics (see integrator),
+      ///the closed-form jacobians are available for the Euler scheme
+      ///without subsampling only
+      void setIntegrator(unsigned i);
+      unsigned getIntegrator() const;
+
+      ///sets the number of integration substeps in a sampling period, it is
+      ///not used by the adaptive integrator
+      void setIntegrationSubsampling(unsigned n);
+      unsigned getIntegrationSubsampling() const;
+
+      ///sets the ratio between the substep of the adaptive integrator and
+      ///the smallest time constant of the contacts
+      void setAdaptiveIntegrationFactor(double factor);
+      double getAdaptiveIntegrationFactor() const;
+
+      ///number of evaluations of the accelerations done by the integration
+      ///in the last call of stateDynamics
+      inline unsigned getIntegrationEvaluationsNumber() const
+      {
+        return integrationEvaluations_;
+      }
+
+      ///Gets the cache of the rotations and its hit rate
+      const kine::RotationCache & getRotationCache() const;
+
       virtual void setWithForceMeasurements(bool b);
       virtual bool getWithForceMeasurements() const;
       virtual void setWithComBias(bool b);
@@ -298,6 +617,11 @@ namespace stateObservation
       virtual Matrix getKte() const;
       virtual Matrix getKtv() const;
 
+      virtual Matrix getKfeRopes() const;
+      virtual Matrix getKfvRopes() const;
+      virtual Matrix getKteRopes() const;
+      virtual Matrix getKtvRopes() const;
+
       virtual void setRobotMass(double d);
 
       virtual double getRobotMass() const;
@@ -317,9 +641,184 @@ namespace stateObservation
       double robotMass_;
       double robotMassInv_;
 
-      Matrix3& computeRotation_(const Vector3 & x, int i);
+      ///conversions of the orientation vectors: the flexibility (slot 0),
+      ///the IMU (slot 1) and then the contacts
+      kine::RotationCache rotationCache_;
+
+      inline const Matrix3& computeRotation_(const Vector3 & x, int i);
+
+      ///copies the positions and orientations of the contacts, and their
+      ///velocities if required, in the arrays of op_ without allocation
+      void readContacts_(const InputView & u, bool withVelocities);
+
+      ///copies the forces and moments of the active contacts in op_.efforts,
+      ///fc_ and tc_
+      void readContactWrenches_(const StateView & x);
+
+      ///reads the parts of the input used by the state dynamics which do not
+      ///depend on the state
+      void readStateInput_(const InputView & u);
+
+      ///computes the next state from x, the input must have been read with
+      ///readStateInput_
+      void computeStateDynamics_(const StateView & x, const InputView & u, double * xk1);
+
+      ///reads the parts of the input used by the measurements which do not
+      ///depend on the state
+      void readMeasurementInput_(const InputView & u);
+
+      ///sets the state of the sensor from x, the input must have been read
+      ///with readMeasurementInput_
+      void computeMeasurement_(const StateView & x, const InputView & u, TimeIndex k);
+
+      ///closed-form jacobians, they use the intermediate values of the last
+      ///call of computeAccelerations
+      void computeAccelerationsJacobian_(const Vector3 & position, const Vector3 & oriVector,
+                                         const Vector3 & angularVel, bool withComBiasColumns);
+      void setAccelerationsJacobianColumns_(unsigned col, unsigned cols,
+                                            const Matrix3 & dvf, const Matrix3 & dvt,
+                                            const Matrix3 & dRc, const Matrix3 & dRcp,
+                                            const Matrix3 & dMalpha);
+      void stateDynamicsJacobianAnalytical_();
+      void measureDynamicsJacobianAnalytical_();
+
+      ///computations specialized for each contact model at compile time,
+      ///setContactModel selects the specialization. The specializations
+      ///call each other directly: the integration of the state dynamics
+      ///goes through a single indirect call and the contact computations
+      ///are inlined in the integrators. The public computations forward to
+      ///the selected specialization.
+      template <unsigned model>
+      void selectContactModel_();
+
+      template <unsigned model>
+      void computeContactWrench_
+      (const Matrix3& orientation, const Vector3& position,
+       const IndexedVectorArray& contactPosV, const IndexedVectorArray& contactOriV,
+       const Vector& fc, const Vector& tc, const Vector3 & fm, const Vector3& tm,
+       const Vector3& addForce, const Vector3 & addMoment);
+
+      template <unsigned model>
+      void computeForcesAndMoments_
+      (const IndexedVectorArray& position1,
+       const IndexedVectorArray& position2,
+       const IndexedVectorArray& velocity1,
+       const IndexedVectorArray& velocity2,
+       const Vector3& position, const Vector3& linVelocity,
+       const Vector3& oriVector, const Matrix3& orientation,
+       const Vector3& angVel,
+       Vector& fc, Vector& tc);
+
+      template <unsigned model>
+      void computeAccelerations_
+      (const Vector3& positionCom, const Vector3& velocityCom,
+       const Vector3& accelerationCom, const Vector3& AngMomentum,
+       const Vector3& dotAngMomentum,
+       const Matrix3& Inertia, const Matrix3& dotInertia,
+       const IndexedVectorArray& contactPos,
+       const IndexedVectorArray& contactOri,
+       const Vector3& position, const Vector3& linVelocity,
+       Vector3& linearAcceleration,  const Vector3& oriVector ,
+       const Matrix3& orientation, const Vector3& angularVel,
+       Vector3& angularAcceleration,
+       const Vector& fc, const Vector& tc,
+       const Vector3 & fm, const Vector3& tm,
+       const Vector3 & addForces, const Vector3& addMoments);
+
+      template <unsigned model>
+      void iterateDynamicsEuler_
+      (const Vector3& positionCom, const Vector3& velocityCom,
+       const Vector3& accelerationCom, const Vector3& AngMomentum,
+       const Vector3& dotAngMomentum,
+       const Matrix3& Inertia, const Matrix3& dotInertia,
+       const IndexedVectorArray& contactPos,
+       const IndexedVectorArray& contactOri,
+       Vector3& position, Vector3& linVelocity, Vector& fc1,
+       Vector3 &oriVector, Vector3& angularVel, Vector& fc2,
+       const Vector3 & fm, const Vector3& tm,
+       const Vector3 & addForces, const Vector3& addMoments,
+       double dt);
 
-      static const unsigned stateSize_=state::size;
+      template <unsigned model>
+      void iterateDynamicsSemiImplicitEuler_
+      (const Vector3& positionCom, const Vector3& velocityCom,
+       const Vector3& accelerationCom, const Vector3& AngMomentum,
+       const Vector3& dotAngMomentum,
+       const Matrix3& Inertia, const Matrix3& dotInertia,
+       const IndexedVectorArray& contactPos,
+       const IndexedVectorArray& contactOri,
+       Vector3& position, Vector3& linVelocity, Vector& fc1,
+       Vector3 &oriVector, Vector3& angularVel, Vector& fc2,
+       const Vector3 & fm, const Vector3& tm,
+       const Vector3 & addForces, const Vector3& addMoments,
+       double dt);
+
+      template <unsigned model>
+      void iterateDynamicsRK4_
+      (const Vector3& positionCom, const Vector3& velocityCom,
+       const Vector3& accelerationCom, const Vector3& AngMomentum,
+       const Vector3& dotAngMomentum,
+       const Matrix3& Inertia, const Matrix3& dotInertia,
+       const IndexedVectorArray& contactPos,
+       const IndexedVectorArray& contactOri,
+       Vector3& position, Vector3& linVelocity, Vector& fc1,
+       Vector3 &oriVector, Vector3& angularVel, Vector& fc2,
+       const Vector3 & fm, const Vector3& tm,
+       const Vector3 & addForces, const Vector3& addMoments,
+       double dt);
+
+      ///computeStateDynamics_ for the contact model
+      template <unsigned model>
+      void integrateStateDynamics_(const StateView & x, const InputView & u, double * xk1);
+
+      typedef void (IMUElasticLocalFrameDynamicalSystem::*ContactWrenchFunction)
+      (const Matrix3&, const Vector3&, const IndexedVectorArray&, const IndexedVectorArray&,
+       const Vector&, const Vector&, const Vector3&, const Vector3&,
+       const Vector3&, const Vector3&);
+
+      typedef void (IMUElasticLocalFrameDynamicalSystem::*ForcesAndMomentsFunction)
+      (const IndexedVectorArray&, const IndexedVectorArray&,
+       const IndexedVectorArray&, const IndexedVectorArray&,
+       const Vector3&, const Vector3&, const Vector3&, const Matrix3&,
+       const Vector3&, Vector&, Vector&);
+
+      typedef void (IMUElasticLocalFrameDynamicalSystem::*AccelerationsFunction)
+      (const Vector3&, const Vector3&, const Vector3&, const Vector3&, const Vector3&,
+       const Matrix3&, const Matrix3&, const IndexedVectorArray&, const IndexedVectorArray&,
+       const Vector3&, const Vector3&, Vector3&, const Vector3&, const Matrix3&,
+       const Vector3&, Vector3&, const Vector&, const Vector&, const Vector3&,
+       const Vector3&, const Vector3&, const Vector3&);
+
+      typedef void (IMUElasticLocalFrameDynamicalSystem::*IntegrationStepFunction)
+      (const Vector3&, const Vector3&, const Vector3&, const Vector3&, const Vector3&,
+       const Matrix3&, const Matrix3&, const IndexedVectorArray&, const IndexedVectorArray&,
+       Vector3&, Vector3&, Vector&, Vector3&, Vector3&, Vector&,
+       const Vector3&, const Vector3&, const Vector3&, const Vector3&, double);
+
+      typedef void (IMUElasticLocalFrameDynamicalSystem::*StateDynamicsFunction)
+      (const StateView&, const InputView&, double*);
+
+      ContactWrenchFunction contactWrench_;
+      ForcesAndMomentsFunction forcesAndMoments_;
+      AccelerationsFunction accelerations_;
+      IntegrationStepFunction eulerStep_;
+      IntegrationStepFunction semiImplicitEulerStep_;
+      IntegrationStepFunction rk4Step_;
+      StateDynamicsFunction stateDynamics_;
+
+      ///number of substeps of the adaptive integrator
+      unsigned computeAdaptiveSubsampling_() const;
+
+      ///whether the closed-form state jacobian matches the contact model
+      ///and the integration scheme
+      bool analyticalStateJacobianAvailable_() const;
+
+      ///finite differences of the column i of the jacobians
+      void stateDynamicsJacobianColumnFD_(unsigned i);
+      void measureDynamicsJacobianColumnFD_(unsigned i);
+
+      unsigned contactsMaxNumber_;
+      unsigned stateSize_;
       unsigned inputSize_;
       static const unsigned measurementSizeBase_=6;
       unsigned nbContacts_;
@@ -352,6 +851,13 @@ namespace stateObservation
       bool withComBias_;
       bool withAbsolutePos_;
       bool withUnmodeledForces_;
+      bool analyticalJacobians_;
+
+      unsigned integrator_;
+      unsigned integrationSubsampling_;
+      double adaptiveIntegrationFactor_;
+      unsigned integrationEvaluations_;
+      static const unsigned adaptiveIntegrationMaxSubsampling_=100;
 
       stateObservation::Vector3 pe;
 
@@ -411,6 +917,15 @@ namespace stateObservation
         Matrix Jx;
         Matrix Jy;
 
+        //closed-form jacobians
+        Eigen::Matrix<double,6,Eigen::Dynamic> Jacc; //linear and angular accelerations
+        Eigen::Matrix<double,3,Eigen::Dynamic> Jrot; //left variation of the orientation
+        Eigen::Matrix<double,3,Eigen::Dynamic> Jpos;
+        Eigen::Matrix<double,3,Eigen::Dynamic> Jvel;
+        Eigen::Matrix<double,3,Eigen::Dynamic> JangVel;
+        Eigen::Matrix<double,3,Eigen::Dynamic> Jtemp;
+        Matrix3 Jori; //left jacobian of the rotation vector
+
         Matrix3 rimu;
         Vector3 imuAcc;
         Vector3 imuOmega;
@@ -482,55 +997,28 @@ namespace stateObservation
         Vector3 Ra;
         Vector3 Rc;
         Vector3 Rcp;
+      } op_;
 
-        //optimization of orientation transformation between vector3 to rotation matrix
-
-        Matrix3 curRotation0;
-        Vector3 orientationVector0;
-        Matrix3 curRotation1;
-        Vector3 orientationVector1;
-        Matrix3 curRotation2;
-        Vector3 orientationVector2;
-        Matrix3 curRotation3;
-        Vector3 orientationVector3;
-
-        Optimization()
-          :
-          curRotation0(Matrix3::Identity()),
-          orientationVector0(Vector3::Zero()),
-          curRotation1(Matrix3::Identity()),
-          orientationVector1(Vector3::Zero()),
-          curRotation2(Matrix3::Identity()),
-          orientationVector2(Vector3::Zero()),
-          curRotation3(Matrix3::Identity()),
-          orientationVector3(Vector3::Zero())
-        {}
+      ///containers whose sizes depend on the number of contacts
+      struct ContactsContainers
+      {
+        Vector uk;
+        Vector ukFory;
+        Vector yk;
+        Vector ykdy;
+        Vector sensorState;
+        Matrix Jy;
+      };
 
-        inline Vector3& orientationVector(int i)
-        {
-          if (i==0)
-            return orientationVector0;
-          if (i==1)
-            return orientationVector1;
-          if (i==2)
-            return orientationVector2;
-
-          return orientationVector3;
-        }
+      ///containers of the other numbers of contacts, indexed by the number,
+      ///they are swapped in when the number changes to avoid allocations
+      std::vector<ContactsContainers> contactsContainers_;
 
-        inline Matrix3& curRotation(int i)
-        {
-          if (i==0)
-            return curRotation0;
-          if (i==1)
-            return curRotation1;
-          if (i==2)
-            return curRotation2;
-
-          return curRotation3;
-        }
+      ///exchanges the current containers with c in constant time
+      void swapContactsContainers_(ContactsContainers & c);
 
-      } op_;
+      ///sets the sizes of the current containers
+      void resizeContactsContainers_();
 
     public:
       EIGEN_MAKE_ALIGNED_OPERATOR_NEW
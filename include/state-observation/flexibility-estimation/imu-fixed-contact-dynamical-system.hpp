@@ -18,6 +18,7 @@
 #include <state-observation/noise/noise-base.hpp>
 #include <state-observation/sensors-simulation/accelerometer-gyrometer.hpp>
 #include <state-observation/tools/rigid-body-kinematics.hpp>
+#include <state-observation/tools/rotation-cache.hpp>
 
 namespace stateObservation
 {
@@ -79,6 +80,9 @@ namespace flexibilityEstimation
         ///Gets the measurement size
         virtual unsigned getMeasurementSize() const;
 
+        ///Gets the cache of the rotations and its hit rate
+        const kine::RotationCache & getRotationCache() const;
+
         ///Sets the number of contacts
         virtual void setContactsNumber(unsigned);
 
@@ -95,10 +99,11 @@ namespace flexibilityEstimation
 
         double dt_;
 
-        Vector3Unaligned orientationVector_;
-        QuaternionUnaligned quaternion_;
+        ///conversions of the orientation vectors, the slot 0 is used for
+        ///the flexibility and the slot 1 for the control
+        kine::RotationCache rotationCache_;
 
-        Quaternion computeQuaternion_(const Vector3 & x);
+        Quaternion computeQuaternion_(const Vector3 & x, unsigned slot=0);
 
         static const unsigned stateSize_=18;
         static const unsigned inputSize_=15;
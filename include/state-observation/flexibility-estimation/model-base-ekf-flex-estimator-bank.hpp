@@ -0,0 +1,186 @@
+/**
+ * \file      model-base-ekf-flex-estimator-bank.hpp
+ * \brief     Declares a bank of flexibility estimators with different
+ *            contact hypotheses running in parallel
+ *
+ * \details
+ *
+ *
+ */
+
+
+#ifndef FLEXBILITYESTMATOR_MODELBASEEKFFLEXIBILITYESTIMATORBANK_H
+#define FLEXBILITYESTMATOR_MODELBASEEKFFLEXIBILITYESTIMATORBANK_H
+
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-imu.hpp>
+
+namespace stateObservation
+{
+namespace flexibilityEstimation
+{
+
+    /**
+    * \class  ModelBaseEKFFlexEstimatorBank
+    * \brief  Runs several ModelBaseEKFFlexEstimatorIMU with different contact
+    *         hypotheses on a pool of worker threads, so that an estimation
+    *         takes the time of a single estimator when there are enough
+    *         threads. The probability of each hypothesis is updated with the
+    *         log-likelihood of the innovations of its filter, forgotten over
+    *         a window of samples, and the flexibility is either the one of
+    *         the most likely hypothesis or the mixture of all of them.
+    *         The likelihoods can only be compared between hypotheses with
+    *         the same measurements (e.g. no force sensors, or force sensors
+    *         on the same contacts).
+    *
+    */
+    class ModelBaseEKFFlexEstimatorBank : private boost::noncopyable
+    {
+    public:
+        struct selection
+        {
+            ///the flexibility of the most likely hypothesis
+            static const unsigned mostLikely= 0;
+            ///the mean of the flexibilities weighted by the probabilities
+            ///of the hypotheses, the orientations are averaged linearly
+            static const unsigned mixture= 1;
+        };
+
+        ///default number of samples of the window of the likelihoods
+        static const unsigned defaultWindowLength= 50;
+
+        ///the estimators of the hypotheses have the sampling period dt and
+        ///model contactsMaxNumber contacts in their state
+        explicit ModelBaseEKFFlexEstimatorBank
+        ( double dt=0.005, unsigned contactsMaxNumber=hrp2::contact::nbModeledMax );
+
+        ///stops the worker threads
+        virtual ~ModelBaseEKFFlexEstimatorBank();
+
+        ///adds an estimator with the hypothesis of the number of contacts
+        ///and gives its index, the estimator can then be set using
+        ///getEstimator. By default there is a worker thread per
+        ///hypothesis but the first one, which runs in the calling thread,
+        ///within the number of cores.
+        unsigned addHypothesis(unsigned contactsNumber);
+
+        unsigned getHypothesesNumber() const
+        {
+            return unsigned(estimators_.size());
+        }
+
+        ModelBaseEKFFlexEstimatorIMU & getEstimator(unsigned i);
+        const ModelBaseEKFFlexEstimatorIMU & getEstimator(unsigned i) const;
+
+        ///sets the number of worker threads, the calling thread runs the
+        ///estimators too. Zero runs all the estimators in the calling thread.
+        void setThreadsNumber(unsigned n);
+
+        unsigned getThreadsNumber() const
+        {
+            return unsigned(threads_.size());
+        }
+
+        ///gives the measurement y_{k+1} to all the hypotheses
+        void setMeasurement(const Vector & y);
+
+        ///gives the measurement y_{k+1} to the hypothesis i
+        void setMeasurement(unsigned i, const Vector & y);
+
+        ///sets the input u_k of the hypothesis i
+        void setInput(unsigned i, const Vector & u);
+
+        ///sets the input of the measurements of the hypothesis i
+        void setMeasurementInput(unsigned i, const Vector & u);
+
+        ///sets how the flexibility is given (see selection)
+        void setSelection(unsigned s);
+
+        unsigned getSelection() const
+        {
+            return selection_;
+        }
+
+        ///sets the number of samples after which the likelihoods are
+        ///forgotten (at least one)
+        void setLikelihoodWindowLength(double samples);
+
+        double getLikelihoodWindowLength() const
+        {
+            return windowLength_;
+        }
+
+        ///sets the same probability to all the hypotheses
+        void resetProbabilities();
+
+        ///runs the estimators of the hypotheses in parallel, updates their
+        ///probabilities and gives the selected or mixed flexibility
+        const Vector & getFlexibilityVector();
+
+        ///probabilities of the hypotheses after the last estimation
+        const Vector & getProbabilities() const
+        {
+            return probabilities_;
+        }
+
+        ///index of the most likely hypothesis after the last estimation
+        unsigned getMostLikelyHypothesis() const
+        {
+            return mostLikely_;
+        }
+
+    protected:
+        ///runs the estimators of one slot: the hypotheses whose index
+        ///modulo the number of slots is the slot
+        void estimate_(unsigned slot);
+
+        ///loop of the worker thread of a slot, generation is the last
+        ///generation of estimations when the thread is created
+        void work_(unsigned slot, unsigned generation);
+
+        void startThreads_(unsigned n);
+        void stopThreads_();
+
+        ///updates the probabilities with the likelihoods of the estimations
+        void updateProbabilities_();
+
+        double dt_;
+        unsigned contactsMaxNumber_;
+
+        std::vector<ModelBaseEKFFlexEstimatorIMU *> estimators_;
+
+        ///results of the estimations of each hypothesis
+        std::vector<const Vector *> flexibilities_;
+        std::vector<double> logLikelihoods_;
+        std::vector<TimeIndex> samples_;
+
+        Vector logWeights_;
+        Vector probabilities_;
+        unsigned mostLikely_;
+
+        unsigned selection_;
+        double windowLength_;
+        double lambda_;
+
+        bool automaticThreads_;
+        std::vector<boost::thread *> threads_;
+
+        ///synchronization of the workers
+        boost::mutex mutex_;
+        boost::condition_variable wakeUp_;
+        boost::condition_variable done_;
+        unsigned generation_;
+        unsigned pending_;
+        bool stop_;
+
+        Vector x_;
+    };
+
+}
+}
+#endif // FLEXBILITYESTMATOR_MODELBASEEKFFLEXIBILITYESTIMATORBANK_H
@@ -17,6 +17,8 @@
 #include <state-observation/flexibility-estimation/ekf-flexibility-estimator-base.hpp>
 //#include <state-observation/flexibility-estimation/stable-imu-fixed-contact-dynamical-system.hpp>
 #include <state-observation/flexibility-estimation/imu-elastic-local-frame-dynamical-system.hpp>
+#include <state-observation/tools/observability-gramian.hpp>
+#include <state-observation/tools/checkpoint.hpp>
 //#include <state-observation/flexibility-estimation/imu-fixed-contact-dynamical-system.hpp>
 
 namespace stateObservation
@@ -49,8 +51,27 @@ namespace flexibilityEstimation
 
         };
 
+        typedef IMUElasticLocalFrameDynamicalSystem::integrator integrator;
+
+        struct degradation
+        {
+          ///flags of the degradations of the estimation when the deadline
+          ///is short (see setDeadline)
+          static const unsigned none= 0;
+          ///the Jacobians of the previous step were reused
+          static const unsigned reusedJacobians= 1;
+          ///only the mean was predicted for some samples, their measurements
+          ///were not used and their covariance is only increased by Q
+          static const unsigned meanOnly= 2;
+          ///the deadline was exceeded despite the degradations
+          static const unsigned deadlineExceeded= 4;
+        };
+
         ///The constructor, it requires the value of the time discretization period
-        explicit ModelBaseEKFFlexEstimatorIMU( double dt=0.005 );
+        ///and the number of contacts modeled in the state, which sets the
+        ///state size (see IMUElasticLocalFrameDynamicalSystem::state)
+        explicit ModelBaseEKFFlexEstimatorIMU
+        ( double dt=0.005, unsigned contactsMaxNumber=hrp2::contact::nbModeledMax );
 
         ///Virtual destructor
         virtual ~ModelBaseEKFFlexEstimatorIMU();
@@ -63,6 +84,12 @@ namespace flexibilityEstimation
             return functor_.getContactsNumber();
         }
 
+        ///Gets the number of contacts modeled in the state
+        unsigned getContactsMaxNumber() const
+        {
+            return functor_.getContactsMaxNumber();
+        }
+
         IMUElasticLocalFrameDynamicalSystem getFunctor()
         {
             return functor_;
@@ -75,6 +102,25 @@ namespace flexibilityEstimation
 
         void setContactModel(unsigned nb);
 
+        ///Sets the integration scheme of the dynamics (see integrator)
+        void setIntegrator(unsigned i)
+        {
+            functor_.setIntegrator(i);
+        }
+
+        ///Sets the number of integration substeps in a sampling period
+        void setIntegrationSubsampling(unsigned n)
+        {
+            functor_.setIntegrationSubsampling(n);
+        }
+
+        ///Sets the ratio between the substep of the adaptive integrator and
+        ///the smallest time constant of the contacts
+        void setAdaptiveIntegrationFactor(double factor)
+        {
+            functor_.setAdaptiveIntegrationFactor(factor);
+        }
+
         /// Sets the value of the next sensor measurement y_{k+1}
         virtual void setMeasurement(const Vector & y);
 
@@ -115,6 +161,47 @@ namespace flexibilityEstimation
         /// Gets an estimation of the flexibility in the form of a state vector \hat{x_{k+1}}
         virtual const Vector& getFlexibilityVector();
 
+        ///sets the time budget (in seconds) of the estimation of the pending
+        ///samples by getFlexibilityVector(). When the steps would exceed
+        ///it, the Jacobians are reused, then the intermediate samples only
+        ///predict the mean and the last one is always estimated.
+        ///Zero (the default) disables the deadline.
+        void setDeadline(double seconds);
+
+        double getDeadline() const
+        {
+            return deadline_;
+        }
+
+        ///gives the degradations of the last estimation (combination of the
+        ///flags of degradation)
+        unsigned getDegradations() const
+        {
+            return degradations_;
+        }
+
+        ///gives the log-likelihood of the measurements used by the last
+        ///estimation, sum of the log-likelihoods of the innovations of the
+        ///filter (the samples which only predicted the mean are not counted).
+        ///It is zero unless the likelihood monitoring is enabled
+        double getInnovationLogLikelihood() const
+        {
+            return innovationLogLikelihood_;
+        }
+
+        ///enables the computation of the log-likelihood of the innovations
+        ///at each estimation step
+        void setLikelihoodMonitoring(bool b)
+        {
+            likelihoodMonitoring_=b;
+        }
+
+        bool getLikelihoodMonitoring() const
+        {
+            return likelihoodMonitoring_;
+        }
+
+        ///gives the local observation matrix [C ; CA] of the last Jacobians
         virtual stateObservation::Matrix& computeLocalObservationMatrix();
         virtual stateObservation::Matrix getAMatrix()
         {
@@ -126,6 +213,43 @@ namespace flexibilityEstimation
             return ekf_.getC();
         }
 
+        ///enables the update of the observability Gramian at each estimation
+        ///step, with the Jacobians of the filter
+        void setObservabilityMonitoring(bool b);
+
+        bool getObservabilityMonitoring() const
+        {
+            return observabilityMonitoring_;
+        }
+
+        ///sets the number of steps of the window of the observability Gramian
+        void setObservabilityWindowLength(double steps)
+        {
+            observabilityGramian_.setWindowLength(steps);
+        }
+
+        const tools::ObservabilityGramian & getObservabilityGramian() const
+        {
+            return observabilityGramian_;
+        }
+
+        ///estimates the condition number of the observability Gramian
+        ///(infinite when the state is not observable over the window)
+        double getObservabilityConditionNumber()
+        {
+            return observabilityGramian_.estimateConditionNumber();
+        }
+
+        ///writes the whole state of the estimator in the checkpoint: the
+        ///configuration of the contacts and of the model, the stiffnesses,
+        ///the covariances, the state and the pending inputs and measurements
+        void saveCheckpoint(tools::Checkpoint & c) const;
+
+        ///restores a state written by saveCheckpoint, possibly by another
+        ///estimator modeling the same number of contacts. The whole
+        ///checkpoint is read before the estimator is modified.
+        void restoreCheckpoint(tools::Checkpoint & c);
+
 
         virtual unsigned getMeasurementSize() const ;
 
@@ -238,7 +362,7 @@ namespace flexibilityEstimation
             return limitOn_;
         }
 
-        static Matrix getDefaultQ();
+        static Matrix getDefaultQ(unsigned contactsMaxNumber=hrp2::contact::nbModeledMax);
 
         static Matrix6 getDefaultRIMU();
 
@@ -246,16 +370,72 @@ namespace flexibilityEstimation
 
     protected:
 
+        ///computes the measurement covariance matrices and the containers of
+        ///the filter for every number of contacts with force measurements
         virtual void updateMeasurementCovarianceMatrix_();
 
+        ///gives to the filter the precomputed measurement containers of the
+        ///number of contacts, in constant time and without allocation
+        void switchMeasurementWorkspace_(unsigned contacts);
+
+        ///extracts from R_ the measurement covariance for a number of contacts
+        void getMeasurementCovariance_(unsigned contacts, Matrix & R) const;
+
+        ///writes in R_ the measurement covariance for a number of contacts
+        void setMeasurementCovariance_(unsigned contacts, const Matrix & R);
+
+        ///sets the force sensor variance to all the contacts
+        void updateForceVariance_();
+
+        ///chooses the kind of step of the sample i with respect to the
+        ///deadline, among the flags of degradation
+        unsigned selectStep_(TimeIndex i);
+
+        ///the content of a checkpoint, read before being restored
+        struct CheckpointData;
+
+        ///reads a checkpoint and checks that it matches the estimator
+        void readCheckpoint_(tools::Checkpoint & c, CheckpointData & d) const;
+
+        ///identifies the checkpoints of the estimator and their format
+        static const unsigned checkpointTag_=0x4d424546;
+        static const unsigned checkpointVersion_=1;
+
+        ///gives the process covariance to the filter without the inactive
+        ///contacts and restricts its update to the active ones
+        void updateProcessCovarianceMatrix_();
+
+        ///updates the state covariance after a change of the number of contacts,
+        ///the activated contacts start with their process covariance
+        void updateContactsCovariance_(unsigned previousForceSlots);
+
+        ///removes the rows and columns of the inactive contacts
+        void removeInactiveContacts_(Matrix & covariance) const;
+
         IMUElasticLocalFrameDynamicalSystem functor_;
 
         Vector x_;
 
+        ///R_ is the measurement covariance with the force measurements of
+        ///forceMeasurementsMax_ contacts and the absolute position
         Matrix R_,Q_,P_;
 
+        static const unsigned forceMeasurementsMax_=hrp2::contact::nbMax;
+
+        ///the measurement containers of the filter for each number of
+        ///contacts with force measurements, workspaceIndexes_ gives the
+        ///workspace of each number of contacts but the active one, whose
+        ///containers are in the filter
+        std::vector<ExtendedKalmanFilter::MeasurementWorkspace> measurementWorkspaces_;
+        std::vector<unsigned> workspaceIndexes_;
+        unsigned activeMeasurementContacts_;
+
         const unsigned stateSize_;
 
+        ///the ranges of the state estimated by the filter, which exclude
+        ///the slots of the inactive contacts
+        KalmanFilterBase::IndexRanges activeRanges_;
+
         static const unsigned measurementSizeBase_=12;
 
         static const unsigned inputSizeBase_=42;
@@ -278,10 +458,30 @@ namespace flexibilityEstimation
         Vector3 limitForces_;
         bool limitOn_;
 
+        double deadline_;
+        unsigned degradations_;
+
+        bool likelihoodMonitoring_;
+        double innovationLogLikelihood_;
+
+        ///durations (in seconds) of the last complete step and of its
+        ///Jacobians
+        double stepDuration_;
+        double jacobianDuration_;
+
+        ///the Jacobians of the filter match the current configuration
+        bool jacobiansSet_;
+
+        tools::SimplestStopwatch deadlineStopwatch_;
+        tools::SimplestStopwatch stepStopwatch_;
+
+        bool observabilityMonitoring_;
+        tools::ObservabilityGramian observabilityGramian_;
+
         struct optimization
         {
             stateObservation::Matrix O;
-            stateObservation::Matrix CA;
+            stateObservation::Matrix Q;
         }op_;
 
     private:
@@ -12,6 +12,7 @@
 #define SENSORSIMULATIONGAUSSIANWHITENOISEHPP
 
 #include <state-observation/noise/noise-base.hpp>
+#include <state-observation/tools/random-stream.hpp>
 
 namespace stateObservation
 {
@@ -21,6 +22,10 @@ namespace stateObservation
      * \brief The class derivates the NoiseBase class to implement a gaussian
      *          white noise with a given covariance matrix, and bias
      *
+     *          Each noise draws from its own random stream (see
+     *          tools::RandomStream), by default a new stream of the default
+     *          seed. A copy of the noise draws the same numbers.
+     *
      * \details
      *
      */
@@ -64,6 +69,13 @@ namespace stateObservation
         /// (used in case of lie group vectors)
         void setSumFunction(void (* sum)(const  Vector& stateVector, const Vector& tangentVector, Vector& result));
 
+        ///restarts the noise from the beginning of the random stream of the
+        ///given seed and id, e.g. the id of a trajectory and of the noise
+        void setSeed(boost::uint64_t seed, boost::uint64_t stream);
+
+        ///gets the random stream of the noise
+        tools::RandomStream & getRandomStream();
+
     protected:
         virtual void checkMatrix_(const Matrix & m) const ;
 
@@ -81,6 +93,7 @@ namespace stateObservation
 
         void (* sum_)(const  Vector& stateVector, const Vector& tangentVector, Vector& result);
 
+        tools::RandomStream stream_;
 
     };
 
@@ -136,6 +136,24 @@ namespace stateObservation
         /// Reset the extended kalman filter (call also the reset function of the dynamics functor)
         virtual void reset();
 
+        /// The containers of the filter which size depends on the measurement
+        /// size, including the ones of the finite differences
+        struct MeasurementWorkspace:
+            public KalmanFilterBase::MeasurementWorkspace
+        {
+            void resize(unsigned m, unsigned nt);
+
+            MeasureVector y;
+            MeasureVector yp;
+            MeasureVector yk1;
+            Cmatrix cFD;
+            IndexedVector ybar;
+        };
+
+        /// Swaps in constant time the measurement containers (see
+        /// KalmanFilterBase::swapMeasurementWorkspace)
+        void swapMeasurementWorkspace(MeasurementWorkspace & w);
+
     protected:
         /// simulate the dynamics of the state using the functor
         virtual StateVector prediction_(TimeIndex k);
@@ -143,6 +161,10 @@ namespace stateObservation
         /// simulate the dynamic of the measurement using the functor
         virtual MeasureVector simulateSensor_(const StateVector& x, TimeIndex k);
 
+        /// simulate the dynamic of the measurement using the functor, the
+        /// measurement is written in y
+        void simulateSensor_(const StateVector& x, TimeIndex k, MeasureVector& y);
+
         /// predicts the measurement using the functor, assumed that the predicted state is up-to-date
         virtual MeasureVector predictSensor_(TimeIndex k);
 
@@ -174,6 +196,11 @@ namespace stateObservation
           ObserverBase::StateVector xp_;
           ObserverBase::MeasureVector y_;
           ObserverBase::MeasureVector yp_;
+          ObserverBase::StateVector xk1_;
+          ObserverBase::MeasureVector yk1_;
+          Matrix xBatch_;
+          Matrix uBatch_;
+          Matrix xpBatch_;
 
         } opt;
 
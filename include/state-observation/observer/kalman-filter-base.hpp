@@ -24,7 +24,11 @@
 #ifndef KALMANFILTERBASEHPP
 #define KALMANFILTERBASEHPP
 
+#include <vector>
+#include <utility>
+
 #include <state-observation/observer/zero-delay-observer.hpp>
+#include <state-observation/tools/stage-timings.hpp>
 
 
 namespace stateObservation
@@ -70,6 +74,23 @@ namespace stateObservation
 
         typedef Eigen::LLT<Pmatrix> LLTPMatrix;
 
+        /// Ranges of components of the tangent vector, given by their
+        /// first index and their size
+        typedef std::vector<std::pair<unsigned,unsigned> > IndexRanges;
+
+        struct timingStage
+        {
+          ///indexes of the timed stages of the filter
+          static const unsigned prediction = 0;
+          static const unsigned jacobianA = 1;
+          static const unsigned jacobianC = 2;
+          static const unsigned covariancePropagation = 3;
+          static const unsigned gain = 4;
+          static const unsigned update = 5;
+
+          static const unsigned count = 6;
+        };
+
         /// Default constructor
         KalmanFilterBase();
 
@@ -97,7 +118,7 @@ namespace stateObservation
         /// Set the value of the jacobian df/dx
         virtual void setA(const Amatrix& A);
 
-        virtual Matrix getA() const;
+        virtual const Matrix & getA() const;
 
         /// Clear the jacobian df/dx
         virtual void clearA();
@@ -106,7 +127,7 @@ namespace stateObservation
         /// Set the value of the Jacobian dh/dx
         virtual void setC(const Cmatrix& C);
 
-        virtual Matrix getC() const;
+        virtual const Matrix & getC() const;
 
         /// Clear the jacobian dh/dx
         virtual void clearC();
@@ -141,7 +162,7 @@ namespace stateObservation
         virtual void clearStateCovariance();
 
         /// Get the covariance matrix of the current time state estimation
-        virtual Pmatrix getStateCovariance() const;
+        virtual const Pmatrix & getStateCovariance() const;
 
         /// Resets all the observer
         virtual void reset();
@@ -240,12 +261,49 @@ namespace stateObservation
         ///the containers for the matrices C, R
         virtual void setMeasureSize(unsigned m);
 
+        /// The containers of the filter which size depends on the measurement
+        /// size, they can be preallocated for each measurement size
+        struct MeasurementWorkspace
+        {
+            /// gives to the containers the sizes for m measurements and
+            /// a tangent state vector of size nt
+            void resize(unsigned m, unsigned nt);
+
+            Cmatrix c;
+            Rmatrix r;
+            Vector predictedMeasurement;
+            Vector inoMeas;
+            Matrix inoMeasCov;
+            Matrix inoMeasCovInverse;
+            LLTPMatrix inoMeasCovLLT;
+            Matrix kGain;
+            Cmatrix cActive;
+        };
+
+        /// Changes the dimension of the measurement vector to the size of
+        /// the R matrix of w and swaps (in constant time) the containers of
+        /// the filter with the ones of w, which then keeps the containers of
+        /// the previous size. The measurement vectors are reset if the size
+        /// changes, unless they are converted before with
+        /// convertMeasurements. The C matrix has to be set again. Without the move
+        /// semantics of C++11 the factorization is swapped by copy.
+        void swapMeasurementWorkspace(MeasurementWorkspace & w);
+
         /// Get simulation of the measurement y_k using the state estimation
         virtual MeasureVector getSimulatedMeasurement(TimeIndex k);
 
         ///Get the last vector of innovation of the Kalman filter
         virtual StateVector getInnovation();
 
+        ///Get the log-likelihood of the innovation of the last measurement,
+        ///computed with the Cholesky factorization of its covariance
+        double getInnovationLogLikelihood() const;
+
+        ///Get the normalized innovation squared (NIS) of the last measurement,
+        ///the squared Mahalanobis norm of the innovation, whose mean is the
+        ///measurement size when the filter is consistent
+        double getNormalizedInnovationSquared() const;
+
         /// A function that gives the prediction (this is NOT the estimation of the state),
         /// for the estimation call getEstimateState method
         /// it is only an execution of the state synamics with the current state
@@ -272,6 +330,29 @@ namespace stateObservation
         void setSumFunction(void (* sum)(const  Vector& stateVector, const Vector& tangentVector, Vector& result));
         void setDifferenceFunction(void (* difference)(const  Vector& stateVector1, const Vector& stateVector2, Vector& difference));
 
+        /// Restricts the covariance propagation and the update to the
+        /// ranges (sorted and disjoint) of the tangent vector, the cost of
+        /// the step then scales with the number of active components. The
+        /// other components keep their prediction and their rows and
+        /// columns of P are set to zero, they must have no process noise and
+        /// must not depend on the active ones in A. The gain only has the
+        /// rows of the active components. Without ranges (default) all the
+        /// components are estimated.
+        void setActiveTangentRanges(const IndexRanges & ranges);
+
+        /// Gets the number of components of the tangent vector which are
+        /// estimated
+        unsigned getActiveTangentSize() const;
+
+        ///gets the wall time statistics of the stages of the filter
+        ///(see timingStage), they are recorded only if the library is
+        ///compiled with STATEOBSERVATION_WITH_TIMINGS
+        const tools::StageTimings & getTimings() const;
+
+        ///non const version, can be used to time the stages
+        ///computed outside of the filter (e.g. analytical jacobians)
+        tools::StageTimings & getTimings();
+
     protected:
 
         unsigned nt_;
@@ -282,6 +363,10 @@ namespace stateObservation
         /// The Kalman filter loop
         virtual StateVector oneStepEstimation_();
 
+        /// The Kalman filter loop restricted to the active ranges of the
+        /// tangent vector
+        StateVector oneActiveStepEstimation_();
+
         /// The abstract method to overload to implement f(x,u)
         virtual StateVector prediction_(TimeIndex k)=0;
 
@@ -324,10 +409,40 @@ namespace stateObservation
             LLTPMatrix inoMeasCovLLT;
             Matrix kGain;
             Matrix t;
+
+            ///the active blocks of A, P and C and the active components of
+            ///the innovation, in the first rows and columns
+            Matrix aActive;
+            Matrix pActive;
+            Matrix cActive;
+            Vector innovationActive;
         } oc_;
 
+        ///the ranges of the tangent vector which are estimated and their
+        ///total size
+        IndexRanges activeTangentRanges_;
+        unsigned activeTangentSize_;
+
         void (* sum_)(const  Vector& stateVector, const Vector& tangentVector, Vector& result);
         void (* difference_)(const  Vector& stateVector1, const Vector& stateVector2, Vector& difference);
+
+        ///computes the log-likelihood and the normalized innovation squared
+        ///of the last measurement if they are not up to date
+        void updateInnovationStatistics_() const;
+
+        ///log-likelihood of the last measurement innovation
+        mutable double innovationLogLikelihood_;
+
+        ///normalized innovation squared of the last measurement
+        mutable double normalizedInnovationSquared_;
+
+        ///the statistics of the innovation are only computed when requested
+        mutable bool innovationStatisticsUpdated_;
+
+        ///names the stages of the timings
+        void initTimings_();
+
+        tools::StageTimings timings_;
     };
 
     /*inline*/ Vector KalmanFilterBase::updateStatePrediction()
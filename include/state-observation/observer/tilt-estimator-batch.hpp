@@ -0,0 +1,164 @@
+/**
+ * \file      tilt-estimator-batch.hpp
+ * \brief      Defines the class for a batch of tilt estimators.
+ *
+ * \details
+ *
+ *
+ */
+
+
+
+#ifndef TILTESTIMATORBATCHHPP
+#define TILTESTIMATORBATCHHPP
+
+#include <vector>
+
+#include <state-observation/tools/definitions.hpp>
+
+
+namespace stateObservation
+{
+
+/**
+  * \class  TiltEstimatorBatch
+  * \brief
+  *         Runs the tilt estimator (see TiltEstimator) for a batch of IMUs
+  *         with the same sampling time, e.g. the IMUs of a skin.
+  *
+  *         Each IMU has its own gains and its own kinematics in the control
+  *         frame. The variables are stored by component: each column of the
+  *         arrays is one component for all the IMUs, so that the operations
+  *         are vectorized over the IMUs by Eigen with the instruction set
+  *         given to the compiler (e.g. -mavx2 or -mavx512f).
+  *
+  *         The estimation of each IMU is the same, bit for bit, as the one of
+  *         TiltEstimator with the same parameters, and a step does not
+  *         allocate memory.
+  *
+  */
+  class TiltEstimatorBatch
+  {
+  public:
+    /// arrays of the vectors of all the IMUs, one row by IMU and one column
+    /// by component
+    typedef Eigen::Array<double, Eigen::Dynamic, 3> Array3;
+
+    /// The constructor
+    ///  \li n : number of IMUs
+    ///  \li alpha, beta, gamma : the gains of all the IMUs (see TiltEstimator)
+    TiltEstimatorBatch(unsigned n, double alpha, double beta, double gamma);
+
+    /// gets the number of IMUs
+    unsigned getSize() const { return n_; }
+
+    ///set the gains of the IMU i
+    void setAlpha(unsigned i, double alpha);
+    double getAlpha(unsigned i) const { return alpha_[i]; }
+
+    void setBeta(unsigned i, double beta);
+    double getBeta(unsigned i) const { return beta_[i]; }
+
+    void setGamma(unsigned i, double gamma);
+    double getGamma(unsigned i) const { return gamma_[i]; }
+
+    ///set the sampling time of the measurements
+    void setSamplingTime(const double dt) { dt_ = dt; }
+    double getSamplingTime() const { return dt_; }
+
+    /// sets the position of the IMU i in the control frame
+    void setSensorPositionInC(unsigned i, const Vector3& p);
+    Vector3 getSensorPositionInC(unsigned i) const { return p_S_C_[i]; }
+
+    /// sets the orientation of the IMU i in the control frame
+    void setSensorOrientationInC(unsigned i, const Matrix3& R);
+    Matrix3 getSensorOrientationInC(unsigned i) const { return R_S_C_[i]; }
+
+    /// sets the linear velocity of the IMU i in the control frame
+    void setSensorLinearVelocityInC(unsigned i, const Vector3& v);
+    Vector3 getSensorLinearVelocityInC(unsigned i) const { return v_S_C_[i]; }
+
+    /// sets the angular velocity of the IMU i in the control frame
+    void setSensorAngularVelocityInC(unsigned i, const Vector3& w);
+    Vector3 getSensorAngularVelocityInC(unsigned i) const { return w_S_C_[i]; }
+
+    /// sets the velocity of the control origin in the world frame, common
+    /// to all the IMUs
+    void setControlOriginVelocityInW(const Vector3& v);
+    Vector3 getControlOriginVelocityInW() const { return v_C_; }
+
+    /// sets the state of the estimator of the IMU i
+    void setEstimation(unsigned i, const Vector3 & x1_hat, const Vector3 & x2_hat_prime,
+                       const Vector3 & x2_hat);
+
+    /// sets the measurements of the accelerometer and the gyrometer of the
+    /// IMU i for the next step
+    void setMeasurement(unsigned i, const Vector3 & ya, const Vector3 & yg);
+
+    /// gives the arrays of the measurements of the next step to be filled
+    /// directly
+    Array3 & accelerometers() { return ya_; }
+    Array3 & gyrometers() { return yg_; }
+
+    /// advances the estimators of all the IMUs by one sample
+    void estimate();
+
+    /// gets the estimations of the IMU i
+    Vector3 getX1Hat(unsigned i) const { return x1_hat_.row(i).transpose(); }
+    Vector3 getX2HatPrime(unsigned i) const { return x2_hat_prime_.row(i).transpose(); }
+    Vector3 getTilt(unsigned i) const { return x2_hat_.row(i).transpose(); }
+
+    /// gets the tilts of all the IMUs
+    const Array3 & getTilts() const { return x2_hat_; }
+
+  protected:
+    /// computes the terms of x1 which are constant for the IMU i
+    void updateKinematics_(unsigned i);
+
+    /// c = a x b for each row, c must not be a or b
+    static void cross_(const Array3 & a, const Array3 & b, Array3 & c);
+
+    unsigned n_;
+
+    /// The parameters of the estimators
+    Eigen::ArrayXd alpha_, beta_, gamma_;
+
+    /// Sampling time
+    double dt_;
+
+    /// Kinematics of the IMUs in the control frame
+    std::vector<Vector3> p_S_C_;
+    std::vector<Matrix3> R_S_C_;
+    std::vector<Vector3> v_S_C_;
+    std::vector<Vector3> w_S_C_;
+
+    /// Linear velocity of the control frame
+    Vector3 v_C_;
+
+    /// R_S_C^T p_S_C, R_S_C^T (v_C + v_S_C) and R_S_C^T w_S_C
+    Array3 p_;
+    Array3 v_;
+    Array3 w_;
+
+    /// measurements of the next step
+    Array3 ya_;
+    Array3 yg_;
+
+    /// state of the estimators
+    Array3 x1_hat_;
+    Array3 x2_hat_prime_;
+    Array3 x2_hat_;
+
+    ///variables used for the computation
+    Array3 x1_;
+    Array3 a_;
+    Array3 b_;
+    Array3 dx1_hat_;
+    Array3 dx2_hat_prime_;
+    Array3 dx2_hat_;
+    Eigen::ArrayXd norm_;
+  };
+
+}
+
+#endif //TILTESTIMATORBATCHHPP
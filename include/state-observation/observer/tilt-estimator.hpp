@@ -80,6 +80,31 @@ namespace stateObservation
     /// sets ths measurement (accelero and gyro stacked in one vector)
     void setMeasurement(const Vector3 ya_k, const Vector3 yg_k, TimeIndex k);
 
+    /// ///////////////////////////////////////////////////////////
+    /// Fixed-size path: the state is kept in Vector3 members and
+    /// advanced sample by sample without the time indexes and the queues
+    /// of the ZeroDelayObserver, it does not allocate memory. The two
+    /// paths run the same computations but each one has its own state,
+    /// so they can be used on the same object without interfering.
+    /// ///////////////////////////////////////////////////////////
+
+    /// sets the state of the fixed-size path
+    void setEstimation(const Vector3 & x1_hat, const Vector3 & x2_hat_prime,
+                       const Vector3 & x2_hat);
+
+    /// advances the fixed-size path by one sample with the measurements
+    /// of the accelerometer and the gyrometer and gives the tilt
+    const Vector3 & estimate(const Vector3 & ya, const Vector3 & yg);
+
+    /// gets the estimation of the linear velocity of the IMU in its frame
+    const Vector3 & getX1Hat() const { return fs_.x1_hat; }
+
+    /// gets the estimation of the tilt with the fast convergence
+    const Vector3 & getX2HatPrime() const { return fs_.x2_hat_prime; }
+
+    /// gets the estimation of the tilt R.transpose()*e_z
+    const Vector3 & getTilt() const { return fs_.x2_hat; }
+
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     
   protected:
@@ -118,6 +143,22 @@ namespace stateObservation
     
     /// The tilt estimator loop
     StateVector oneStepEstimation_();
+
+    /// advances the state x1_hat, x2_hat_prime, x2_hat by one sample
+    void integrate_(Vector3 & x1_hat, Vector3 & x2_hat_prime, Vector3 & x2_hat,
+                    const Vector3 & ya, const Vector3 & yg);
+
+    /// state of the fixed-size path
+    struct fixedSizeState
+    {
+      Vector3 x1_hat;
+      Vector3 x2_hat_prime;
+      Vector3 x2_hat;
+    } fs_;
+
+    /// container of the measurement and of the next state
+    ObserverBase::MeasureVector y_k_;
+    ObserverBase::StateVector x_hat_;
   };
   
 }
@@ -18,6 +18,7 @@
 #define ZERODELAYOBSERVER_H
 
 #include <deque>
+#include <vector>
 
 #include <state-observation/observer/observer-base.hpp>
 
@@ -105,8 +106,11 @@ namespace stateObservation
         ///Get the value of the current time index
         virtual TimeIndex getCurrentTime()const;
 
+        ///Get the estimation of the state at the current time
+        const ObserverBase::StateVector & getCurrentEstimatedState() const;
+
         ///Get the value of the input of the time index k
-        Vector getInput(TimeIndex k) const;
+        const Vector & getInput(TimeIndex k) const;
 
         ///Get the number of available inputs
         virtual TimeSize getInputsNumber()const;
@@ -115,7 +119,7 @@ namespace stateObservation
         virtual TimeIndex getInputTime()const;
 
         ///Get the measurement of the time index k
-        Vector getMeasurement(TimeIndex k) const;
+        const Vector & getMeasurement(TimeIndex k) const;
 
         ///Get the time index of the last given measurement
         virtual TimeIndex getMeasurementTime()const;
@@ -132,6 +136,16 @@ namespace stateObservation
         ///changes the size of the input vector: reset the stored input vectors
         virtual void setInputSize(unsigned p);
 
+        ///changes the size of the measurement vector and converts the stored
+        ///measurements instead of resetting them: their first coefficients
+        ///and their last tail ones are kept, the other ones are set to zero
+        void convertMeasurements(unsigned m, unsigned tail=0);
+
+        ///changes the size of the input vector and converts the stored
+        ///inputs instead of resetting them: their first coefficients and
+        ///their last tail ones are kept, the other ones are set to zero
+        void convertInputs(unsigned p, unsigned tail=0);
+
     protected:
 
         ///This method describes one loop of the observer (from k_0 to k_0+1)
@@ -149,6 +163,15 @@ namespace stateObservation
         ///Container for the inputs.
         IndexedVectorArray u_;
 
+        ///converts the vectors of the array to the size n (see
+        ///convertMeasurements). The converted vectors take the storage of
+        ///the spare vectors of size n, which then keep the previous storage,
+        ///so that alternating between sizes does not allocate
+        void convertVectors_(IndexedVectorArray & a, unsigned n, unsigned tail);
+
+        ///storage of the vectors of the previous sizes
+        std::vector<Vector> spareVectors_;
+
     };
 
 }
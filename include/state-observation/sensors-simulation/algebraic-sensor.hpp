@@ -12,6 +12,8 @@
 #ifndef SIMULATIONALGEBRAICSENSORHPP
 #define SIMULATIONALGEBRAICSENSORHPP
 
+#include <vector>
+
 #include <Eigen/Core>
 #include <boost/assert.hpp>
 
@@ -59,7 +61,8 @@ namespace stateObservation
 
         ///concatenates the n last components of the state in the measurement
         ///(useful when the measurements are already computed or
-        ///when they come from external source)
+        ///when they come from external source). The containers of the
+        ///previous n are kept, coming back to it does not allocate.
         virtual unsigned concatenateWithInput( unsigned n);
 
     protected:
@@ -92,6 +95,11 @@ namespace stateObservation
 
         Vector noiselessMeasurement_;
 
+        ///directInputToOutput_ and noiselessMeasurement_ of the other sizes of
+        ///concatenation, indexed by the size
+        std::vector<Vector> spareDirectInputs_;
+        std::vector<Vector> spareMeasurements_;
+
     };
 
 }
@@ -0,0 +1,100 @@
+/**
+ * \file      checkpoint.hpp
+ * \brief     Compact binary snapshot of the values of an estimator, used to
+ *            save and restore its state
+ *
+ *
+ *
+ */
+
+#ifndef STATEOBSERVATIONTOOLSCHECKPOINT
+#define STATEOBSERVATIONTOOLSCHECKPOINT
+
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include <state-observation/tools/definitions.hpp>
+
+namespace stateObservation
+{
+  namespace tools
+  {
+    /**
+     * \class  Checkpoint
+     * \brief  Binary buffer where scalars and Eigen matrices are written one
+     *         after the other and read back in the same order. The matrices
+     *         are stored with their size followed by their coefficients
+     *         (column major). Clearing the checkpoint keeps its memory, so a
+     *         checkpoint which is written periodically does not allocate.
+     *         Reading beyond the written data or reading a matrix of the
+     *         wrong fixed size throws a std::runtime_error.
+     *
+     */
+    class Checkpoint
+    {
+    public:
+      Checkpoint();
+
+      ///empties the checkpoint, the memory is kept for the next writes
+      void clear();
+
+      ///the next read starts at the beginning of the data
+      void rewind();
+
+      ///size of the data in bytes
+      TimeSize size() const;
+
+      ///whether all the data has been read
+      bool atEnd() const;
+
+      void write(bool b);
+      void write(unsigned i);
+      void write(long i);
+      void write(double d);
+
+      template <typename Derived>
+      void write(const Eigen::MatrixBase<Derived> & m);
+
+      void read(bool & b);
+      void read(unsigned & i);
+      void read(long & i);
+      void read(double & d);
+
+      ///the matrix is resized when its size is dynamic
+      template <typename Derived>
+      void read(Eigen::PlainObjectBase<Derived> & m);
+
+      ///gives the raw data
+      const std::vector<char> & getData() const;
+
+      ///sets the raw data and rewinds the checkpoint
+      void setData(const std::vector<char> & data);
+
+      ///writes the data to a binary stream, with a header
+      void save(std::ostream & os) const;
+
+      ///reads data written by save, throws a std::runtime_error when the
+      ///stream does not contain a checkpoint or when the checkpoint is
+      ///larger than maxBytes
+      void load(std::istream & is, TimeSize maxBytes=defaultMaxBytes);
+
+      ///default bound of the size of the checkpoints read from a stream
+      static const TimeSize defaultMaxBytes=16*1024*1024;
+
+    protected:
+      void writeRaw_(const void * data, TimeSize bytes);
+      void readRaw_(void * data, TimeSize bytes);
+
+      ///identifies the streams written by save
+      static const unsigned streamTag_=0x4b504f53;
+
+      std::vector<char> data_;
+      TimeSize readPosition_;
+    };
+  }
+}
+
+#include <state-observation/tools/checkpoint.hxx>
+
+#endif //STATEOBSERVATIONTOOLSCHECKPOINT
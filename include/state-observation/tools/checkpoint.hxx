@@ -0,0 +1,49 @@
+namespace stateObservation
+{
+  namespace tools
+  {
+    template <typename Derived>
+    void Checkpoint::write(const Eigen::MatrixBase<Derived> & m)
+    {
+      write(unsigned(m.rows()));
+      write(unsigned(m.cols()));
+
+      for (int j=0; j<int(m.cols()); ++j)
+      {
+        for (int i=0; i<int(m.rows()); ++i)
+        {
+          write(double(m(i,j)));
+        }
+      }
+    }
+
+    template <typename Derived>
+    void Checkpoint::read(Eigen::PlainObjectBase<Derived> & m)
+    {
+      unsigned rows, cols;
+      read(rows);
+      read(cols);
+
+      if ((Derived::RowsAtCompileTime!=Eigen::Dynamic && int(rows)!=Derived::RowsAtCompileTime) ||
+          (Derived::ColsAtCompileTime!=Eigen::Dynamic && int(cols)!=Derived::ColsAtCompileTime))
+      {
+        throw std::runtime_error("Checkpoint: the size of the matrix does not match the data");
+      }
+
+      ///the coefficients must be in the data, this bounds the allocation
+      if (TimeSize(rows)*TimeSize(cols)>(data_.size()-readPosition_)/sizeof(double))
+      {
+        throw std::runtime_error("Checkpoint: reading beyond the end of the data");
+      }
+
+      m.resize(rows,cols);
+      for (int j=0; j<int(m.cols()); ++j)
+      {
+        for (int i=0; i<int(m.rows()); ++i)
+        {
+          read(m.coeffRef(i,j));
+        }
+      }
+    }
+  }
+}
@@ -15,8 +15,10 @@
 //#define STATEOBSERVATION_VERBOUS_CONSTRUCTORS
 
 #include <vector>
+#include <algorithm>
 #include <deque>
 #include <stdexcept>
+#include <time.h>
 
 #ifdef STATEOBSERVATION_VERBOUS_CONSTRUCTORS
 #   include <iostream>
@@ -247,6 +249,9 @@ namespace stateObservation
     ///Switch off the initalization flag, the value is no longer accessible
     inline void reset();
 
+    ///Exchanges the values with m without copy
+    inline void swap(IndexedMatrixT & m);
+
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   protected:
@@ -290,7 +295,7 @@ namespace stateObservation
     inline void popFront();
 
     ///gets the value with the given time index
-    inline MatrixType operator[](TimeIndex index) const;
+    inline const MatrixType & operator[](TimeIndex index) const;
 
     ///gets the value with the given time index, non const version
     inline MatrixType  & operator[](TimeIndex index);
@@ -420,6 +425,10 @@ namespace stateObservation
   {
     struct SimplestStopwatch
     {
+      ///the clock is the process CPU time by default,
+      ///use CLOCK_MONOTONIC to measure the wall time
+      inline explicit SimplestStopwatch(clockid_t clock=CLOCK_PROCESS_CPUTIME_ID);
+
       inline void start();
 
       ///provides the time since the start
@@ -429,6 +438,8 @@ namespace stateObservation
       inline double diff(const timespec & start, const timespec & end);
 
       timespec time1, time2, time3;
+
+      clockid_t clock;
     };
 
 
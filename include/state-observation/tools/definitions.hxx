@@ -115,6 +115,18 @@ inline void IndexedMatrixT<MatrixType,lazy>::reset()
   IsSet::set(false);
 }
 
+///Exchanges the matrices, their time indexes and flags in constant time
+template <typename MatrixType, bool lazy>
+inline void IndexedMatrixT<MatrixType,lazy>::swap(IndexedMatrixT & m)
+{
+  bool isSet=IsSet::get();
+  IsSet::set(m.IsSet::get());
+  m.IsSet::set(isSet);
+
+  std::swap(k_,m.k_);
+  v_.swap(m.v_);
+}
+
 
 
 ///Checks whether the matrix is set or not (assert)
@@ -199,7 +211,7 @@ inline void IndexedMatrixArrayT<MatrixType>::popFront()
 
 ///Get the matrix value
 template <typename MatrixType>
-inline MatrixType IndexedMatrixArrayT<MatrixType>::operator[](TimeIndex time)const
+inline const MatrixType & IndexedMatrixArrayT<MatrixType>::operator[](TimeIndex time)const
 {
     check_(time);
     return v_[time - k_];
@@ -577,15 +589,20 @@ void IndexedMatrixArrayT<MatrixType>::writeInFile(const char * filename, bool cl
 namespace tools
 {
 
+  inline SimplestStopwatch::SimplestStopwatch(clockid_t c):
+    clock(c)
+  {
+  }
+
   inline void SimplestStopwatch::start()
   {
-    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time1);
-    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time2);
+    clock_gettime(clock, &time1);
+    clock_gettime(clock, &time2);
   }
 
   inline double SimplestStopwatch::stop()
   {
-    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time3);
+    clock_gettime(clock, &time3);
 
     return diff(time2,time3)-diff(time1,time2);
   }
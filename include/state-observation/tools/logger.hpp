@@ -1,8 +1,8 @@
 #ifndef STATEOBSERVATIONLOGGER_H
 #define STATEOBSERVATIONLOGGER_H
 
-#include <typeinfo>
 #include <map>
+#include <vector>
 #include <string>
 #include <stdexcept>
 
@@ -12,19 +12,193 @@ namespace stateObservation
 {
   namespace tools
   {
+    namespace detail
+    {
+      ///Describes how a recorded type is laid out in the log buffer.
+      ///Only the specialized types can be recorded, any other type
+      ///triggers a compilation error.
+      template <typename T>
+      struct LogTraits;
+
+      ///Eigen matrices and vectors (fixed or dynamic size)
+      template <int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+      struct LogTraits<Eigen::Matrix<double,Rows,Cols,Options,MaxRows,MaxCols> >
+      {
+        typedef Eigen::Matrix<double,Rows,Cols,Options,MaxRows,MaxCols> Type;
+
+        static inline unsigned rows(const Type & v)
+        {
+          return v.rows();
+        }
+        static inline unsigned cols(const Type & v)
+        {
+          return v.cols();
+        }
+        ///plain copy of the coefficients (column major)
+        static inline void copy(const Type & v, double * dest)
+        {
+          Eigen::Map<Eigen::Matrix<double,Rows,Cols> > coeffs(dest,v.rows(),v.cols());
+          coeffs=v;
+        }
+      };
+
+      ///Quaternions are logged as their coefficients (x,y,z,w)
+      template <int Options>
+      struct LogTraits<Eigen::Quaternion<double,Options> >
+      {
+        typedef Eigen::Quaternion<double,Options> Type;
+
+        static inline unsigned rows(const Type &)
+        {
+          return 4;
+        }
+        static inline unsigned cols(const Type &)
+        {
+          return 1;
+        }
+        static inline void copy(const Type & v, double * dest)
+        {
+          Eigen::Map<Vector4> coeffs(dest);
+          coeffs=v.coeffs();
+        }
+      };
+
+      ///Scalars are converted to double
+      template <typename T>
+      struct ScalarLogTraits
+      {
+        static inline unsigned rows(const T &)
+        {
+          return 1;
+        }
+        static inline unsigned cols(const T &)
+        {
+          return 1;
+        }
+        static inline void copy(const T & v, double * dest)
+        {
+          *dest=double(v);
+        }
+      };
+
+      template <> struct LogTraits<double>: public ScalarLogTraits<double> {};
+      template <> struct LogTraits<float>: public ScalarLogTraits<float> {};
+      template <> struct LogTraits<int>: public ScalarLogTraits<int> {};
+      template <> struct LogTraits<unsigned>: public ScalarLogTraits<unsigned> {};
+      template <> struct LogTraits<long>: public ScalarLogTraits<long> {};
+    }
+
+    /**
+     * \class  LogChannelBase
+     * \brief  Untyped part of a log channel: a contiguous buffer of samples
+     *         having all the same size, with time indexation.
+     *
+     */
+    class LogChannelBase
+    {
+    public:
+      LogChannelBase(unsigned rows, unsigned cols, const std::string & filename,
+                     TimeSize capacity);
+
+      virtual ~LogChannelBase();
+
+      ///records the current value of the tracked variable
+      virtual void push()=0;
+
+      ///gets the address of the tracked variable
+      virtual const void * getAddress() const=0;
+
+      ///number of recorded samples
+      inline TimeSize size() const;
+
+      ///time index of the first recorded sample
+      inline TimeIndex getFirstIndex() const;
+
+      ///preallocates the buffer for the given number of samples
+      void reserve(TimeSize capacity);
+
+      ///copies the log into an indexed array of matrices
+      const IndexedMatrixArray & getRecord() const;
+
+      ///copies the log into an indexed array of matrices, modifying the
+      ///returned array does not change the log
+      IndexedMatrixArray & getRecord();
+
+      const std::string & getFilename() const;
+
+      ///writes the log in a file, with the same format as
+      ///IndexedMatrixArrayT::writeInFile
+      void writeInFile(const std::string & filename, bool clear=false, bool append=false);
+
+      ///clears the log but keeps the time indexation
+      void clear();
+
+    protected:
+      ///gives the slot where the next sample has to be copied
+      inline double * nextSlot_();
+
+      unsigned rows_;
+      unsigned cols_;
+      TimeSize stride_;
+      TimeSize size_;
+      TimeIndex k_;
+
+      std::vector<double> buffer_;
+      std::string filename_;
+
+      mutable IndexedMatrixArray record_;
+    };
+
+    /**
+     * \class  LogChannel
+     * \brief  Typed log channel, the pushes are resolved at compile time
+     *         and cost one copy of the value into the preallocated buffer.
+     *
+     */
+    template <typename T>
+    class LogChannel: public LogChannelBase
+    {
+    public:
+      LogChannel(const T * address, const std::string & filename, TimeSize capacity);
+
+      ///records the current value of the tracked variable
+      virtual void push();
+
+      ///records the given value, it must have the same size as the
+      ///tracked variable otherwise std::invalid_argument is thrown
+      inline void push(const T & value);
+
+      ///changes the tracked variable
+      void setAddress(const T * address);
+
+      virtual const void * getAddress() const;
+
+    protected:
+      const T * address_;
+    };
+
     class Logger
     {
     public:
-      Logger();
+      ///The capacity is the number of samples preallocated for each channel
+      explicit Logger(TimeSize capacity=defaultCapacity);
       virtual ~Logger();
 
+      static const TimeSize defaultCapacity=1000;
+
       ///Use this function to start the recoding of this variable.
+      ///Recording an address twice throws std::invalid_argument.
       /// WARNING: Be sure that the recorded variable keeps the same memory address
-      ///otherwise use updateAddress
+      ///otherwise use updateAddress.
+      ///The returned channel allows to push directly without any lookup,
+      ///it is valid until clearTracking() is called or the logger is destroyed.
+      ///The size of dynamic matrices is given by their size when recorded
+      template <typename T>
+        LogChannel<T> * record(const T * address, const std::string & filename=std::string(""));
       template <typename T>
-        void record(const T * address, const std::string & filename=std::string(""));
+        LogChannel<T> * record(T * address, const std::string & filename=std::string(""));
       template <typename T>
-        void record(const T & reference, const std::string & filename=std::string(""));
+        LogChannel<T> * record(const T & reference, const std::string & filename=std::string(""));
 
       ///updates the address of a recorded variable with a new address
       template <typename T>
@@ -34,6 +208,9 @@ namespace stateObservation
       ///set the Path for the log files, the filenames will be appended to this path
       void setPath(const std::string & path);
 
+      ///sets the number of samples preallocated for each channel
+      void setCapacity(TimeSize capacity);
+
       ///update the log with a new value of the reference
       template <typename T>
       void push(const T & reference);
@@ -41,6 +218,9 @@ namespace stateObservation
       template <typename T>
       void push(const T * address);
 
+      template <typename T>
+      void push(T * address);
+
       ///updates all the logs for all recorded variables
       void push();
 
@@ -48,6 +228,9 @@ namespace stateObservation
 
       IndexedMatrixArray & getRecord(const void *address);
 
+      ///gets the channel recording the given address
+      LogChannelBase * getChannel(const void *address) const;
+
       ///saves the log in a file
       void save(bool clear = false, bool append = false);
 
@@ -58,39 +241,24 @@ namespace stateObservation
       void clearLogs();
 
     protected:
-      struct log_s
-      {
-
-        IndexedMatrixArray array;
-        std::string filename;
-        const std::type_info * type;
-
-        log_s(const std::string & newfilename):
-          type (0x0)
-        {
-          filename = newfilename;
-
-        }
-
-        template <typename T>
-        void setType()
-        {
-          type =&typeid(T);
-        }
-      };
-
-      typedef std::map<const void *, log_s > Tmap;
-      typedef std::pair<const void *, log_s > Tpair;
+      typedef std::map<const void *, LogChannelBase * > Tmap;
+      typedef std::pair<const void *, LogChannelBase * > Tpair;
 
-      void update_(const Tmap::iterator & i);
+      LogChannelBase * find_(const void * address) const;
 
       std::string path_;
-      std::map<const void *, log_s > logs_;
-      Matrix scalar_;
+      TimeSize capacity_;
 
+      ///all the channels, in the order of recording
+      std::vector<LogChannelBase *> channels_;
 
-    private:
+      ///lookup of the channels by address
+      Tmap logs_;
 
+    private:
+      ///the logger owns its channels
+      Logger(const Logger &);
+      Logger & operator=(const Logger &);
     };
   }
 }
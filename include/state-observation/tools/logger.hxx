@@ -1,55 +1,111 @@
-
 namespace stateObservation
 {
   namespace tools
   {
+    inline TimeSize LogChannelBase::size() const
+    {
+      return size_;
+    }
+
+    inline TimeIndex LogChannelBase::getFirstIndex() const
+    {
+      return k_;
+    }
+
+    inline double * LogChannelBase::nextSlot_()
+    {
+      if ((size_+1)*stride_ > buffer_.size())
+      {
+        ///the preallocated buffer is full
+        reserve(2*size_+1);
+      }
+      return &buffer_[(size_++)*stride_];
+    }
+
     template <typename T>
-    void Logger::record(const T * address, const std::string& filename)
+    LogChannel<T>::LogChannel(const T * address, const std::string& filename,
+                              TimeSize capacity):
+      LogChannelBase(detail::LogTraits<T>::rows(*address),
+                     detail::LogTraits<T>::cols(*address),filename,capacity),
+      address_(address)
     {
-      log_s log(filename);
-      log.setType<T>();
-      if    (*log.type!=typeid(Matrix)
-          && *log.type!=typeid(Matrix3)
-          && *log.type!=typeid(Vector)
-          && *log.type!=typeid(Vector3)
-          && *log.type!=typeid(int)
-          && *log.type!=typeid(long)
-          && *log.type!=typeid(double)
-          && *log.type!=typeid(float))
+    }
+
+    template <typename T>
+    void LogChannel<T>::push()
+    {
+      push(*address_);
+    }
+
+    template <typename T>
+    inline void LogChannel<T>::push(const T & value)
+    {
+      ///the slots of the buffer have the size of the recorded value
+      if (detail::LogTraits<T>::rows(value)!=rows_ || detail::LogTraits<T>::cols(value)!=cols_)
       {
-        BOOST_ASSERT(false && "Tentative to record an unsupported type");
         throw std::invalid_argument
-                ((std::string("The type ") +
-                    std::string("log.type->name")
-                      +std::string(" is not supported")).c_str());
+                ("Logger: the size of the pushed value has changed since it was recorded");
       }
+      detail::LogTraits<T>::copy(value,nextSlot_());
+    }
+
+    template <typename T>
+    void LogChannel<T>::setAddress(const T * address)
+    {
+      address_=address;
+    }
 
+    template <typename T>
+    const void * LogChannel<T>::getAddress() const
+    {
+      return address_;
+    }
+
+    template <typename T>
+    LogChannel<T> * Logger::record(const T * address, const std::string& filename)
+    {
+      if (logs_.find(address)!=logs_.end())
+      {
+        throw std::invalid_argument
+                ("Logger: this address is already recorded, please use updateAddress");
+      }
+
+      LogChannel<T> * log = new LogChannel<T>(address,filename,capacity_);
+
+      channels_.push_back(log);
       logs_.insert(Tpair(address,log));
+
+      return log;
     }
 
     template <typename T>
-    void Logger::record(const T & reference, const std::string& filename)
+    LogChannel<T> * Logger::record(T * address, const std::string& filename)
     {
-      record<T>(&reference,filename);
+      return record<T>(static_cast<const T *>(address),filename);
+    }
+
+    template <typename T>
+    LogChannel<T> * Logger::record(const T & reference, const std::string& filename)
+    {
+      return record<T>(&reference,filename);
     }
 
     template <typename T>
     void Logger::push(const T * address)
     {
-      Tmap::iterator i= logs_.find( * address );
+      find_(address)->push();
+    }
 
-      if (i!=logs_.end())
-        update_(i);
-      else
-        BOOST_ASSERT(false && "The logger cannot find the data to push, please use record function");
-        throw std::invalid_argument
-                ("The logger cannot find the data, please use record function");
+    template <typename T>
+    void Logger::push(T * address)
+    {
+      find_(address)->push();
     }
 
     template <typename T>
     void Logger::push(const T & reference)
     {
-      push(*reference);
+      push(&reference);
     }
 
     template <typename T>
@@ -64,10 +120,16 @@ namespace stateObservation
       }
       else
       {
-        log_s log(i->second.filename);
-        log.setType<T>();
-        logs_.insert(Tpair(newAddress,log));
+        LogChannel<T> * log = dynamic_cast<LogChannel<T> *>(i->second);
+        if (log==0x0)
+        {
+          BOOST_ASSERT(false && "Logger : the new address has not the recorded type");
+          throw std::invalid_argument
+                ("The logger cannot change the type of a recorded data");
+        }
+        log->setAddress(newAddress);
         logs_.erase(i);
+        logs_.insert(Tpair(newAddress,log));
       }
     }
 
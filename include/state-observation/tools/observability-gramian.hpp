@@ -0,0 +1,127 @@
+/**
+ * \file      observability-gramian.hpp
+ * \brief     Incremental observability Gramian over a sliding window of
+ *            linearizations of a dynamical system
+ *
+ *
+ *
+ */
+
+#ifndef STATEOBSERVATIONTOOLSOBSERVABILITYGRAMIAN
+#define STATEOBSERVATIONTOOLSOBSERVABILITYGRAMIAN
+
+#include <Eigen/Cholesky>
+
+#include <state-observation/tools/definitions.hpp>
+
+namespace stateObservation
+{
+  namespace tools
+  {
+    /**
+     * \class  ObservabilityGramian
+     * \brief  Accumulates the Gramian W = sum lambda^(k-i) O_i^T O_i of the
+     *         local observation matrices O_i = [C_i ; C_i A_i] given by the
+     *         Jacobians of a filter. The forgetting factor lambda=1-1/N sets
+     *         a window of about N steps. Each update is a rank-2m update of
+     *         the lower triangle (m being the measurement size) in
+     *         preallocated matrices. The extreme eigenvalues are estimated
+     *         with a few power and inverse iterations warm-started from the
+     *         previous estimates. The inverse iterations reuse a
+     *         factorization of the Gramian refreshed every few updates, so
+     *         that an estimation costs O(n^2) but every few updates.
+     *
+     */
+    class ObservabilityGramian
+    {
+    public:
+      explicit ObservabilityGramian(unsigned stateSize=0,
+                                    double windowLength=defaultWindowLength);
+
+      ///default number of steps of the window
+      static const unsigned defaultWindowLength=200;
+
+      ///default number of iterations of the eigenvalues estimation
+      static const unsigned defaultIterations=3;
+
+      ///default number of updates between two factorizations
+      static const unsigned defaultFactorizationPeriod=20;
+
+      ///sets the size of the state, this resets the Gramian
+      void setStateSize(unsigned n);
+
+      unsigned getStateSize() const;
+
+      ///sets the number of steps of the window (at least one)
+      void setWindowLength(double steps);
+
+      double getWindowLength() const;
+
+      ///sets the number of updates after which the estimation of the
+      ///condition number factorizes the Gramian again (at least one).
+      ///In between, the smallest eigenvalue is estimated with the previous
+      ///factorization and the current Gramian
+      void setFactorizationPeriod(TimeSize updates);
+
+      TimeSize getFactorizationPeriod() const;
+
+      ///sets the Gramian to zero
+      void reset();
+
+      ///adds the local observation matrix of the Jacobians A (n x n) and
+      ///C (m x n) and forgets the oldest ones
+      void update(const Matrix & A, const Matrix & C);
+
+      ///number of updates since the last reset
+      TimeSize getUpdatesNumber() const;
+
+      ///gets the (symmetric) Gramian
+      const Matrix & getGramian() const;
+
+      ///estimates the condition number of the Gramian (infinite when the
+      ///Gramian is singular), the extreme eigenvalues are then available.
+      ///It costs O(n^2) per iteration, plus a factorization in O(n^3) when
+      ///the last one is older than the factorization period
+      double estimateConditionNumber(unsigned iterations=defaultIterations);
+
+      ///the largest eigenvalue given by the last estimation
+      double getMaxEigenvalue() const;
+
+      ///the smallest eigenvalue given by the last estimation
+      double getMinEigenvalue() const;
+
+    protected:
+      ///only the lower triangle is updated
+      Matrix gramian_;
+      mutable Matrix symmetric_;
+      mutable bool symmetricSet_;
+
+      Matrix ca_;
+
+      double windowLength_;
+      double lambda_;
+      TimeSize updates_;
+
+      Eigen::LDLT<Matrix> ldlt_;
+
+      ///factorizes the Gramian, false if it is singular
+      bool factorize_(double threshold);
+
+      TimeSize factorizationPeriod_;
+      ///the Gramian has been factorized since the last reset
+      bool factorized_;
+      ///the factorized Gramian was singular
+      bool singular_;
+      ///number of updates at the last factorization
+      TimeSize factorizationUpdates_;
+      Vector vMax_;
+      Vector vMin_;
+      Vector w_;
+
+      double maxEigenvalue_;
+      double minEigenvalue_;
+    };
+  }
+}
+
+#endif //STATEOBSERVATIONTOOLSOBSERVABILITYGRAMIAN
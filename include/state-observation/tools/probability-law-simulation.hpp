@@ -12,9 +12,10 @@
 #ifndef SENSORSSIMULATIONPROBABILITYLAWSIMULATIONHPP
 #define SENSORSSIMULATIONPROBABILITYLAWSIMULATIONHPP
 
-#include <boost/random.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <state-observation/tools/definitions.hpp>
+#include <state-observation/tools/random-stream.hpp>
 
 
 namespace stateObservation
@@ -26,12 +27,18 @@ namespace stateObservation
         public:
 
             ///gets White Gaussian Noise
-            ///having a given bias and standard deviation(std)
+            ///having a given bias and standard deviation(std),
+            ///the stream is shared by the threads
             static Matrix getWGNoise( const Matrix & std, const Matrix & bias,
                 unsigned rows, unsigned cols=1);
 
+            ///gets White Gaussian Noise drawn from the given stream
+            static Matrix getWGNoise( const Matrix & std, const Matrix & bias,
+                RandomStream & stream, unsigned rows, unsigned cols=1);
+
         protected:
-            static boost::lagged_fibonacci1279 gen_;
+            static RandomStream stream_;
+            static boost::mutex mutex_;
 
         };
 
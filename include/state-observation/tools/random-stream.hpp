@@ -0,0 +1,95 @@
+/**
+ * \file      random-stream.hpp
+ * \brief     Counter-based random number streams
+ *
+ *
+ *
+ */
+
+#ifndef STATEOBSERVATIONTOOLSRANDOMSTREAM
+#define STATEOBSERVATIONTOOLSRANDOMSTREAM
+
+#include <boost/cstdint.hpp>
+
+namespace stateObservation
+{
+  namespace tools
+  {
+    /**
+     * \class  RandomStream
+     * \brief  Draws uniform and normal numbers from the Philox4x32-10
+     *         counter-based generator. The numbers are the encryption of a
+     *         counter with a key: the key is the seed and the counter is
+     *         made of the stream id and of the index of the draw.
+     *
+     *         A stream is then given by its seed and its id only, it does not
+     *         depend on the other streams, on the threads or on the order of
+     *         the draws of the other streams. Any position of the stream can
+     *         be reached in constant time.
+     *
+     */
+    class RandomStream
+    {
+    public:
+      ///a new stream of the default seed, the ids of these streams are
+      ///given in the order of the construction
+      RandomStream();
+
+      ///the stream of the given seed and id
+      RandomStream(boost::uint64_t seed, boost::uint64_t stream);
+
+      ///restarts from the beginning of the stream of the given seed and id
+      void setSeed(boost::uint64_t seed, boost::uint64_t stream);
+
+      boost::uint64_t getSeed() const
+      {
+        return seed_;
+      }
+
+      boost::uint64_t getStream() const
+      {
+        return stream_;
+      }
+
+      ///sets the position in the stream, each position gives two uniform
+      ///or two normal numbers
+      void setCounter(boost::uint64_t counter);
+
+      ///gets the position of the next draw
+      boost::uint64_t getCounter() const
+      {
+        return counter_;
+      }
+
+      ///uniform number in (0,1]
+      double uniform();
+
+      ///standard normal number (Box-Muller transform)
+      double normal();
+
+      ///the Philox4x32-10 function: encrypts the counter with the key
+      static void philox(const boost::uint32_t counter[4], const boost::uint32_t key[2],
+                         boost::uint32_t result[4]);
+
+      ///the seed of the streams built by default
+      static const boost::uint64_t defaultSeed=0;
+
+    protected:
+      ///computes the two uniform numbers of the current position and moves
+      ///to the next one
+      void nextBlock_();
+
+      boost::uint64_t seed_;
+      boost::uint64_t stream_;
+      boost::uint64_t counter_;
+
+      ///numbers of the current position which are not drawn yet
+      double uniforms_[2];
+      unsigned uniformsNumber_;
+      double normal_;
+      bool withNormal_;
+    };
+  }
+}
+
+#endif //STATEOBSERVATIONTOOLSRANDOMSTREAM
@@ -112,6 +112,13 @@ namespace stateObservation
     ///transform a 3d vector into a squared skew symmetric 3x3 matrix
     inline Matrix3 skewSymmetric2(const Vector3 & v);
 
+    ///left Jacobian of the rotation vector: for a small variation dv of v
+    ///the rotation matrix of v+dv is (I+[J dv]x) R(v)
+    inline Matrix3 rotationVectorLeftJacobian(const Vector3 & v);
+
+    ///inverse of the left Jacobian of the rotation vector
+    inline Matrix3 rotationVectorLeftJacobianInverse(const Vector3 & v);
+
     inline Matrix3 computeInertiaTensor(const Vector6 inputInertia, Matrix3& inertiaTensor);
 
     ///transforms a homogeneous matrix into 6d vector (position theta mu)
@@ -251,6 +251,50 @@ namespace stateObservation
       return skewSymmetric2(v,R);
     }
 
+    ///left Jacobian of the rotation vector
+    inline Matrix3 rotationVectorLeftJacobian(const Vector3 & v)
+    {
+      double angle2(v.squaredNorm());
+      double a,b;
+      if (angle2 > 1e-8)
+      {
+        double angle(sqrt(angle2));
+        a=(1-cos(angle))/angle2;
+        b=(angle-sin(angle))/(angle2*angle);
+      }
+      else
+      {
+        ///Taylor expansion
+        a=0.5-angle2/24;
+        b=1./6-angle2/120;
+      }
+
+      Matrix3 J(Matrix3::Identity());
+      J.noalias()+=a*skewSymmetric(v)+b*skewSymmetric2(v);
+      return J;
+    }
+
+    ///inverse of the left Jacobian of the rotation vector
+    inline Matrix3 rotationVectorLeftJacobianInverse(const Vector3 & v)
+    {
+      double angle2(v.squaredNorm());
+      double b;
+      if (angle2 > 1e-8)
+      {
+        double angle(sqrt(angle2));
+        b=1/angle2-(1+cos(angle))/(2*angle*sin(angle));
+      }
+      else
+      {
+        ///Taylor expansion
+        b=1./12+angle2/720;
+      }
+
+      Matrix3 J(Matrix3::Identity());
+      J.noalias()+=-0.5*skewSymmetric(v)+b*skewSymmetric2(v);
+      return J;
+    }
+
     inline Matrix3 computeInertiaTensor(const Vector6 inputInertia, Matrix3& inertiaTensor)
     {
 
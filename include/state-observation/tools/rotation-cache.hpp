@@ -0,0 +1,133 @@
+/**
+ * \file      rotation-cache.hpp
+ * \brief     Memoization of the conversions of rotation vectors into
+ *            rotation matrices and quaternions
+ *
+ *
+ *
+ */
+
+#ifndef STATEOBSERVATIONTOOLSROTATIONCACHE
+#define STATEOBSERVATIONTOOLSROTATIONCACHE
+
+#include <vector>
+
+#include <state-observation/tools/rigid-body-kinematics.hpp>
+
+namespace stateObservation
+{
+  namespace kine
+  {
+    /**
+     * \class  RotationCache
+     * \brief  Converts rotation vectors into rotation matrices and
+     *         quaternions and keeps the results. Each slot remembers the
+     *         last rotation vector it was given (compared exactly) and
+     *         the conversions are computed again only when this vector
+     *         changes. The number of hits and misses is counted.
+     *
+     */
+    class RotationCache
+    {
+    public:
+      explicit RotationCache(unsigned slotsNumber=1);
+
+      ///sets the number of slots, this clears the cache
+      void setSlotsNumber(unsigned slotsNumber);
+
+      unsigned getSlotsNumber() const;
+
+      ///gets the rotation matrix of the rotation vector v
+      inline const Matrix3 & getMatrix(const Vector3 & v, unsigned slot=0);
+
+      ///gets the quaternion of the rotation vector v
+      inline const Quaternion & getQuaternion(const Vector3 & v, unsigned slot=0);
+
+      ///number of conversions found in the cache
+      unsigned long getHits() const;
+
+      ///number of conversions computed
+      unsigned long getMisses() const;
+
+      ///ratio of the conversions found in the cache (zero if none was asked)
+      double getHitRate() const;
+
+      ///sets the number of hits and misses to zero
+      void resetStatistics();
+
+      ///forgets the stored conversions
+      void clear();
+
+    protected:
+      struct Slot
+      {
+        Slot();
+
+        Vector3 vector;
+        Matrix3 matrix;
+        Quaternion quaternion;
+
+        bool vectorSet;
+        bool matrixSet;
+        bool quaternionSet;
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+      };
+
+      inline Slot & getSlot_(const Vector3 & v, unsigned slot);
+
+      std::vector<Slot, Eigen::aligned_allocator<Slot> > slots_;
+
+      unsigned long hits_;
+      unsigned long misses_;
+    };
+
+    inline RotationCache::Slot & RotationCache::getSlot_(const Vector3 & v, unsigned slot)
+    {
+      BOOST_ASSERT(slot<slots_.size() && "ERROR: The rotation cache slot is out of range");
+      Slot & s=slots_[slot];
+      if (!s.vectorSet || s.vector!=v)
+      {
+        s.vector=v;
+        s.vectorSet=true;
+        s.matrixSet=false;
+        s.quaternionSet=false;
+      }
+      return s;
+    }
+
+    inline const Matrix3 & RotationCache::getMatrix(const Vector3 & v, unsigned slot)
+    {
+      Slot & s=getSlot_(v,slot);
+      if (s.matrixSet)
+      {
+        ++hits_;
+      }
+      else
+      {
+        ++misses_;
+        s.matrix=rotationVectorToAngleAxis(v).toRotationMatrix();
+        s.matrixSet=true;
+      }
+      return s.matrix;
+    }
+
+    inline const Quaternion & RotationCache::getQuaternion(const Vector3 & v, unsigned slot)
+    {
+      Slot & s=getSlot_(v,slot);
+      if (s.quaternionSet)
+      {
+        ++hits_;
+      }
+      else
+      {
+        ++misses_;
+        s.quaternion=rotationVectorToAngleAxis(v);
+        s.quaternionSet=true;
+      }
+      return s.quaternion;
+    }
+  }
+}
+
+#endif //STATEOBSERVATIONTOOLSROTATIONCACHE
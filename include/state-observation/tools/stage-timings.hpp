@@ -0,0 +1,149 @@
+/**
+ * \file      stage-timings.hpp
+ * \brief     Statistics on the computation time of the stages of an
+ *            algorithm (e.g. the steps of a Kalman filter)
+ *
+ *
+ *
+ */
+
+#ifndef STATEOBSERVATIONTOOLSSTAGETIMINGS
+#define STATEOBSERVATIONTOOLSSTAGETIMINGS
+
+#include <string>
+#include <vector>
+
+#include <state-observation/tools/definitions.hpp>
+
+///The timing instrumentation of the estimators is compiled only when
+///STATEOBSERVATION_WITH_TIMINGS is defined (CMake option WITH_TIMINGS)
+#ifdef STATEOBSERVATION_WITH_TIMINGS
+#   define STATEOBSERVATION_TIMING_START(timings,stage) (timings).start(stage)
+#   define STATEOBSERVATION_TIMING_STOP(timings,stage) (timings).stop(stage)
+#else
+#   define STATEOBSERVATION_TIMING_START(timings,stage)
+#   define STATEOBSERVATION_TIMING_STOP(timings,stage)
+#endif // STATEOBSERVATION_WITH_TIMINGS
+
+namespace stateObservation
+{
+  namespace tools
+  {
+    /**
+     * \class  DurationStatistics
+     * \brief  Accumulates durations (in nanoseconds). The minimum, the mean
+     *         and the maximum are computed over all the samples, the
+     *         percentiles over the last "capacity" samples which are kept
+     *         in a preallocated circular buffer.
+     *
+     */
+    class DurationStatistics
+    {
+    public:
+      explicit DurationStatistics(TimeSize capacity=defaultCapacity);
+
+      static const TimeSize defaultCapacity=1000;
+
+      ///adds a new duration, negative durations are counted as zero
+      inline void add(double duration);
+
+      ///number of durations added since the last reset
+      TimeSize getCount() const;
+
+      double getMin() const;
+      double getMean() const;
+      double getMax() const;
+
+      ///gets the percentile p (between 0 and 100) of the last samples
+      double getPercentile(double p) const;
+
+      ///clears all the statistics
+      void reset();
+
+    protected:
+      TimeSize count_;
+      double sum_;
+      double min_;
+      double max_;
+
+      std::vector<double> samples_;
+      TimeSize next_;
+
+      mutable std::vector<double> sorted_;
+    };
+
+    /**
+     * \class  StageTimings
+     * \brief  Measures the wall time of named stages using a
+     *         SimplestStopwatch per stage and gathers a DurationStatistics
+     *         for each of them.
+     *
+     */
+    class StageTimings
+    {
+    public:
+      StageTimings();
+
+      ///sets the names of the stages, this resets the statistics
+      void setStages(const std::vector<std::string> & names,
+                     TimeSize capacity=DurationStatistics::defaultCapacity);
+
+      inline void start(unsigned stage);
+
+      inline void stop(unsigned stage);
+
+      unsigned getStagesNumber() const;
+
+      const std::string & getStageName(unsigned stage) const;
+
+      const DurationStatistics & getStatistics(unsigned stage) const;
+
+      ///clears all the statistics
+      void reset();
+
+      ///writes one line per stage:
+      ///name count min mean p99 max (in nanoseconds)
+      void writeInFile(const std::string & filename) const;
+
+    protected:
+      std::vector<std::string> names_;
+      std::vector<DurationStatistics> statistics_;
+      std::vector<SimplestStopwatch> stopwatches_;
+    };
+
+    inline void DurationStatistics::add(double duration)
+    {
+      ///SimplestStopwatch removes the duration of its own start, a very
+      ///short stage can then be measured negative when the start is preempted
+      if (duration<0)
+        duration=0;
+
+      ++count_;
+      sum_+=duration;
+      if (duration<min_)
+        min_=duration;
+      if (duration>max_)
+        max_=duration;
+
+      if (samples_.size()>0)
+      {
+        samples_[next_]=duration;
+        next_=(next_+1)%samples_.size();
+      }
+    }
+
+    inline void StageTimings::start(unsigned stage)
+    {
+      BOOST_ASSERT(stage<stopwatches_.size() && "ERROR: The stage index is out of range");
+      stopwatches_[stage].start();
+    }
+
+    inline void StageTimings::stop(unsigned stage)
+    {
+      BOOST_ASSERT(stage<stopwatches_.size() && "ERROR: The stage index is out of range");
+      statistics_[stage].add(stopwatches_[stage].stop());
+    }
+  }
+}
+
+#endif //STATEOBSERVATIONTOOLSSTAGETIMINGS
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <state-observation/sensors-simulation/algebraic-sensor.hpp>
 
 namespace stateObservation
@@ -86,7 +88,27 @@ namespace stateObservation
 
     unsigned AlgebraicSensor::concatenateWithInput( unsigned n)
     {
+        if (n!=concat_)
+        {
+            unsigned spares=std::max(n,concat_)+1;
+            if (spareMeasurements_.size()<spares)
+            {
+                spareDirectInputs_.resize(spares);
+                spareMeasurements_.resize(spares);
+            }
+
+            ///keeps the containers of the current size and takes the ones
+            ///of the new size
+            directInputToOutput_.swap(spareDirectInputs_[concat_]);
+            noiselessMeasurement_.swap(spareMeasurements_[concat_]);
+            directInputToOutput_.swap(spareDirectInputs_[n]);
+            noiselessMeasurement_.swap(spareMeasurements_[n]);
+            storedNoiselessMeasurement_=false;
+            storedNoisyMeasurement_=false;
+        }
+
         concat_ = n;
+        directInputToOutput_.resize(concat_);
         noiselessMeasurement_.resize(getMeasurementSize());
         return unsigned(getMeasurementSize());
     }
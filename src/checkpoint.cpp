@@ -0,0 +1,150 @@
+#include <cstring>
+
+#include <state-observation/tools/checkpoint.hpp>
+
+namespace stateObservation
+{
+  namespace tools
+  {
+    Checkpoint::Checkpoint():
+      readPosition_(0)
+    {
+    }
+
+    void Checkpoint::clear()
+    {
+      data_.clear();
+      readPosition_=0;
+    }
+
+    void Checkpoint::rewind()
+    {
+      readPosition_=0;
+    }
+
+    TimeSize Checkpoint::size() const
+    {
+      return data_.size();
+    }
+
+    bool Checkpoint::atEnd() const
+    {
+      return readPosition_==data_.size();
+    }
+
+    void Checkpoint::write(bool b)
+    {
+      char c= b ? 1 : 0;
+      writeRaw_(&c,sizeof(c));
+    }
+
+    void Checkpoint::write(unsigned i)
+    {
+      writeRaw_(&i,sizeof(i));
+    }
+
+    void Checkpoint::write(long i)
+    {
+      writeRaw_(&i,sizeof(i));
+    }
+
+    void Checkpoint::write(double d)
+    {
+      writeRaw_(&d,sizeof(d));
+    }
+
+    void Checkpoint::read(bool & b)
+    {
+      char c;
+      readRaw_(&c,sizeof(c));
+      b=(c!=0);
+    }
+
+    void Checkpoint::read(unsigned & i)
+    {
+      readRaw_(&i,sizeof(i));
+    }
+
+    void Checkpoint::read(long & i)
+    {
+      readRaw_(&i,sizeof(i));
+    }
+
+    void Checkpoint::read(double & d)
+    {
+      readRaw_(&d,sizeof(d));
+    }
+
+    const std::vector<char> & Checkpoint::getData() const
+    {
+      return data_;
+    }
+
+    void Checkpoint::setData(const std::vector<char> & data)
+    {
+      data_=data;
+      readPosition_=0;
+    }
+
+    void Checkpoint::save(std::ostream & os) const
+    {
+      const unsigned tag=streamTag_;
+      const TimeSize bytes=data_.size();
+
+      os.write(reinterpret_cast<const char *>(&tag),sizeof(tag));
+      os.write(reinterpret_cast<const char *>(&bytes),sizeof(bytes));
+      if (bytes>0)
+      {
+        os.write(&data_[0],bytes);
+      }
+    }
+
+    void Checkpoint::load(std::istream & is, TimeSize maxBytes)
+    {
+      unsigned tag=0;
+      TimeSize bytes=0;
+
+      is.read(reinterpret_cast<char *>(&tag),sizeof(tag));
+      is.read(reinterpret_cast<char *>(&bytes),sizeof(bytes));
+      if (!is || tag!=streamTag_)
+      {
+        throw std::runtime_error("Checkpoint: the stream does not contain a checkpoint");
+      }
+
+      if (bytes>maxBytes)
+      {
+        throw std::runtime_error("Checkpoint: the checkpoint in the stream is too large");
+      }
+
+      data_.resize(bytes);
+      if (bytes>0)
+      {
+        is.read(&data_[0],bytes);
+      }
+      readPosition_=0;
+
+      if (!is)
+      {
+        data_.clear();
+        throw std::runtime_error("Checkpoint: the checkpoint in the stream is truncated");
+      }
+    }
+
+    void Checkpoint::writeRaw_(const void * data, TimeSize bytes)
+    {
+      TimeSize position=data_.size();
+      data_.resize(position+bytes);
+      std::memcpy(&data_[position],data,bytes);
+    }
+
+    void Checkpoint::readRaw_(void * data, TimeSize bytes)
+    {
+      if (readPosition_+bytes>data_.size())
+      {
+        throw std::runtime_error("Checkpoint: reading beyond the end of the data");
+      }
+      std::memcpy(data,&data_[readPosition_],bytes);
+      readPosition_+=bytes;
+    }
+  }
+}
@@ -16,6 +16,52 @@ namespace stateObservation
         //dtor
     }
 
+    void DynamicalSystemFunctorBase::computeStateDynamics
+        (const Vector& x, const Vector& u, TimeIndex k, Vector& xk1)
+    {
+        xk1=stateDynamics(x,u,k);
+    }
+
+    void DynamicalSystemFunctorBase::computeMeasureDynamics
+        (const Vector& x, const Vector& u, TimeIndex k, Vector& y)
+    {
+        y=measureDynamics(x,u,k);
+    }
+
+    void DynamicalSystemFunctorBase::stateDynamicsBatch
+        (const Matrix& x, const Matrix& u, TimeIndex k, Matrix& xk1)
+    {
+        assertBatch_(x,u);
+        xk1.resize(getStateSize(),x.cols());
+
+        for (unsigned i=0; i<unsigned(x.cols()); ++i)
+        {
+            batchX_=x.col(i);
+            if (i==0 || u.cols()>1)
+                batchU_=u.col(batchInputColumn_(u,i));
+
+            computeStateDynamics(batchX_,batchU_,k,batchY_);
+            xk1.col(i)=batchY_;
+        }
+    }
+
+    void DynamicalSystemFunctorBase::measureDynamicsBatch
+        (const Matrix& x, const Matrix& u, TimeIndex k, Matrix& y)
+    {
+        assertBatch_(x,u);
+        y.resize(getMeasurementSize(),x.cols());
+
+        for (unsigned i=0; i<unsigned(x.cols()); ++i)
+        {
+            batchX_=x.col(i);
+            if (i==0 || u.cols()>1)
+                batchU_=u.col(batchInputColumn_(u,i));
+
+            computeMeasureDynamics(batchX_,batchU_,k,batchY_);
+            y.col(i)=batchY_;
+        }
+    }
+
     bool DynamicalSystemFunctorBase::checkStateVector(const Vector & v)
     {
         return (unsigned(v.rows())==getStateSize() && v.cols()==1);
@@ -40,24 +40,23 @@ namespace stateObservation
     {
         if (!this->xbar_.isSet() || this->xbar_.getTime()!=k)
         {
+            BOOST_ASSERT (f_!=0x0 && "ERROR: The Kalman filter functor is not set");
+
             if ((p_>0) && (directInputStateProcessFeedthrough_))
             {
 
                 BOOST_ASSERT(this->u_.size()>0 && this->u_.checkIndex(k-1) &&
                                         "ERROR: The input vector is not set");
-                opt.u_=this->u_[k-1];
+                //the input is given without copy, no container depends on its size
+                f_->computeStateDynamics(this->x_(), this->u_[k-1], this->x_.getTime(), opt.xk1_);
             }
             else
             {
                 opt.u_ = inputVectorZero();
+                f_->computeStateDynamics(this->x_(), opt.u_, this->x_.getTime(), opt.xk1_);
             }
 
-            BOOST_ASSERT (f_!=0x0 && "ERROR: The Kalman filter functor is not set");
-            xbar_.set(f_->stateDynamics(
-                      this->x_(),
-                      opt.u_,
-                      this->x_.getTime()),
-                      k);
+            xbar_.set(opt.xk1_,k);
         }
 
         return xbar_();
@@ -68,13 +67,21 @@ namespace stateObservation
 
         if (!this->ybar_.isSet() || this->ybar_.getTime()!=k)
         {
-            ybar_.set(simulateSensor_(xbar_(),k),k);
+            simulateSensor_(xbar_(),k,opt.yk1_);
+            ybar_.set(opt.yk1_,k);
         }
 
         return ybar_();
     }
 
     ObserverBase::MeasureVector ExtendedKalmanFilter::simulateSensor_(const ObserverBase::StateVector& x, TimeIndex k)
+    {
+        simulateSensor_(x,k,opt.yk1_);
+        return opt.yk1_;
+    }
+
+    void ExtendedKalmanFilter::simulateSensor_
+        (const ObserverBase::StateVector& x, TimeIndex k, ObserverBase::MeasureVector& y)
     {
         BOOST_ASSERT (f_!=0x0 && "ERROR: The Kalman filter functor is not set");
 
@@ -91,21 +98,21 @@ must set directInputOutputFeedthrough to 'false' in the constructor");
 
             if (u_.checkIndex(k))
             {
-                opt.u_=u_[k];
-            }
-            else
-            {
-                opt.u_=inputVectorZero();
+                f_->computeMeasureDynamics(x,u_[k],k,y);
+                return;
             }
+
+            opt.u_=inputVectorZero();
         }
 
-        return f_->measureDynamics(x,opt.u_,k);
+        f_->computeMeasureDynamics(x,opt.u_,k,y);
     }
 
     KalmanFilterBase::Amatrix// ExtendedKalmanFilter<n,m,p>::Amatrix does not work
     ExtendedKalmanFilter::getAMatrixFD(const Vector
                                        &dx)
     {
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::jacobianA);
         TimeIndex k=this->x_.getTime();
         opt.a_.resize(nt_,nt_);
         opt.xbar_=prediction_(k+1);
@@ -120,16 +127,25 @@ must set directInputOutputFeedthrough to 'false' in the constructor");
                 opt.u_=inputVectorZero();
         }
 
+        opt.xBatch_.resize(n_,nt_);
+
         for (unsigned i=0;i<nt_;++i)
         {
-
             opt.dx_.setZero();
             opt.dx_[i]=dx[i];
 
             sum_(this->x_(),opt.dx_,opt.x_);
 
+            opt.xBatch_.col(i)=opt.x_;
+        }
+
+        //all the perturbed states are evaluated at once
+        opt.uBatch_=opt.u_;
+        f_->stateDynamicsBatch(opt.xBatch_,opt.uBatch_,k,opt.xpBatch_);
 
-            opt.xp_=f_->stateDynamics(opt.x_,opt.u_,k);
+        for (unsigned i=0;i<nt_;++i)
+        {
+            opt.xp_=opt.xpBatch_.col(i);
 
             difference_(opt.xp_,opt.xbar_,opt.dx_);
 
@@ -137,6 +153,7 @@ must set directInputOutputFeedthrough to 'false' in the constructor");
 
             opt.a_.col(i)=opt.dx_;
         }
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::jacobianA);
 
         return opt.a_;
     }
@@ -144,6 +161,7 @@ must set directInputOutputFeedthrough to 'false' in the constructor");
     KalmanFilterBase::Cmatrix
     ExtendedKalmanFilter::getCMatrixFD(const Vector  &dx)
     {
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::jacobianC);
         TimeIndex k=this->x_.getTime();
 
         opt.c_.resize(m_,nt_);
@@ -162,13 +180,14 @@ must set directInputOutputFeedthrough to 'false' in the constructor");
 
             sum_(opt.xbar_,opt.dx_,opt.xp_);
 
-            opt.yp_=simulateSensor_(opt.xp_, k+1);
+            simulateSensor_(opt.xp_, k+1, opt.yp_);
 
             opt.yp_-=opt.y_;
             opt.yp_/=dx[i];
 
             opt.c_.col(i)=opt.yp_;
         }
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::jacobianC);
 
         return opt.c_;
     }
@@ -180,6 +199,31 @@ must set directInputOutputFeedthrough to 'false' in the constructor");
             f_->reset();
     }
 
+    void ExtendedKalmanFilter::MeasurementWorkspace::resize(unsigned m, unsigned nt)
+    {
+        KalmanFilterBase::MeasurementWorkspace::resize(m,nt);
+        y.resize(m);
+        yp.resize(m);
+        yk1.resize(m);
+        cFD.resize(m,nt);
+        ybar.set(Vector::Zero(m),0);
+        ybar.reset();
+    }
+
+    void ExtendedKalmanFilter::swapMeasurementWorkspace(MeasurementWorkspace & w)
+    {
+        KalmanFilterBase::swapMeasurementWorkspace(w);
+
+        opt.y_.swap(w.y);
+        opt.yp_.swap(w.yp);
+        opt.yk1_.swap(w.yk1);
+        opt.c_.swap(w.cFD);
+
+        //the prediction of the previous size is not valid anymore
+        ybar_.swap(w.ybar);
+        ybar_.reset();
+    }
+
     DynamicalSystemFunctorBase* ExtendedKalmanFilter::functor() const
     {
         return f_;
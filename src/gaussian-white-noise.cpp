@@ -26,7 +26,7 @@ namespace stateObservation
     {
         checkVector_(v);
 
-        sum_(v,tools::ProbabilityLawSimulation::getWGNoise(std_, bias_,dim_),noisy_);
+        sum_(v,tools::ProbabilityLawSimulation::getWGNoise(std_, bias_, stream_, dim_),noisy_);
 
         return noisy_;
 
@@ -79,4 +79,14 @@ namespace stateObservation
     {
       sum_=sum;
     }
+
+    void GaussianWhiteNoise::setSeed(boost::uint64_t seed, boost::uint64_t stream)
+    {
+      stream_.setSeed(seed,stream);
+    }
+
+    tools::RandomStream & GaussianWhiteNoise::getRandomStream()
+    {
+      return stream_;
+    }
 }
@@ -7,8 +7,7 @@ namespace stateObservation
 {
 
     IMUDynamicalSystem::IMUDynamicalSystem()
-    :processNoise_(0x0),dt_(1),orientationVector_(Vector3::Zero()),
-        quaternion_(Quaternion::Identity())
+    :processNoise_(0x0),dt_(1),rotationCache_(2)
     {
 #ifdef STATEOBSERVATION_VERBOUS_CONSTRUCTORS
        std::cout<<std::endl<<"IMUFixedContactDynamicalSystem Constructor"<<std::endl;
@@ -22,85 +21,141 @@ namespace stateObservation
     }
 
     Vector IMUDynamicalSystem::stateDynamics
-        (const Vector& x, const Vector& u, TimeIndex)
+        (const Vector& x, const Vector& u, TimeIndex k)
+    {
+        Vector xk1;
+        computeStateDynamics(x,u,k,xk1);
+        return xk1;
+    }
+
+    void IMUDynamicalSystem::computeStateDynamics
+        (const Vector& x, const Vector& u, TimeIndex, Vector& xk1)
     {
         assertStateVector_(x);
         assertInputVector_(u);
 
-        Vector3 position=x.segment(indexes::pos,3);
-        Vector3 velocity=x.segment(indexes::linVel,3);
-        Vector3 acceleration=x.segment(indexes::linAcc,3);
+        Vector3 position=x.segment<3>(indexes::pos);
+        Vector3 velocity=x.segment<3>(indexes::linVel);
+        Vector3 acceleration=x.segment<3>(indexes::linAcc);
 
-        Vector3 orientationV=x.segment(indexes::ori,3);
-        Vector3 angularVelocity=x.segment(indexes::angVel,3);
-        Vector3 angularAcceleration=x.segment(indexes::angAcc,3);
+        Vector3 orientationV=x.segment<3>(indexes::ori);
+        Vector3 angularVelocity=x.segment<3>(indexes::angVel);
+        Vector3 angularAcceleration=x.segment<3>(indexes::angAcc);
 
         Quaternion orientation=computeQuaternion_(orientationV);
 
-        kine::integrateKinematics
-                (position, velocity, acceleration, orientation, angularVelocity,
-                        angularAcceleration, dt_);
+        kine::integrateKinematics(position, velocity, acceleration, dt_);
+
+        //same as kine::integrateKinematics, the rotation increment is cached
+        //because it does not change for most of the finite differences
+        orientation = rotationCache_.getQuaternion
+                        (angularVelocity*dt_ + 0.5 * dt_ * dt_ * angularAcceleration, 1)
+                    * orientation;
+        angularVelocity.noalias() += dt_ * angularAcceleration;
 
         //x_{k+1}
-        Vector xk1=Vector::Zero(18,1);
+        xk1.resize(stateSize_);
 
-        xk1.segment(indexes::pos,3) = position;
-        xk1.segment(indexes::linVel,3) = velocity;
+        xk1.segment<3>(indexes::pos) = position;
+        xk1.segment<3>(indexes::linVel) = velocity;
 
         AngleAxis orientationAA(orientation);
 
         orientationV=orientationAA.angle()*orientationAA.axis();
 
-        xk1.segment(indexes::ori,3) =  orientationV;
-        xk1.segment(indexes::angVel,3) = angularVelocity;
-
+        xk1.segment<3>(indexes::ori) =  orientationV;
+        xk1.segment<3>(indexes::angVel) = angularVelocity;
 
         //inputs
-        Vector3 accelerationInput =u.head(3);
-        Vector3 angularAccelerationInput =u.tail(3);
-
-        xk1.segment(indexes::linAcc,3)+=accelerationInput;
-        xk1.segment(indexes::angAcc,3)+=angularAccelerationInput;
+        xk1.segment<3>(indexes::linAcc) = u.head<3>();
+        xk1.segment<3>(indexes::angAcc) = u.tail<3>();
 
         if (processNoise_!=0x0)
-            return processNoise_->addNoise(xk1);
+            xk1=processNoise_->addNoise(xk1);
+    }
+
+    void IMUDynamicalSystem::stateDynamicsBatch
+        (const Matrix& x, const Matrix& u, TimeIndex, Matrix& xk1)
+    {
+        assertBatch_(x,u);
+
+        const unsigned n=unsigned(x.cols());
+        xk1.resize(stateSize_,n);
+
+        //translations, same operations as kine::integrateKinematics
+        xk1.middleRows<3>(indexes::pos) = x.middleRows<3>(indexes::pos) +
+            (dt_ * x.middleRows<3>(indexes::linVel) +
+             0.5 * dt_ * dt_ * x.middleRows<3>(indexes::linAcc));
+        xk1.middleRows<3>(indexes::linVel) = x.middleRows<3>(indexes::linVel) +
+            dt_ * x.middleRows<3>(indexes::linAcc);
+        xk1.middleRows<3>(indexes::angVel) = x.middleRows<3>(indexes::angVel) +
+            dt_ * x.middleRows<3>(indexes::angAcc);
+
+        //the accelerations are the inputs
+        if (u.cols()==1)
+        {
+            xk1.middleRows<3>(indexes::linAcc) = u.col(0).head<3>().replicate(1,n);
+            xk1.middleRows<3>(indexes::angAcc) = u.col(0).tail<3>().replicate(1,n);
+        }
         else
-            return xk1;
+        {
+            xk1.middleRows<3>(indexes::linAcc) = u.topRows<3>();
+            xk1.middleRows<3>(indexes::angAcc) = u.bottomRows<3>();
+        }
 
+        //rotations
+        for (unsigned i=0; i<n; ++i)
+        {
+            Quaternion orientation=rotationCache_.getQuaternion
+                (x.col(i).segment<3>(indexes::angVel)*dt_ +
+                 0.5 * dt_ * dt_ * x.col(i).segment<3>(indexes::angAcc), 1)
+              * computeQuaternion_(x.col(i).segment<3>(indexes::ori));
+
+            AngleAxis orientationAA(orientation);
+            xk1.col(i).segment<3>(indexes::ori) = orientationAA.angle()*orientationAA.axis();
+        }
+
+        if (processNoise_!=0x0)
+        {
+            for (unsigned i=0; i<n; ++i)
+                xk1.col(i)=processNoise_->addNoise(xk1.col(i));
+        }
     }
 
     Quaternion IMUDynamicalSystem::computeQuaternion_(const Vector3 & x)
     {
-        if (orientationVector_!=x)
-        {
-            quaternion_ = kine::rotationVectorToAngleAxis(x);
-            orientationVector_=x;
-        }
+        return rotationCache_.getQuaternion(x);
+    }
 
-        return quaternion_;
+    Vector IMUDynamicalSystem::measureDynamics (const Vector& x, const Vector& u, TimeIndex k)
+    {
+        Vector y;
+        computeMeasureDynamics(x,u,k,y);
+        return y;
     }
 
-    Vector IMUDynamicalSystem::measureDynamics (const Vector& x, const Vector& , TimeIndex k)
+    void IMUDynamicalSystem::computeMeasureDynamics
+        (const Vector& x, const Vector& , TimeIndex k, Vector& y)
     {
         assertStateVector_(x);
 
-        Vector3 acceleration=x.segment(indexes::linAcc,3);
+        Vector3 acceleration=x.segment<3>(indexes::linAcc);
 
-        Vector3 orientationV=x.segment(indexes::ori,3);
-        Vector3 angularVelocity=x.segment(indexes::angVel,3);
+        Vector3 orientationV=x.segment<3>(indexes::ori);
+        Vector3 angularVelocity=x.segment<3>(indexes::angVel);
 
         Quaternion q=computeQuaternion_(orientationV);
 
-        Vector v=Vector::Zero(10,1);
+        sensorState_.resize(10);
 
-        v.head<4>() = q.coeffs();
+        sensorState_.head<4>() = q.coeffs();
 
-        v.segment(4,3)=acceleration;
-        v.tail(3)=angularVelocity;
+        sensorState_.segment<3>(4)=acceleration;
+        sensorState_.tail<3>()=angularVelocity;
 
-        sensor_.setState(v,k);
+        sensor_.setState(sensorState_,k);
 
-        return sensor_.getMeasurements();
+        y=sensor_.getMeasurements();
     }
 
     void IMUDynamicalSystem::setProcessNoise( NoiseBase * n)
@@ -142,6 +197,11 @@ namespace stateObservation
         return measurementSize_;
     }
 
+    const kine::RotationCache & IMUDynamicalSystem::getRotationCache() const
+    {
+        return rotationCache_;
+    }
+
     NoiseBase * IMUDynamicalSystem::getProcessNoise() const
     {
         return processNoise_;
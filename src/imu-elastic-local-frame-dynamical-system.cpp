@@ -8,6 +8,8 @@
 #include <state-observation/flexibility-estimation/imu-elastic-local-frame-dynamical-system.hpp>
 #include <state-observation/tools/miscellaneous-algorithms.hpp>
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
 
 namespace stateObservation
 {
@@ -16,19 +18,28 @@ namespace stateObservation
     using namespace stateObservation;
 
    IMUElasticLocalFrameDynamicalSystem::
-    	IMUElasticLocalFrameDynamicalSystem(double dt):
+    	IMUElasticLocalFrameDynamicalSystem(double dt, unsigned contactsMaxNumber):
         processNoise_(0x0), dt_(dt),
         robotMass_(hrp2::m),
         robotMassInv_(1/hrp2::m),
+        contactsMaxNumber_(std::max(contactsMaxNumber,hrp2::contact::nbModeledMax)),
+        stateSize_(state::getSize(contactsMaxNumber_)),
         measurementSize_(measurementSizeBase_),
         withForceMeasurements_(false), withComBias_(false), withAbsolutePos_(false),
         withUnmodeledForces_(false),
+        analyticalJacobians_(true),
+        integrator_(integrator::euler),
+        integrationSubsampling_(1),
+        adaptiveIntegrationFactor_(0.5),
+        integrationEvaluations_(0),
         marginalStabilityFactor_(0.9999)
     {
 #ifdef STATEOBSERVATION_VERBOUS_CONSTRUCTORS
       // std::cout<<std::endl<<"IMUElasticLocalFrameDynamicalSystem Constructor"<<std::endl;
 
 #endif //STATEOBSERVATION_VERBOUS_CONSTRUCTOR
+      rotationCache_.setSlotsNumber(2+contactsMaxNumber_);
+
       Kfe_=40000*Matrix3::Identity();
       Kte_=600*Matrix3::Identity();
       Kfv_=600*Matrix3::Identity();
@@ -41,18 +52,32 @@ namespace stateObservation
 
       sensor_.setMatrixMode(true);
 
-      contactModel_=contactModel::none;
+      setContactModel(contactModel::none);
 
       nbContacts_=0;
       inputSize_=input::sizeBase;
 
       kcurrent_=-1;
 
-      fc_.resize(hrp2::contact::nbModeledMax*3);
+      BOOST_ASSERT(contactsMaxNumber<=hrp2::contact::nbMax &&
+                   "ERROR: The number of modeled contacts is too large");
+
+      fc_.resize(contactsMaxNumber_*3);
       fc_.setZero();
-      tc_.resize(hrp2::contact::nbModeledMax*3);
+      tc_.resize(contactsMaxNumber_*3);
       tc_.setZero();
 
+      //the efforts of all the modeled contacts are allocated once
+      for (unsigned i=0; i<contactsMaxNumber_; ++i)
+        op_.efforts.setValue(Vector6::Zero(),i);
+
+      op_.Jacc.resize(6,stateSize_);
+      op_.Jrot.resize(3,stateSize_);
+      op_.Jpos.resize(3,stateSize_);
+      op_.Jvel.resize(3,stateSize_);
+      op_.JangVel.resize(3,stateSize_);
+      op_.Jtemp.resize(3,stateSize_);
+
       printed_ = false;
       pe.setZero();
 
@@ -76,9 +101,41 @@ namespace stateObservation
     }
 
 
+    template <unsigned model>
+    void IMUElasticLocalFrameDynamicalSystem::selectContactModel_()
+    {
+      contactWrench_ = &IMUElasticLocalFrameDynamicalSystem::computeContactWrench_<model>;
+      forcesAndMoments_ = &IMUElasticLocalFrameDynamicalSystem::computeForcesAndMoments_<model>;
+      accelerations_ = &IMUElasticLocalFrameDynamicalSystem::computeAccelerations_<model>;
+      eulerStep_ = &IMUElasticLocalFrameDynamicalSystem::iterateDynamicsEuler_<model>;
+      semiImplicitEulerStep_ =
+        &IMUElasticLocalFrameDynamicalSystem::iterateDynamicsSemiImplicitEuler_<model>;
+      rk4Step_ = &IMUElasticLocalFrameDynamicalSystem::iterateDynamicsRK4_<model>;
+      stateDynamics_ = &IMUElasticLocalFrameDynamicalSystem::integrateStateDynamics_<model>;
+    }
+
     void IMUElasticLocalFrameDynamicalSystem::setContactModel(unsigned nb)
     {
       contactModel_=nb;
+
+      //selects the computations specialized for the model, the whole
+      //integration of the state dynamics is then instantiated for it
+      switch(contactModel_)
+      {
+      case contactModel::elasticContact :
+        selectContactModel_<contactModel::elasticContact>();
+        break;
+
+      case contactModel::pendulum :
+        selectContactModel_<contactModel::pendulum>();
+        break;
+
+      default:
+        selectContactModel_<contactModel::none>();
+      }
+
+      BOOST_ASSERT(getForceSlotsNumber()<=contactsMaxNumber_ &&
+                   "ERROR: The number of contacts exceeds the modeled contacts");
     }
 
 
@@ -87,41 +144,32 @@ namespace stateObservation
       assertStateVector_(x);
       assertInputVector_(u);
 
+      StateView xv(x);
+      InputView uv(u);
+
       // Getting flexibility
-      op_.positionFlex=x.segment(state::pos,3);
-      op_.orientationFlexV=x.segment(state::ori,3);
+      op_.positionFlex=xv.position();
+      op_.orientationFlexV=xv.orientation();
       op_.rFlex = computeRotation_(op_.orientationFlexV,0);
 
       // Getting contact forces
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-        op_.efforts.setValue(x.segment(state::fc+6*i,6),i);
+      readContactWrenches_(xv);
 
-      op_.fm=x.segment(state::unmodeledForces,3);
-      op_.tm=x.segment(state::unmodeledForces+3,3);
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-      {
-        fc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(0,0);
-        tc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(3,0);
-      }
+      op_.fm=xv.unmodeledForce();
+      op_.tm=xv.unmodeledMoment();
 
       // Getting CoM
-      op_.positionComBias <<  x.segment(state::comBias,2),
+      op_.positionComBias <<  xv.comBias(),
                           0;// the bias of the com along the z axis is assumed 0.
-      op_.positionCom=u.segment<3>(input::posCom);
+      op_.positionCom=uv.positionCom();
       if(withComBias_) op_.positionCom-=op_.positionComBias;
 
 
       // Getting contact positions
-      unsigned nbContacts(getContactsNumber());
-      for (unsigned i = 0; i<nbContacts ; ++i)
-      {
-        // Positions
-        op_.contactPosV.setValue(u.segment<3>(input::contacts + 12*i),i);
-        op_.contactOriV.setValue(u.segment<3>(input::contacts +12*i+3),i);
-      }
+      readContacts_(uv,false);
 
-      op_.addForce = u.segment<3>(input::additionalForces);
-      op_.addMoment = u.segment<3>(input::additionalForces+3);
+      op_.addForce = uv.additionalForce();
+      op_.addMoment = uv.additionalMoment();
 
       computeContactWrench(op_.rFlex, op_.positionFlex, op_.contactPosV, op_.contactOriV,
                            fc_, tc_, op_.fm, op_.tm, op_.addForce, op_.addMoment);
@@ -138,53 +186,39 @@ namespace stateObservation
       assertStateVector_(x);
       assertInputVector_(u);
 
-      op_.positionFlex=x.segment(state::pos,3);
-      op_.orientationFlexV=x.segment(state::ori,3);
+      StateView xv(x);
+      InputView uv(u);
+
+      op_.positionFlex=xv.position();
+      op_.orientationFlexV=xv.orientation();
       op_.rFlex = computeRotation_(op_.orientationFlexV,0);
       op_.rFlexT = computeRotation_(op_.orientationFlexV,0).transpose();
-      op_.velocityFlex=x.segment(state::linVel,3);
-      op_.angularVelocityFlex=x.segment(state::angVel,3);
+      op_.velocityFlex=xv.linVelocity();
+      op_.angularVelocityFlex=xv.angVelocity();
 
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-      {
-        op_.efforts.setValue(x.segment(state::fc+6*i,6),i);
-        fc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(0,0);
-        tc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(3,0);
-      }
-      op_.fm=x.segment(state::unmodeledForces,3);
-      op_.tm=x.segment(state::unmodeledForces+3,3);
+      readContactWrenches_(xv);
+      op_.fm=xv.unmodeledForce();
+      op_.tm=xv.unmodeledMoment();
 
-      op_.positionCom=u.segment<3>(input::posCom);
-      op_.velocityCom=u.segment<3>(input::velCom);
-      op_.accelerationCom=u.segment<3>(input::accCom);
+      op_.positionCom=uv.positionCom();
+      op_.velocityCom=uv.velocityCom();
+      op_.accelerationCom=uv.accelerationCom();
       if(withComBias_)
       {
-        op_.positionComBias <<  x.segment(state::comBias,2),
+        op_.positionComBias <<  xv.comBias(),
                             0;// the bias of the com along the z axis is assumed 0.
         op_.positionCom-=op_.positionComBias;
       }
 
-      kine::computeInertiaTensor(u.segment<6>(input::inertia),op_.inertia);
-      kine::computeInertiaTensor(u.segment<6>(input::dotInertia),op_.dotInertia);
-      op_.AngMomentum=u.segment<3>(input::angMoment);
-      op_.dotAngMomentum=u.segment<3>(input::dotAngMoment);
-
-      unsigned nbContacts(getContactsNumber());
-
-      for (unsigned i = 0; i<nbContacts ; ++i)
-      {
-        // Positions
-        op_.contactPosV.setValue(u.segment<3>(input::contacts + 12*i),i);
-        op_.contactOriV.setValue(u.segment<3>(input::contacts +12*i+3),i);
+      kine::computeInertiaTensor(uv.inertia(),op_.inertia);
+      kine::computeInertiaTensor(uv.dotInertia(),op_.dotInertia);
+      op_.AngMomentum=uv.angMomentum();
+      op_.dotAngMomentum=uv.dotAngMomentum();
 
-        // Velocities
-        op_.contactVelArray.setValue(u.segment<3>(input::contacts + 12*i +6),i);
-        op_.contactAngVelArray.setValue(u.segment<3>(input::contacts +12*i +9),i);
-
-      }
+      readContacts_(uv,true);
 
-      op_.addForce = u.segment<3>(input::additionalForces);
-      op_.addMoment = u.segment<3>(input::additionalForces+3);
+      op_.addForce = uv.additionalForce();
+      op_.addMoment = uv.additionalMoment();
 
 
       computeAccelerations (op_.positionCom, op_.velocityCom, op_. accelerationCom,
@@ -334,7 +368,8 @@ namespace stateObservation
     }
 
 
-    inline void IMUElasticLocalFrameDynamicalSystem::computeForcesAndMoments
+    template <unsigned model>
+    void IMUElasticLocalFrameDynamicalSystem::computeForcesAndMoments_
                           (const IndexedVectorArray& contactpos,
                            const IndexedVectorArray& contactori,
                            const IndexedVectorArray& contactvel,
@@ -344,49 +379,51 @@ namespace stateObservation
                            const Vector3& angVel,
                            Vector& fc, Vector& tc)
     {
-      switch(contactModel_)
-      {
-      case contactModel::elasticContact :
-        computeElastContactForcesAndMoments(contactpos, contactori, contactvel, contactangvel, position, linVelocity, oriVector, orientation, angVel, fc, tc);
-        break;
-
-      case contactModel::pendulum :
-        computeElastPendulumForcesAndMoments(contactpos, position, linVelocity, oriVector, orientation, angVel, fc, tc);
-        break;
-
-      default:
+      //the model is a compile-time constant, the other branches are removed
+      if (model==contactModel::elasticContact)
+        computeElastContactForcesAndMoments
+          (contactpos, contactori, contactvel, contactangvel, position, linVelocity, oriVector, orientation, angVel, fc, tc);
+      else if (model==contactModel::pendulum)
+        computeElastPendulumForcesAndMoments
+          (contactpos, position, linVelocity, oriVector, orientation, angVel, fc, tc);
+      else
         throw std::invalid_argument("IMUElasticLocalFrameDynamicalSystem: the contact model is incorrectly set.");
-      }
+    }
+
+    inline void IMUElasticLocalFrameDynamicalSystem::computeForcesAndMoments
+                          (const IndexedVectorArray& contactpos,
+                           const IndexedVectorArray& contactori,
+                           const IndexedVectorArray& contactvel,
+                           const IndexedVectorArray& contactangvel,
+                           const Vector3& position, const Vector3& linVelocity,
+                           const Vector3& oriVector, const Matrix3& orientation,
+                           const Vector3& angVel,
+                           Vector& fc, Vector& tc)
+    {
+      (this->*forcesAndMoments_)(contactpos, contactori, contactvel, contactangvel,
+                                 position, linVelocity, oriVector, orientation, angVel, fc, tc);
     }
 
     inline void IMUElasticLocalFrameDynamicalSystem::computeForcesAndMoments (const Vector& x,const Vector& u)
     {
+      StateView xv(x);
+      InputView uv(u);
 
-      op_.positionFlex=x.segment(state::pos,3);
-      op_.velocityFlex=x.segment(state::linVel,3);
-      op_.orientationFlexV=x.segment(state::ori,3);
-      op_.angularVelocityFlex=x.segment(state::angVel,3);
+      op_.positionFlex=xv.position();
+      op_.velocityFlex=xv.linVelocity();
+      op_.orientationFlexV=xv.orientation();
+      op_.angularVelocityFlex=xv.angVelocity();
       op_.rFlex = computeRotation_(op_.orientationFlexV,0);
 
-      unsigned nbContacts(getContactsNumber());
-
-      for (unsigned i = 0; i<nbContacts ; ++i)
-      {
-        // Positions
-        op_.contactPosV.setValue(u.segment<3>(input::contacts + 12*i),i);
-        op_.contactOriV.setValue(u.segment<3>(input::contacts +12*i+3),i);
-
-        // Velocities
-        op_.contactVelArray.setValue(u.segment<3>(input::contacts + 12*i +6),i);
-        op_.contactAngVelArray.setValue(u.segment<3>(input::contacts +12*i +9),i);
-      }
+      readContacts_(uv,true);
 
       computeForcesAndMoments (op_.contactPosV, op_.contactOriV, op_.contactVelArray, op_.contactAngVelArray,
                                op_.positionFlex, op_.velocityFlex, op_.orientationFlexV, op_.rFlex,
                                op_.angularVelocityFlex, fc_, tc_);
     }
 
-    void IMUElasticLocalFrameDynamicalSystem::computeContactWrench
+    template <unsigned model>
+    void IMUElasticLocalFrameDynamicalSystem::computeContactWrench_
             (const Matrix3& orientation, const Vector3& position,
              const IndexedVectorArray& contactPosV, const IndexedVectorArray& contactOriV,
              const Vector& fc, const Vector& tc, const Vector3 & fm, const Vector3& tm,
@@ -399,73 +436,71 @@ namespace stateObservation
       op_.f+=fm;
       op_.t+=tm;
 
-      if(contactModel_==contactModel::elasticContact)
+      if (model==contactModel::elasticContact)
       {
         for (unsigned i = 0; i<getContactsNumber() ; ++i)
         {
-          op_.Rci = kine::rotationVectorToAngleAxis(contactOriV[i]).toRotationMatrix();
+          op_.Rci.noalias() = orientation*computeRotation_(contactOriV[i],i+2);
           op_.globalContactPos.noalias() = orientation*contactPosV[i] + position ;
-          op_.fi=orientation*op_.Rci*fc.segment<3>(i*3);
+          op_.fi.noalias()=op_.Rci*fc.segment<3>(i*3);
           op_.f+= op_.fi;
-          op_.t+= orientation*op_.Rci*tc.segment<3>(i*3)+op_.globalContactPos.cross(op_.fi);
+          op_.t.noalias()+= op_.Rci*tc.segment<3>(i*3);
+          op_.t+= op_.globalContactPos.cross(op_.fi);
         }
       }
       else
       {
+        //the other models sum the forces in the first slot
         op_.f+=fc.segment<3>(0);
         op_.t+=tc.segment<3>(0);
       }
     }
 
+    void IMUElasticLocalFrameDynamicalSystem::computeContactWrench
+            (const Matrix3& orientation, const Vector3& position,
+             const IndexedVectorArray& contactPosV, const IndexedVectorArray& contactOriV,
+             const Vector& fc, const Vector& tc, const Vector3 & fm, const Vector3& tm,
+             const Vector3& addForce,const Vector3& addMoment)
+    {
+      (this->*contactWrench_)(orientation, position, contactPosV, contactOriV,
+                              fc, tc, fm, tm, addForce, addMoment);
+    }
+
     stateObservation::Vector IMUElasticLocalFrameDynamicalSystem::computeAccelerations(const Vector& x,const Vector& u)
     {
       assertStateVector_(x);
       assertInputVector_(u);
 
-      op_.positionFlex=x.segment(state::pos,3);
-      op_.orientationFlexV=x.segment(state::ori,3);
+      StateView xv(x);
+      InputView uv(u);
+
+      op_.positionFlex=xv.position();
+      op_.orientationFlexV=xv.orientation();
       op_.rFlex = computeRotation_(op_.orientationFlexV,0);
-      op_.velocityFlex=x.segment(state::linVel,3);
-      op_.angularVelocityFlex=x.segment(state::angVel,3);
+      op_.velocityFlex=xv.linVelocity();
+      op_.angularVelocityFlex=xv.angVelocity();
 
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-      {
-        op_.efforts.setValue(x.segment(state::fc+6*i,6),i);
-        fc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(0,0);
-        tc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(3,0);
-      }
+      readContactWrenches_(xv);
 
-      op_.positionComBias <<  x.segment(state::comBias,2),
+      op_.positionComBias <<  xv.comBias(),
                           0;// the bias of the com along the z axis is assumed 0.
-      op_.fm=x.segment(state::unmodeledForces,3);
-      op_.tm=x.segment(state::unmodeledForces+3,3);
-
-      kine::computeInertiaTensor(u.segment<6>(input::inertia),op_.inertia);
-      kine::computeInertiaTensor(u.segment<6>(input::dotInertia),op_.dotInertia);
-
-      unsigned nbContacts(getContactsNumber());
-
-      for (unsigned i = 0; i<nbContacts ; ++i)
-      {
-        // Positions
-        op_.contactPosV.setValue(u.segment<3>(input::contacts + 12*i),i);
-        op_.contactOriV.setValue(u.segment<3>(input::contacts +12*i+3),i);
+      op_.fm=xv.unmodeledForce();
+      op_.tm=xv.unmodeledMoment();
 
-        // Velocities
-        op_.contactVelArray.setValue(u.segment<3>(input::contacts + 12*i +6),i);
-        op_.contactAngVelArray.setValue(u.segment<3>(input::contacts +12*i +9),i);
+      kine::computeInertiaTensor(uv.inertia(),op_.inertia);
+      kine::computeInertiaTensor(uv.dotInertia(),op_.dotInertia);
 
-      }
+      readContacts_(uv,true);
 
-      op_.positionCom=u.segment<3>(input::posCom);
+      op_.positionCom=uv.positionCom();
       if(withComBias_) op_.positionCom-=op_.positionComBias;
-      op_.velocityCom=u.segment<3>(input::velCom);
-      op_.accelerationCom=u.segment<3>(input::accCom);
-      op_.AngMomentum=u.segment<3>(input::angMoment);
-      op_.dotAngMomentum=u.segment<3>(input::dotAngMoment);
+      op_.velocityCom=uv.velocityCom();
+      op_.accelerationCom=uv.accelerationCom();
+      op_.AngMomentum=uv.angMomentum();
+      op_.dotAngMomentum=uv.dotAngMomentum();
 
-      op_.addForce = u.segment<3>(input::additionalForces);
-      op_.addMoment = u.segment<3>(input::additionalForces+3);
+      op_.addForce = uv.additionalForce();
+      op_.addMoment = uv.additionalMoment();
 
 
       computeAccelerations
@@ -483,7 +518,8 @@ namespace stateObservation
       return acceleration;
     }
 
-    void IMUElasticLocalFrameDynamicalSystem::computeAccelerations
+    template <unsigned model>
+    void IMUElasticLocalFrameDynamicalSystem::computeAccelerations_
        (const Vector3& positionCom, const Vector3& velocityCom,
         const Vector3& accelerationCom, const Vector3& AngMomentum,
         const Vector3& dotAngMomentum,
@@ -508,7 +544,7 @@ namespace stateObservation
 
       op_.rFlexT.noalias()=orientation.transpose();
 
-      computeContactWrench(orientation, position, contactPosV, contactOriV,
+      computeContactWrench_<model>(orientation, position, contactPosV, contactOriV,
                            fc, tc, fm, tm, addForces, addMoments);
 
       op_.wx2Rc.noalias()=op_.skewV2R*positionCom;
@@ -548,7 +584,30 @@ namespace stateObservation
       linearAcceleration += kine::skewSymmetric(op_.Rc)*angularAcceleration;
     }
 
-    void IMUElasticLocalFrameDynamicalSystem::iterateDynamicsEuler
+    void IMUElasticLocalFrameDynamicalSystem::computeAccelerations
+       (const Vector3& positionCom, const Vector3& velocityCom,
+        const Vector3& accelerationCom, const Vector3& AngMomentum,
+        const Vector3& dotAngMomentum,
+        const Matrix3& Inertia, const Matrix3& dotInertia,
+        const IndexedVectorArray& contactPosV,
+        const IndexedVectorArray& contactOriV,
+        const Vector3& position, const Vector3& linVelocity, Vector3& linearAcceleration,
+        const Vector3 &oriVector ,const Matrix3& orientation,
+        const Vector3& angularVel, Vector3& angularAcceleration,
+        const Vector& fc, const Vector& tc,
+        const Vector3 & fm, const Vector3& tm,
+        const Vector3 & addForces, const Vector3& addMoments)
+    {
+      (this->*accelerations_)(positionCom, velocityCom, accelerationCom, AngMomentum,
+                              dotAngMomentum, Inertia, dotInertia, contactPosV, contactOriV,
+                              position, linVelocity, linearAcceleration, oriVector, orientation,
+                              angularVel, angularAcceleration, fc, tc, fm, tm,
+                              addForces, addMoments);
+    }
+
+
+    template <unsigned model>
+    void IMUElasticLocalFrameDynamicalSystem::iterateDynamicsEuler_
     (const Vector3& positionCom, const Vector3& velocityCom,
      const Vector3& accelerationCom, const Vector3& AngMomentum,
      const Vector3& dotAngMomentum,
@@ -569,7 +628,7 @@ namespace stateObservation
 //                          position, linVelocity, oriVector, op_.rFlex,
 //                             angularVel, fc, tc);
 
-      computeAccelerations (positionCom, velocityCom,
+      computeAccelerations_<model> (positionCom, velocityCom,
                             accelerationCom, AngMomentum, dotAngMomentum,
                             inertia, dotInertia,  contactPos, contactOri, position, linVelocity, op_.linearAcceleration,
                             oriVector, op_.rFlex, angularVel, op_.angularAcceleration,
@@ -615,12 +674,87 @@ namespace stateObservation
       op_.orientationAA=op_.rFlex;
       oriVector.noalias()=op_.orientationAA.angle()*op_.orientationAA.axis();
 
-      computeForcesAndMoments (contactPos, contactOri, op_.contactVelArray, op_.contactAngVelArray,
+      computeForcesAndMoments_<model> (contactPos, contactOri, op_.contactVelArray, op_.contactAngVelArray,
                                position, linVelocity, oriVector, op_.rFlex,
                                angularVel, fc, tc);
     }
 
-    void IMUElasticLocalFrameDynamicalSystem::iterateDynamicsRK4
+    void IMUElasticLocalFrameDynamicalSystem::iterateDynamicsEuler
+    (const Vector3& positionCom, const Vector3& velocityCom,
+     const Vector3& accelerationCom, const Vector3& AngMomentum,
+     const Vector3& dotAngMomentum,
+     const Matrix3& inertia, const Matrix3& dotInertia,
+     const IndexedVectorArray& contactPos,
+     const IndexedVectorArray& contactOri,
+     Vector3& position, Vector3& linVelocity, Vector& fc,
+     Vector3 &oriVector, Vector3& angularVel, Vector& tc,
+     const Vector3 & fm, const Vector3& tm, const Vector3 &addiForces,
+     const Vector3 & addiMoments,
+     double dt)
+    {
+      (this->*eulerStep_)(positionCom, velocityCom, accelerationCom, AngMomentum, dotAngMomentum,
+                  inertia, dotInertia, contactPos, contactOri, position, linVelocity, fc,
+                  oriVector, angularVel, tc, fm, tm, addiForces, addiMoments, dt);
+    }
+
+
+    template <unsigned model>
+    void IMUElasticLocalFrameDynamicalSystem::iterateDynamicsSemiImplicitEuler_
+    (const Vector3& positionCom, const Vector3& velocityCom,
+     const Vector3& accelerationCom, const Vector3& AngMomentum,
+     const Vector3& dotAngMomentum,
+     const Matrix3& inertia, const Matrix3& dotInertia,
+     const IndexedVectorArray& contactPos,
+     const IndexedVectorArray& contactOri,
+     Vector3& position, Vector3& linVelocity, Vector& fc,
+     Vector3 &oriVector, Vector3& angularVel, Vector& tc,
+     const Vector3 & fm, const Vector3& tm, const Vector3 &addiForces,
+     const Vector3 & addiMoments,
+     double dt)
+    {
+      op_.rFlex = computeRotation_(oriVector,0);
+
+      computeAccelerations_<model> (positionCom, velocityCom,
+                            accelerationCom, AngMomentum, dotAngMomentum,
+                            inertia, dotInertia,  contactPos, contactOri, position, linVelocity, op_.linearAcceleration,
+                            oriVector, op_.rFlex, angularVel, op_.angularAcceleration,
+                            fc, tc, fm,tm, addiForces, addiMoments);
+
+      ///the velocities are updated first and then integrated
+      linVelocity.noalias() += dt*op_.linearAcceleration;
+      angularVel.noalias() += dt*op_.angularAcceleration;
+
+      kine::integrateKinematics(position, linVelocity, op_.rFlex, angularVel, dt);
+
+      op_.orientationAA=op_.rFlex;
+      oriVector.noalias()=op_.orientationAA.angle()*op_.orientationAA.axis();
+
+      computeForcesAndMoments_<model> (contactPos, contactOri, op_.contactVelArray, op_.contactAngVelArray,
+                               position, linVelocity, oriVector, op_.rFlex,
+                               angularVel, fc, tc);
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::iterateDynamicsSemiImplicitEuler
+    (const Vector3& positionCom, const Vector3& velocityCom,
+     const Vector3& accelerationCom, const Vector3& AngMomentum,
+     const Vector3& dotAngMomentum,
+     const Matrix3& inertia, const Matrix3& dotInertia,
+     const IndexedVectorArray& contactPos,
+     const IndexedVectorArray& contactOri,
+     Vector3& position, Vector3& linVelocity, Vector& fc,
+     Vector3 &oriVector, Vector3& angularVel, Vector& tc,
+     const Vector3 & fm, const Vector3& tm, const Vector3 &addiForces,
+     const Vector3 & addiMoments,
+     double dt)
+    {
+      (this->*semiImplicitEulerStep_)(positionCom, velocityCom, accelerationCom, AngMomentum, dotAngMomentum,
+                  inertia, dotInertia, contactPos, contactOri, position, linVelocity, fc,
+                  oriVector, angularVel, tc, fm, tm, addiForces, addiMoments, dt);
+    }
+
+
+    template <unsigned model>
+    void IMUElasticLocalFrameDynamicalSystem::iterateDynamicsRK4_
              (const Vector3& positionCom, const Vector3& velocityCom,
               const Vector3& accelerationCom, const Vector3& AngMomentum,
               const Vector3& dotAngMomentum,
@@ -676,7 +810,7 @@ namespace stateObservation
       Vector3 angAcc4;
 
         //////////1st/////////////
-        computeAccelerations (positionCom, velocityCom,
+        computeAccelerations_<model> (positionCom, velocityCom,
                         accelerationCom, AngMomentum, dotAngMomentum,
                         inertia, dotInertia,  contactPos, contactOri,
                         position, linVelocity, linAcc1, oriVector,
@@ -697,7 +831,12 @@ namespace stateObservation
       angVelocity2 = angularVel + (dt/2)*angAcc1;
 
 
-      computeAccelerations (positionCom, velocityCom,
+      ///the contact wrenches are recomputed with the stage kinematics
+      computeForcesAndMoments_<model> (contactPos, contactOri, op_.contactVelArray, op_.contactAngVelArray,
+                               pos2, linVelocity2, oriv2, ori2,
+                               angVelocity2, fc, tc);
+
+      computeAccelerations_<model> (positionCom, velocityCom,
                             accelerationCom, AngMomentum, dotAngMomentum,
                             inertia, dotInertia,  contactPos, contactOri,
                             pos2, linVelocity2, linAcc2, oriv2,
@@ -717,12 +856,16 @@ namespace stateObservation
       linVelocity3 = linVelocity + (dt/2)*linAcc2;
       angVelocity3 = angularVel + (dt/2)*angAcc2;
 
-      computeAccelerations (positionCom, velocityCom,
+      computeForcesAndMoments_<model> (contactPos, contactOri, op_.contactVelArray, op_.contactAngVelArray,
+                               pos3, linVelocity3, oriv3, ori3,
+                               angVelocity3, fc, tc);
+
+      computeAccelerations_<model> (positionCom, velocityCom,
                             accelerationCom, AngMomentum, dotAngMomentum,
                             inertia, dotInertia,  contactPos, contactOri,
                             pos3, linVelocity3, linAcc3, oriv3,
                             ori3, angVelocity3, angAcc3,
-                            tc, fc, fm, tm,
+                            fc, tc, fm, tm,
                             addForces, addMoments);
 
 
@@ -738,7 +881,11 @@ namespace stateObservation
       linVelocity4 = linVelocity + (dt)*linAcc3;
       angVelocity4 = angularVel + (dt)*angAcc3;
 
-      computeAccelerations (positionCom, velocityCom,
+      computeForcesAndMoments_<model> (contactPos, contactOri, op_.contactVelArray, op_.contactAngVelArray,
+                               pos4, linVelocity4, oriv4, ori4,
+                               angVelocity4, fc, tc);
+
+      computeAccelerations_<model> (positionCom, velocityCom,
                             accelerationCom, AngMomentum, dotAngMomentum,
                             inertia, dotInertia,  contactPos, contactOri,
                             pos4, linVelocity4, linAcc4, oriv4,
@@ -761,82 +908,169 @@ namespace stateObservation
 
       // Getting forces
       op_.rFlex = computeRotation_(oriVector,0);
-      computeForcesAndMoments (contactPos, contactOri, op_.contactVelArray, op_.contactAngVelArray,
+      computeForcesAndMoments_<model> (contactPos, contactOri, op_.contactVelArray, op_.contactAngVelArray,
                                position, linVelocity, oriVector, op_.rFlex,
                                angularVel, fc, tc);
     }
 
+    void IMUElasticLocalFrameDynamicalSystem::iterateDynamicsRK4
+    (const Vector3& positionCom, const Vector3& velocityCom,
+     const Vector3& accelerationCom, const Vector3& AngMomentum,
+     const Vector3& dotAngMomentum,
+     const Matrix3& inertia, const Matrix3& dotInertia,
+     const IndexedVectorArray& contactPos,
+     const IndexedVectorArray& contactOri,
+     Vector3& position, Vector3& linVelocity, Vector& fc,
+     Vector3 &oriVector, Vector3& angularVel, Vector& tc,
+     const Vector3 & fm, const Vector3& tm, const Vector3 &addiForces,
+     const Vector3 & addiMoments,
+     double dt)
+    {
+      (this->*rk4Step_)(positionCom, velocityCom, accelerationCom, AngMomentum, dotAngMomentum,
+                  inertia, dotInertia, contactPos, contactOri, position, linVelocity, fc,
+                  oriVector, angularVel, tc, fm, tm, addiForces, addiMoments, dt);
+    }
+
+
     Vector IMUElasticLocalFrameDynamicalSystem::stateDynamics
-    (const Vector& x, const Vector& u, TimeIndex)
+    (const Vector& x, const Vector& u, TimeIndex k)
     {
+      Vector xk1;
+      computeStateDynamics(x,u,k,xk1);
+      return xk1;
+    }
 
+    void IMUElasticLocalFrameDynamicalSystem::computeStateDynamics
+    (const Vector& x, const Vector& u, TimeIndex, Vector& xk1)
+    {
       assertStateVector_(x);
       assertInputVector_(u);
 
       xk_=x;
       uk_=u;
 
-      op_.positionFlex=x.segment(state::pos,3);
-      op_.orientationFlexV=x.segment(state::ori,3);
-      op_.velocityFlex=x.segment(state::linVel,3);
-      op_.angularVelocityFlex=x.segment(state::angVel,3);
+      readStateInput_(InputView(u));
 
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-        op_.efforts.setValue(x.segment(state::fc+6*i,6),i);
+      xk1_.resize(stateSize_);
+      computeStateDynamics_(StateView(x),InputView(u),xk1_.data());
 
-      op_.positionComBias <<  x.segment(state::comBias,2),
-                          0;// the bias of the com along the z axis is assumed 0.
-      op_.fm=x.segment(state::unmodeledForces,3);
-      op_.tm=x.segment(state::unmodeledForces+3,3);
+      if (processNoise_!=0x0)
+        xk1=processNoise_->addNoise(xk1_);
+      else
+        xk1=xk1_;
+    }
 
-      kine::computeInertiaTensor(u.segment<6>(input::inertia),op_.inertia);
-      kine::computeInertiaTensor(u.segment<6>(input::dotInertia),op_.dotInertia);
+    void IMUElasticLocalFrameDynamicalSystem::stateDynamicsBatch
+    (const Matrix& x, const Matrix& u, TimeIndex, Matrix& xk1)
+    {
+      assertBatch_(x,u);
 
-      unsigned nbContacts(getContactsNumber());
+      const unsigned n=unsigned(x.cols());
+      xk1.resize(stateSize_,n);
 
-      for (unsigned i = 0; i<nbContacts ; ++i)
+      for (unsigned i=0; i<n; ++i)
       {
-        // Positions
-        op_.contactPosV.setValue(u.segment<3>(input::contacts + 12*i),i);
-        op_.contactOriV.setValue(u.segment<3>(input::contacts +12*i+3),i);
+        const unsigned j=batchInputColumn_(u,i);
 
-        // Velocities
-        op_.contactVelArray.setValue(u.segment<3>(input::contacts + 12*i +6),i);
-        op_.contactAngVelArray.setValue(u.segment<3>(input::contacts +12*i +9),i);
+        //a shared input is read once for all the states
+        if (i==0 || j>0)
+          readStateInput_(InputView(u.col(j).data()));
 
+        computeStateDynamics_(StateView(x.col(i).data()),InputView(u.col(j).data()),
+                              xk1.col(i).data());
+
+        if (processNoise_!=0x0)
+          xk1.col(i)=processNoise_->addNoise(xk1.col(i));
       }
+    }
 
-      op_.positionCom=u.segment<3>(input::posCom);
-      if(withComBias_) op_.positionCom-=op_.positionComBias;
-      op_.velocityCom=u.segment<3>(input::velCom);
-      op_.accelerationCom=u.segment<3>(input::accCom);
-      op_.AngMomentum=u.segment<3>(input::angMoment);
-      op_.dotAngMomentum=u.segment<3>(input::dotAngMoment);
+    void IMUElasticLocalFrameDynamicalSystem::readStateInput_(const InputView & uv)
+    {
+      kine::computeInertiaTensor(uv.inertia(),op_.inertia);
+      kine::computeInertiaTensor(uv.dotInertia(),op_.dotInertia);
 
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-      {
-        fc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(0,0);
-        tc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(3,0);
-      }
+      readContacts_(uv,true);
+
+      op_.velocityCom=uv.velocityCom();
+      op_.accelerationCom=uv.accelerationCom();
+      op_.AngMomentum=uv.angMomentum();
+      op_.dotAngMomentum=uv.dotAngMomentum();
+
+      op_.addForce = uv.additionalForce();
+      op_.addMoment = uv.additionalMoment();
+    }
+
+    template <unsigned model>
+    void IMUElasticLocalFrameDynamicalSystem::integrateStateDynamics_
+    (const StateView & xv, const InputView & uv, double * xk1Data)
+    {
+      op_.positionFlex=xv.position();
+      op_.orientationFlexV=xv.orientation();
+      op_.velocityFlex=xv.linVelocity();
+      op_.angularVelocityFlex=xv.angVelocity();
+
+      readContactWrenches_(xv);
+
+      op_.positionComBias <<  xv.comBias(),
+                          0;// the bias of the com along the z axis is assumed 0.
+      op_.fm=xv.unmodeledForce();
+      op_.tm=xv.unmodeledMoment();
 
-      op_.addForce = u.segment<3>(input::additionalForces);
-      op_.addMoment = u.segment<3>(input::additionalForces+3);
+      //the com position depends on the bias in the state
+      op_.positionCom=uv.positionCom();
+      if(withComBias_) op_.positionCom-=op_.positionComBias;
+
+      unsigned subsample=integrationSubsampling_;
+      if (integrator_==integrator::adaptive)
+        subsample=computeAdaptiveSubsampling_();
 
-      const int subsample=1;
-      for (int i=0; i<subsample; ++i)
+      for (unsigned i=0; i<subsample; ++i)
       {
-        iterateDynamicsEuler (
-          op_.positionCom, op_.velocityCom,
-          op_.accelerationCom, op_.AngMomentum, op_.dotAngMomentum,
-          op_.inertia, op_.dotInertia,  op_.contactPosV, op_.contactOriV,
-          op_.positionFlex, op_.velocityFlex, fc_,
-          op_.orientationFlexV, op_.angularVelocityFlex,
-          tc_, op_.fm, op_.tm,op_.addForce,op_.addMoment,
-          dt_/subsample);
+        switch(integrator_)
+        {
+        case integrator::euler :
+          iterateDynamicsEuler_<model> (
+            op_.positionCom, op_.velocityCom,
+            op_.accelerationCom, op_.AngMomentum, op_.dotAngMomentum,
+            op_.inertia, op_.dotInertia,  op_.contactPosV, op_.contactOriV,
+            op_.positionFlex, op_.velocityFlex, fc_,
+            op_.orientationFlexV, op_.angularVelocityFlex,
+            tc_, op_.fm, op_.tm,op_.addForce,op_.addMoment,
+            dt_/subsample);
+          break;
+
+        case integrator::semiImplicitEuler :
+        case integrator::adaptive :
+          iterateDynamicsSemiImplicitEuler_<model> (
+            op_.positionCom, op_.velocityCom,
+            op_.accelerationCom, op_.AngMomentum, op_.dotAngMomentum,
+            op_.inertia, op_.dotInertia,  op_.contactPosV, op_.contactOriV,
+            op_.positionFlex, op_.velocityFlex, fc_,
+            op_.orientationFlexV, op_.angularVelocityFlex,
+            tc_, op_.fm, op_.tm,op_.addForce,op_.addMoment,
+            dt_/subsample);
+          break;
+
+        case integrator::rk4 :
+          iterateDynamicsRK4_<model> (
+            op_.positionCom, op_.velocityCom,
+            op_.accelerationCom, op_.AngMomentum, op_.dotAngMomentum,
+            op_.inertia, op_.dotInertia,  op_.contactPosV, op_.contactOriV,
+            op_.positionFlex, op_.velocityFlex, fc_,
+            op_.orientationFlexV, op_.angularVelocityFlex,
+            tc_, op_.fm, op_.tm,op_.addForce,op_.addMoment,
+            dt_/subsample);
+          break;
+
+        default:
+          throw std::invalid_argument("IMUElasticLocalFrameDynamicalSystem: the integrator is incorrectly set.");
+        }
       }
+
+      integrationEvaluations_ = (integrator_==integrator::rk4) ? 4*subsample : subsample;
       //x_{k+1}
 
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
+      for (unsigned i=0; i<getForceSlotsNumber(); ++i)
       {
         //std::cout << "Contact " << i << std::endl
         //          << fc_.segment<3>(3*i).transpose() << std::endl
@@ -845,54 +1079,148 @@ namespace stateObservation
         op_.efforts[i].block<3,1>(3,0) = tc_.segment<3>(3*i);
       }
 
-      xk1_=x;
+      Eigen::Map<Vector> xk1(xk1Data,stateSize_);
+      xk1=Eigen::Map<const Vector>(xv.data(),stateSize_);
+
+      xk1.segment<3>(state::pos) = op_.positionFlex;
+      xk1.segment<3>(state::ori) =  op_.orientationFlexV;
 
-      xk1_.segment<3>(state::pos) = op_.positionFlex;
-      xk1_.segment<3>(state::ori) =  op_.orientationFlexV;
+      xk1.segment<3>(state::linVel) = op_.velocityFlex;
+      xk1.segment<3>(state::angVel) = op_.angularVelocityFlex;
 
-      xk1_.segment<3>(state::linVel) = op_.velocityFlex;
-      xk1_.segment<3>(state::angVel) = op_.angularVelocityFlex;
+      for (unsigned i=0; i<getForceSlotsNumber(); ++i)
+        xk1.segment<6>(state::fcIndex(i)) = op_.efforts[i].col(0);
 
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-        xk1_.segment(state::fc+6*i,6) = op_.efforts[i].col(0);
+      //the forces of the inactive contacts are zero
+      for (unsigned i=getForceSlotsNumber(); i<contactsMaxNumber_; ++i)
+        xk1.segment<6>(state::fcIndex(i)).setZero();
 
       // xk1_.segment<2>(state::comBias) = op_.positionComBias.head<2>();
 
       if (withUnmodeledForces_)
       {
-        xk1_.segment<3>(state::unmodeledForces) =
+        xk1.segment<3>(state::unmodeledForces) =
           marginalStabilityFactor_*op_.fm;
-        xk1_.segment<3>(state::unmodeledForces+3) =
+        xk1.segment<3>(state::unmodeledForces+3) =
           marginalStabilityFactor_*op_.tm;
       }
       else
       {
-        xk1_.segment<6>(state::unmodeledForces).setZero();
+        xk1.segment<6>(state::unmodeledForces).setZero();
       }
+    }
 
-      if (processNoise_!=0x0)
-        return processNoise_->addNoise(op_.xk1);
+    void IMUElasticLocalFrameDynamicalSystem::computeStateDynamics_
+    (const StateView & xv, const InputView & uv, double * xk1Data)
+    {
+      (this->*stateDynamics_)(xv,uv,xk1Data);
+    }
+
+
+
+    unsigned IMUElasticLocalFrameDynamicalSystem::computeAdaptiveSubsampling_() const
+    {
+      const Matrix3 & Kfe = (contactModel_==contactModel::pendulum) ? KfeRopes_ : Kfe_;
+      const Matrix3 & Kfv = (contactModel_==contactModel::pendulum) ? KfvRopes_ : Kfv_;
+      const Matrix3 & Kte = (contactModel_==contactModel::pendulum) ? KteRopes_ : Kte_;
+      const Matrix3 & Ktv = (contactModel_==contactModel::pendulum) ? KtvRopes_ : Ktv_;
+
+      //the contacts act in parallel
+      double n = std::max(nbContacts_,1u);
+
+      //smallest time constant of the linear and angular mass-spring-damper
+      //systems made by the robot and its contacts
+      double tau = std::min(std::sqrt(robotMass_/(n*Kfe.diagonal().maxCoeff())),
+                            robotMass_/(n*Kfv.diagonal().maxCoeff()));
+
+      double inertia = op_.inertia.diagonal().minCoeff();
+      if (inertia>0)
+      {
+        tau = std::min(tau, std::sqrt(inertia/(n*Kte.diagonal().maxCoeff())));
+        tau = std::min(tau, inertia/(n*Ktv.diagonal().maxCoeff()));
+      }
+
+      double subsample = std::ceil(dt_/(adaptiveIntegrationFactor_*tau));
+
+      if (!(subsample<adaptiveIntegrationMaxSubsampling_)) //also true for NaN
+        return adaptiveIntegrationMaxSubsampling_;
       else
-        return xk1_;
+        return std::max(unsigned(subsample),1u);
+    }
+
+    bool IMUElasticLocalFrameDynamicalSystem::analyticalStateJacobianAvailable_() const
+    {
+      return contactModel_==contactModel::elasticContact &&
+             integrator_==integrator::euler && integrationSubsampling_==1;
     }
 
+    unsigned IMUElasticLocalFrameDynamicalSystem::getForceSlotsNumber() const
+    {
+      if (contactModel_==contactModel::elasticContact)
+        return nbContacts_;
+      else
+        return 1; //the other models sum the forces in the first slot
+    }
 
-    inline Matrix3& IMUElasticLocalFrameDynamicalSystem::computeRotation_
+    inline const Matrix3& IMUElasticLocalFrameDynamicalSystem::computeRotation_
     (const Vector3 & x, int i)
     {
-      Vector3 & oriV = op_.orientationVector(i);
-      Matrix3 & oriR = op_.curRotation(i);
-      if (oriV!=x)
+      return rotationCache_.getMatrix(x,i);
+    }
+
+    const kine::RotationCache & IMUElasticLocalFrameDynamicalSystem::getRotationCache() const
+    {
+      return rotationCache_;
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::readContacts_
+    (const InputView & u, bool withVelocities)
+    {
+      for (unsigned i = 0; i<getContactsNumber() ; ++i)
       {
-        oriV = x;
-        oriR = kine::rotationVectorToAngleAxis(x).toRotationMatrix();
+        //the arrays are only extended when a contact is added
+        if (!op_.contactPosV.checkIndex(i))
+        {
+          op_.contactPosV.setValue(Vector3::Zero(),i);
+          op_.contactOriV.setValue(Vector3::Zero(),i);
+        }
+
+        op_.contactPosV[i] = u.contactPosition(i);
+        op_.contactOriV[i] = u.contactOrientation(i);
+
+        if (withVelocities)
+        {
+          if (!op_.contactVelArray.checkIndex(i))
+          {
+            op_.contactVelArray.setValue(Vector3::Zero(),i);
+            op_.contactAngVelArray.setValue(Vector3::Zero(),i);
+          }
+
+          op_.contactVelArray[i] = u.contactVelocity(i);
+          op_.contactAngVelArray[i] = u.contactAngVelocity(i);
+        }
       }
+    }
 
-      return oriR;
+    void IMUElasticLocalFrameDynamicalSystem::readContactWrenches_(const StateView & x)
+    {
+      for (unsigned i=0; i<getForceSlotsNumber(); ++i)
+      {
+        op_.efforts[i] = x.contactWrench(i);
+        fc_.segment<3>(3*i) = x.contactWrench(i).head<3>();
+        tc_.segment<3>(3*i) = x.contactWrench(i).tail<3>();
+      }
     }
 
     Vector IMUElasticLocalFrameDynamicalSystem::measureDynamics
     (const Vector& x, const Vector& u, TimeIndex k)
+    {
+      computeMeasureDynamics(x,u,k,yk_);
+      return yk_;
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::computeMeasureDynamics
+    (const Vector& x, const Vector& u, TimeIndex k, Vector& y)
     {
       assertStateVector_(x);
       assertInputVector_(u);
@@ -901,54 +1229,79 @@ namespace stateObservation
       uk_fory_=u;
       op_.k_fory=k;
 
-      op_.positionFlex=x.segment(state::pos,3);
-      op_.velocityFlex=x.segment(state::linVel,3);
-      op_.orientationFlexV=x.segment(state::ori,3);
-      op_.angularVelocityFlex=x.segment(state::angVel,3);
+      readMeasurementInput_(InputView(u));
+      computeMeasurement_(StateView(x),InputView(u),k);
 
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-        op_.efforts[i]=x.segment(state::fc+6*i,6);
+      //measurements
+      yk_=sensor_.getMeasurements();
+      y=yk_;
+    }
 
-      op_.fm=x.segment(state::unmodeledForces,3);
-      op_.tm=x.segment(state::unmodeledForces+3,3);
-      op_.drift=x.segment<3>(state::drift);
+    void IMUElasticLocalFrameDynamicalSystem::measureDynamicsBatch
+    (const Matrix& x, const Matrix& u, TimeIndex k, Matrix& y)
+    {
+      assertBatch_(x,u);
 
-      op_.rFlex =computeRotation_(op_.orientationFlexV,0);
+      const unsigned n=unsigned(x.cols());
+      y.resize(getMeasurementSize(),n);
 
-      kine::computeInertiaTensor(u.segment<6>(input::inertia),op_.inertia);
-      kine::computeInertiaTensor(u.segment<6>(input::dotInertia),op_.dotInertia);
-      unsigned nbContacts(getContactsNumber());
-      for (unsigned i = 0; i<nbContacts ; ++i)
+      for (unsigned i=0; i<n; ++i)
       {
-        // Positions
-        op_.contactPosV.setValue(u.segment<3>(input::contacts + 12*i),i);
-        op_.contactOriV.setValue(u.segment<3>(input::contacts +12*i+3),i);
+        const unsigned j=batchInputColumn_(u,i);
+
+        //a shared input is read once for all the states
+        if (i==0 || j>0)
+          readMeasurementInput_(InputView(u.col(j).data()));
+
+        computeMeasurement_(StateView(x.col(i).data()),InputView(u.col(j).data()),k);
+
+        y.col(i)=sensor_.getMeasurements();
       }
-      op_.positionCom=u.segment<3>(input::posCom);
-      if(withComBias_) op_.positionCom-=op_.positionComBias;
-      op_.velocityCom=u.segment<3>(input::velCom);
-      op_.accelerationCom=u.segment<3>(input::accCom);
-      op_.AngMomentum=u.segment<3>(input::angMoment);
-      op_.dotAngMomentum=u.segment<3>(input::dotAngMoment);
+    }
 
-      op_.positionControl=u.segment(input::posIMU,3);
-      op_.velocityControl=u.segment(input::linVelIMU,3);
-      op_.accelerationControl=u.segment(input::linAccIMU,3);
-      op_.orientationControlV=u.segment(input::oriIMU,3);
-      op_.angularVelocityControl=u.segment(input::angVelIMU,3);
+    void IMUElasticLocalFrameDynamicalSystem::readMeasurementInput_(const InputView & uv)
+    {
+      kine::computeInertiaTensor(uv.inertia(),op_.inertia);
+      kine::computeInertiaTensor(uv.dotInertia(),op_.dotInertia);
+      readContacts_(uv,false);
+
+      op_.velocityCom=uv.velocityCom();
+      op_.accelerationCom=uv.accelerationCom();
+      op_.AngMomentum=uv.angMomentum();
+      op_.dotAngMomentum=uv.dotAngMomentum();
+
+      op_.positionControl=uv.positionIMU();
+      op_.velocityControl=uv.linVelocityIMU();
+      op_.accelerationControl=uv.linAccelerationIMU();
+      op_.orientationControlV=uv.orientationIMU();
+      op_.angularVelocityControl=uv.angVelocityIMU();
 
       op_.rControl=computeRotation_(op_.orientationControlV,1);
 
-      op_.rimu = op_.rFlex * op_.rControl;
+      op_.addForce = uv.additionalForce();
+      op_.addMoment = uv.additionalMoment();
+    }
 
-      for (unsigned i=0; i<hrp2::contact::nbModeledMax; ++i)
-      {
-        fc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(0,0);
-        tc_.segment<3>(3*i) = op_.efforts[i].block<3,1>(3,0);
-      }
+    void IMUElasticLocalFrameDynamicalSystem::computeMeasurement_
+    (const StateView & xv, const InputView & uv, TimeIndex k)
+    {
+      op_.positionFlex=xv.position();
+      op_.velocityFlex=xv.linVelocity();
+      op_.orientationFlexV=xv.orientation();
+      op_.angularVelocityFlex=xv.angVelocity();
+
+      readContactWrenches_(xv);
+
+      op_.fm=xv.unmodeledForce();
+      op_.tm=xv.unmodeledMoment();
+      op_.drift=xv.drift();
+
+      op_.rFlex =computeRotation_(op_.orientationFlexV,0);
 
-      op_.addForce = u.segment<3>(input::additionalForces);
-      op_.addMoment = u.segment<3>(input::additionalForces+3);
+      op_.positionCom=uv.positionCom();
+      if(withComBias_) op_.positionCom-=op_.positionComBias;
+
+      op_.rimu = op_.rFlex * op_.rControl;
 
       // Get acceleration
       computeAccelerations (op_.positionCom, op_.velocityCom,
@@ -983,7 +1336,7 @@ namespace stateObservation
       {
         for (unsigned int i=0; i<nbContacts_; ++i)
         {
-          op_.sensorState.segment(index_,6) = x.segment(state::fc+i*6,6);
+          op_.sensorState.segment(index_,6) = xv.contactWrench(i);
           // the last part of the measurement is force torque, it is
           // computes by the current functor and not the sensor_.
           // (see AlgebraicSensor::concatenateWithInput
@@ -1012,14 +1365,34 @@ namespace stateObservation
       }
 
       sensor_.setState(op_.sensorState,k);
+    }
 
-      //measurements
-      yk_=sensor_.getMeasurements();
+    stateObservation::Matrix IMUElasticLocalFrameDynamicalSystem::measureDynamicsJacobian()
+    {
+      if (analyticalJacobians_ && contactModel_==contactModel::elasticContact)
+      {
+        measureDynamicsJacobianAnalytical_();
+        return op_.Jy;
+      }
+      else
+      {
+        return measureDynamicsJacobianFD();
+      }
+    }
 
-      return yk_;
+    void IMUElasticLocalFrameDynamicalSystem::measureDynamicsJacobianColumnFD_(unsigned i)
+    {
+      op_.xdx[i]+= dx_[i];
+
+      computeMeasureDynamics(op_.xdx,uk_fory_, op_.k_fory, op_.ykdy);
+      op_.ykdy-=op_.yk;
+      op_.ykdy/=dx_[i];
+
+      op_.Jy.col(i)=op_.ykdy;
+      op_.xdx[i]=op_.xk_fory[i];
     }
 
-    stateObservation::Matrix IMUElasticLocalFrameDynamicalSystem::measureDynamicsJacobian()
+    stateObservation::Matrix IMUElasticLocalFrameDynamicalSystem::measureDynamicsJacobianFD()
     {
       op_.Jy.resize(getMeasurementSize(),getStateSize());
       op_.Jy.setZero();
@@ -1028,75 +1401,32 @@ namespace stateObservation
       op_.xk_fory = xk_fory_;
       op_.yk = yk_;
 
-      unsigned sizeAfterComBias=getStateSize()-state::comBias-2;
+      for (unsigned i=0; i<state::fc; ++i)
+        measureDynamicsJacobianColumnFD_(i);
 
-      for (unsigned i=0; i<state::unmodeledForces; ++i)
+      //the columns of the inactive contacts are zero
+      for (unsigned j=0; j<getForceSlotsNumber(); ++j)
       {
-        op_.xdx[i]+= dx_[i];
-
-        op_.ykdy=measureDynamics(op_.xdx,uk_fory_, op_.k_fory);
-        op_.ykdy-=op_.yk;
-        op_.ykdy/=dx_[i];
-
-        op_.Jy.col(i)=op_.ykdy;
-        op_.xdx[i]=op_.xk_fory[i];
+        for (unsigned i=state::fcIndex(j); i<state::fcIndex(j)+6; ++i)
+          measureDynamicsJacobianColumnFD_(i);
       }
 
-      if(!withUnmodeledForces_)
-      {
-        op_.Jy.block(0,state::unmodeledForces,getMeasurementSize(),6).setZero();
-      }
-      else
+      if (withUnmodeledForces_)
       {
         for (unsigned i=state::unmodeledForces; i<state::unmodeledForces+6; ++i)
-        {
-          op_.xdx[i]+= dx_[i];
-
-          op_.ykdy=measureDynamics(op_.xdx,uk_fory_, op_.k_fory);
-          op_.ykdy-=op_.yk;
-          op_.ykdy/=dx_[i];
-
-          op_.Jy.col(i)=op_.ykdy;
-          op_.xdx[i]=op_.xk_fory[i];
-        }
+          measureDynamicsJacobianColumnFD_(i);
       }
 
-      if(!withComBias_)
-      {
-        op_.Jy.block(0,state::comBias,getMeasurementSize(),2).setZero();
-      }
-      else
+      if (withComBias_)
       {
         for (unsigned i=state::comBias; i<state::comBias+2; ++i)
-        {
-          op_.xdx[i]+= dx_[i];
-
-          op_.ykdy=measureDynamics(op_.xdx,uk_fory_, op_.k_fory);
-          op_.ykdy-=op_.yk;
-          op_.ykdy/=dx_[i];
-
-          op_.Jy.col(i)=op_.ykdy;
-          op_.xdx[i]=op_.xk_fory[i];
-        }
+          measureDynamicsJacobianColumnFD_(i);
       }
 
-      if (!withAbsolutePos_)
-      {
-        op_.Jy.block(0,state::drift,getMeasurementSize(),3).setZero();
-      }
-      else
+      if (withAbsolutePos_)
       {
-        for (unsigned i=state::comBias+2; i<state::comBias+2+sizeAfterComBias; ++i)
-        {
-          op_.xdx[i]+= dx_[i];
-
-          op_.ykdy=measureDynamics(op_.xdx,uk_fory_, op_.k_fory);
-          op_.ykdy-=op_.yk;
-          op_.ykdy/=dx_[i];
-
-          op_.Jy.col(i)=op_.ykdy;
-          op_.xdx[i]=op_.xk_fory[i];
-        }
+        for (unsigned i=state::drift; i<state::drift+3; ++i)
+          measureDynamicsJacobianColumnFD_(i);
       }
 
       //std::cout << "JACOBIAN: "<<std::endl;
@@ -1110,6 +1440,31 @@ namespace stateObservation
     }
 
     stateObservation::Matrix IMUElasticLocalFrameDynamicalSystem::stateDynamicsJacobian()
+    {
+      if (analyticalJacobians_ && analyticalStateJacobianAvailable_())
+      {
+        stateDynamicsJacobianAnalytical_();
+        return op_.Jx;
+      }
+      else
+      {
+        return stateDynamicsJacobianFD();
+      }
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::stateDynamicsJacobianColumnFD_(unsigned i)
+    {
+      op_.xdx[i]+= dx_[i];
+
+      computeStateDynamics(op_.xdx,uk_, 0, op_.xk1dx);
+      op_.xk1dx-=op_.xk1;
+      op_.xk1dx/=dx_[i];
+
+      op_.Jx.col(i)=op_.xk1dx;
+      op_.xdx[i]=op_.xk[i];
+    }
+
+    stateObservation::Matrix IMUElasticLocalFrameDynamicalSystem::stateDynamicsJacobianFD()
     {
       op_.Jx.resize(getStateSize(),getStateSize());
       op_.Jx.setZero();
@@ -1118,81 +1473,44 @@ namespace stateObservation
       op_.xk = xk_;
       op_.xk1 = xk1_;
 
-      unsigned sizeAfterComBias=getStateSize()-state::comBias-2;
-      unsigned sizeAfterUnmodeledForces=getStateSize()-state::unmodeledForces-6;
+      for (unsigned i=0; i<state::fc; ++i)
+        stateDynamicsJacobianColumnFD_(i);
 
-      for (unsigned i=0; i<state::unmodeledForces; ++i)
+      //the columns of the inactive contacts are zero
+      for (unsigned j=0; j<getForceSlotsNumber(); ++j)
       {
-        op_.xdx[i]+= dx_[i];
-
-        op_.xk1dx=stateDynamics(op_.xdx,uk_, 0);
-        op_.xk1dx-=op_.xk1;
-        op_.xk1dx/=dx_[i];
-
-        op_.Jx.col(i)=op_.xk1dx;
-        op_.xdx[i]=op_.xk[i];
+        for (unsigned i=state::fcIndex(j); i<state::fcIndex(j)+6; ++i)
+          stateDynamicsJacobianColumnFD_(i);
       }
 
       if(!withUnmodeledForces_)
       {
         op_.Jx.block(state::unmodeledForces,state::unmodeledForces,6,6).setIdentity();
-        op_.Jx.block(0,state::unmodeledForces,state::unmodeledForces,6).setZero();
-        op_.Jx.block(state::unmodeledForces+6,state::unmodeledForces,sizeAfterUnmodeledForces,6).setZero();
       }
       else
       {
         for (unsigned i=state::unmodeledForces; i<state::unmodeledForces+6; ++i)
-        {
-          op_.xdx[i]+= dx_[i];
-
-          op_.xk1dx=stateDynamics(op_.xdx,uk_, 0);
-          op_.xk1dx-=op_.xk1;
-          op_.xk1dx/=dx_[i];
-
-          op_.Jx.col(i)=op_.xk1dx;
-          op_.xdx[i]=op_.xk[i];
-        }
+          stateDynamicsJacobianColumnFD_(i);
       }
 
       if(!withComBias_)
       {
         op_.Jx.block(state::comBias,state::comBias,2,2).setIdentity();
-        op_.Jx.block(0,state::comBias,state::comBias,2).setZero();
-        op_.Jx.block(state::comBias+2,state::comBias,sizeAfterComBias,2).setZero();
       }
       else
       {
         for (unsigned i=state::comBias; i<state::comBias+2; ++i)
-        {
-          op_.xdx[i]+= dx_[i];
-
-          op_.xk1dx=stateDynamics(op_.xdx,uk_, 0);
-          op_.xk1dx-=op_.xk1;
-          op_.xk1dx/=dx_[i];
-
-          op_.Jx.col(i)=op_.xk1dx;
-          op_.xdx[i]=op_.xk[i];
-        }
+          stateDynamicsJacobianColumnFD_(i);
       }
 
       if (!withAbsolutePos_)
       {
-        op_.Jx.block(0,state::drift,getStateSize(),3).setZero();
         op_.Jx.block(state::drift,state::drift,3,3).setIdentity();
       }
       else
       {
         for (unsigned i=state::drift; i<state::drift+3; ++i)
-        {
-          op_.xdx[i]+= dx_[i];
-
-          op_.xk1dx=stateDynamics(op_.xdx,uk_, 0);
-          op_.xk1dx-=op_.xk1;
-          op_.xk1dx/=dx_[i];
-
-          op_.Jx.col(i)=op_.xk1dx;
-          op_.xdx[i]=op_.xk[i];
-        }
+          stateDynamicsJacobianColumnFD_(i);
       }
 
       //std::cout << "JACOBIAN: "<<std::endl;
@@ -1204,6 +1522,325 @@ namespace stateObservation
       return op_.Jx;
     }
 
+    void IMUElasticLocalFrameDynamicalSystem::setAccelerationsJacobianColumns_
+    (unsigned col, unsigned cols, const Matrix3 & dvf, const Matrix3 & dvt,
+     const Matrix3 & dRc, const Matrix3 & dRcp, const Matrix3 & dMalpha)
+    {
+      //variation of the right hand side of the angular acceleration equation
+      Matrix3 dalpha(dvt);
+      dalpha.noalias() += robotMass_*kine::skewSymmetric(op_.vf)*dRcp;
+      dalpha.noalias() -= robotMass_*kine::skewSymmetric(op_.Rcp)*dvf;
+      dalpha -= dMalpha;
+
+      op_.invinertia.matrixL().solveInPlace(dalpha);
+      op_.invinertia.matrixL().transpose().solveInPlace(dalpha);
+
+      Matrix3 da(dvf);
+      da.noalias() += kine::skewSymmetric(op_.Rc)*dalpha;
+      da.noalias() -= kine::skewSymmetric(op_.angularAcceleration)*dRc;
+
+      op_.Jacc.block(0,col,3,cols) = da.leftCols(cols);
+      op_.Jacc.block(3,col,3,cols) = dalpha.leftCols(cols);
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::computeAccelerationsJacobian_
+    (const Vector3 & position, const Vector3 & oriVector, const Vector3 & angularVel,
+     bool withComBiasColumns)
+    {
+      op_.Jacc.setZero();
+
+      const Matrix3 orientation(computeRotation_(oriVector,0));
+      const Vector3 gravity(cst::gravity);
+      const Matrix3 & skewV = op_.skewV;
+      const double m = robotMass_;
+
+      const Matrix3 skewP(kine::skewSymmetric(position));
+      const Matrix3 skewRc(kine::skewSymmetric(op_.Rc));
+
+      //contact wrench without the unmodeled forces, in the global frame
+      const Vector3 fR(op_.f-op_.fm);
+      const Vector3 tR(op_.t-op_.tm-position.cross(fR));
+
+      const Vector3 w(op_.wx2Rc+op_._2wxRv+op_.Ra);
+      const Vector3 Rv(orientation*op_.velocityCom);
+      const Vector3 RL(orientation*op_.AngMomentum);
+      const Vector3 RIRTw(op_.RIRT*angularVel);
+      const Matrix3 RdIRT(orientation*op_.dotInertia*orientation.transpose());
+      const Vector3 RdIRTw(RdIRT*angularVel+orientation*op_.dotAngMomentum);
+
+      //variation of the inertia matrix times the angular acceleration
+      //with respect to the rotated CoM position
+      const Matrix3 dMalphadRc(-m*(kine::skewSymmetric(skewRc*op_.angularAcceleration)
+                                   +skewRc*kine::skewSymmetric(op_.angularAcceleration)));
+
+      Matrix3 dvf, dvt, dRc, dW, dMalpha;
+
+      //position
+      dvt = m*kine::skewSymmetric(w) + m*kine::skewSymmetric(gravity) - kine::skewSymmetric(fR);
+      setAccelerationsJacobianColumns_(state::pos, 3, Matrix3::Zero(), dvt,
+                                       Matrix3::Zero(), Matrix3::Identity(), Matrix3::Zero());
+
+      //orientation, the variations are first expressed with respect to a
+      //left variation of the rotation and then to the rotation vector
+      op_.Jori = kine::rotationVectorLeftJacobian(oriVector);
+
+      dRc = -skewRc;
+      dW.noalias() = op_.skewV2*dRc;
+      dW.noalias() -= 2*skewV*kine::skewSymmetric(Rv);
+      dW -= kine::skewSymmetric(op_.Ra);
+
+      dvf = -robotMassInv_*kine::skewSymmetric(fR) - dW;
+
+      dvt = -kine::skewSymmetric(tR);
+      dvt.noalias() -= skewP*kine::skewSymmetric(fR);
+      dvt.noalias() -= skewV*(op_.RIRT*skewV - kine::skewSymmetric(RIRTw));
+      dvt.noalias() -= RdIRT*skewV;
+      dvt += kine::skewSymmetric(RdIRTw);
+      dvt.noalias() += skewV*kine::skewSymmetric(RL);
+      dvt.noalias() -= m*skewP*dW;
+      dvt.noalias() += m*kine::skewSymmetric(gravity)*dRc;
+
+      dMalpha = op_.RIRT*kine::skewSymmetric(op_.angularAcceleration)
+                - kine::skewSymmetric(op_.RIRT*op_.angularAcceleration);
+      dMalpha.noalias() += dMalphadRc*dRc;
+
+      setAccelerationsJacobianColumns_(state::ori, 3, dvf*op_.Jori, dvt*op_.Jori,
+                                       dRc*op_.Jori, dRc*op_.Jori, dMalpha*op_.Jori);
+
+      //angular velocity (the linear velocity has no effect on the accelerations)
+      dW = -kine::skewSymmetric(skewV*op_.Rc) - skewV*skewRc - 2*kine::skewSymmetric(Rv);
+
+      dvt = kine::skewSymmetric(RIRTw) - skewV*op_.RIRT - RdIRT + kine::skewSymmetric(RL);
+      dvt.noalias() -= m*skewP*dW;
+
+      setAccelerationsJacobianColumns_(state::angVel, 3, -dW, dvt,
+                                       Matrix3::Zero(), Matrix3::Zero(), Matrix3::Zero());
+
+      //contact forces and moments
+      if (contactModel_==contactModel::elasticContact)
+      {
+        for (unsigned i = 0; i<getContactsNumber() ; ++i)
+        {
+          Matrix3 RRci(orientation*computeRotation_(op_.contactOriV[i],i+2));
+          Vector3 globalContactPos(orientation*op_.contactPosV[i] + position);
+
+          dvt.noalias() = kine::skewSymmetric(globalContactPos)*RRci;
+          setAccelerationsJacobianColumns_(state::fcIndex(i), 3, robotMassInv_*RRci, dvt,
+                                           Matrix3::Zero(), Matrix3::Zero(), Matrix3::Zero());
+
+          setAccelerationsJacobianColumns_(state::fcIndex(i)+3, 3, Matrix3::Zero(), RRci,
+                                           Matrix3::Zero(), Matrix3::Zero(), Matrix3::Zero());
+        }
+      }
+
+      //unmodeled forces and moments
+      if (withUnmodeledForces_)
+      {
+        setAccelerationsJacobianColumns_(state::unmodeledForces, 3,
+                                         robotMassInv_*Matrix3::Identity(), Matrix3::Zero(),
+                                         Matrix3::Zero(), Matrix3::Zero(), Matrix3::Zero());
+
+        setAccelerationsJacobianColumns_(state::unmodeledForces+3, 3,
+                                         Matrix3::Zero(), Matrix3::Identity(),
+                                         Matrix3::Zero(), Matrix3::Zero(), Matrix3::Zero());
+      }
+
+      //bias of the CoM position, only along the x and y axes
+      if (withComBiasColumns)
+      {
+        dRc = -orientation;
+        dRc.col(2).setZero();
+
+        dW.noalias() = op_.skewV2*dRc;
+
+        dvt.noalias() = m*kine::skewSymmetric(gravity)*dRc;
+        dvt.noalias() -= m*skewP*dW;
+
+        setAccelerationsJacobianColumns_(state::comBias, 2, -dW, dvt,
+                                         dRc, dRc, dMalphadRc*dRc);
+      }
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::stateDynamicsJacobianAnalytical_()
+    {
+      op_.xk = xk_;
+      op_.xk1 = xk1_;
+
+      //sets the intermediate values of the computation at the last state
+      computeStateDynamics(op_.xk,uk_,0,op_.xk1dx);
+
+      StateView xv(op_.xk);
+      const Vector3 position(xv.position());
+      const Vector3 oriVector(xv.orientation());
+      const Vector3 angularVel(xv.angVelocity());
+
+      computeAccelerationsJacobian_(position, oriVector, angularVel, withComBias_);
+
+      //integration of the kinematics
+      const double dt2 = 0.5*dt_*dt_;
+      const Vector3 rotationIncrement(dt_*angularVel + dt2*op_.angularAcceleration);
+
+      op_.Jpos.noalias() = dt2*op_.Jacc.topRows<3>();
+      op_.Jpos.block<3,3>(0,state::pos) += Matrix3::Identity();
+      op_.Jpos.block<3,3>(0,state::linVel) += dt_*Matrix3::Identity();
+
+      op_.Jvel.noalias() = dt_*op_.Jacc.topRows<3>();
+      op_.Jvel.block<3,3>(0,state::linVel) += Matrix3::Identity();
+
+      op_.JangVel.noalias() = dt_*op_.Jacc.bottomRows<3>();
+      op_.JangVel.block<3,3>(0,state::angVel) += Matrix3::Identity();
+
+      op_.Jtemp.noalias() = dt2*op_.Jacc.bottomRows<3>();
+      op_.Jtemp.block<3,3>(0,state::angVel) += dt_*Matrix3::Identity();
+
+      op_.Jrot.noalias() = kine::rotationVectorLeftJacobian(rotationIncrement)*op_.Jtemp;
+      op_.Jrot.block<3,3>(0,state::ori).noalias() +=
+        kine::rotationVectorToRotationMatrix(rotationIncrement)*op_.Jori;
+
+      op_.Jx.resize(getStateSize(),getStateSize());
+      op_.Jx.setZero();
+
+      const Vector3 & position1 = op_.positionFlex;
+      const Vector3 & linVelocity1 = op_.velocityFlex;
+      const Vector3 & oriVector1 = op_.orientationFlexV;
+      const Vector3 & angularVel1 = op_.angularVelocityFlex;
+
+      op_.Jx.middleRows<3>(state::pos) = op_.Jpos;
+      op_.Jx.middleRows<3>(state::ori).noalias() =
+        kine::rotationVectorLeftJacobianInverse(oriVector1)*op_.Jrot;
+      op_.Jx.middleRows<3>(state::linVel) = op_.Jvel;
+      op_.Jx.middleRows<3>(state::angVel) = op_.JangVel;
+
+      //elastic contact forces and moments at the new state
+      const Matrix3 Rt(op_.rFlex.transpose());
+      Matrix3 K;
+
+      for (unsigned i = 0; i<getContactsNumber() ; ++i)
+      {
+        const Vector3 contactPos(op_.contactPosV[i]);
+        const Matrix3 Rcit(computeRotation_(op_.contactOriV[i],i+2).transpose());
+        const Matrix3 RcitRt(Rcit*Rt);
+
+        //displacement of the contact
+        op_.Jtemp.noalias() = kine::skewSymmetric(position1-contactPos)*op_.Jrot;
+        op_.Jtemp += op_.Jpos;
+        K.noalias() = -Kfe_*RcitRt;
+        op_.Jx.middleRows<3>(state::fcIndex(i)).noalias() = K*op_.Jtemp;
+
+        //velocity of the contact
+        op_.Jtemp.noalias() = kine::skewSymmetric(linVelocity1)*op_.Jrot;
+        op_.Jtemp += op_.Jvel;
+        K.noalias() = -Kfv_*RcitRt;
+        op_.Jx.middleRows<3>(state::fcIndex(i)).noalias() += K*op_.Jtemp;
+
+        op_.Jtemp.noalias() = kine::skewSymmetric(angularVel1)*op_.Jrot;
+        op_.Jtemp += op_.JangVel;
+        K.noalias() = Kfv_*Rcit*kine::skewSymmetric(contactPos)*Rt;
+        op_.Jx.middleRows<3>(state::fcIndex(i)).noalias() += K*op_.Jtemp;
+
+        //moments
+        K.noalias() = -Ktv_*RcitRt;
+        op_.Jx.middleRows<3>(state::fcIndex(i)+3).noalias() = K*op_.Jtemp;
+
+        op_.Jtemp.noalias() = kine::skewSymmetric(oriVector1)*op_.Jrot;
+        op_.Jtemp += op_.Jx.middleRows<3>(state::ori);
+        K.noalias() = -Kte_*RcitRt;
+        op_.Jx.middleRows<3>(state::fcIndex(i)+3).noalias() += K*op_.Jtemp;
+      }
+
+      if (withUnmodeledForces_)
+      {
+        op_.Jx.block<6,6>(state::unmodeledForces,state::unmodeledForces) =
+          marginalStabilityFactor_*Matrix6::Identity();
+      }
+      else
+      {
+        op_.Jx.block<6,6>(state::unmodeledForces,state::unmodeledForces).setIdentity();
+      }
+
+      op_.Jx.block<2,2>(state::comBias,state::comBias).setIdentity();
+      op_.Jx.block<3,3>(state::drift,state::drift).setIdentity();
+
+      xk_= op_.xk;
+      xk1_ = op_.xk1;
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::measureDynamicsJacobianAnalytical_()
+    {
+      op_.xk_fory = xk_fory_;
+
+      //sets the intermediate values of the computation at the last state
+      computeMeasureDynamics(op_.xk_fory,uk_fory_,op_.k_fory,op_.ykdy);
+
+      StateView xv(op_.xk_fory);
+      const Vector3 position(xv.position());
+      const Vector3 oriVector(xv.orientation());
+      const Vector3 angularVel(xv.angVelocity());
+
+      //the bias of the CoM is not read from the state by measureDynamics
+      computeAccelerationsJacobian_(position, oriVector, angularVel, false);
+
+      const Matrix3 & skewV = op_.skewV;
+      const Matrix3 rimuT(op_.rimu.transpose());
+      const Vector3 Rp(op_.rFlex*op_.positionControl);
+      const Vector3 Rv(op_.rFlex*op_.velocityControl);
+      const Vector3 Ra(op_.rFlex*op_.accelerationControl);
+      const Matrix3 skewRp(kine::skewSymmetric(Rp));
+
+      op_.Jy.resize(getMeasurementSize(),getStateSize());
+      op_.Jy.setZero();
+
+      //acceleration of the IMU
+      op_.Jtemp = op_.Jacc.topRows<3>();
+      op_.Jtemp.noalias() -= skewRp*op_.Jacc.bottomRows<3>();
+
+      Matrix3 K(-2*skewV*kine::skewSymmetric(Rv) - kine::skewSymmetric(Ra));
+      K.noalias() -= (kine::skewSymmetric(op_.angularAcceleration)+op_.skewV2)*skewRp;
+      op_.Jtemp.block<3,3>(0,state::ori).noalias() += K*op_.Jori;
+
+      op_.Jtemp.block<3,3>(0,state::angVel) -= 2*kine::skewSymmetric(Rv)
+                                               + kine::skewSymmetric(skewV*Rp) + skewV*skewRp;
+
+      //accelerometer
+      op_.Jy.topRows<3>().noalias() = rimuT*op_.Jtemp;
+      K.noalias() = rimuT*kine::skewSymmetric(Vector3(op_.imuAcc+cst::gravity));
+      op_.Jy.block<3,3>(0,state::ori).noalias() += K*op_.Jori;
+
+      //gyrometer
+      K.noalias() = rimuT*skewV;
+      op_.Jy.block<3,3>(3,state::ori).noalias() = K*op_.Jori;
+      op_.Jy.block<3,3>(3,state::angVel) = rimuT;
+
+      unsigned index=measurementSizeBase_;
+
+      if (withForceMeasurements_)
+      {
+        for (unsigned i=0; i<nbContacts_; ++i)
+        {
+          op_.Jy.block<6,6>(index,state::fcIndex(i)).setIdentity();
+          index+=6;
+        }
+      }
+
+      if (withAbsolutePos_)
+      {
+        const Vector3 rdriftp(op_.rdrift*op_.positionFlex);
+
+        op_.Jy.block<3,3>(index,state::pos) = op_.rdrift;
+        op_.Jy(index,state::drift) = 1;
+        op_.Jy(index+1,state::drift+1) = 1;
+        op_.Jy(index,state::drift+2) = -rdriftp(1);
+        op_.Jy(index+1,state::drift+2) = rdriftp(0);
+
+        //the drift is a left rotation around the z axis
+        K = kine::rotationVectorLeftJacobianInverse(op_.oritotal);
+        op_.Jy.block<3,3>(index+3,state::ori).noalias() = K*op_.rdrift*op_.Jori;
+        op_.Jy.block<3,1>(index+3,state::drift+2) = K.col(2);
+      }
+
+      xk_fory_ = op_.xk_fory;
+    }
+
     void IMUElasticLocalFrameDynamicalSystem::setProcessNoise(NoiseBase * n)
     {
       processNoise_=n;
@@ -1230,6 +1867,11 @@ namespace stateObservation
       dt_=dt;
     }
 
+    double IMUElasticLocalFrameDynamicalSystem::getSamplingPeriod() const
+    {
+      return dt_;
+    }
+
     unsigned IMUElasticLocalFrameDynamicalSystem::getStateSize() const
     {
       return stateSize_;
@@ -1263,13 +1905,49 @@ namespace stateObservation
 
     void IMUElasticLocalFrameDynamicalSystem::setContactsNumber(unsigned i)
     {
+      if (i!=nbContacts_)
+      {
+        unsigned configurations=std::max(i,nbContacts_)+1;
+        if (contactsContainers_.size()<configurations)
+          contactsContainers_.resize(configurations);
+
+        //keeps the containers of the current number of contacts and takes
+        //the ones of the new number
+        swapContactsContainers_(contactsContainers_[nbContacts_]);
+        swapContactsContainers_(contactsContainers_[i]);
+      }
+
       nbContacts_=i;
+
+      BOOST_ASSERT(getForceSlotsNumber()<=contactsMaxNumber_ &&
+                   "ERROR: The number of contacts exceeds the modeled contacts");
+
       inputSize_ =input::sizeBase +12*i;
 
       updateMeasurementSize_();
 
     }
 
+    void IMUElasticLocalFrameDynamicalSystem::swapContactsContainers_(ContactsContainers & c)
+    {
+      uk_.swap(c.uk);
+      uk_fory_.swap(c.ukFory);
+      yk_.swap(c.yk);
+      op_.ykdy.swap(c.ykdy);
+      op_.sensorState.swap(c.sensorState);
+      op_.Jy.swap(c.Jy);
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::resizeContactsContainers_()
+    {
+      uk_.resize(inputSize_);
+      uk_fory_.resize(inputSize_);
+      yk_.resize(measurementSize_);
+      op_.ykdy.resize(measurementSize_);
+      op_.sensorState.resize(sensor_.getStateSize());
+      op_.Jy.resize(measurementSize_,stateSize_);
+    }
+
     void IMUElasticLocalFrameDynamicalSystem::updateMeasurementSize_()
     {
       measurementSize_=measurementSizeBase_;
@@ -1286,6 +1964,7 @@ namespace stateObservation
 
       sensor_.concatenateWithInput(measurementSize_-measurementSizeBase_);
 
+      resizeContactsContainers_();
     }
 
     void IMUElasticLocalFrameDynamicalSystem::setWithForceMeasurements(bool b)
@@ -1311,6 +1990,40 @@ namespace stateObservation
       withUnmodeledForces_=b;
     }
 
+    void IMUElasticLocalFrameDynamicalSystem::setIntegrator(unsigned i)
+    {
+      if (i>integrator::adaptive)
+        throw std::invalid_argument("IMUElasticLocalFrameDynamicalSystem: unknown integrator.");
+      integrator_=i;
+    }
+
+    unsigned IMUElasticLocalFrameDynamicalSystem::getIntegrator() const
+    {
+      return integrator_;
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::setIntegrationSubsampling(unsigned n)
+    {
+      BOOST_ASSERT(n>0 && "ERROR: The integration needs at least one substep");
+      integrationSubsampling_=n;
+    }
+
+    unsigned IMUElasticLocalFrameDynamicalSystem::getIntegrationSubsampling() const
+    {
+      return integrationSubsampling_;
+    }
+
+    void IMUElasticLocalFrameDynamicalSystem::setAdaptiveIntegrationFactor(double factor)
+    {
+      BOOST_ASSERT(factor>0 && "ERROR: The adaptive integration factor must be positive");
+      adaptiveIntegrationFactor_=factor;
+    }
+
+    double IMUElasticLocalFrameDynamicalSystem::getAdaptiveIntegrationFactor() const
+    {
+      return adaptiveIntegrationFactor_;
+    }
+
     bool IMUElasticLocalFrameDynamicalSystem::getWithForceMeasurements() const
     {
       return withForceMeasurements_;
@@ -1386,10 +2099,40 @@ namespace stateObservation
       return Ktv_;
     }
 
+    Matrix IMUElasticLocalFrameDynamicalSystem::getKfeRopes() const
+    {
+      return KfeRopes_;
+    }
+
+    Matrix IMUElasticLocalFrameDynamicalSystem::getKfvRopes() const
+    {
+      return KfvRopes_;
+    }
+
+    Matrix IMUElasticLocalFrameDynamicalSystem::getKteRopes() const
+    {
+      return KteRopes_;
+    }
+
+    Matrix IMUElasticLocalFrameDynamicalSystem::getKtvRopes() const
+    {
+      return KtvRopes_;
+    }
+
     void  IMUElasticLocalFrameDynamicalSystem::setFDstep(const stateObservation::Vector & dx)
     {
       dx_ = dx;
     }
+
+    void IMUElasticLocalFrameDynamicalSystem::setAnalyticalJacobians(bool b)
+    {
+      analyticalJacobians_=b;
+    }
+
+    bool IMUElasticLocalFrameDynamicalSystem::getAnalyticalJacobians() const
+    {
+      return analyticalJacobians_;
+    }
   }
 }
 
@@ -9,8 +9,7 @@ namespace flexibilityEstimation
 
     IMUFixedContactDynamicalSystem::
                     IMUFixedContactDynamicalSystem(double dt):
-        processNoise_(0x0), dt_(dt),orientationVector_(Vector3::Zero()),
-        quaternion_(Quaternion::Identity()),
+        processNoise_(0x0), dt_(dt),rotationCache_(2),
         measurementSize_(measurementSizeBase_)
     {
 #ifdef STATEOBSERVATION_VERBOUS_CONSTRUCTORS
@@ -63,15 +62,9 @@ namespace flexibilityEstimation
     }
 
     Quaternion IMUFixedContactDynamicalSystem::computeQuaternion_
-                (const Vector3 & x)
+                (const Vector3 & x, unsigned slot)
     {
-        if (orientationVector_!=x)
-        {
-            orientationVector_ = x;
-            quaternion_ = kine::rotationVectorToAngleAxis(x);
-        }
-
-        return quaternion_;
+        return rotationCache_.getQuaternion(x,slot);
     }
 
     Vector IMUFixedContactDynamicalSystem::measureDynamics
@@ -100,7 +93,7 @@ namespace flexibilityEstimation
         Vector3 orientationControlV(u.segment(indexes::ori,3));
         Vector3 angularVelocityControl(u.segment(indexes::angVel,3));
 
-        Quaternion qControl(computeQuaternion_(orientationControlV));
+        Quaternion qControl(computeQuaternion_(orientationControlV,1));
 
         Quaternion q = qFlex * qControl;
 
@@ -178,6 +171,11 @@ namespace flexibilityEstimation
         return measurementSize_;
     }
 
+    const kine::RotationCache & IMUFixedContactDynamicalSystem::getRotationCache() const
+    {
+        return rotationCache_;
+    }
+
     NoiseBase * IMUFixedContactDynamicalSystem::getProcessNoise() const
     {
         return processNoise_;
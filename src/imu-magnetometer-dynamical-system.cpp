@@ -7,8 +7,7 @@ namespace stateObservation
 {
 
     IMUMagnetometerDynamicalSystem::IMUMagnetometerDynamicalSystem()
-    :processNoise_(0x0),dt_(1),orientationVector_(Vector3::Zero()),
-        quaternion_(Quaternion::Identity())
+    :processNoise_(0x0),dt_(1),rotationCache_(1)
     {
 #ifdef STATEOBSERVATION_VERBOUS_CONSTRUCTORS
        std::cout<<std::endl<<"IMUFixedContactDynamicalSystem Constructor"<<std::endl;
@@ -65,13 +64,7 @@ namespace stateObservation
 
     Quaternion IMUMagnetometerDynamicalSystem::computeQuaternion_(const Vector3 & x)
     {
-        if (orientationVector_!=x)
-        {
-            quaternion_ = kine::rotationVectorToAngleAxis(x);
-            orientationVector_=x;
-        }
-
-        return quaternion_;
+        return rotationCache_.getQuaternion(x);
     }
 
     Vector IMUMagnetometerDynamicalSystem::measureDynamics (const Vector& x, const Vector& , unsigned k)
@@ -136,6 +129,11 @@ namespace stateObservation
         return measurementSize_;
     }
 
+    const kine::RotationCache & IMUMagnetometerDynamicalSystem::getRotationCache() const
+    {
+        return rotationCache_;
+    }
+
     NoiseBase * IMUMagnetometerDynamicalSystem::getProcessNoise() const
     {
         return processNoise_;
@@ -1,5 +1,7 @@
 #include <state-observation/observer/kalman-filter-base.hpp>
 
+#include <algorithm>
+
 #ifndef NDEBUG
 //#define VERBOUS_KALMANFILTER
 #endif
@@ -11,28 +13,84 @@
 
 namespace stateObservation
 {
+    namespace
+    {
+        ///copies the blocks of the square matrix m between the ranges in
+        ///the top left corner of active
+        void gatherActiveBlocks(const Matrix & m, const KalmanFilterBase::IndexRanges & ranges,
+                                Matrix & active)
+        {
+            unsigned row=0;
+            for (unsigned i=0; i<ranges.size(); ++i)
+            {
+                unsigned col=0;
+                for (unsigned j=0; j<ranges.size(); ++j)
+                {
+                    active.block(row,col,ranges[i].second,ranges[j].second)=
+                        m.block(ranges[i].first,ranges[j].first,ranges[i].second,ranges[j].second);
+                    col+=ranges[j].second;
+                }
+                row+=ranges[i].second;
+            }
+        }
+
+        ///copies the top left corner of active in the blocks of the square
+        ///matrix m between the ranges
+        void scatterActiveBlocks(const Matrix & active, const KalmanFilterBase::IndexRanges & ranges,
+                                 Matrix & m)
+        {
+            unsigned row=0;
+            for (unsigned i=0; i<ranges.size(); ++i)
+            {
+                unsigned col=0;
+                for (unsigned j=0; j<ranges.size(); ++j)
+                {
+                    m.block(ranges[i].first,ranges[j].first,ranges[i].second,ranges[j].second)=
+                        active.block(row,col,ranges[i].second,ranges[j].second);
+                    col+=ranges[j].second;
+                }
+                row+=ranges[i].second;
+            }
+        }
+    }
+
 
     KalmanFilterBase::KalmanFilterBase():
       nt_(0),
+      activeTangentSize_(0),
       sum_(detail::defaultSum),
-      difference_(detail::defaultDifference)
+      difference_(detail::defaultDifference),
+      innovationLogLikelihood_(0),
+      normalizedInnovationSquared_(0),
+      innovationStatisticsUpdated_(true)
     {
+      initTimings_();
     }
 
     KalmanFilterBase::KalmanFilterBase(unsigned n,unsigned m,unsigned p)
             :ZeroDelayObserver(n,m,p),
             nt_(n),
+            activeTangentSize_(0),
             sum_(detail::defaultSum),
-            difference_(detail::defaultDifference)
+            difference_(detail::defaultDifference),
+            innovationLogLikelihood_(0),
+            normalizedInnovationSquared_(0),
+            innovationStatisticsUpdated_(true)
     {
+      initTimings_();
     }
 
     KalmanFilterBase::KalmanFilterBase(unsigned n, unsigned nt, unsigned m,unsigned p)
             :ZeroDelayObserver(n,m,p),
             nt_(nt),
+            activeTangentSize_(0),
             sum_(detail::defaultSum),
-            difference_(detail::defaultDifference)
+            difference_(detail::defaultDifference),
+            innovationLogLikelihood_(0),
+            normalizedInnovationSquared_(0),
+            innovationStatisticsUpdated_(true)
     {
+      initTimings_();
     }
 
 
@@ -42,7 +100,7 @@ namespace stateObservation
         a_=A;
     }
 
-    Matrix KalmanFilterBase::getA() const
+    const Matrix & KalmanFilterBase::getA() const
     {
         return a_;
     }
@@ -63,7 +121,7 @@ namespace stateObservation
         c_.resize(0,0);
     }
 
-    Matrix KalmanFilterBase::getC() const
+    const Matrix & KalmanFilterBase::getC() const
     {
         return c_;
     }
@@ -123,15 +181,24 @@ namespace stateObservation
         BOOST_ASSERT(checkRmatrix(r_) && "ERROR: The Matrix R is not initialized");
         BOOST_ASSERT(checkPmatrix(pr_) && "ERROR: The Matrix P is not initialized");
 
+        if (!activeTangentRanges_.empty())
+            return oneActiveStepEstimation_();
+
         //prediction
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::prediction);
         updateStateAndMeasurementPrediction();// runs also updatePrediction_();
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::prediction);
+
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::covariancePropagation);
         oc_.pbar.noalias()=q_ +a_*(pr_*a_.transpose());
 
 
         //innovation Measurements
         oc_.inoMeas.noalias() = this->y_[k+1] - predictedMeasurement_;
         oc_.inoMeasCov.noalias() = r_ +  c_ * (oc_.pbar * c_.transpose());
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::covariancePropagation);
 
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::gain);
         unsigned &  measurementSize =m_;
         //inversing innovation measurement covariance matrix
         oc_.inoMeasCovLLT.compute(oc_.inoMeasCov);
@@ -139,9 +206,13 @@ namespace stateObservation
         oc_.inoMeasCovInverse.setIdentity();
         oc_.inoMeasCovLLT.matrixL().solveInPlace(oc_.inoMeasCovInverse);
         oc_.inoMeasCovLLT.matrixL().transpose().solveInPlace(oc_.inoMeasCovInverse);
+        innovationStatisticsUpdated_=false;
 
         //innovation
         oc_.kGain.noalias() = oc_.pbar * (c_.transpose() * oc_.inoMeasCovInverse);
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::gain);
+
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::update);
         innovation_.noalias() = oc_.kGain*oc_.inoMeas;
 
         //update
@@ -172,11 +243,122 @@ namespace stateObservation
 
         // simmetrize the pr_ matrix
         pr_=(pr_+pr_.transpose())*0.5;
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::update);
+
+        return oc_.xhat;
+    }
+
+    ObserverBase::StateVector KalmanFilterBase::oneActiveStepEstimation_()
+    {
+        TimeIndex k=this->x_.getTime();
+        const unsigned na=activeTangentSize_;
+
+        //the containers have the size of the whole tangent vector so that
+        //the active ranges change without allocation
+        if (unsigned(oc_.aActive.rows())!=nt_)
+        {
+            oc_.aActive.resize(nt_,nt_);
+            oc_.pActive.resize(nt_,nt_);
+            oc_.innovationActive.resize(nt_);
+        }
+        if (unsigned(oc_.cActive.rows())!=m_ || unsigned(oc_.cActive.cols())!=nt_)
+            oc_.cActive.resize(m_,nt_);
+        if (unsigned(oc_.kGain.rows())!=nt_ || unsigned(oc_.kGain.cols())!=m_)
+            oc_.kGain.resize(nt_,m_);
+        oc_.pbar.resize(nt_,nt_);
+        innovation_.resize(nt_);
+
+        //prediction
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::prediction);
+        updateStateAndMeasurementPrediction();
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::prediction);
+
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::covariancePropagation);
+        gatherActiveBlocks(a_,activeTangentRanges_,oc_.aActive);
+        gatherActiveBlocks(pr_,activeTangentRanges_,oc_.pActive);
+        gatherActiveBlocks(q_,activeTangentRanges_,oc_.pbar);
+
+        unsigned index=0;
+        for (unsigned i=0; i<activeTangentRanges_.size(); ++i)
+        {
+            oc_.cActive.middleCols(index,activeTangentRanges_[i].second)=
+                c_.middleCols(activeTangentRanges_[i].first,activeTangentRanges_[i].second);
+            index+=activeTangentRanges_[i].second;
+        }
+
+        Eigen::Block<Matrix> a(oc_.aActive,0,0,na,na);
+        Eigen::Block<Matrix> p(oc_.pActive,0,0,na,na);
+        Eigen::Block<Matrix> pbar(oc_.pbar,0,0,na,na);
+        Eigen::Block<Matrix> c(oc_.cActive,0,0,m_,na);
+        Eigen::Block<Matrix> kGain(oc_.kGain,0,0,na,m_);
+
+        pbar.noalias()+=a*(p*a.transpose());
+
+        //innovation Measurements
+        oc_.inoMeas.noalias() = this->y_[k+1] - predictedMeasurement_;
+        oc_.inoMeasCov.noalias() = r_ +  c * (pbar * c.transpose());
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::covariancePropagation);
+
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::gain);
+        oc_.inoMeasCovLLT.compute(oc_.inoMeasCov);
+        oc_.inoMeasCovInverse.resize(m_,m_);
+        oc_.inoMeasCovInverse.setIdentity();
+        oc_.inoMeasCovLLT.matrixL().solveInPlace(oc_.inoMeasCovInverse);
+        oc_.inoMeasCovLLT.matrixL().transpose().solveInPlace(oc_.inoMeasCovInverse);
+        innovationStatisticsUpdated_=false;
+
+        kGain.noalias() = pbar * (c.transpose() * oc_.inoMeasCovInverse);
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::gain);
+
+        STATEOBSERVATION_TIMING_START(timings_,timingStage::update);
+        oc_.innovationActive.head(na).noalias() = kGain*oc_.inoMeas;
+
+        //the inactive components keep their prediction
+        innovation_.setZero();
+        index=0;
+        for (unsigned i=0; i<activeTangentRanges_.size(); ++i)
+        {
+            innovation_.segment(activeTangentRanges_[i].first,activeTangentRanges_[i].second)=
+                oc_.innovationActive.segment(index,activeTangentRanges_[i].second);
+            index+=activeTangentRanges_[i].second;
+        }
+
+        sum_(oc_.xbar,innovation_,oc_.xhat);
+
+        this->x_.set(oc_.xhat,k+1);
+        p.noalias() = -kGain*c;
+        p.diagonal().array()+=1;
+        p *= pbar;
+
+        // simmetrize the covariance matrix
+        p=(p+p.transpose())*0.5;
+
+        pr_.setZero();
+        scatterActiveBlocks(oc_.pActive,activeTangentRanges_,pr_);
+        STATEOBSERVATION_TIMING_STOP(timings_,timingStage::update);
 
         return oc_.xhat;
     }
 
-    KalmanFilterBase::Pmatrix KalmanFilterBase::getStateCovariance() const
+    void KalmanFilterBase::setActiveTangentRanges(const IndexRanges & ranges)
+    {
+        activeTangentSize_=0;
+        for (unsigned i=0; i<ranges.size(); ++i)
+        {
+            BOOST_ASSERT((i==0 || ranges[i].first>=ranges[i-1].first+ranges[i-1].second) &&
+                         ranges[i].first+ranges[i].second<=nt_ &&
+                         "ERROR: The active ranges must be sorted, disjoint and in the tangent vector");
+            activeTangentSize_+=ranges[i].second;
+        }
+        activeTangentRanges_=ranges;
+    }
+
+    unsigned KalmanFilterBase::getActiveTangentSize() const
+    {
+        return activeTangentRanges_.empty() ? nt_ : activeTangentSize_;
+    }
+
+    const KalmanFilterBase::Pmatrix & KalmanFilterBase::getStateCovariance() const
     {
         return pr_;
     }
@@ -319,6 +501,7 @@ namespace stateObservation
             ZeroDelayObserver::setStateSize(n);
 
             nt_=n;
+            activeTangentRanges_.clear();
 
             clearA();
             clearC();
@@ -335,6 +518,7 @@ namespace stateObservation
             ZeroDelayObserver::setStateSize(n);
 
             nt_=nt;
+            activeTangentRanges_.clear();
 
             clearA();
             clearC();
@@ -354,6 +538,40 @@ namespace stateObservation
         }
     }
 
+    void KalmanFilterBase::MeasurementWorkspace::resize(unsigned m, unsigned nt)
+    {
+        c.resize(m,nt);
+        r.resize(m,m);
+        predictedMeasurement.resize(m);
+        inoMeas.resize(m);
+        inoMeasCov.resize(m,m);
+        inoMeasCovInverse.resize(m,m);
+        inoMeasCovLLT=LLTPMatrix(m);
+        kGain.resize(nt,m);
+        cActive.resize(m,nt);
+    }
+
+    void KalmanFilterBase::swapMeasurementWorkspace(MeasurementWorkspace & w)
+    {
+        BOOST_ASSERT(w.r.rows()==w.r.cols() &&
+                     "ERROR: The R matrix of the workspace is not square");
+
+        ///the statistics of the last innovation are lost with its containers
+        updateInnovationStatistics_();
+
+        ZeroDelayObserver::setMeasureSize(unsigned(w.r.rows()));
+
+        c_.swap(w.c);
+        r_.swap(w.r);
+        predictedMeasurement_.swap(w.predictedMeasurement);
+        oc_.inoMeas.swap(w.inoMeas);
+        oc_.inoMeasCov.swap(w.inoMeasCov);
+        oc_.inoMeasCovInverse.swap(w.inoMeasCovInverse);
+        std::swap(oc_.inoMeasCovLLT,w.inoMeasCovLLT);
+        oc_.kGain.swap(w.kGain);
+        oc_.cActive.swap(w.cActive);
+    }
+
     Vector KalmanFilterBase::getSimulatedMeasurement(TimeIndex k)
     {
         return simulateSensor_(getEstimatedState(k),k);
@@ -364,6 +582,36 @@ namespace stateObservation
         return innovation_;
     }
 
+    void KalmanFilterBase::updateInnovationStatistics_() const
+    {
+        if (innovationStatisticsUpdated_)
+            return;
+
+        //the determinant of the covariance is given by the diagonal of
+        //its factorization
+        double mahalanobis=0;
+        for (unsigned i=0; i<m_; ++i)
+        {
+            mahalanobis+=oc_.inoMeas[i]*oc_.inoMeasCovInverse.col(i).dot(oc_.inoMeas);
+        }
+        normalizedInnovationSquared_=mahalanobis;
+        innovationLogLikelihood_= -0.5*(mahalanobis+m_*std::log(2*M_PI))
+                                  -oc_.inoMeasCovLLT.matrixLLT().diagonal().array().log().sum();
+        innovationStatisticsUpdated_=true;
+    }
+
+    double KalmanFilterBase::getInnovationLogLikelihood() const
+    {
+        updateInnovationStatistics_();
+        return innovationLogLikelihood_;
+    }
+
+    double KalmanFilterBase::getNormalizedInnovationSquared() const
+    {
+        updateInnovationStatistics_();
+        return normalizedInnovationSquared_;
+    }
+
     Vector KalmanFilterBase::getLastPrediction() const
     {
         return oc_.xbar;
@@ -396,5 +644,29 @@ namespace stateObservation
       difference_= difference;
     }
 
+    const tools::StageTimings & KalmanFilterBase::getTimings() const
+    {
+      return timings_;
+    }
+
+    tools::StageTimings & KalmanFilterBase::getTimings()
+    {
+      return timings_;
+    }
+
+    void KalmanFilterBase::initTimings_()
+    {
+#ifdef STATEOBSERVATION_WITH_TIMINGS
+      std::vector<std::string> names(timingStage::count);
+      names[timingStage::prediction]="prediction";
+      names[timingStage::jacobianA]="jacobianA";
+      names[timingStage::jacobianC]="jacobianC";
+      names[timingStage::covariancePropagation]="covariancePropagation";
+      names[timingStage::gain]="gain";
+      names[timingStage::update]="update";
+      timings_.setStages(names);
+#endif // STATEOBSERVATION_WITH_TIMINGS
+    }
+
 
 }
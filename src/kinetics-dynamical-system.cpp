@@ -0,0 +1,636 @@
+#include <state-observation/dynamic-estimators/kinetics-dynamical-system.hpp>
+#include <state-observation/tools/hrp2.hpp>
+
+namespace stateObservation
+{
+namespace kineticsObserver
+{
+    KineticsDynamicalSystem::KineticsDynamicalSystem
+                        (double dt, unsigned maxContacts, unsigned maxIMUs):
+      dt_(dt),
+      mass_(hrp2::m),
+      maxContacts_(maxContacts),
+      maxIMUs_(maxIMUs),
+      stateSize_(state::getSize(maxContacts)),
+      inputSize_(input::getSize(maxContacts,maxIMUs)),
+      contacts_(maxContacts,false),
+      wrenchSensors_(maxContacts,false),
+      accelerometers_(maxIMUs,false),
+      gyrometers_(maxIMUs,false),
+      linStiffness_(maxContacts,hrp2::linKe*Matrix3::Identity()),
+      linDamping_(maxContacts,hrp2::linKv*Matrix3::Identity()),
+      angStiffness_(maxContacts,hrp2::angKe*Matrix3::Identity()),
+      angDamping_(maxContacts,hrp2::angKv*Matrix3::Identity()),
+      jAcc_(Matrix::Zero(6,stateSize_)),
+      lastX_(Vector::Zero(stateSize_)),
+      lastU_(Vector::Zero(inputSize_)),
+      lastXMeasurement_(Vector::Zero(stateSize_)),
+      lastUMeasurement_(Vector::Zero(inputSize_)),
+      aKine_(Matrix::Zero(state::kinematicsSize,stateSize_))
+    {
+#ifdef STATEOBSERVATION_VERBOUS_CONSTRUCTORS
+      std::cout<<std::endl<<"KineticsDynamicalSystem Constructor"<<std::endl;
+#endif //STATEOBSERVATION_VERBOUS_CONSTRUCTOR
+    }
+
+    KineticsDynamicalSystem::~KineticsDynamicalSystem()
+    {
+    }
+
+    Vector KineticsDynamicalSystem::stateDynamics(const Vector& x, const Vector& u, TimeIndex k)
+    {
+      Vector xk1;
+      computeStateDynamics(x,u,k,xk1);
+      return xk1;
+    }
+
+    Vector KineticsDynamicalSystem::measureDynamics(const Vector& x, const Vector& u, TimeIndex k)
+    {
+      Vector y;
+      computeMeasureDynamics(x,u,k,y);
+      return y;
+    }
+
+    void KineticsDynamicalSystem::computeStateDynamics(const Vector& x, const Vector& u, TimeIndex,
+                                                Vector& xk1)
+    {
+      assertStateVector_(x);
+      assertInputVector_(u);
+
+      lastX_=x;
+      lastU_=u;
+
+      computeAccelerations_(x,u,false);
+
+      const Vector3 & linAcc=acc_.linAcc;
+      const Vector3 & angAcc=acc_.angAcc;
+
+      xk1=x;
+      xk1.segment<3>(state::pos)+=dt_*x.segment<3>(state::linVel)+0.5*dt_*dt_*linAcc;
+      xk1.segment<3>(state::linVel)+=dt_*linAcc;
+      xk1.segment<3>(state::angVel)+=dt_*angAcc;
+
+      Vector3 rotation(dt_*x.segment<3>(state::angVel)+0.5*dt_*dt_*angAcc);
+      Matrix3 orientation(kine::rotationVectorToRotationMatrix(rotation)*acc_.orientation);
+      xk1.segment<3>(state::ori)=kine::rotationMatrixToRotationVector(orientation);
+
+      ///the wrenches of the contacts come from the kinematics at k+1 and
+      ///the rest poses remain constant
+      Vector3 force;
+      Vector3 torque;
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (contacts_[i])
+        {
+          computeContactWrench(xk1,u,i,force,torque);
+          xk1.segment<3>(state::contactIndex(i)+state::contactForce)=force;
+          xk1.segment<3>(state::contactIndex(i)+state::contactTorque)=torque;
+        }
+      }
+    }
+
+    void KineticsDynamicalSystem::computeMeasureDynamics(const Vector& x, const Vector& u, TimeIndex,
+                                                  Vector& y)
+    {
+      assertStateVector_(x);
+      assertInputVector_(u);
+
+      lastXMeasurement_=x;
+      lastUMeasurement_=u;
+
+      computeAccelerations_(x,u,false);
+
+      const Matrix3 & orientation=acc_.orientation;
+      const Vector3 angVel(x.segment<3>(state::angVel));
+
+      y.resize(getMeasurementSize());
+      unsigned index=0;
+
+      for (unsigned j=0; j<maxIMUs_; ++j)
+      {
+        const unsigned imu=input::imuIndex(maxContacts_,j);
+        Matrix3 imuOrientation(orientation*kine::rotationVectorToRotationMatrix
+                                           (u.segment<3>(imu+input::imuOri)));
+
+        if (accelerometers_[j])
+        {
+          Vector3 imuPos(orientation*u.segment<3>(imu+input::imuPos));
+          Vector3 acceleration(acc_.linAcc+acc_.angAcc.cross(imuPos)
+                               +angVel.cross(angVel.cross(imuPos))
+                               +2*angVel.cross(orientation*u.segment<3>(imu+input::imuLinVel))
+                               +orientation*u.segment<3>(imu+input::imuLinAcc));
+          acceleration[2]+=cst::gravityConstant;
+
+          y.segment<3>(index).noalias()=imuOrientation.transpose()*acceleration;
+          index+=3;
+        }
+
+        if (gyrometers_[j])
+        {
+          Vector3 rate(angVel+orientation*u.segment<3>(imu+input::imuAngVel));
+          y.segment<3>(index).noalias()=imuOrientation.transpose()*rate;
+          index+=3;
+        }
+      }
+
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (wrenchSensors_[i])
+        {
+          const unsigned contact=state::contactIndex(i);
+          Matrix3 sensorOrientation(orientation*kine::rotationVectorToRotationMatrix
+                                    (u.segment<3>(input::contactIndex(i)+input::contactOri)));
+
+          y.segment<3>(index).noalias()=sensorOrientation.transpose()*
+                                        x.segment<3>(contact+state::contactForce);
+          y.segment<3>(index+3).noalias()=sensorOrientation.transpose()*
+                                          x.segment<3>(contact+state::contactTorque);
+          index+=6;
+        }
+      }
+    }
+
+    void KineticsDynamicalSystem::computeAccelerations(const Vector& x, const Vector& u,
+                                                       Vector3 & linAcc, Vector3 & angAcc)
+    {
+      assertStateVector_(x);
+      assertInputVector_(u);
+
+      computeAccelerations_(x,u,false);
+      linAcc=acc_.linAcc;
+      angAcc=acc_.angAcc;
+    }
+
+    void KineticsDynamicalSystem::computeAccelerations_(const Vector& x, const Vector& u,
+                                                        bool jacobian)
+    {
+      using kine::skewSymmetric;
+
+      Matrix3 & orientation=acc_.orientation;
+      orientation=kine::rotationVectorToRotationMatrix(x.segment<3>(state::ori));
+      const Vector3 angVel(x.segment<3>(state::angVel));
+
+      const Vector3 com(orientation*u.segment<3>(input::com));
+      const Vector3 comVel(orientation*u.segment<3>(input::comVel));
+      const Vector3 comAcc(orientation*u.segment<3>(input::comAcc));
+      const Vector3 angMomentum(orientation*u.segment<3>(input::angMomentum));
+      const Vector3 dotAngMomentum(orientation*u.segment<3>(input::dotAngMomentum));
+
+      Matrix3 inertia;
+      kine::computeInertiaTensor(u.segment<6>(input::inertia),inertia);
+      const Matrix3 worldInertia(orientation*inertia*orientation.transpose());
+      const Matrix3 worldInertiaInv(orientation*inertia.inverse()*orientation.transpose());
+
+      ///total force and torque at the center of mass
+      Vector3 force(x.segment<3>(state::unmodeledForce)+u.segment<3>(input::additionalForce));
+      force[2]-=mass_*cst::gravityConstant;
+      Vector3 torque(x.segment<3>(state::unmodeledTorque)+u.segment<3>(input::additionalTorque));
+
+      ///derivative of the torque with the orientation
+      Matrix3 dTorqueOri(Matrix3::Zero());
+
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (contacts_[i])
+        {
+          const unsigned contact=state::contactIndex(i);
+          const Vector3 lever(orientation*(u.segment<3>(input::contactIndex(i)+input::contactPos)
+                                           -u.segment<3>(input::com)));
+          const Vector3 contactForce(x.segment<3>(contact+state::contactForce));
+
+          force+=contactForce;
+          torque+=x.segment<3>(contact+state::contactTorque)+lever.cross(contactForce);
+
+          if (jacobian)
+          {
+            dTorqueOri.noalias()+=skewSymmetric(contactForce)*skewSymmetric(lever);
+          }
+        }
+      }
+
+      ///Euler equation with the momentum of the internal motions
+      const Vector3 momentum(worldInertia*angVel+angMomentum);
+      const Vector3 netTorque(torque-angVel.cross(momentum)-dotAngMomentum);
+
+      acc_.angAcc.noalias()=worldInertiaInv*netTorque;
+      acc_.linAcc=force/mass_-acc_.angAcc.cross(com)-angVel.cross(angVel.cross(com))
+                  -2*angVel.cross(comVel)-comAcc;
+
+      if (!jacobian)
+        return;
+
+      const Vector3 & angAcc=acc_.angAcc;
+      const Matrix3 skewCom(skewSymmetric(com));
+      const Matrix3 skewAngVel(skewSymmetric(angVel));
+      const Matrix3 linear(Matrix3::Identity()/mass_);
+      const Matrix3 comTorque(skewCom*worldInertiaInv);
+
+      Matrix3 dMomentumOri(-skewSymmetric(worldInertia*angVel)+worldInertia*skewAngVel
+                           -skewSymmetric(angMomentum));
+      Matrix3 dNetTorqueOri(dTorqueOri-skewAngVel*dMomentumOri+skewSymmetric(dotAngMomentum));
+      Matrix3 dNetTorqueAngVel(skewSymmetric(momentum)-skewAngVel*worldInertia);
+
+      Matrix3 dAngAccOri(-skewSymmetric(angAcc)+worldInertiaInv*(skewSymmetric(netTorque)+dNetTorqueOri));
+      Matrix3 dAngAccAngVel(worldInertiaInv*dNetTorqueAngVel);
+
+      jAcc_.setZero();
+
+      jAcc_.block<3,3>(3,state::ori)=dAngAccOri;
+      jAcc_.block<3,3>(3,state::angVel)=dAngAccAngVel;
+      jAcc_.block<3,3>(3,state::unmodeledTorque)=worldInertiaInv;
+
+      jAcc_.block<3,3>(0,state::ori)=skewCom*dAngAccOri
+                                     +(skewSymmetric(angAcc)+skewAngVel*skewAngVel)*skewCom
+                                     +2*skewAngVel*skewSymmetric(comVel)+skewSymmetric(comAcc);
+      jAcc_.block<3,3>(0,state::angVel)=skewCom*dAngAccAngVel+skewSymmetric(angVel.cross(com))
+                                        +skewAngVel*skewCom+2*skewSymmetric(comVel);
+      jAcc_.block<3,3>(0,state::unmodeledForce)=linear;
+      jAcc_.block<3,3>(0,state::unmodeledTorque)=comTorque;
+
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (contacts_[i])
+        {
+          const unsigned contact=state::contactIndex(i);
+          const Vector3 lever(orientation*(u.segment<3>(input::contactIndex(i)+input::contactPos)
+                                           -u.segment<3>(input::com)));
+          const Matrix3 dAngAccForce(worldInertiaInv*skewSymmetric(lever));
+
+          jAcc_.block<3,3>(3,contact+state::contactForce)=dAngAccForce;
+          jAcc_.block<3,3>(3,contact+state::contactTorque)=worldInertiaInv;
+          jAcc_.block<3,3>(0,contact+state::contactForce)=linear+skewCom*dAngAccForce;
+          jAcc_.block<3,3>(0,contact+state::contactTorque)=comTorque;
+        }
+      }
+    }
+
+    void KineticsDynamicalSystem::computeContactWrench
+                (const Vector& x, const Vector& u, unsigned i, Vector3 & force, Vector3 & torque) const
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+
+      const unsigned contact=state::contactIndex(i);
+      const unsigned contactInput=input::contactIndex(i);
+
+      const Matrix3 orientation(kine::rotationVectorToRotationMatrix(x.segment<3>(state::ori)));
+      const Vector3 angVel(x.segment<3>(state::angVel));
+
+      const Vector3 lever(orientation*u.segment<3>(contactInput+input::contactPos));
+      const Vector3 position(x.segment<3>(state::pos)+lever);
+      const Vector3 velocity(x.segment<3>(state::linVel)+angVel.cross(lever)
+                             +orientation*u.segment<3>(contactInput+input::contactLinVel));
+
+      force.noalias()=-linStiffness_[i]*(position-x.segment<3>(contact+state::contactPos));
+      force.noalias()-=linDamping_[i]*velocity;
+
+      const Matrix3 contactOrientation(orientation*kine::rotationVectorToRotationMatrix
+                                       (u.segment<3>(contactInput+input::contactOri)));
+      const Matrix3 restOrientation(kine::rotationVectorToRotationMatrix
+                                    (x.segment<3>(contact+state::contactOri)));
+      const Vector3 error(kine::rotationMatrixToRotationVector
+                          (contactOrientation*restOrientation.transpose()));
+      const Vector3 contactAngVel(angVel+orientation*u.segment<3>(contactInput+input::contactAngVel));
+
+      torque.noalias()=-angStiffness_[i]*error;
+      torque.noalias()-=angDamping_[i]*contactAngVel;
+    }
+
+    void KineticsDynamicalSystem::stateDynamicsJacobian(Matrix & A)
+    {
+      using kine::skewSymmetric;
+
+      const Vector & x=lastX_;
+      const Vector & u=lastU_;
+
+      computeAccelerations_(x,u,true);
+
+      const Matrix3 identity(Matrix3::Identity());
+      const Vector3 rotation(dt_*x.segment<3>(state::angVel)+0.5*dt_*dt_*acc_.angAcc);
+      const Matrix3 rotationMatrix(kine::rotationVectorToRotationMatrix(rotation));
+      const Matrix3 rotationJacobian(kine::rotationVectorLeftJacobian(rotation));
+
+      ///kinematics at k+1, the orientation is perturbed on the left
+      aKine_.middleRows<3>(state::pos)=(0.5*dt_*dt_)*jAcc_.topRows<3>();
+      aKine_.block<3,3>(state::pos,state::pos)+=identity;
+      aKine_.block<3,3>(state::pos,state::linVel)+=dt_*identity;
+
+      aKine_.middleRows<3>(state::ori).noalias()=(0.5*dt_*dt_)*rotationJacobian*jAcc_.bottomRows<3>();
+      aKine_.block<3,3>(state::ori,state::ori)+=rotationMatrix;
+      aKine_.block<3,3>(state::ori,state::angVel)+=dt_*rotationJacobian;
+
+      aKine_.middleRows<3>(state::linVel)=dt_*jAcc_.topRows<3>();
+      aKine_.block<3,3>(state::linVel,state::linVel)+=identity;
+
+      aKine_.middleRows<3>(state::angVel)=dt_*jAcc_.bottomRows<3>();
+      aKine_.block<3,3>(state::angVel,state::angVel)+=identity;
+
+      A.resize(stateSize_,stateSize_);
+      A.setIdentity();
+      A.topRows(aKine_.rows())=aKine_;
+
+      const Matrix3 orientation(rotationMatrix*acc_.orientation);
+      const Vector3 angVel(x.segment<3>(state::angVel)+dt_*acc_.angAcc);
+      const Matrix3 skewAngVel(skewSymmetric(angVel));
+
+      Eigen::Matrix<double,6,state::kinematicsSize> wrenchJacobian;
+
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (contacts_[i])
+        {
+          const unsigned contact=state::contactIndex(i);
+          const unsigned contactInput=input::contactIndex(i);
+
+          const Vector3 lever(orientation*u.segment<3>(contactInput+input::contactPos));
+          const Vector3 leverVel(orientation*u.segment<3>(contactInput+input::contactLinVel));
+          const Vector3 leverAngVel(orientation*u.segment<3>(contactInput+input::contactAngVel));
+          const Matrix3 skewLever(skewSymmetric(lever));
+
+          const Matrix3 error(orientation*kine::rotationVectorToRotationMatrix
+                              (u.segment<3>(contactInput+input::contactOri))*
+                              kine::rotationVectorToRotationMatrix
+                              (x.segment<3>(contact+state::contactOri)).transpose());
+          const Matrix3 errorJacobianInv(kine::rotationVectorLeftJacobianInverse
+                                         (kine::rotationMatrixToRotationVector(error)));
+
+          const Matrix3 & kfe=linStiffness_[i];
+          const Matrix3 & kfv=linDamping_[i];
+          const Matrix3 & kte=angStiffness_[i];
+          const Matrix3 & ktv=angDamping_[i];
+
+          ///derivatives of the wrench with the kinematics at k+1
+          wrenchJacobian.setZero();
+          wrenchJacobian.block<3,3>(0,state::pos)=-kfe;
+          wrenchJacobian.block<3,3>(0,state::ori)=kfe*skewLever
+                                      +kfv*(skewAngVel*skewLever+skewSymmetric(leverVel));
+          wrenchJacobian.block<3,3>(0,state::linVel)=-kfv;
+          wrenchJacobian.block<3,3>(0,state::angVel)=kfv*skewLever;
+          wrenchJacobian.block<3,3>(3,state::ori)=-kte*errorJacobianInv
+                                                  +ktv*skewSymmetric(leverAngVel);
+          wrenchJacobian.block<3,3>(3,state::angVel)=-ktv;
+
+          A.middleRows<6>(contact+state::contactForce).noalias()=wrenchJacobian*aKine_;
+          A.block<3,3>(contact+state::contactForce,contact+state::contactPos)+=kfe;
+          A.block<3,3>(contact+state::contactTorque,contact+state::contactOri)+=
+                                                          kte*errorJacobianInv*error;
+        }
+      }
+    }
+
+    void KineticsDynamicalSystem::measureDynamicsJacobian(Matrix & C)
+    {
+      using kine::skewSymmetric;
+
+      const Vector & x=lastXMeasurement_;
+      const Vector & u=lastUMeasurement_;
+
+      computeAccelerations_(x,u,true);
+
+      const Matrix3 & orientation=acc_.orientation;
+      const Vector3 angVel(x.segment<3>(state::angVel));
+      const Matrix3 skewAngVel(skewSymmetric(angVel));
+
+      C.resize(getMeasurementSize(),stateSize_);
+      C.setZero();
+      unsigned index=0;
+
+      for (unsigned j=0; j<maxIMUs_; ++j)
+      {
+        const unsigned imu=input::imuIndex(maxContacts_,j);
+        const Matrix3 imuOrientationT((orientation*kine::rotationVectorToRotationMatrix
+                                       (u.segment<3>(imu+input::imuOri))).transpose());
+
+        if (accelerometers_[j])
+        {
+          const Vector3 imuPos(orientation*u.segment<3>(imu+input::imuPos));
+          const Vector3 imuVel(orientation*u.segment<3>(imu+input::imuLinVel));
+          const Vector3 imuAcc(orientation*u.segment<3>(imu+input::imuLinAcc));
+          const Matrix3 skewImuPos(skewSymmetric(imuPos));
+
+          Vector3 acceleration(acc_.linAcc+acc_.angAcc.cross(imuPos)
+                               +angVel.cross(angVel.cross(imuPos))+2*angVel.cross(imuVel)+imuAcc);
+          acceleration[2]+=cst::gravityConstant;
+
+          ///the accelerations depend on the whole state
+          const Matrix3 dAngAcc(-imuOrientationT*skewImuPos);
+          C.middleRows<3>(index).noalias()=imuOrientationT*jAcc_.topRows<3>();
+          C.middleRows<3>(index).noalias()+=dAngAcc*jAcc_.bottomRows<3>();
+
+          C.block<3,3>(index,state::ori)+=imuOrientationT*
+                 (skewSymmetric(acceleration)
+                  -(skewSymmetric(acc_.angAcc)+skewAngVel*skewAngVel)*skewImuPos
+                  -2*skewAngVel*skewSymmetric(imuVel)-skewSymmetric(imuAcc));
+          C.block<3,3>(index,state::angVel)+=imuOrientationT*
+                 (-skewSymmetric(angVel.cross(imuPos))-skewAngVel*skewImuPos
+                  -2*skewSymmetric(imuVel));
+          index+=3;
+        }
+
+        if (gyrometers_[j])
+        {
+          C.block<3,3>(index,state::ori)=imuOrientationT*skewAngVel;
+          C.block<3,3>(index,state::angVel)=imuOrientationT;
+          index+=3;
+        }
+      }
+
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (wrenchSensors_[i])
+        {
+          const unsigned contact=state::contactIndex(i);
+          const Matrix3 sensorOrientationT((orientation*kine::rotationVectorToRotationMatrix
+                                  (u.segment<3>(input::contactIndex(i)+input::contactOri))).transpose());
+
+          C.block<3,3>(index,state::ori)=sensorOrientationT*
+                             skewSymmetric(x.segment<3>(contact+state::contactForce));
+          C.block<3,3>(index,contact+state::contactForce)=sensorOrientationT;
+          C.block<3,3>(index+3,state::ori)=sensorOrientationT*
+                             skewSymmetric(x.segment<3>(contact+state::contactTorque));
+          C.block<3,3>(index+3,contact+state::contactTorque)=sensorOrientationT;
+          index+=6;
+        }
+      }
+    }
+
+    void KineticsDynamicalSystem::stateSum(const Vector& stateVector, const Vector& tangentVector,
+                                           Vector& sum)
+    {
+      sum=stateVector+tangentVector;
+
+      sum.segment<3>(state::ori)=kine::rotationMatrixToRotationVector
+              (kine::rotationVectorToRotationMatrix(tangentVector.segment<3>(state::ori))*
+               kine::rotationVectorToRotationMatrix(stateVector.segment<3>(state::ori)));
+
+      const unsigned contacts=unsigned(stateVector.size()-state::contacts)/state::contactSize;
+      for (unsigned i=0; i<contacts; ++i)
+      {
+        const unsigned ori=state::contactIndex(i)+state::contactOri;
+        sum.segment<3>(ori)=kine::rotationMatrixToRotationVector
+                (kine::rotationVectorToRotationMatrix(tangentVector.segment<3>(ori))*
+                 kine::rotationVectorToRotationMatrix(stateVector.segment<3>(ori)));
+      }
+    }
+
+    void KineticsDynamicalSystem::stateDifference(const Vector& stateVector1,
+                                                  const Vector& stateVector2, Vector& difference)
+    {
+      difference=stateVector1-stateVector2;
+
+      difference.segment<3>(state::ori)=kine::rotationMatrixToRotationVector
+              (kine::rotationVectorToRotationMatrix(stateVector1.segment<3>(state::ori))*
+               kine::rotationVectorToRotationMatrix(stateVector2.segment<3>(state::ori)).transpose());
+
+      const unsigned contacts=unsigned(stateVector1.size()-state::contacts)/state::contactSize;
+      for (unsigned i=0; i<contacts; ++i)
+      {
+        const unsigned ori=state::contactIndex(i)+state::contactOri;
+        difference.segment<3>(ori)=kine::rotationMatrixToRotationVector
+                (kine::rotationVectorToRotationMatrix(stateVector1.segment<3>(ori))*
+                 kine::rotationVectorToRotationMatrix(stateVector2.segment<3>(ori)).transpose());
+      }
+    }
+
+    void KineticsDynamicalSystem::setSamplingPeriod(double dt)
+    {
+      dt_=dt;
+    }
+
+    double KineticsDynamicalSystem::getSamplingPeriod() const
+    {
+      return dt_;
+    }
+
+    void KineticsDynamicalSystem::setMass(double m)
+    {
+      mass_=m;
+    }
+
+    double KineticsDynamicalSystem::getMass() const
+    {
+      return mass_;
+    }
+
+    void KineticsDynamicalSystem::setContact(unsigned i, bool b)
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      contacts_[i]=b;
+      if (!b)
+        wrenchSensors_[i]=false;
+    }
+
+    bool KineticsDynamicalSystem::getContact(unsigned i) const
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      return contacts_[i];
+    }
+
+    void KineticsDynamicalSystem::setContactWrenchSensor(unsigned i, bool b)
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      BOOST_ASSERT((!b || contacts_[i]) && "ERROR: The contact is not set");
+      wrenchSensors_[i]=b;
+    }
+
+    bool KineticsDynamicalSystem::getContactWrenchSensor(unsigned i) const
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      return wrenchSensors_[i];
+    }
+
+    void KineticsDynamicalSystem::setIMUSensors(unsigned j, bool accelerometer, bool gyrometer)
+    {
+      BOOST_ASSERT(j<maxIMUs_ && "ERROR: The IMU index is out of range");
+      accelerometers_[j]=accelerometer;
+      gyrometers_[j]=gyrometer;
+    }
+
+    bool KineticsDynamicalSystem::getAccelerometer(unsigned j) const
+    {
+      BOOST_ASSERT(j<maxIMUs_ && "ERROR: The IMU index is out of range");
+      return accelerometers_[j];
+    }
+
+    bool KineticsDynamicalSystem::getGyrometer(unsigned j) const
+    {
+      BOOST_ASSERT(j<maxIMUs_ && "ERROR: The IMU index is out of range");
+      return gyrometers_[j];
+    }
+
+    void KineticsDynamicalSystem::setContactStiffnessAndDamping
+              (unsigned i, const Matrix3 & linStiffness, const Matrix3 & linDamping,
+               const Matrix3 & angStiffness, const Matrix3 & angDamping)
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      linStiffness_[i]=linStiffness;
+      linDamping_[i]=linDamping;
+      angStiffness_[i]=angStiffness;
+      angDamping_[i]=angDamping;
+    }
+
+    const Matrix3 & KineticsDynamicalSystem::getContactLinStiffness(unsigned i) const
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      return linStiffness_[i];
+    }
+
+    const Matrix3 & KineticsDynamicalSystem::getContactLinDamping(unsigned i) const
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      return linDamping_[i];
+    }
+
+    const Matrix3 & KineticsDynamicalSystem::getContactAngStiffness(unsigned i) const
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      return angStiffness_[i];
+    }
+
+    const Matrix3 & KineticsDynamicalSystem::getContactAngDamping(unsigned i) const
+    {
+      BOOST_ASSERT(i<maxContacts_ && "ERROR: The contact index is out of range");
+      return angDamping_[i];
+    }
+
+    unsigned KineticsDynamicalSystem::getContactsNumber() const
+    {
+      unsigned n=0;
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (contacts_[i])
+          ++n;
+      }
+      return n;
+    }
+
+    unsigned KineticsDynamicalSystem::getStateSize() const
+    {
+      return stateSize_;
+    }
+
+    unsigned KineticsDynamicalSystem::getInputSize() const
+    {
+      return inputSize_;
+    }
+
+    unsigned KineticsDynamicalSystem::getMeasurementSize() const
+    {
+      unsigned m=0;
+      for (unsigned j=0; j<maxIMUs_; ++j)
+      {
+        m+= (accelerometers_[j] ? 3 : 0) + (gyrometers_[j] ? 3 : 0);
+      }
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (wrenchSensors_[i])
+          m+=6;
+      }
+      return m;
+    }
+
+    unsigned KineticsDynamicalSystem::getMaxMeasurementSize() const
+    {
+      return 6*maxIMUs_+6*maxContacts_;
+    }
+}
+}
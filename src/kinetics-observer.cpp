@@ -1,2 +1,1006 @@
+#include <cmath>
+#include <stdexcept>
 
 #include <state-observation/dynamic-estimators/kinetics-observer.hpp>
+
+namespace stateObservation
+{
+namespace kineticsObserver
+{
+    namespace
+    {
+      ///default variances of the initial state
+      const double posInitVariance=1e-4;
+      const double oriInitVariance=1e-3;
+      const double linVelInitVariance=1e-4;
+      const double angVelInitVariance=1e-4;
+      const double unmodeledForceInitVariance=1e2;
+      const double unmodeledTorqueInitVariance=1e0;
+      const double contactPosInitVariance=1e-6;
+      const double contactOriInitVariance=1e-4;
+      const double contactForceInitVariance=1e2;
+      const double contactTorqueInitVariance=1e0;
+
+      ///default variances of the process noise for one sample
+      const double posProcessVariance=1e-10;
+      const double oriProcessVariance=1e-10;
+      const double linVelProcessVariance=1e-8;
+      const double angVelProcessVariance=1e-8;
+      const double unmodeledForceProcessVariance=1e-2;
+      const double unmodeledTorqueProcessVariance=1e-4;
+      const double contactPosProcessVariance=1e-10;
+      const double contactOriProcessVariance=1e-10;
+      const double contactForceProcessVariance=1e0;
+      const double contactTorqueProcessVariance=1e-2;
+
+      ///default variances of the sensors
+      const double acceleroVariance=1e-4;
+      const double gyroVariance=1e-6;
+      const double forceSensorVariance=1e0;
+      const double torqueSensorVariance=1e-2;
+
+      ///step of the finite differences
+      const double dxFactor=1e-6;
+
+      const double defaultDt=1e-3;
+
+      ///a block of measurements of one sensor, without dynamic allocation
+      typedef Eigen::Matrix<double,Eigen::Dynamic,1,0,6,1> BlockVector;
+      typedef Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,0,6,6> BlockMatrix;
+    }
+
+    KineticsObserver::KineticsObserver(unsigned maxContacts, unsigned maxIMUs):
+      maxContacts_(maxContacts),
+      maxIMUs_(maxIMUs),
+      functor_(defaultDt,maxContacts,maxIMUs),
+      ekf_(functor_.getStateSize(),functor_.getStateSize(),0,functor_.getInputSize()),
+      k_(0),
+      x_(Vector::Zero(functor_.getStateSize())),
+      u_(Vector::Zero(functor_.getInputSize())),
+      imuMeasurements_(Vector::Zero(6*maxIMUs)),
+      wrenchMeasurements_(Vector::Zero(6*maxContacts)),
+      activeWorkspace_(0),
+      dx_(Vector::Constant(functor_.getStateSize(),dxFactor)),
+      finiteDifferencesJacobians_(false),
+      withUnmodeledWrench_(false),
+      sequentialUpdate_(false),
+      blocksNumber_(0),
+      withPreviousInput_(false),
+      withAccelerationEstimation_(false),
+      withAccelerations_(false),
+      withFilteringMeasurements_(false),
+      filteredSize_(0)
+    {
+      const unsigned n=functor_.getStateSize();
+
+      ekf_.setFunctor(&functor_);
+      ekf_.setSumFunction(KineticsDynamicalSystem::stateSum);
+      ekf_.setDifferenceFunction(KineticsDynamicalSystem::stateDifference);
+
+      ///the inertia of the default input must be invertible
+      u_.segment<3>(input::inertia).setOnes();
+      uk_=u_;
+
+      ///containers of every measurement size
+      const unsigned sizes=functor_.getMaxMeasurementSize()/3+1;
+      measurementWorkspaces_.resize(sizes);
+      workspaceIndexes_.resize(sizes);
+      y_.resize(sizes);
+      r_.resize(sizes);
+      c_.resize(sizes);
+      yp_.resize(sizes);
+      filteredMeasurements_.resize(sizes);
+      innovations_.resize(sizes);
+      stackedPct_.resize(sizes);
+      innovationCovariances_.resize(sizes);
+      innovationCovarianceLLTs_.resize(sizes);
+      gainsTranspose_.resize(sizes);
+      for (unsigned i=0; i<sizes; ++i)
+      {
+        measurementWorkspaces_[i].r.resize(3*i,3*i);
+        measurementWorkspaces_[i].resize(3*i,n);
+        workspaceIndexes_[i]=i;
+        y_[i].resize(3*i);
+        r_[i].resize(3*i,3*i);
+        c_[i].resize(3*i,n);
+        yp_[i].resize(3*i);
+        filteredMeasurements_[i].resize(3*i);
+        innovations_[i].resize(3*i);
+        stackedPct_[i].resize(n,3*i);
+        innovationCovariances_[i].resize(3*i,3*i);
+        innovationCovarianceLLTs_[i]=Eigen::LLT<Matrix>(3*i);
+        gainsTranspose_[i].resize(3*i,n);
+      }
+
+      a_.resize(n,n);
+      p_.resize(n,n);
+      pk1_.resize(n,n);
+      activeQ_.resize(n,n);
+
+      xbar_.resize(n);
+      dxUpdate_.resize(n);
+      pct_.resize(n,6);
+      gain_.resize(n,6);
+      measurementBlocks_.resize(2*maxIMUs+maxContacts);
+
+      linAcc_.setZero();
+      angAcc_.setZero();
+
+      acceleroCovariance_=Matrix3::Identity()*acceleroVariance;
+      gyroCovariance_=Matrix3::Identity()*gyroVariance;
+      wrenchCovariance_.setZero();
+      wrenchCovariance_.block<3,3>(0,0)=Matrix3::Identity()*forceSensorVariance;
+      wrenchCovariance_.block<3,3>(3,3)=Matrix3::Identity()*torqueSensorVariance;
+
+      ekf_.setState(x_,k_);
+      resetCovarianceMatrices();
+    }
+
+    KineticsObserver::~KineticsObserver()
+    {
+    }
+
+    void KineticsObserver::setSamplingTime(double dt)
+    {
+      functor_.setSamplingPeriod(dt);
+    }
+
+    double KineticsObserver::getSamplingTime() const
+    {
+      return functor_.getSamplingPeriod();
+    }
+
+    TimeIndex KineticsObserver::getCurrentTime() const
+    {
+      return k_;
+    }
+
+    double KineticsObserver::getTime() const
+    {
+      return double(k_)*getSamplingTime();
+    }
+
+    void KineticsObserver::setTime(double t)
+    {
+      x_=getState();
+      k_=TimeIndex(std::floor(t/getSamplingTime()+0.5));
+      ekf_.clearInputs();
+      ekf_.clearMeasurements();
+      ekf_.setState(x_,k_);
+    }
+
+    const Vector & KineticsObserver::update()
+    {
+      const unsigned m=functor_.getMeasurementSize();
+      switchMeasurementWorkspace_(m);
+
+      Vector & y=y_[m/3];
+      Matrix & r=r_[m/3];
+      Matrix & c=c_[m/3];
+
+      ///the measurements and their covariance, in the order of the
+      ///dynamical system, the sequential update only reads the diagonal
+      ///blocks of the covariance
+      if (!sequentialUpdate_)
+      {
+        r.setZero();
+      }
+      unsigned index=0;
+      blocksNumber_=0;
+      for (unsigned j=0; j<maxIMUs_; ++j)
+      {
+        if (functor_.getAccelerometer(j))
+        {
+          y.segment<3>(index)=imuMeasurements_.segment<3>(6*j);
+          r.block<3,3>(index,index)=acceleroCovariance_;
+          measurementBlocks_[blocksNumber_++]=3;
+          index+=3;
+        }
+        if (functor_.getGyrometer(j))
+        {
+          y.segment<3>(index)=imuMeasurements_.segment<3>(6*j+3);
+          r.block<3,3>(index,index)=gyroCovariance_;
+          measurementBlocks_[blocksNumber_++]=3;
+          index+=3;
+        }
+      }
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (functor_.getContactWrenchSensor(i))
+        {
+          y.segment<6>(index)=wrenchMeasurements_.segment<6>(6*i);
+          r.block<6,6>(index,index)=wrenchCovariance_;
+          measurementBlocks_[blocksNumber_++]=6;
+          index+=6;
+        }
+      }
+
+      ///the prediction uses the input of the previous step, which is the
+      ///current one at the first step
+      if (!withPreviousInput_)
+      {
+        uk_=u_;
+        withPreviousInput_=true;
+      }
+
+      ///only the finite differences use the input queue of the filter
+      if (finiteDifferencesJacobians_)
+      {
+        if (ekf_.getInputsNumber()==0 || ekf_.getInputTime()<k_)
+        {
+          ekf_.setInput(uk_,k_);
+        }
+        ekf_.setInput(u_,k_+1);
+      }
+
+      predict_();
+
+      if (m>0)
+      {
+        if (finiteDifferencesJacobians_)
+        {
+          c=ekf_.getCMatrixFD(dx_);
+        }
+        functor_.computeMeasureDynamics(xbar_,u_,k_+1,yp_[m/3]);
+        if (!finiteDifferencesJacobians_)
+        {
+          functor_.measureDynamicsJacobian(c);
+        }
+
+        if (sequentialUpdate_)
+        {
+          ///the sensors are fused one after the other in the tangent
+          ///space of the prediction
+          dxUpdate_.setZero();
+          index=0;
+          for (unsigned b=0; b<blocksNumber_; ++b)
+          {
+            fuseMeasurementBlock_(y,yp_[m/3],c,r,index,measurementBlocks_[b]);
+            index+=measurementBlocks_[b];
+          }
+        }
+        else
+        {
+          fuseMeasurements_(y,yp_[m/3],c,r);
+        }
+
+        ///symmetrization of the covariance
+        p_=pk1_.transpose();
+        pk1_+=p_;
+        pk1_*=0.5;
+
+        KineticsDynamicalSystem::stateSum(xbar_,dxUpdate_,x_);
+      }
+      else
+      {
+        x_=xbar_;
+      }
+
+      ekf_.setState(x_,k_+1);
+      ekf_.setStateCovariance(pk1_);
+
+      ++k_;
+      uk_=u_;
+
+      withAccelerations_=false;
+      if (withAccelerationEstimation_)
+      {
+        estimateAcceleration();
+      }
+      if (withFilteringMeasurements_)
+      {
+        filterMeasurements();
+      }
+
+      ///the measurements are used once
+      for (unsigned j=0; j<maxIMUs_; ++j)
+      {
+        functor_.setIMUSensors(j,false,false);
+      }
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        functor_.setContactWrenchSensor(i,false);
+      }
+
+      return ekf_.getCurrentEstimatedState();
+    }
+
+    const Vector & KineticsObserver::getState() const
+    {
+      return ekf_.getCurrentEstimatedState();
+    }
+
+    unsigned KineticsObserver::getStateSize() const
+    {
+      return functor_.getStateSize();
+    }
+
+    Vector3 KineticsObserver::getPosition() const
+    {
+      return getState().segment<3>(state::pos);
+    }
+
+    Matrix3 KineticsObserver::getOrientation() const
+    {
+      return kine::rotationVectorToRotationMatrix(getState().segment<3>(state::ori));
+    }
+
+    Vector3 KineticsObserver::getLinearVelocity() const
+    {
+      return getState().segment<3>(state::linVel);
+    }
+
+    Vector3 KineticsObserver::getAngularVelocity() const
+    {
+      return getState().segment<3>(state::angVel);
+    }
+
+    Vector6 KineticsObserver::getUnmodeledWrench() const
+    {
+      return getState().segment<6>(state::unmodeledForce);
+    }
+
+    Vector6 KineticsObserver::getContactWrench(unsigned num) const
+    {
+      BOOST_ASSERT(num<maxContacts_ && "ERROR: The contact index is out of range");
+      return getState().segment<6>(state::contactIndex(num)+state::contactForce);
+    }
+
+    void KineticsObserver::estimateAccelerations(Vector3 & linAcc, Vector3 & angAcc)
+    {
+      functor_.computeAccelerations(getState(),u_,linAcc,angAcc);
+    }
+
+    void KineticsObserver::estimateAcceleration()
+    {
+      estimateAccelerations(linAcc_,angAcc_);
+      withAccelerations_=true;
+    }
+
+    Vector KineticsObserver::getKinematics(const Vector & localKinematics) const
+    {
+      const unsigned size=unsigned(localKinematics.size());
+      if (size%3!=0 || size>18)
+      {
+        throw std::invalid_argument("KineticsObserver: the local kinematics have the wrong size");
+      }
+
+      if (size==0)
+      {
+        Vector kinematics(withAccelerations_ ? 18 : 12);
+        kinematics.head<state::kinematicsSize>()=getState().head<state::kinematicsSize>();
+        if (withAccelerations_)
+        {
+          kinematics.segment<3>(12)=linAcc_;
+          kinematics.segment<3>(15)=angAcc_;
+        }
+        return kinematics;
+      }
+
+      ///without the accelerations, only the velocities are given
+      const unsigned outputSize= (size>12 && !withAccelerations_) ? 12 : size;
+      Vector kinematics(outputSize);
+
+      const Matrix3 orientation=getOrientation();
+      const Vector3 angVel=getAngularVelocity();
+
+      ///position of the frame relative to the base in the world frame
+      const Vector3 leverArm=orientation*localKinematics.segment<3>(0);
+      kinematics.segment<3>(0)=getPosition()+leverArm;
+
+      if (outputSize>=6)
+      {
+        kinematics.segment<3>(3)=kine::rotationMatrixToRotationVector
+                    (orientation*kine::rotationVectorToRotationMatrix(localKinematics.segment<3>(3)));
+      }
+
+      Vector3 linVel=Vector3::Zero();
+      if (outputSize>=9)
+      {
+        linVel=orientation*localKinematics.segment<3>(6);
+        kinematics.segment<3>(6)=getLinearVelocity()+angVel.cross(leverArm)+linVel;
+      }
+
+      Vector3 localAngVel=Vector3::Zero();
+      if (outputSize>=12)
+      {
+        localAngVel=orientation*localKinematics.segment<3>(9);
+        kinematics.segment<3>(9)=angVel+localAngVel;
+      }
+
+      if (outputSize>=15)
+      {
+        kinematics.segment<3>(12)=linAcc_+angAcc_.cross(leverArm)
+                                  +angVel.cross(angVel.cross(leverArm))+2*angVel.cross(linVel)
+                                  +orientation*localKinematics.segment<3>(12);
+      }
+
+      if (outputSize==18)
+      {
+        kinematics.segment<3>(15)=angAcc_+angVel.cross(localAngVel)
+                                  +orientation*localKinematics.segment<3>(15);
+      }
+
+      return kinematics;
+    }
+
+    Vector KineticsObserver::getExternalForces() const
+    {
+      Vector forces(Vector::Zero(6+6*maxContacts_));
+      forces.head<6>()=getUnmodeledWrench();
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (getContact(i))
+        {
+          forces.segment<6>(6+6*i)=getContactWrench(i);
+        }
+      }
+      return forces;
+    }
+
+    void KineticsObserver::setState(const Vector & x, bool resetCovariance)
+    {
+      BOOST_ASSERT(unsigned(x.size())==getStateSize() && "ERROR: The state vector has the wrong size");
+      if (unsigned(x.size())!=getStateSize())
+      {
+        throw std::invalid_argument("KineticsObserver: the state vector has the wrong size");
+      }
+
+      x_=x;
+      if (!withUnmodeledWrench_)
+      {
+        x_.segment<6>(state::unmodeledForce).setZero();
+      }
+      ekf_.setState(x_,k_);
+
+      if (resetCovariance)
+      {
+        ekf_.setStateCovariance(getDefaultStateCovariance(maxContacts_));
+      }
+    }
+
+    void KineticsObserver::setKinematics(const Vector3 & position, const Matrix3 & orientation,
+                                         const Vector3 & linVel, const Vector3 & angVel,
+                                         bool resetCovariance)
+    {
+      x_=getState();
+      x_.segment<3>(state::pos)=position;
+      x_.segment<3>(state::ori)=kine::rotationMatrixToRotationVector(orientation);
+      x_.segment<3>(state::linVel)=linVel;
+      x_.segment<3>(state::angVel)=angVel;
+      ekf_.setState(x_,k_);
+
+      if (resetCovariance)
+      {
+        const unsigned kine=state::kinematicsSize;
+
+        p_=ekf_.getStateCovariance();
+        p_.topRows(kine).setZero();
+        p_.leftCols(kine).setZero();
+        p_.topLeftCorner(kine,kine)=getDefaultStateCovariance(maxContacts_).topLeftCorner(kine,kine);
+        ekf_.setStateCovariance(p_);
+      }
+    }
+
+    void KineticsObserver::setWithUnmodeledWrench(bool b)
+    {
+      withUnmodeledWrench_=b;
+      if (!b)
+      {
+        x_=getState();
+        x_.segment<6>(state::unmodeledForce).setZero();
+        ekf_.setState(x_,k_);
+      }
+      updateProcessNoise_();
+    }
+
+    bool KineticsObserver::getWithUnmodeledWrench() const
+    {
+      return withUnmodeledWrench_;
+    }
+
+    void KineticsObserver::setWithExternalForces(bool b)
+    {
+      setWithUnmodeledWrench(b);
+    }
+
+    void KineticsObserver::setWithAccelerationEstimation(bool b)
+    {
+      withAccelerationEstimation_=b;
+    }
+
+    bool KineticsObserver::getWithAccelerationEstimation() const
+    {
+      return withAccelerationEstimation_;
+    }
+
+    void KineticsObserver::setWithFilteringMeasurements(bool b)
+    {
+      withFilteringMeasurements_=b;
+    }
+
+    bool KineticsObserver::getWithFilteringMeasurements() const
+    {
+      return withFilteringMeasurements_;
+    }
+
+    void KineticsObserver::filterMeasurements()
+    {
+      filteredSize_=functor_.getMeasurementSize();
+      if (filteredSize_>0)
+      {
+        functor_.computeMeasureDynamics(getState(),u_,k_,filteredMeasurements_[filteredSize_/3]);
+      }
+    }
+
+    const Vector & KineticsObserver::getFilteredMeasurements() const
+    {
+      return filteredMeasurements_[filteredSize_/3];
+    }
+
+    void KineticsObserver::setMass(double m)
+    {
+      functor_.setMass(m);
+    }
+
+    double KineticsObserver::getMass() const
+    {
+      return functor_.getMass();
+    }
+
+    void KineticsObserver::setCenterOfMass(const Vector3 & com, const Vector3 & comVel,
+                                           const Vector3 & comAcc)
+    {
+      u_.segment<3>(input::com)=com;
+      u_.segment<3>(input::comVel)=comVel;
+      u_.segment<3>(input::comAcc)=comAcc;
+    }
+
+    void KineticsObserver::setCoMInertiaTensor(const Matrix3 & inertia)
+    {
+      u_.segment<6>(input::inertia) << inertia(0,0), inertia(1,1), inertia(2,2),
+                                       inertia(0,1), inertia(0,2), inertia(1,2);
+    }
+
+    void KineticsObserver::setCoMAngularMomentum(const Vector3 & sigma, const Vector3 & sigmaDot)
+    {
+      u_.segment<3>(input::angMomentum)=sigma;
+      u_.segment<3>(input::dotAngMomentum)=sigmaDot;
+    }
+
+    void KineticsObserver::setAdditionalWrench(const Vector3 & force, const Vector3 & torque)
+    {
+      u_.segment<3>(input::additionalForce)=force;
+      u_.segment<3>(input::additionalTorque)=torque;
+    }
+
+    void KineticsObserver::setIMU(const Vector3 & accelero, const Vector3 & gyrometer,
+                                  const Vector3 & position, const Matrix3 & orientation,
+                                  const Vector3 & linVel, const Vector3 & angVel,
+                                  const Vector3 & linAcc, unsigned num)
+    {
+      setAccelerometer(accelero,position,orientation,linVel,angVel,linAcc,num);
+      setGyrometer(gyrometer,position,orientation,angVel,num);
+    }
+
+    void KineticsObserver::setIMU(const Vector3 & accelero, const Vector3 & gyrometer,
+                                  const Vector3 & position, const Matrix & orientation,
+                                  const Vector3 & linearVel, Vector3 angularVel, int num)
+    {
+      BOOST_ASSERT(num>=0 && "ERROR: The IMU index is out of range");
+      setIMU(accelero,gyrometer,position,Matrix3(orientation),linearVel,angularVel,
+             Vector3::Zero(),unsigned(num));
+    }
+
+    void KineticsObserver::setGyrometer(const Vector3 & measurement, const Vector3 & position,
+                                        const Matrix3 & orientation, const Vector3 & angVel,
+                                        unsigned num)
+    {
+      BOOST_ASSERT(num<maxIMUs_ && "ERROR: The IMU index is out of range");
+
+      const unsigned imu=input::imuIndex(maxContacts_,num);
+      u_.segment<3>(imu+input::imuPos)=position;
+      u_.segment<3>(imu+input::imuOri)=kine::rotationMatrixToRotationVector(orientation);
+      u_.segment<3>(imu+input::imuAngVel)=angVel;
+
+      imuMeasurements_.segment<3>(6*num+3)=measurement;
+      functor_.setIMUSensors(num,functor_.getAccelerometer(num),true);
+    }
+
+    void KineticsObserver::setAccelerometer(const Vector3 & measurement, const Vector3 & position,
+                                            const Matrix3 & orientation, const Vector3 & linVel,
+                                            const Vector3 & angVel, const Vector3 & linAcc,
+                                            unsigned num)
+    {
+      BOOST_ASSERT(num<maxIMUs_ && "ERROR: The IMU index is out of range");
+
+      const unsigned imu=input::imuIndex(maxContacts_,num);
+      u_.segment<3>(imu+input::imuPos)=position;
+      u_.segment<3>(imu+input::imuOri)=kine::rotationMatrixToRotationVector(orientation);
+      u_.segment<3>(imu+input::imuLinVel)=linVel;
+      u_.segment<3>(imu+input::imuAngVel)=angVel;
+      u_.segment<3>(imu+input::imuLinAcc)=linAcc;
+
+      imuMeasurements_.segment<3>(6*num)=measurement;
+      functor_.setIMUSensors(num,true,functor_.getGyrometer(num));
+    }
+
+    void KineticsObserver::setIMUCovariance(const Matrix3 & accelero, const Matrix3 & gyrometer)
+    {
+      acceleroCovariance_=accelero;
+      gyroCovariance_=gyrometer;
+    }
+
+    void KineticsObserver::setContactWrenchSensorCovariance(const Matrix6 & wrench)
+    {
+      wrenchCovariance_=wrench;
+    }
+
+    void KineticsObserver::setMeasurementNoiseCovariance(const Matrix & R)
+    {
+      BOOST_ASSERT(R.rows()==12 && R.cols()==12 && "ERROR: The covariance matrix has the wrong size");
+      if (R.rows()!=12 || R.cols()!=12)
+      {
+        throw std::invalid_argument("KineticsObserver: the measurement covariance has the wrong size");
+      }
+
+      setIMUCovariance(R.block<3,3>(0,0),R.block<3,3>(3,3));
+      setContactWrenchSensorCovariance(R.block<6,6>(6,6));
+    }
+
+    Matrix KineticsObserver::getMeasurementNoiseCovariance() const
+    {
+      Matrix R(Matrix::Zero(12,12));
+      R.block<3,3>(0,0)=acceleroCovariance_;
+      R.block<3,3>(3,3)=gyroCovariance_;
+      R.block<6,6>(6,6)=wrenchCovariance_;
+      return R;
+    }
+
+    void KineticsObserver::addContact(unsigned num, const Vector3 & restPosition,
+                                      const Matrix3 & restOrientation)
+    {
+      BOOST_ASSERT(num<maxContacts_ && "ERROR: The contact index is out of range");
+      if (functor_.getContact(num))
+      {
+        throw std::invalid_argument("KineticsObserver: the contact is already set");
+      }
+
+      const unsigned contact=state::contactIndex(num);
+
+      x_=getState();
+      x_.segment<3>(contact+state::contactPos)=restPosition;
+      x_.segment<3>(contact+state::contactOri)=kine::rotationMatrixToRotationVector(restOrientation);
+      x_.segment<6>(contact+state::contactForce).setZero();
+      ekf_.setState(x_,k_);
+
+      functor_.setContact(num,true);
+      resetContactCovariance_(num);
+      updateProcessNoise_();
+    }
+
+    void KineticsObserver::removeContact(unsigned num)
+    {
+      BOOST_ASSERT(num<maxContacts_ && "ERROR: The contact index is out of range");
+      if (!functor_.getContact(num))
+      {
+        throw std::invalid_argument("KineticsObserver: the contact is not set");
+      }
+
+      x_=getState();
+      x_.segment<6>(state::contactIndex(num)+state::contactForce).setZero();
+      ekf_.setState(x_,k_);
+
+      functor_.setContact(num,false);
+      resetContactCovariance_(num);
+      updateProcessNoise_();
+    }
+
+    bool KineticsObserver::getContact(unsigned num) const
+    {
+      return functor_.getContact(num);
+    }
+
+    unsigned KineticsObserver::getContactsNumber() const
+    {
+      return functor_.getContactsNumber();
+    }
+
+    unsigned KineticsObserver::getMaxContacts() const
+    {
+      return maxContacts_;
+    }
+
+    unsigned KineticsObserver::getMaxIMUs() const
+    {
+      return maxIMUs_;
+    }
+
+    void KineticsObserver::setContactStiffnessAndDamping
+                (unsigned num, const Matrix3 & linStiffness, const Matrix3 & linDamping,
+                 const Matrix3 & angStiffness, const Matrix3 & angDamping)
+    {
+      functor_.setContactStiffnessAndDamping(num,linStiffness,linDamping,angStiffness,angDamping);
+    }
+
+    void KineticsObserver::updateContactWithNoSensor(unsigned num, const Vector3 & position,
+                                                     const Matrix3 & orientation,
+                                                     const Vector3 & linVel, const Vector3 & angVel)
+    {
+      BOOST_ASSERT(num<maxContacts_ && "ERROR: The contact index is out of range");
+      if (!functor_.getContact(num))
+      {
+        throw std::invalid_argument("KineticsObserver: the contact is not set");
+      }
+
+      const unsigned contact=input::contactIndex(num);
+      u_.segment<3>(contact+input::contactPos)=position;
+      u_.segment<3>(contact+input::contactOri)=kine::rotationMatrixToRotationVector(orientation);
+      u_.segment<3>(contact+input::contactLinVel)=linVel;
+      u_.segment<3>(contact+input::contactAngVel)=angVel;
+    }
+
+    void KineticsObserver::updateContactWithWrenchSensor(unsigned num, const Vector6 & wrench,
+                                                         const Vector3 & position,
+                                                         const Matrix3 & orientation,
+                                                         const Vector3 & linVel,
+                                                         const Vector3 & angVel)
+    {
+      updateContactWithNoSensor(num,position,orientation,linVel,angVel);
+
+      wrenchMeasurements_.segment<6>(6*num)=wrench;
+      functor_.setContactWrenchSensor(num,true);
+    }
+
+    void KineticsObserver::setStateCovariance(const Matrix & P)
+    {
+      ekf_.setStateCovariance(P);
+    }
+
+    const Matrix & KineticsObserver::getStateCovariance() const
+    {
+      return ekf_.getStateCovariance();
+    }
+
+    void KineticsObserver::setProcessNoiseCovariance(const Matrix & Q)
+    {
+      BOOST_ASSERT(unsigned(Q.rows())==getStateSize() && unsigned(Q.cols())==getStateSize() &&
+                   "ERROR: The process noise covariance matrix has the wrong size");
+      q_=Q;
+      updateProcessNoise_();
+    }
+
+    const Matrix & KineticsObserver::getProcessNoiseCovariance() const
+    {
+      return q_;
+    }
+
+    void KineticsObserver::resetCovarianceMatrices()
+    {
+      q_=getDefaultQ(maxContacts_);
+      updateProcessNoise_();
+      ekf_.setStateCovariance(getDefaultStateCovariance(maxContacts_));
+    }
+
+    Matrix KineticsObserver::getDefaultQ(unsigned maxContacts)
+    {
+      const unsigned n=state::getSize(maxContacts);
+      Vector diagonal(n);
+
+      diagonal.segment<3>(state::pos).fill(posProcessVariance);
+      diagonal.segment<3>(state::ori).fill(oriProcessVariance);
+      diagonal.segment<3>(state::linVel).fill(linVelProcessVariance);
+      diagonal.segment<3>(state::angVel).fill(angVelProcessVariance);
+      diagonal.segment<3>(state::unmodeledForce).fill(unmodeledForceProcessVariance);
+      diagonal.segment<3>(state::unmodeledTorque).fill(unmodeledTorqueProcessVariance);
+
+      for (unsigned i=0; i<maxContacts; ++i)
+      {
+        const unsigned contact=state::contactIndex(i);
+        diagonal.segment<3>(contact+state::contactPos).fill(contactPosProcessVariance);
+        diagonal.segment<3>(contact+state::contactOri).fill(contactOriProcessVariance);
+        diagonal.segment<3>(contact+state::contactForce).fill(contactForceProcessVariance);
+        diagonal.segment<3>(contact+state::contactTorque).fill(contactTorqueProcessVariance);
+      }
+
+      return diagonal.asDiagonal();
+    }
+
+    Matrix KineticsObserver::getDefaultStateCovariance(unsigned maxContacts)
+    {
+      const unsigned n=state::getSize(maxContacts);
+      Vector diagonal(n);
+
+      diagonal.segment<3>(state::pos).fill(posInitVariance);
+      diagonal.segment<3>(state::ori).fill(oriInitVariance);
+      diagonal.segment<3>(state::linVel).fill(linVelInitVariance);
+      diagonal.segment<3>(state::angVel).fill(angVelInitVariance);
+      diagonal.segment<3>(state::unmodeledForce).fill(unmodeledForceInitVariance);
+      diagonal.segment<3>(state::unmodeledTorque).fill(unmodeledTorqueInitVariance);
+
+      for (unsigned i=0; i<maxContacts; ++i)
+      {
+        const unsigned contact=state::contactIndex(i);
+        diagonal.segment<3>(contact+state::contactPos).fill(contactPosInitVariance);
+        diagonal.segment<3>(contact+state::contactOri).fill(contactOriInitVariance);
+        diagonal.segment<3>(contact+state::contactForce).fill(contactForceInitVariance);
+        diagonal.segment<3>(contact+state::contactTorque).fill(contactTorqueInitVariance);
+      }
+
+      return diagonal.asDiagonal();
+    }
+
+    unsigned KineticsObserver::getMeasurementSize() const
+    {
+      return functor_.getMeasurementSize();
+    }
+
+    unsigned KineticsObserver::getInputSize() const
+    {
+      return functor_.getInputSize();
+    }
+
+    const Vector & KineticsObserver::getInput() const
+    {
+      return u_;
+    }
+
+    void KineticsObserver::setFiniteDifferencesJacobians(bool b)
+    {
+      finiteDifferencesJacobians_=b;
+    }
+
+    const ExtendedKalmanFilter & KineticsObserver::getEKF() const
+    {
+      return ekf_;
+    }
+
+    ExtendedKalmanFilter & KineticsObserver::getEKF()
+    {
+      return ekf_;
+    }
+
+    const KineticsDynamicalSystem & KineticsObserver::getDynamicalSystem() const
+    {
+      return functor_;
+    }
+
+    void KineticsObserver::setSequentialUpdate(bool b)
+    {
+      sequentialUpdate_=b;
+    }
+
+    bool KineticsObserver::getSequentialUpdate() const
+    {
+      return sequentialUpdate_;
+    }
+
+    void KineticsObserver::predict_()
+    {
+      if (finiteDifferencesJacobians_)
+      {
+        xbar_=ekf_.updateStatePrediction();
+        a_=ekf_.getAMatrixFD(dx_);
+      }
+      else
+      {
+        functor_.computeStateDynamics(getState(),uk_,k_,xbar_);
+        functor_.stateDynamicsJacobian(a_);
+      }
+
+      p_.noalias()=a_*ekf_.getStateCovariance();
+      pk1_=activeQ_;
+      pk1_.noalias()+=p_*a_.transpose();
+    }
+
+    void KineticsObserver::fuseMeasurementBlock_(const Vector & y, const Vector & yp,
+                                                 const Matrix & c, const Matrix & r,
+                                                 unsigned index, unsigned size)
+    {
+      BOOST_ASSERT(size<=6 && "ERROR: The measurement blocks have at most 6 rows");
+
+      const Eigen::Block<const Matrix> cBlock(c.middleRows(index,size));
+
+      ///the innovation is linearized at the prediction, as in the stacked
+      ///update, so that the result does not depend on the order of the
+      ///sensors
+      BlockVector innovation(y.segment(index,size)-yp.segment(index,size));
+      innovation.noalias()-=cBlock*dxUpdate_;
+
+      pct_.leftCols(size).noalias()=pk1_*cBlock.transpose();
+
+      BlockMatrix innovationCovariance(r.block(index,index,size,size));
+      innovationCovariance.noalias()+=cBlock*pct_.leftCols(size);
+
+      BlockMatrix inverse(innovationCovariance.inverse());
+      gain_.leftCols(size).noalias()=pct_.leftCols(size)*inverse;
+
+      dxUpdate_.noalias()+=gain_.leftCols(size)*innovation;
+      pk1_.noalias()-=gain_.leftCols(size)*pct_.leftCols(size).transpose();
+    }
+
+    void KineticsObserver::fuseMeasurements_(const Vector & y, const Vector & yp,
+                                             const Matrix & c, const Matrix & r)
+    {
+      const unsigned size=unsigned(y.size())/3;
+
+      Vector & innovation=innovations_[size];
+      Matrix & pct=stackedPct_[size];
+      Matrix & innovationCovariance=innovationCovariances_[size];
+      Matrix & gainTranspose=gainsTranspose_[size];
+
+      innovation=y-yp;
+
+      pct.noalias()=pk1_*c.transpose();
+
+      innovationCovariance=r;
+      innovationCovariance.noalias()+=c*pct;
+
+      ///the transposed gain is the solution of S K^T = C P^T
+      innovationCovarianceLLTs_[size].compute(innovationCovariance);
+      gainTranspose=pct.transpose();
+      innovationCovarianceLLTs_[size].solveInPlace(gainTranspose);
+
+      dxUpdate_.noalias()=gainTranspose.transpose()*innovation;
+      pk1_.noalias()-=gainTranspose.transpose()*pct.transpose();
+    }
+
+    void KineticsObserver::switchMeasurementWorkspace_(unsigned m)
+    {
+      BOOST_ASSERT(m%3==0 && m/3<workspaceIndexes_.size() &&
+                   "ERROR: The measurement size is out of range");
+
+      const unsigned size=m/3;
+      if (size==activeWorkspace_)
+        return;
+
+      const unsigned index=workspaceIndexes_[size];
+      ekf_.swapMeasurementWorkspace(measurementWorkspaces_[index]);
+
+      ///the workspace now keeps the containers of the previous size
+      workspaceIndexes_[activeWorkspace_]=index;
+      activeWorkspace_=size;
+    }
+
+    void KineticsObserver::updateProcessNoise_()
+    {
+      activeQ_=q_;
+
+      if (!withUnmodeledWrench_)
+      {
+        activeQ_.middleRows<6>(state::unmodeledForce).setZero();
+        activeQ_.middleCols<6>(state::unmodeledForce).setZero();
+      }
+
+      for (unsigned i=0; i<maxContacts_; ++i)
+      {
+        if (!functor_.getContact(i))
+        {
+          const unsigned contact=state::contactIndex(i);
+          activeQ_.middleRows<state::contactSize>(contact).setZero();
+          activeQ_.middleCols<state::contactSize>(contact).setZero();
+        }
+      }
+
+      ekf_.setQ(activeQ_);
+    }
+
+    void KineticsObserver::resetContactCovariance_(unsigned i)
+    {
+      const unsigned contact=state::contactIndex(i);
+      const unsigned size=state::contactSize;
+
+      p_=ekf_.getStateCovariance();
+      p_.middleRows<size>(contact).setZero();
+      p_.middleCols<size>(contact).setZero();
+
+      Eigen::Block<Matrix,size,size> block(p_.block<size,size>(contact,contact));
+      block.diagonal().segment<3>(state::contactPos).fill(contactPosInitVariance);
+      block.diagonal().segment<3>(state::contactOri).fill(contactOriInitVariance);
+      block.diagonal().segment<3>(state::contactForce).fill(contactForceInitVariance);
+      block.diagonal().segment<3>(state::contactTorque).fill(contactTorqueInitVariance);
+
+      ekf_.setStateCovariance(p_);
+    }
+}
+}
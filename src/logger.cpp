@@ -1,4 +1,5 @@
 #include <fstream>
+#include <sstream>
 #include <state-observation/tools/logger.hpp>
 
 
@@ -6,48 +7,159 @@ namespace stateObservation
 {
   namespace tools
   {
-    Logger::Logger()
+    LogChannelBase::LogChannelBase(unsigned rows, unsigned cols,
+                                   const std::string & filename, TimeSize capacity):
+      rows_(rows),
+      cols_(cols),
+      stride_(rows*cols),
+      size_(0),
+      k_(0),
+      filename_(filename)
     {
-      scalar_.resize(1,1);
+      reserve(capacity);
     }
 
-    Logger::~Logger()
+    LogChannelBase::~LogChannelBase()
     {
       //dtor
     }
 
-     void Logger::setPath(const std::string& path)
+    void LogChannelBase::reserve(TimeSize capacity)
+    {
+      if (capacity*stride_ > buffer_.size())
+      {
+        buffer_.resize(capacity*stride_);
+      }
+    }
+
+    const IndexedMatrixArray & LogChannelBase::getRecord() const
+    {
+      record_.reset();
+      Matrix m(rows_,cols_);
+      for (TimeSize i=0; i<size_; ++i)
+      {
+        m = Eigen::Map<const Matrix>(&buffer_[i*stride_],rows_,cols_);
+        record_.setValue(m,k_+TimeIndex(i));
+      }
+      return record_;
+    }
+
+    IndexedMatrixArray & LogChannelBase::getRecord()
+    {
+      const LogChannelBase & constThis=*this;
+      constThis.getRecord();
+      return record_;
+    }
+
+    const std::string & LogChannelBase::getFilename() const
+    {
+      return filename_;
+    }
+
+    void LogChannelBase::writeInFile(const std::string & filename, bool clearLog, bool append)
+    {
+      std::ofstream f;
+      if (!append)
+      {
+        f.open(filename.c_str());
+      }
+      else
+      {
+        f.open(filename.c_str(),std::ofstream::app);
+      }
+
+      if (f.is_open())
+      {
+        for (TimeSize s=0; s<size_; ++s)
+        {
+          const double * sample = &buffer_[s*stride_];
+
+          f << k_+TimeIndex(s);
+
+          ///row by row, the buffer is column major
+          for (unsigned i = 0 ; i< rows_; ++i)
+          {
+            for (unsigned j = 0 ; j< cols_; ++j)
+            {
+              f << " "<< sample[j*rows_+i];
+            }
+          }
+          f << std::endl;
+        }
+
+        if (clearLog)
+        {
+          clear();
+        }
+      }
+      else
+      {
+        std::stringstream ss;
+        ss<< "Logger: File " <<filename<<" could not be created/opened.";
+        throw std::runtime_error(ss.str());
+      }
+    }
+
+    void LogChannelBase::clear()
+    {
+      k_+=TimeIndex(size_);
+      size_=0;
+    }
+
+    Logger::Logger(TimeSize capacity):
+      capacity_(capacity)
+    {
+    }
+
+    Logger::~Logger()
+    {
+      clearTracking();
+    }
+
+    void Logger::setPath(const std::string& path)
     {
       path_=path;
+    }
 
+    void Logger::setCapacity(TimeSize capacity)
+    {
+      capacity_=capacity;
+      for (std::vector<LogChannelBase *>::iterator i=channels_.begin();i!=channels_.end();++i)
+      {
+        (*i)->reserve(capacity);
+      }
     }
 
     void Logger::save(bool clear, bool append)
     {
-      for (std::map<const void *, log_s >::iterator i=logs_.begin();i!=logs_.end();++i)
+      for (std::vector<LogChannelBase *>::iterator i=channels_.begin();i!=channels_.end();++i)
       {
-        if (i->second.filename!=std::string(""))
+        if ((*i)->getFilename()!=std::string(""))
         {
-          i->second.array.writeInFile((path_+std::string("/")+i->second.filename).c_str(),
-                                      clear,append);
+          (*i)->writeInFile(path_+std::string("/")+(*i)->getFilename(),clear,append);
         }
       }
     }
 
     void Logger::clearTracking()
     {
+      for (std::vector<LogChannelBase *>::iterator i=channels_.begin();i!=channels_.end();++i)
+      {
+        delete *i;
+      }
+      channels_.clear();
       logs_.clear();
     }
 
     void Logger::clearLogs()
     {
-      for (std::map<const void *, log_s >::iterator i=logs_.begin();i!=logs_.end();++i)
+      for (std::vector<LogChannelBase *>::iterator i=channels_.begin();i!=channels_.end();++i)
       {
-        i->second.array.clear();
+        (*i)->clear();
       }
     }
 
-    const IndexedMatrixArray & Logger::getRecord(const void* address) const
+    LogChannelBase * Logger::find_(const void* address) const
     {
       Tmap::const_iterator i= logs_.find(address);
       if (i==logs_.end())
@@ -56,75 +168,31 @@ namespace stateObservation
         throw std::invalid_argument
                 ("The logger cannot find the data, please use record function");
       }
-      else
-        return i->second.array;
+      return i->second;
+    }
+
+    const IndexedMatrixArray & Logger::getRecord(const void* address) const
+    {
+      const LogChannelBase * log=find_(address);
+      return log->getRecord();
     }
 
     IndexedMatrixArray & Logger::getRecord(const void* address)
     {
-      Tmap::iterator i= logs_.find(address);
-      if (i==logs_.end())
-      {
-        BOOST_ASSERT(false && "The logger cannot find the data, please use record function");
-        throw std::invalid_argument
-                ("The logger cannot find the data, please use record function");
-      }
-      else
-        return i->second.array;
+      return find_(address)->getRecord();
     }
 
-    void Logger::push()
+    LogChannelBase * Logger::getChannel(const void* address) const
     {
-      for (std::map<const void *, log_s >::iterator i=logs_.begin();i!=logs_.end();++i)
-      {
-        update_(i);
-      }
+      return find_(address);
     }
 
-    void Logger::update_(const Tmap::iterator & i)
+    void Logger::push()
     {
-      if (*i->second.type == typeid(Matrix))
-      {
-        i->second.array.pushBack(*static_cast<const Matrix *>(i->first));
-        return;
-      }
-      if (*i->second.type == typeid(Vector))
-      {
-        i->second.array.pushBack(*static_cast<const Vector *>(i->first));
-        return;
-      }
-      if (*i->second.type == typeid(Matrix3))
-      {
-        i->second.array.pushBack(*static_cast<const Matrix3 *>(i->first));
-        return;
-      }
-      if (*i->second.type == typeid(Vector3))
+      for (std::vector<LogChannelBase *>::iterator i=channels_.begin();i!=channels_.end();++i)
       {
-        i->second.array.pushBack(*static_cast<const Vector3 *>(i->first));
-        return;
+        (*i)->push();
       }
-      else if (*i->second.type == typeid(int))
-      {
-        scalar_(0,0)=double(*static_cast<const int *>(i->first));
-      }
-      else if (*i->second.type == typeid(unsigned))
-      {
-        scalar_(0,0)=double(*static_cast<const unsigned *>(i->first));
-      }
-      else if (*i->second.type == typeid(long))
-      {
-        scalar_(0,0)=double(*static_cast<const long *>(i->first));
-      }
-      else if (*i->second.type == typeid(double))
-      {
-        scalar_(0,0)=*static_cast<const double *>(i->first);
-      }
-      else if (*i->second.type == typeid(float))
-      {
-        scalar_(0,0)=double(*static_cast<const float *>(i->first));
-      }
-
-      i->second.array.pushBack(scalar_);
     }
 
   }
@@ -0,0 +1,280 @@
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-bank.hpp>
+
+namespace stateObservation
+{
+  namespace flexibilityEstimation
+  {
+    ModelBaseEKFFlexEstimatorBank::ModelBaseEKFFlexEstimatorBank(double dt,
+                                                                unsigned contactsMaxNumber):
+      dt_(dt),
+      contactsMaxNumber_(contactsMaxNumber),
+      mostLikely_(0),
+      selection_(selection::mostLikely),
+      automaticThreads_(true),
+      generation_(0),
+      pending_(0),
+      stop_(false)
+    {
+      setLikelihoodWindowLength(defaultWindowLength);
+    }
+
+    ModelBaseEKFFlexEstimatorBank::~ModelBaseEKFFlexEstimatorBank()
+    {
+      stopThreads_();
+      for (unsigned i=0; i<estimators_.size(); ++i)
+      {
+        delete estimators_[i];
+      }
+    }
+
+    unsigned ModelBaseEKFFlexEstimatorBank::addHypothesis(unsigned contactsNumber)
+    {
+      ModelBaseEKFFlexEstimatorIMU * estimator=
+        new ModelBaseEKFFlexEstimatorIMU(dt_,contactsMaxNumber_);
+      estimator->setContactsNumber(contactsNumber);
+      estimator->setLikelihoodMonitoring(true);
+
+      estimators_.push_back(estimator);
+      flexibilities_.resize(estimators_.size(),0);
+      logLikelihoods_.resize(estimators_.size(),0);
+      samples_.resize(estimators_.size(),0);
+      resetProbabilities();
+
+      if (automaticThreads_)
+      {
+        ///the calling thread runs the first hypothesis
+        unsigned threads=unsigned(estimators_.size())-1;
+        unsigned cores=boost::thread::hardware_concurrency();
+        if (cores>0)
+        {
+          threads=std::min(threads,cores-1);
+        }
+
+        stopThreads_();
+        startThreads_(threads);
+      }
+
+      return unsigned(estimators_.size())-1;
+    }
+
+    ModelBaseEKFFlexEstimatorIMU & ModelBaseEKFFlexEstimatorBank::getEstimator(unsigned i)
+    {
+      BOOST_ASSERT(i<estimators_.size() && "ERROR: The hypothesis does not exist");
+      return *estimators_[i];
+    }
+
+    const ModelBaseEKFFlexEstimatorIMU & ModelBaseEKFFlexEstimatorBank::getEstimator(unsigned i) const
+    {
+      BOOST_ASSERT(i<estimators_.size() && "ERROR: The hypothesis does not exist");
+      return *estimators_[i];
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::setThreadsNumber(unsigned n)
+    {
+      automaticThreads_=false;
+      stopThreads_();
+      startThreads_(n);
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::setMeasurement(const Vector & y)
+    {
+      for (unsigned i=0; i<estimators_.size(); ++i)
+      {
+        estimators_[i]->setMeasurement(y);
+      }
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::setMeasurement(unsigned i, const Vector & y)
+    {
+      getEstimator(i).setMeasurement(y);
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::setInput(unsigned i, const Vector & u)
+    {
+      getEstimator(i).setInput(u);
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::setMeasurementInput(unsigned i, const Vector & u)
+    {
+      getEstimator(i).setMeasurementInput(u);
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::setSelection(unsigned s)
+    {
+      BOOST_ASSERT((s==selection::mostLikely || s==selection::mixture) &&
+                   "ERROR: Unknown selection of the flexibility");
+      selection_=s;
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::setLikelihoodWindowLength(double samples)
+    {
+      BOOST_ASSERT(samples>=1 && "ERROR: The window must be at least one sample long");
+      if (samples<1)
+      {
+        throw std::invalid_argument("ModelBaseEKFFlexEstimatorBank: the window must be at least one sample long");
+      }
+      windowLength_=samples;
+      lambda_=1-1/samples;
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::resetProbabilities()
+    {
+      const unsigned n=unsigned(estimators_.size());
+      logWeights_=Vector::Zero(n);
+      probabilities_=Vector::Constant(n,1./n);
+      mostLikely_=0;
+    }
+
+    const Vector & ModelBaseEKFFlexEstimatorBank::getFlexibilityVector()
+    {
+      BOOST_ASSERT(estimators_.size()>0 && "ERROR: There is no hypothesis");
+      if (estimators_.size()==0)
+      {
+        throw std::runtime_error("ModelBaseEKFFlexEstimatorBank: there is no hypothesis");
+      }
+
+      if (threads_.size()>0)
+      {
+        {
+          boost::unique_lock<boost::mutex> lock(mutex_);
+          pending_=unsigned(threads_.size());
+          ++generation_;
+        }
+        wakeUp_.notify_all();
+
+        estimate_(0);
+
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        while (pending_>0)
+        {
+          done_.wait(lock);
+        }
+      }
+      else
+      {
+        estimate_(0);
+      }
+
+      updateProbabilities_();
+
+      if (selection_==selection::mixture)
+      {
+        x_=probabilities_[0]*(*flexibilities_[0]);
+        for (unsigned i=1; i<estimators_.size(); ++i)
+        {
+          x_+=probabilities_[i]*(*flexibilities_[i]);
+        }
+      }
+      else
+      {
+        x_=*flexibilities_[mostLikely_];
+      }
+
+      return x_;
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::estimate_(unsigned slot)
+    {
+      const unsigned slots=unsigned(threads_.size())+1;
+
+      for (unsigned i=slot; i<estimators_.size(); i+=slots)
+      {
+        ModelBaseEKFFlexEstimatorIMU & estimator=*estimators_[i];
+        const TimeIndex k=estimator.getEKF().getCurrentTime();
+
+        flexibilities_[i]=&estimator.getFlexibilityVector();
+
+        samples_[i]=estimator.getEKF().getCurrentTime()-k;
+        logLikelihoods_[i]= samples_[i]>0 ? estimator.getInnovationLogLikelihood() : 0;
+      }
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::work_(unsigned slot, unsigned generation)
+    {
+      for (;;)
+      {
+        {
+          boost::unique_lock<boost::mutex> lock(mutex_);
+          while (!stop_ && generation_==generation)
+          {
+            wakeUp_.wait(lock);
+          }
+          if (stop_)
+          {
+            return;
+          }
+          generation=generation_;
+        }
+
+        estimate_(slot);
+
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        if (--pending_==0)
+        {
+          done_.notify_one();
+        }
+      }
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::startThreads_(unsigned n)
+    {
+      stop_=false;
+      for (unsigned i=0; i<n; ++i)
+      {
+        threads_.push_back(new boost::thread
+                           (&ModelBaseEKFFlexEstimatorBank::work_,this,i+1,generation_));
+      }
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::stopThreads_()
+    {
+      {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        stop_=true;
+      }
+      wakeUp_.notify_all();
+
+      for (unsigned i=0; i<threads_.size(); ++i)
+      {
+        threads_[i]->join();
+        delete threads_[i];
+      }
+      threads_.clear();
+    }
+
+    void ModelBaseEKFFlexEstimatorBank::updateProbabilities_()
+    {
+      const unsigned n=unsigned(estimators_.size());
+      const double lowest=-std::numeric_limits<double>::max();
+
+      for (unsigned i=0; i<n; ++i)
+      {
+        if (samples_[i]>0)
+        {
+          logWeights_[i]=std::pow(lambda_,double(samples_[i]))*logWeights_[i]+logLikelihoods_[i];
+
+          ///a diverging filter makes its hypothesis the least likely
+          if (!(logWeights_[i]>lowest))
+          {
+            logWeights_[i]=lowest;
+          }
+        }
+      }
+
+      Vector::Index index;
+      double maxLogWeight=logWeights_.maxCoeff(&index);
+      mostLikely_=unsigned(index);
+
+      for (unsigned i=0; i<n; ++i)
+      {
+        probabilities_[i]=std::exp(logWeights_[i]-maxLogWeight);
+      }
+      probabilities_/=probabilities_.sum();
+    }
+  }
+}
@@ -2,20 +2,22 @@
 #include <state-observation/tools/miscellaneous-algorithms.hpp>
 
 const double dxFactor = 1.0e-8;
-const int stateSize = 35;
 
 namespace stateObservation
 {
   namespace flexibilityEstimation
   {
     typedef IMUElasticLocalFrameDynamicalSystem::state state;
+    typedef IMUElasticLocalFrameDynamicalSystem::input input;
 
-    ModelBaseEKFFlexEstimatorIMU::ModelBaseEKFFlexEstimatorIMU(double dt):
+    ModelBaseEKFFlexEstimatorIMU::ModelBaseEKFFlexEstimatorIMU(double dt,
+                                                              unsigned contactsMaxNumber):
       EKFFlexibilityEstimatorBase
-      (stateSize,measurementSizeBase_,inputSizeBase_,
-       Matrix::Constant(stateSize,1,dxFactor)),
-      functor_(dt),
-      stateSize_(stateSize),
+      (state::getSize(contactsMaxNumber),measurementSizeBase_,inputSizeBase_,
+       Matrix::Constant(state::getSize(contactsMaxNumber),1,dxFactor)),
+      functor_(dt,contactsMaxNumber),
+      activeMeasurementContacts_(0),
+      stateSize_(functor_.getStateSize()),
       unmodeledForceVariance_(1e-6),
       forceVariance_(Matrix::Identity(6,6)*1e-4),
       absPosVariance_(1e-4),
@@ -23,7 +25,17 @@ namespace stateObservation
       withAbsolutePos_(false),
       withComBias_(false),
       withUnmodeledForces_(false),
-      limitOn_(true)
+      limitOn_(true),
+      deadline_(0),
+      degradations_(degradation::none),
+      likelihoodMonitoring_(false),
+      innovationLogLikelihood_(0),
+      stepDuration_(0),
+      jacobianDuration_(0),
+      jacobiansSet_(false),
+      deadlineStopwatch_(CLOCK_MONOTONIC),
+      stepStopwatch_(CLOCK_MONOTONIC),
+      observabilityMonitoring_(false)
     {
       ekf_.setMeasureSize(functor_.getMeasurementSize());
       ekf_.setStateSize(stateSize_);
@@ -44,7 +56,7 @@ namespace stateObservation
       lastX_=x0;
       ekf_.setState(x0,0);
 
-      ekf_.setStateCovariance(Q_);
+      ModelBaseEKFFlexEstimatorIMU::resetStateCovarianceMatrix();
 
       ekf_.setFunctor(& functor_);
 
@@ -72,8 +84,9 @@ namespace stateObservation
       //dtor
     }
 
-    Matrix ModelBaseEKFFlexEstimatorIMU::getDefaultQ()
+    Matrix ModelBaseEKFFlexEstimatorIMU::getDefaultQ(unsigned contactsMaxNumber)
     {
+      unsigned stateSize=state::getSize(contactsMaxNumber);
       Matrix Q=Matrix::Identity(stateSize,stateSize);
 
       Q.block(state::pos,state::pos,3,3)=Matrix3::Identity()*1.e-8;
@@ -81,10 +94,11 @@ namespace stateObservation
       Q.block(state::linVel,state::linVel,3,3)=Matrix3::Identity()*1.e-8;
       Q.block(state::angVel,state::angVel,3,3)=Matrix3::Identity()*1.e-8;
 
-      Q.block(state::fc,state::fc,3,3)=Matrix3::Identity()*1.e-4;
-      Q.block(state::fc+3,state::fc+3,3,3)=Matrix3::Identity()*1.e-4;
-      Q.block(state::fc+6,state::fc+6,3,3)=Matrix3::Identity()*1.e-4;
-      Q.block(state::fc+6+3,state::fc+6+3,3,3)=Matrix3::Identity()*1.e-4;
+      for (unsigned i=0; i<std::max(contactsMaxNumber,hrp2::contact::nbModeledMax); ++i)
+      {
+        Q.block(state::fcIndex(i),state::fcIndex(i),3,3)=Matrix3::Identity()*1.e-4;
+        Q.block(state::fcIndex(i)+3,state::fcIndex(i)+3,3,3)=Matrix3::Identity()*1.e-4;
+      }
 
       return Q;
     }
@@ -93,6 +107,7 @@ namespace stateObservation
     {
       Matrix6 R;
 
+      R.setZero();
       R.block<3,3>(0,0)=Matrix3::Identity()*1.e-6;//accelerometer
       R.block<3,3>(3,3)=Matrix3::Identity()*1.e-6;//gyrometer
 
@@ -104,15 +119,22 @@ namespace stateObservation
 
 /////// std::cout << "\n\n\n ============> RESET COVARIANCE MATRIX <=============== \n\n\n" << std::endl;
 
-      R_=Matrix::Identity(getMeasurementSize(),getMeasurementSize());
+      const unsigned absPosIndex=6+6*forceMeasurementsMax_;
+
+      R_=Matrix::Identity(absPosIndex+6,absPosIndex+6);
       R_.block<6,6>(0,0)=getDefaultRIMU();
+      for (unsigned i=0; i<forceMeasurementsMax_; ++i)
+      {
+        R_.block<6,6>(6+6*i,6+6*i)=forceVariance_;
+      }
+      R_.block<6,6>(absPosIndex,absPosIndex)=Matrix6::Identity()*absPosVariance_;
 
       updateMeasurementCovarianceMatrix_();
       stateObservation::Matrix m;
       m.resize(6,6);
       m.setIdentity();
 
-      Q_=getDefaultQ();
+      Q_=getDefaultQ(getContactsMaxNumber());
 
       if(withUnmodeledForces_)
         Q_.block(state::unmodeledForces,state::unmodeledForces,6,6)=Matrix6::Identity()*m*1.e-2;
@@ -129,33 +151,94 @@ namespace stateObservation
       else
         Q_.block(state::drift,state::drift,3,3).setZero();
 
-      ekf_.setQ(Q_);
+      updateProcessCovarianceMatrix_();
       resetStateCovarianceMatrix();
     }
 
     void ModelBaseEKFFlexEstimatorIMU::resetStateCovarianceMatrix()
     {
       P_=Q_;
+      removeInactiveContacts_(P_);
+      ekf_.setStateCovariance(P_);
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::updateProcessCovarianceMatrix_()
+    {
+      op_.Q=Q_;
+      removeInactiveContacts_(op_.Q);
+      ekf_.setQ(op_.Q);
+
+      ///the cost of the update scales with the number of active contacts,
+      ///without inactive contacts there is no range and the whole state is
+      ///estimated
+      activeRanges_.clear();
+      unsigned begin=0;
+      for (unsigned i=functor_.getForceSlotsNumber(); i<getContactsMaxNumber(); ++i)
+      {
+        const unsigned index=state::fcIndex(i);
+        if (index>begin)
+          activeRanges_.push_back(std::make_pair(begin,index-begin));
+        begin=index+6;
+      }
+      if (begin>0 && begin<stateSize_)
+        activeRanges_.push_back(std::make_pair(begin,stateSize_-begin));
+
+      ekf_.setActiveTangentRanges(activeRanges_);
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::updateContactsCovariance_(unsigned previousForceSlots)
+    {
+      unsigned forceSlots=functor_.getForceSlotsNumber();
+      if (forceSlots==previousForceSlots)
+        return;
+
+      P_=ekf_.getStateCovariance();
+      for (unsigned i=previousForceSlots; i<forceSlots; ++i)
+      {
+        unsigned index=state::fcIndex(i);
+        P_.block(index,0,6,stateSize_).setZero();
+        P_.block(0,index,stateSize_,6).setZero();
+        P_.block(index,index,6,6)=Q_.block(index,index,6,6);
+      }
+      removeInactiveContacts_(P_);
       ekf_.setStateCovariance(P_);
+
+      updateProcessCovarianceMatrix_();
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::removeInactiveContacts_(Matrix & covariance) const
+    {
+      for (unsigned i=functor_.getForceSlotsNumber(); i<getContactsMaxNumber(); ++i)
+      {
+        covariance.block(state::fcIndex(i),0,6,stateSize_).setZero();
+        covariance.block(0,state::fcIndex(i),stateSize_,6).setZero();
+      }
     }
 
     void ModelBaseEKFFlexEstimatorIMU::setContactsNumber(unsigned i)
     {
+      unsigned previousForceSlots=functor_.getForceSlotsNumber();
       functor_.setContactsNumber(i);
+      updateContactsCovariance_(previousForceSlots);
+      jacobiansSet_=false;
 
+      ///the pending inputs are kept, the ones of the new contacts are zero
+      ///until they are set
       inputSize_ = functor_.getInputSize();
-      ekf_.setInputSize(inputSize_);
+      ekf_.convertInputs(inputSize_);
 
       if (useFTSensors_)
       {
-        ekf_.setMeasureSize(functor_.getMeasurementSize());
-        updateMeasurementCovarianceMatrix_();
+        switchMeasurementWorkspace_(i);
       }
     }
 
     void ModelBaseEKFFlexEstimatorIMU::setContactModel(unsigned nb)
     {
+      unsigned previousForceSlots=functor_.getForceSlotsNumber();
       functor_.setContactModel(nb);
+      updateContactsCovariance_(previousForceSlots);
+      jacobiansSet_=false;
     }
 
 
@@ -200,7 +283,7 @@ namespace stateObservation
 
         ekf_.setState(x_s,k_);
 
-        ekf_.setQ(Q_);
+        updateProcessCovarianceMatrix_();
       }
     }
 
@@ -221,7 +304,7 @@ namespace stateObservation
                         ///the matrix should be square
                         ///and have a size multiple of 6
 
-      R_=R;
+      setMeasurementCovariance_(activeMeasurementContacts_,R);
       updateMeasurementCovarianceMatrix_();
     }
 
@@ -230,7 +313,7 @@ namespace stateObservation
     (const Matrix & Q)
     {
       Q_=Q;
-      ekf_.setQ(Q_);
+      updateProcessCovarianceMatrix_();
     }
 
     Matrix ModelBaseEKFFlexEstimatorIMU::getProcessNoiseCovariance() const
@@ -241,7 +324,7 @@ namespace stateObservation
 
     Matrix ModelBaseEKFFlexEstimatorIMU::getMeasurementNoiseCovariance() const
     {
-      return R_;
+      return ekf_.getR();
     }
 
     Vector ModelBaseEKFFlexEstimatorIMU::getMomentaDotFromForces()
@@ -278,56 +361,97 @@ namespace stateObservation
 
       Vector v2;
       v2.resize(functor_.getContactsNumber()*6);
-      v2 << v.segment(state::fc,functor_.getContactsNumber()*6);
+      for (unsigned i=0; i<functor_.getContactsNumber(); ++i)
+        v2.segment<6>(6*i) = v.segment<6>(state::fcIndex(i));
 
       return v2;
     }
 
     void ModelBaseEKFFlexEstimatorIMU::updateMeasurementCovarianceMatrix_()
     {
+      const unsigned configurations=forceMeasurementsMax_+1;
+
+      measurementWorkspaces_.resize(configurations);
+      workspaceIndexes_.resize(configurations);
 
-      if (R_.rows()!=getMeasurementSize())
+      for (unsigned i=0; i<configurations; ++i)
       {
+        ExtendedKalmanFilter::MeasurementWorkspace & w=measurementWorkspaces_[i];
+        getMeasurementCovariance_(i,w.r);
+        w.resize(unsigned(w.r.rows()),stateSize_);
+        workspaceIndexes_[i]=i;
+      }
 
-        size_t realIndex = R_.rows();
-        R_.conservativeResize(getMeasurementSize(),getMeasurementSize());
+      activeMeasurementContacts_= useFTSensors_ ? functor_.getContactsNumber() : 0;
 
-        size_t currIndex = 6;
-        if(useFTSensors_)
-        {
-          ///if the force part of the matrix is not filled
-          if (realIndex < currIndex + functor_.getContactsNumber() * 6)
-          {
-            R_.block(currIndex,0,functor_.getContactsNumber()*6,currIndex).setZero();
-            R_.block(0,currIndex,currIndex,functor_.getContactsNumber()*6).setZero();
-            for (size_t i=0; i<functor_.getContactsNumber(); ++i)
-            {
-              R_.block(currIndex,currIndex,6,6) = forceVariance_;
-              currIndex +=6;
-            }
-          }
-        }
+      BOOST_ASSERT(activeMeasurementContacts_<configurations &&
+                   "ERROR: Too many contacts with force measurements");
 
-        if(withAbsolutePos_)
-        {
-          if (realIndex < currIndex + 6)
-          {
+      ekf_.swapMeasurementWorkspace(measurementWorkspaces_[activeMeasurementContacts_]);
+      jacobiansSet_=false;
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::switchMeasurementWorkspace_(unsigned contacts)
+    {
+      BOOST_ASSERT(contacts<workspaceIndexes_.size() &&
+                   "ERROR: Too many contacts with force measurements");
 
+      if (contacts==activeMeasurementContacts_)
+        return;
 
-            R_.block(currIndex,0,6,currIndex).setZero();
-            R_.block(0,currIndex,currIndex,6).setZero();
-            R_.block(currIndex,currIndex,6,6) = Matrix::Identity(6,6)*absPosVariance_;
+      const unsigned index=workspaceIndexes_[contacts];
 
-            currIndex += 6;
-          }
-        }
+      ///the pending measurements are kept, the absolute position stays at
+      ///the end and the forces of the new contacts are zero until they are set
+      ekf_.convertMeasurements(unsigned(measurementWorkspaces_[index].r.rows()),
+                               withAbsolutePos_ ? 6 : 0);
+      ekf_.swapMeasurementWorkspace(measurementWorkspaces_[index]);
+
+      ///the workspace now keeps the containers of the previous contacts
+      workspaceIndexes_[activeMeasurementContacts_]=index;
+      activeMeasurementContacts_=contacts;
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::getMeasurementCovariance_
+                                            (unsigned contacts, Matrix & R) const
+    {
+      const unsigned top=6+(useFTSensors_ ? 6*contacts : 0);
+      const unsigned size=top+(withAbsolutePos_ ? 6 : 0);
+      const unsigned absPosIndex=6+6*forceMeasurementsMax_;
+
+      R.resize(size,size);
+      R.topLeftCorner(top,top)=R_.topLeftCorner(top,top);
+
+      if (withAbsolutePos_)
+      {
+        R.block(top,top,6,6)=R_.block(absPosIndex,absPosIndex,6,6);
+        R.block(top,0,6,top)=R_.block(absPosIndex,0,6,top);
+        R.block(0,top,top,6)=R_.block(0,absPosIndex,top,6);
+      }
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::setMeasurementCovariance_
+                                            (unsigned contacts, const Matrix & R)
+    {
+      const unsigned top=6+(useFTSensors_ ? 6*contacts : 0);
+      const unsigned absPosIndex=6+6*forceMeasurementsMax_;
+
+      BOOST_ASSERT(unsigned(R.rows())==top+(withAbsolutePos_ ? 6 : 0) &&
+                   "ERROR: The measurement noise covariance matrix R has incorrect size");
+
+      R_.topLeftCorner(top,top)=R.topLeftCorner(top,top);
+
+      if (withAbsolutePos_)
+      {
+        R_.block(absPosIndex,absPosIndex,6,6)=R.block(top,top,6,6);
+        R_.block(absPosIndex,0,6,top)=R.block(top,0,6,top);
+        R_.block(0,absPosIndex,top,6)=R.block(0,top,top,6);
       }
-      ekf_.setR(R_);
     }
 
     unsigned ModelBaseEKFFlexEstimatorIMU::getStateSize() const
     {
-      return stateSize;
+      return stateSize_;
     }
 
 
@@ -382,24 +506,64 @@ namespace stateObservation
         {
           k_=ekf_.getMeasurementTime();
 
+          degradations_=degradation::none;
+          innovationLogLikelihood_=0;
+          if (deadline_>0)
+            deadlineStopwatch_.start();
+
           TimeIndex i;
           for (i=ekf_.getCurrentTime()+1; i<=k_; ++i)
           {
-            if (finiteDifferencesJacobians_)
+            unsigned step=selectStep_(i);
+            degradations_|=step;
+
+            if (step==degradation::meanOnly)
+            {
+              ///the measurement of the sample is dropped
+              ekf_.setState(ekf_.updateStatePrediction(),i);
+              P_=ekf_.getStateCovariance();
+              P_+=op_.Q;
+              ekf_.setStateCovariance(P_);
+              continue;
+            }
+
+            if (step==degradation::none)
+              stepStopwatch_.start();
+
+            if (finiteDifferencesJacobians_ && step==degradation::none)
             {
               ekf_.updateStateAndMeasurementPrediction();
 
               //ekf_.setA(ekf_.getAMatrixFD(dx_));
               //ekf_.setC(ekf_.getCMatrixFD(dx_));
-             ekf_.setA(functor_.stateDynamicsJacobian());
-             ekf_.setC(functor_.measureDynamicsJacobian());
-
+              STATEOBSERVATION_TIMING_START(ekf_.getTimings(),KalmanFilterBase::timingStage::jacobianA);
+              ekf_.setA(functor_.stateDynamicsJacobian());
+              STATEOBSERVATION_TIMING_STOP(ekf_.getTimings(),KalmanFilterBase::timingStage::jacobianA);
+              STATEOBSERVATION_TIMING_START(ekf_.getTimings(),KalmanFilterBase::timingStage::jacobianC);
+              ekf_.setC(functor_.measureDynamicsJacobian());
+              STATEOBSERVATION_TIMING_STOP(ekf_.getTimings(),KalmanFilterBase::timingStage::jacobianC);
+
+              jacobiansSet_=true;
+              jacobianDuration_=1e-9*stepStopwatch_.stop();
             }
 
 
             ekf_.getEstimatedState(i);
+            if (likelihoodMonitoring_)
+              innovationLogLikelihood_+=ekf_.getInnovationLogLikelihood();
 
+            if (step==degradation::none)
+              stepDuration_=1e-9*stepStopwatch_.stop();
+
+            if (observabilityMonitoring_ && ekf_.checkAmatrix(ekf_.getA())
+                                         && ekf_.checkCmatrix(ekf_.getC()))
+            {
+              observabilityGramian_.update(ekf_.getA(),ekf_.getC());
+            }
           }
+          if (deadline_>0 && 1e-9*deadlineStopwatch_.stop()>deadline_)
+            degradations_|=degradation::deadlineExceeded;
+
           x_=ekf_.getEstimatedState(k_);
 #ifndef EIGEN_VERSION_LESS_THAN_3_2
           if (! x_.hasNaN())//detect NaN values
@@ -464,17 +628,370 @@ namespace stateObservation
       return lastX_;
     }
 
+    unsigned ModelBaseEKFFlexEstimatorIMU::selectStep_(TimeIndex i)
+    {
+      if (deadline_<=0)
+        return degradation::none;
+
+      ///the given Jacobians are always reused
+      const bool reusable= jacobiansSet_ || !finiteDifferencesJacobians_;
+      const double samples=double(k_-i+1);
+      const double budget=deadline_-1e-9*deadlineStopwatch_.stop();
+
+      if (samples*stepDuration_<=budget)
+        return degradation::none;
+
+      if (reusable && samples*(stepDuration_-jacobianDuration_)<=budget)
+        return degradation::reusedJacobians;
+
+      ///the last sample is always estimated
+      if (i<k_)
+        return degradation::meanOnly;
+
+      return reusable ? degradation::reusedJacobians : degradation::none;
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::setDeadline(double seconds)
+    {
+      BOOST_ASSERT(seconds>=0 && "ERROR: The deadline must be non negative");
+      if (seconds<0)
+      {
+        throw std::invalid_argument("ModelBaseEKFFlexEstimatorIMU: the deadline must be non negative.");
+      }
+      deadline_=seconds;
+    }
+
     stateObservation::Matrix& ModelBaseEKFFlexEstimatorIMU::computeLocalObservationMatrix()
     {
-      op_.O.resize(getMeasurementSize()*2,getStateSize());
-      op_.CA.resize(getMeasurementSize(),getStateSize());
-      op_.CA  = ekf_.getC();
-      op_.O.block(0,0,getMeasurementSize(),getStateSize()) = op_.CA;
-      op_.CA = op_.CA * ekf_.getA();
-      op_.O.block(getMeasurementSize(),0,getMeasurementSize(),getStateSize()) = op_.CA;
+      const Matrix & A=ekf_.getA();
+      const Matrix & C=ekf_.getC();
+
+      op_.O.resize(2*C.rows(),C.cols());
+      op_.O.topRows(C.rows())=C;
+      op_.O.bottomRows(C.rows()).noalias()=C*A;
       return op_.O;
     }
 
+    void ModelBaseEKFFlexEstimatorIMU::setObservabilityMonitoring(bool b)
+    {
+      if (b && !observabilityMonitoring_)
+      {
+        observabilityGramian_.setStateSize(getStateSize());
+      }
+      observabilityMonitoring_=b;
+    }
+
+    struct ModelBaseEKFFlexEstimatorIMU::CheckpointData
+    {
+      unsigned contactModel;
+      unsigned contactsNumber;
+      bool useFTSensors;
+      bool withAbsolutePos;
+      bool withComBias;
+      bool withUnmodeledForces;
+
+      unsigned integrator;
+      unsigned integrationSubsampling;
+      double adaptiveIntegrationFactor;
+      double dt;
+      double robotMass;
+      Matrix3 Kfe, Kfv, Kte, Ktv;
+      Matrix3 KfeRopes, KfvRopes, KteRopes, KtvRopes;
+      Vector3 pe;
+
+      bool on;
+      bool limitOn;
+      Vector3 limitForces;
+      Vector3 limitTorques;
+      double deadline;
+
+      Matrix Q, R;
+      Matrix forceVariance;
+      double absPosVariance;
+      double unmodeledForceVariance;
+
+      TimeIndex k;
+      TimeIndex time;
+      Vector x, lastX, xOut;
+      Matrix P;
+      bool jacobiansSet;
+      Matrix A, C;
+
+      IndexedVectorArray u;
+      IndexedVectorArray y;
+    };
+
+    void ModelBaseEKFFlexEstimatorIMU::saveCheckpoint(tools::Checkpoint & c) const
+    {
+      c.clear();
+      c.write(checkpointTag_);
+      c.write(checkpointVersion_);
+      c.write(getContactsMaxNumber());
+
+      c.write(functor_.getContactModel());
+      c.write(functor_.getContactsNumber());
+      c.write(useFTSensors_);
+      c.write(withAbsolutePos_);
+      c.write(withComBias_);
+      c.write(withUnmodeledForces_);
+
+      c.write(functor_.getIntegrator());
+      c.write(functor_.getIntegrationSubsampling());
+      c.write(functor_.getAdaptiveIntegrationFactor());
+      c.write(functor_.getSamplingPeriod());
+      c.write(functor_.getRobotMass());
+      c.write(functor_.getKfe());
+      c.write(functor_.getKfv());
+      c.write(functor_.getKte());
+      c.write(functor_.getKtv());
+      c.write(functor_.getKfeRopes());
+      c.write(functor_.getKfvRopes());
+      c.write(functor_.getKteRopes());
+      c.write(functor_.getKtvRopes());
+      c.write(functor_.getPe());
+
+      c.write(on_);
+      c.write(limitOn_);
+      c.write(limitForces_);
+      c.write(limitTorques_);
+      c.write(deadline_);
+
+      c.write(Q_);
+      c.write(R_);
+      c.write(forceVariance_);
+      c.write(absPosVariance_);
+      c.write(unmodeledForceVariance_);
+
+      c.write(k_);
+      c.write(ekf_.getCurrentTime());
+      c.write(ekf_.getCurrentEstimatedState());
+      c.write(lastX_);
+      c.write(x_);
+      c.write(ekf_.getStateCovariance());
+
+      ///the Jacobians are kept only when they can be reused
+      c.write(jacobiansSet_);
+      if (jacobiansSet_)
+      {
+        c.write(ekf_.getA());
+        c.write(ekf_.getC());
+      }
+
+      ///pending samples, they are contiguous
+      const TimeSize inputs=ekf_.getInputsNumber();
+      const TimeIndex firstInput= inputs>0 ? ekf_.getInputTime()-TimeIndex(inputs)+1 : 0;
+      c.write(unsigned(inputs));
+      c.write(firstInput);
+      for (TimeIndex i=firstInput; i<firstInput+TimeIndex(inputs); ++i)
+      {
+        c.write(ekf_.getInput(i));
+      }
+
+      const TimeSize measurements=ekf_.getMeasurementsNumber();
+      const TimeIndex firstMeasurement=
+        measurements>0 ? ekf_.getMeasurementTime()-TimeIndex(measurements)+1 : 0;
+      c.write(unsigned(measurements));
+      c.write(firstMeasurement);
+      for (TimeIndex i=firstMeasurement; i<firstMeasurement+TimeIndex(measurements); ++i)
+      {
+        c.write(ekf_.getMeasurement(i));
+      }
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::readCheckpoint_
+                                        (tools::Checkpoint & c, CheckpointData & d) const
+    {
+      c.rewind();
+
+      unsigned tag, version, contactsMaxNumber;
+      c.read(tag);
+      c.read(version);
+      if (tag!=checkpointTag_ || version!=checkpointVersion_)
+      {
+        throw std::runtime_error("ModelBaseEKFFlexEstimatorIMU: the checkpoint has an unknown format");
+      }
+
+      c.read(contactsMaxNumber);
+      if (contactsMaxNumber!=getContactsMaxNumber())
+      {
+        throw std::invalid_argument("ModelBaseEKFFlexEstimatorIMU: the checkpoint does not model the same number of contacts");
+      }
+
+      c.read(d.contactModel);
+      c.read(d.contactsNumber);
+      c.read(d.useFTSensors);
+      c.read(d.withAbsolutePos);
+      c.read(d.withComBias);
+      c.read(d.withUnmodeledForces);
+
+      c.read(d.integrator);
+      c.read(d.integrationSubsampling);
+      c.read(d.adaptiveIntegrationFactor);
+      c.read(d.dt);
+      c.read(d.robotMass);
+      c.read(d.Kfe);
+      c.read(d.Kfv);
+      c.read(d.Kte);
+      c.read(d.Ktv);
+      c.read(d.KfeRopes);
+      c.read(d.KfvRopes);
+      c.read(d.KteRopes);
+      c.read(d.KtvRopes);
+      c.read(d.pe);
+
+      ///the configuration is checked before it sizes anything
+      if ((d.contactModel!=IMUElasticLocalFrameDynamicalSystem::contactModel::none &&
+           d.contactModel!=contactModel::elasticContact &&
+           d.contactModel!=contactModel::pendulum) ||
+          d.contactsNumber>getContactsMaxNumber() ||
+          (d.useFTSensors && d.contactsNumber>forceMeasurementsMax_) ||
+          d.integrator>integrator::adaptive || d.integrationSubsampling==0 ||
+          !(d.adaptiveIntegrationFactor>0) || !(d.dt>0))
+      {
+        throw std::runtime_error("ModelBaseEKFFlexEstimatorIMU: the checkpoint has an invalid configuration");
+      }
+
+      c.read(d.on);
+      c.read(d.limitOn);
+      c.read(d.limitForces);
+      c.read(d.limitTorques);
+      c.read(d.deadline);
+
+      c.read(d.Q);
+      c.read(d.R);
+      c.read(d.forceVariance);
+      c.read(d.absPosVariance);
+      c.read(d.unmodeledForceVariance);
+
+      c.read(d.k);
+      c.read(d.time);
+      c.read(d.x);
+      c.read(d.lastX);
+      c.read(d.xOut);
+      c.read(d.P);
+
+      c.read(d.jacobiansSet);
+      if (d.jacobiansSet)
+      {
+        c.read(d.A);
+        c.read(d.C);
+      }
+
+      const int inputSize=input::sizeBase+12*d.contactsNumber;
+      const int measurementSize=6+(d.useFTSensors ? 6*d.contactsNumber : 0)
+                                 +(d.withAbsolutePos ? 6 : 0);
+
+      unsigned samples;
+      TimeIndex first;
+      Vector v;
+
+      d.u.reset();
+      c.read(samples);
+      c.read(first);
+      for (unsigned i=0; i<samples; ++i)
+      {
+        c.read(v);
+        if (v.size()!=inputSize)
+        {
+          throw std::runtime_error("ModelBaseEKFFlexEstimatorIMU: the checkpoint has inconsistent inputs");
+        }
+        d.u.setValue(v,first+TimeIndex(i));
+      }
+
+      d.y.reset();
+      c.read(samples);
+      c.read(first);
+      for (unsigned i=0; i<samples; ++i)
+      {
+        c.read(v);
+        if (v.size()!=measurementSize)
+        {
+          throw std::runtime_error("ModelBaseEKFFlexEstimatorIMU: the checkpoint has inconsistent measurements");
+        }
+        d.y.setValue(v,first+TimeIndex(i));
+      }
+
+      const int n=int(stateSize_);
+      if (!c.atEnd() || d.x.size()!=n || d.P.rows()!=n || d.P.cols()!=n ||
+          d.Q.rows()!=n || d.Q.cols()!=n || d.R.rows()!=R_.rows() || d.R.cols()!=R_.cols() ||
+          d.forceVariance.rows()!=6 || d.forceVariance.cols()!=6 ||
+          (d.jacobiansSet && (d.A.rows()!=n || d.A.cols()!=n ||
+                              d.C.rows()!=measurementSize || d.C.cols()!=n)))
+      {
+        throw std::runtime_error("ModelBaseEKFFlexEstimatorIMU: the checkpoint is inconsistent");
+      }
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::restoreCheckpoint(tools::Checkpoint & c)
+    {
+      ///all the values are checked before the estimator is modified, so
+      ///that it is left unchanged when the checkpoint is rejected
+      CheckpointData d;
+      readCheckpoint_(c,d);
+
+      functor_.setIntegrator(d.integrator);
+      setSamplingPeriod(d.dt);
+      functor_.setIntegrationSubsampling(d.integrationSubsampling);
+      functor_.setAdaptiveIntegrationFactor(d.adaptiveIntegrationFactor);
+      functor_.setRobotMass(d.robotMass);
+      functor_.setKfe(d.Kfe);
+      functor_.setKfv(d.Kfv);
+      functor_.setKte(d.Kte);
+      functor_.setKtv(d.Ktv);
+      functor_.setKfeRopes(d.KfeRopes);
+      functor_.setKfvRopes(d.KfvRopes);
+      functor_.setKteRopes(d.KteRopes);
+      functor_.setKtvRopes(d.KtvRopes);
+      functor_.setPe(d.pe);
+
+      on_=d.on;
+      limitOn_=d.limitOn;
+      limitForces_=d.limitForces;
+      limitTorques_=d.limitTorques;
+      deadline_=d.deadline;
+
+      R_=d.R;
+      Q_=d.Q;
+      forceVariance_=d.forceVariance;
+      absPosVariance_=d.absPosVariance;
+      unmodeledForceVariance_=d.unmodeledForceVariance;
+
+      setWithForcesMeasurements(d.useFTSensors);
+      setWithAbsolutePos(d.withAbsolutePos);
+      setWithUnmodeledForces(d.withUnmodeledForces);
+      setWithComBias(d.withComBias);
+      setContactModel(d.contactModel);
+      setContactsNumber(d.contactsNumber);
+
+      updateMeasurementCovarianceMatrix_();
+      updateProcessCovarianceMatrix_();
+
+      ekf_.clearMeasurements();
+      ekf_.clearInputs();
+      ekf_.setState(d.x,d.time);
+      ekf_.setStateCovariance(d.P);
+      k_=d.k;
+      lastX_=d.lastX;
+      x_=d.xOut;
+
+      if (d.jacobiansSet)
+      {
+        ekf_.setA(d.A);
+        ekf_.setC(d.C);
+        jacobiansSet_=true;
+      }
+
+      for (TimeIndex i=d.u.getFirstIndex(); i<d.u.getNextIndex(); ++i)
+      {
+        ekf_.setInput(d.u[i],i);
+      }
+
+      for (TimeIndex i=d.y.getFirstIndex(); i<d.y.getNextIndex(); ++i)
+      {
+        ekf_.setMeasurement(d.y[i],i);
+      }
+    }
+
     void ModelBaseEKFFlexEstimatorIMU::setSamplingPeriod(double dt)
     {
       dt_=dt;
@@ -553,7 +1070,6 @@ namespace stateObservation
       {
         useFTSensors_=b;
         functor_.setWithForceMeasurements(b);
-        ekf_.setMeasureSize(functor_.getMeasurementSize());
 
         updateMeasurementCovarianceMatrix_();
       }
@@ -564,7 +1080,6 @@ namespace stateObservation
       if (withAbsolutePos_!= b)
       {
         functor_.setWithAbsolutePosition(b);
-        ekf_.setMeasureSize(functor_.getMeasurementSize());
         withAbsolutePos_=b;
         updateMeasurementCovarianceMatrix_();
       }
@@ -575,8 +1090,6 @@ namespace stateObservation
       if (withUnmodeledForces_!= b)
       {
         functor_.setWithUnmodeledForces(b);
-        ekf_.setMeasureSize(functor_.getMeasurementSize());
-        ekf_.setInputSize(functor_.getInputSize());
         withUnmodeledForces_=b;
         updateMeasurementCovarianceMatrix_();
       }
@@ -612,7 +1125,7 @@ namespace stateObservation
     void ModelBaseEKFFlexEstimatorIMU::setUnmodeledForceProcessVariance(double d)
     {
       Q_.diagonal().segment<6>(state::unmodeledForces).setConstant(d);
-      ekf_.setQ(Q_);
+      updateProcessCovarianceMatrix_();
       if (d>0)
       {
         setWithUnmodeledForces(true);
@@ -622,18 +1135,32 @@ namespace stateObservation
     void ModelBaseEKFFlexEstimatorIMU::setForceVariance(double d)
     {
       forceVariance_ = Matrix::Identity(6,6)*d;
-      updateMeasurementCovarianceMatrix_();
+      updateForceVariance_();
     }
 
     void ModelBaseEKFFlexEstimatorIMU::setForceVariance(const Matrix3 &v)
     {
-      forceVariance_ = v;
+      forceVariance_.setZero();
+      forceVariance_.block<3,3>(0,0) = v;
+      forceVariance_.block<3,3>(3,3) = v;
+      updateForceVariance_();
+    }
+
+    void ModelBaseEKFFlexEstimatorIMU::updateForceVariance_()
+    {
+      for (unsigned i=0; i<forceMeasurementsMax_; ++i)
+      {
+        R_.block<6,6>(6+6*i,6+6*i)=forceVariance_;
+      }
       updateMeasurementCovarianceMatrix_();
     }
 
     void ModelBaseEKFFlexEstimatorIMU::setAbsolutePosVariance(double d)
     {
+      const unsigned absPosIndex=6+6*forceMeasurementsMax_;
+
       absPosVariance_ = d;
+      R_.block<6,6>(absPosIndex,absPosIndex)=Matrix6::Identity()*absPosVariance_;
       updateMeasurementCovarianceMatrix_();
     }
 
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <state-observation/dynamical-system/monte-carlo-simulator.hpp>
+
+namespace stateObservation
+{
+    MonteCarloSimulator::MonteCarloSimulator():
+            seed_(0),
+            nextTrajectory_(0),
+            trajectories_(0),
+            meanNEES_(0),
+            meanNIS_(0)
+    {
+        unsigned cores=boost::thread::hardware_concurrency();
+        threadsNumber_= cores>0 ? cores-1 : 0;
+    }
+
+    MonteCarloSimulator::~MonteCarloSimulator()
+    {
+        deleteWorkers_();
+    }
+
+    void MonteCarloSimulator::setThreadsNumber(unsigned n)
+    {
+        threadsNumber_=n;
+    }
+
+    void MonteCarloSimulator::setSeed(boost::uint64_t seed)
+    {
+        seed_=seed;
+    }
+
+    void MonteCarloSimulator::setInputs(const Matrix & u)
+    {
+        BOOST_ASSERT(u.cols()>0 && "ERROR: There must be at least one input");
+        inputs_=u;
+    }
+
+    void MonteCarloSimulator::getInput_(TimeIndex k, Vector & u) const
+    {
+        u=inputs_.col(std::min(k,TimeIndex(inputs_.cols()-1)));
+    }
+
+    void MonteCarloSimulator::run(const Worker & prototype, unsigned trajectories,
+                                  TimeSize duration)
+    {
+        if (inputs_.cols()==0)
+        {
+            throw std::invalid_argument("MonteCarloSimulator: the inputs are not set");
+        }
+
+        if (trajectories==0 || duration==0)
+        {
+            throw std::invalid_argument
+                ("MonteCarloSimulator: there must be at least one trajectory and one step");
+        }
+
+        ///the calling thread takes the first slot
+        deleteWorkers_();
+        slots_.resize(std::min(threadsNumber_+1,trajectories));
+        for (unsigned i=0; i<slots_.size(); ++i)
+        {
+            slots_[i].worker=prototype.clone();
+        }
+
+        const unsigned errorSize=slots_[0].worker->getErrorSize();
+        squaredErrors_.resize(duration,trajectories);
+        nees_.resize(duration,trajectories);
+        nis_.resize(duration,trajectories);
+        componentsErrors_.resize(errorSize,trajectories);
+
+        nextTrajectory_=0;
+        trajectories_=trajectories;
+        error_.clear();
+
+        std::vector<boost::thread *> threads;
+        for (unsigned i=1; i<slots_.size(); ++i)
+        {
+            threads.push_back(new boost::thread(&MonteCarloSimulator::work_,this,i));
+        }
+
+        work_(0);
+
+        for (unsigned i=0; i<threads.size(); ++i)
+        {
+            threads[i]->join();
+            delete threads[i];
+        }
+        deleteWorkers_();
+
+        if (!error_.empty())
+        {
+            throw std::runtime_error("MonteCarloSimulator: "+error_);
+        }
+
+        aggregate_();
+    }
+
+    void MonteCarloSimulator::work_(unsigned slot)
+    {
+        try
+        {
+            for (;;)
+            {
+                unsigned i;
+                {
+                    boost::unique_lock<boost::mutex> lock(mutex_);
+                    if (nextTrajectory_>=trajectories_ || !error_.empty())
+                    {
+                        return;
+                    }
+                    i=nextTrajectory_++;
+                }
+
+                simulate_(i,slots_[slot]);
+            }
+        }
+        catch (const std::exception & e)
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            error_=e.what();
+        }
+    }
+
+    void MonteCarloSimulator::simulate_(unsigned i, Slot & s)
+    {
+        Worker & worker=*s.worker;
+        DynamicalSystemFunctorBase & f=worker.getFunctor();
+
+        worker.initialize(seed_,i,s.x);
+        componentsErrors_.col(i).setZero();
+
+        for (TimeIndex k=0; k<TimeIndex(squaredErrors_.rows()); ++k)
+        {
+            ///the same steps as DynamicalSystemSimulator
+            getInput_(k,s.u);
+            f.computeStateDynamics(s.x,s.u,k,s.xk1);
+            s.x.swap(s.xk1);
+
+            getInput_(k+1,s.uy);
+            f.computeMeasureDynamics(s.x,s.uy,k+1,s.y);
+
+            double nis;
+            worker.estimate(s.y,s.u,k,s.xHat,s.covariance,nis);
+            worker.stateError(s.xHat,s.x,s.error);
+
+            if (s.error.size()!=componentsErrors_.rows() ||
+                s.covariance.rows()!=s.error.size() || s.covariance.cols()!=s.error.size())
+            {
+                throw std::runtime_error("the error or its covariance has the wrong size");
+            }
+
+            s.llt.compute(s.covariance);
+            if (s.llt.info()!=Eigen::Success)
+            {
+                throw std::runtime_error("the covariance is not positive definite");
+            }
+            s.normalizedError=s.error;
+            s.llt.solveInPlace(s.normalizedError);
+
+            squaredErrors_(k,i)=s.error.squaredNorm();
+            nees_(k,i)=s.error.dot(s.normalizedError);
+            nis_(k,i)=nis;
+            componentsErrors_.col(i)+=s.error.cwiseAbs2();
+        }
+    }
+
+    void MonteCarloSimulator::aggregate_()
+    {
+        const double trajectories=double(squaredErrors_.cols());
+        const double samples=trajectories*double(squaredErrors_.rows());
+
+        rmse_=(squaredErrors_.rowwise().sum()/trajectories).cwiseSqrt();
+        componentsRMSE_=(componentsErrors_.rowwise().sum()/samples).cwiseSqrt();
+        averageNEES_=nees_.rowwise().sum()/trajectories;
+        averageNIS_=nis_.rowwise().sum()/trajectories;
+        meanNEES_=averageNEES_.sum()/double(squaredErrors_.rows());
+        meanNIS_=averageNIS_.sum()/double(squaredErrors_.rows());
+    }
+
+    void MonteCarloSimulator::deleteWorkers_()
+    {
+        for (unsigned i=0; i<slots_.size(); ++i)
+        {
+            delete slots_[i].worker;
+            slots_[i].worker=0x0;
+        }
+    }
+}
@@ -0,0 +1,204 @@
+#include <limits>
+#include <stdexcept>
+
+#include <state-observation/tools/observability-gramian.hpp>
+
+namespace stateObservation
+{
+  namespace tools
+  {
+    ObservabilityGramian::ObservabilityGramian(unsigned stateSize, double windowLength):
+      symmetricSet_(false),
+      updates_(0),
+      factorizationPeriod_(defaultFactorizationPeriod),
+      factorized_(false),
+      singular_(false),
+      factorizationUpdates_(0),
+      maxEigenvalue_(0),
+      minEigenvalue_(0)
+    {
+      setWindowLength(windowLength);
+      setStateSize(stateSize);
+    }
+
+    void ObservabilityGramian::setStateSize(unsigned n)
+    {
+      gramian_.resize(n,n);
+      symmetric_.resize(n,n);
+      ldlt_=Eigen::LDLT<Matrix>(n);
+
+      vMax_=Vector::Ones(n);
+      vMin_=Vector::LinSpaced(n,1,2);
+      w_=Vector::Zero(n);
+
+      if (n>0)
+      {
+        vMax_.normalize();
+        vMin_.normalize();
+      }
+
+      reset();
+    }
+
+    unsigned ObservabilityGramian::getStateSize() const
+    {
+      return unsigned(gramian_.rows());
+    }
+
+    void ObservabilityGramian::setWindowLength(double steps)
+    {
+      BOOST_ASSERT(steps>=1 && "ERROR: The window must be at least one step long");
+      if (steps<1)
+      {
+        throw std::invalid_argument("ObservabilityGramian: the window must be at least one step long");
+      }
+      windowLength_=steps;
+      lambda_=1-1/steps;
+    }
+
+    double ObservabilityGramian::getWindowLength() const
+    {
+      return windowLength_;
+    }
+
+    void ObservabilityGramian::setFactorizationPeriod(TimeSize updates)
+    {
+      BOOST_ASSERT(updates>=1 && "ERROR: The factorization period must be at least one update");
+      if (updates<1)
+      {
+        throw std::invalid_argument("ObservabilityGramian: the factorization period must be at least one update");
+      }
+      factorizationPeriod_=updates;
+    }
+
+    TimeSize ObservabilityGramian::getFactorizationPeriod() const
+    {
+      return factorizationPeriod_;
+    }
+
+    void ObservabilityGramian::reset()
+    {
+      gramian_.setZero();
+      symmetricSet_=false;
+      updates_=0;
+      factorized_=false;
+      singular_=false;
+      factorizationUpdates_=0;
+      maxEigenvalue_=0;
+      minEigenvalue_=0;
+    }
+
+    void ObservabilityGramian::update(const Matrix & A, const Matrix & C)
+    {
+      BOOST_ASSERT(A.rows()==gramian_.rows() && A.cols()==gramian_.rows() &&
+                   C.cols()==gramian_.rows() &&
+                   "ERROR: The Jacobians do not match the state size of the Gramian");
+
+      gramian_.triangularView<Eigen::Lower>()*=lambda_;
+
+      ca_.noalias()=C*A;
+
+      gramian_.selfadjointView<Eigen::Lower>().rankUpdate(C.transpose());
+      gramian_.selfadjointView<Eigen::Lower>().rankUpdate(ca_.transpose());
+
+      symmetricSet_=false;
+      ++updates_;
+    }
+
+    TimeSize ObservabilityGramian::getUpdatesNumber() const
+    {
+      return updates_;
+    }
+
+    const Matrix & ObservabilityGramian::getGramian() const
+    {
+      if (!symmetricSet_)
+      {
+        symmetric_=gramian_.selfadjointView<Eigen::Lower>();
+        symmetricSet_=true;
+      }
+      return symmetric_;
+    }
+
+    bool ObservabilityGramian::factorize_(double threshold)
+    {
+      ldlt_.compute(gramian_);
+      factorized_=true;
+      factorizationUpdates_=updates_;
+
+      ///the pivots of the factorization detect the singular Gramians
+      singular_=(ldlt_.info()!=Eigen::Success || ldlt_.vectorD().minCoeff()<=threshold);
+      return !singular_;
+    }
+
+    double ObservabilityGramian::estimateConditionNumber(unsigned iterations)
+    {
+      maxEigenvalue_=0;
+      minEigenvalue_=0;
+
+      if (gramian_.rows()==0 || updates_==0)
+      {
+        return std::numeric_limits<double>::infinity();
+      }
+
+      ///the products use the full symmetric matrix, which is updated
+      ///once per estimation
+      const Matrix & gramian=getGramian();
+
+      ///power iterations for the largest eigenvalue
+      for (unsigned i=0; i<iterations; ++i)
+      {
+        w_.noalias()=gramian*vMax_;
+        double norm=w_.norm();
+        if (norm==0)
+        {
+          return std::numeric_limits<double>::infinity();
+        }
+        vMax_=w_/norm;
+      }
+      w_.noalias()=gramian*vMax_;
+      maxEigenvalue_=vMax_.dot(w_);
+
+      const double threshold=std::numeric_limits<double>::epsilon()*
+                             double(gramian_.rows())*maxEigenvalue_;
+
+      if (!factorized_ || updates_-factorizationUpdates_>=factorizationPeriod_)
+      {
+        factorize_(threshold);
+      }
+
+      if (singular_)
+      {
+        return std::numeric_limits<double>::infinity();
+      }
+
+      ///inverse iterations for the smallest one, with the last
+      ///factorization. The Rayleigh quotient is computed on the current
+      ///Gramian, it is an upper bound of its smallest eigenvalue
+      for (unsigned i=0; i<iterations; ++i)
+      {
+        w_=ldlt_.solve(vMin_);
+        vMin_=w_/w_.norm();
+      }
+      w_.noalias()=gramian*vMin_;
+      minEigenvalue_=vMin_.dot(w_);
+
+      if (minEigenvalue_<=threshold)
+      {
+        return std::numeric_limits<double>::infinity();
+      }
+
+      return maxEigenvalue_/minEigenvalue_;
+    }
+
+    double ObservabilityGramian::getMaxEigenvalue() const
+    {
+      return maxEigenvalue_;
+    }
+
+    double ObservabilityGramian::getMinEigenvalue() const
+    {
+      return minEigenvalue_;
+    }
+  }
+}
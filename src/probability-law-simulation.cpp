@@ -6,17 +6,27 @@ namespace stateObservation
     namespace tools
     {
 
-        boost::lagged_fibonacci1279 ProbabilityLawSimulation::gen_;
+        ///the last stream of the default seed, apart from the ones given in
+        ///the order of the construction
+        RandomStream ProbabilityLawSimulation::stream_
+            (RandomStream::defaultSeed,~boost::uint64_t(0));
+        boost::mutex ProbabilityLawSimulation::mutex_;
 
         Matrix ProbabilityLawSimulation::getWGNoise(const Matrix& std,
                                           const Matrix& bias,unsigned rows, unsigned cols)
         {
-            boost::normal_distribution<> g(0, 1);
-            Matrix ret= Matrix::Zero(rows,cols);
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            return getWGNoise(std,bias,stream_,rows,cols);
+        }
+
+        Matrix ProbabilityLawSimulation::getWGNoise(const Matrix& std, const Matrix& bias,
+                                          RandomStream & stream, unsigned rows, unsigned cols)
+        {
+            Matrix ret(rows,cols);
             for (unsigned i=0;i<rows;++i)
             {
                 for (unsigned j=0; j<cols; ++j)
-                    ret(i,j)=g(gen_);
+                    ret(i,j)=stream.normal();
             }
             ret=std*ret+bias;
 
@@ -0,0 +1,138 @@
+#include <cmath>
+
+#include <boost/thread/mutex.hpp>
+
+#include <state-observation/tools/random-stream.hpp>
+
+namespace stateObservation
+{
+  namespace tools
+  {
+    namespace
+    {
+      ///ids of the streams built by default, the mutex is built at its
+      ///first use since streams can be static members of other units
+      boost::uint64_t nextStream=0;
+
+      boost::mutex & nextStreamMutex()
+      {
+        static boost::mutex mutex;
+        return mutex;
+      }
+
+      const double twoPi=6.283185307179586;
+
+      inline void multiplyHighLow(boost::uint32_t a, boost::uint32_t b,
+                                  boost::uint32_t & high, boost::uint32_t & low)
+      {
+        boost::uint64_t product=boost::uint64_t(a)*b;
+        high=boost::uint32_t(product>>32);
+        low=boost::uint32_t(product);
+      }
+    }
+
+    const boost::uint64_t RandomStream::defaultSeed;
+
+    RandomStream::RandomStream()
+    {
+      boost::uint64_t stream;
+      {
+        boost::unique_lock<boost::mutex> lock(nextStreamMutex());
+        stream=nextStream++;
+      }
+      setSeed(defaultSeed,stream);
+    }
+
+    RandomStream::RandomStream(boost::uint64_t seed, boost::uint64_t stream)
+    {
+      setSeed(seed,stream);
+    }
+
+    void RandomStream::setSeed(boost::uint64_t seed, boost::uint64_t stream)
+    {
+      seed_=seed;
+      stream_=stream;
+      setCounter(0);
+    }
+
+    void RandomStream::setCounter(boost::uint64_t counter)
+    {
+      counter_=counter;
+      uniformsNumber_=0;
+      withNormal_=false;
+    }
+
+    void RandomStream::philox(const boost::uint32_t counter[4], const boost::uint32_t key[2],
+                              boost::uint32_t result[4])
+    {
+      boost::uint32_t c[4]={counter[0],counter[1],counter[2],counter[3]};
+      boost::uint32_t k[2]={key[0],key[1]};
+
+      for (unsigned i=0; i<10; ++i)
+      {
+        boost::uint32_t high0, low0, high1, low1;
+        multiplyHighLow(0xD2511F53,c[0],high0,low0);
+        multiplyHighLow(0xCD9E8D57,c[2],high1,low1);
+
+        c[0]=high1^c[1]^k[0];
+        c[1]=low1;
+        c[2]=high0^c[3]^k[1];
+        c[3]=low0;
+
+        k[0]+=0x9E3779B9;
+        k[1]+=0xBB67AE85;
+      }
+
+      for (unsigned i=0; i<4; ++i)
+      {
+        result[i]=c[i];
+      }
+    }
+
+    void RandomStream::nextBlock_()
+    {
+      const boost::uint32_t counter[4]={boost::uint32_t(counter_),boost::uint32_t(counter_>>32),
+                                        boost::uint32_t(stream_),boost::uint32_t(stream_>>32)};
+      const boost::uint32_t key[2]={boost::uint32_t(seed_),boost::uint32_t(seed_>>32)};
+      boost::uint32_t r[4];
+      philox(counter,key,r);
+      ++counter_;
+
+      ///the 53 high bits of each pair of words, shifted away from zero
+      for (unsigned i=0; i<2; ++i)
+      {
+        boost::uint64_t bits=(boost::uint64_t(r[2*i])<<32) | r[2*i+1];
+        uniforms_[1-i]=double((bits>>11)+1)*(1.0/9007199254740992.0);
+      }
+      uniformsNumber_=2;
+    }
+
+    double RandomStream::uniform()
+    {
+      if (uniformsNumber_==0)
+      {
+        nextBlock_();
+      }
+      return uniforms_[--uniformsNumber_];
+    }
+
+    double RandomStream::normal()
+    {
+      if (withNormal_)
+      {
+        withNormal_=false;
+        return normal_;
+      }
+
+      ///the two uniform numbers of the same position give two normal ones
+      nextBlock_();
+      uniformsNumber_=0;
+      const double radius=std::sqrt(-2*std::log(uniforms_[1]));
+      const double angle=twoPi*uniforms_[0];
+
+      normal_=radius*std::sin(angle);
+      withNormal_=true;
+      return radius*std::cos(angle);
+    }
+  }
+}
@@ -0,0 +1,64 @@
+#include <state-observation/tools/rotation-cache.hpp>
+
+namespace stateObservation
+{
+  namespace kine
+  {
+    RotationCache::Slot::Slot():
+      vector(Vector3::Zero()),
+      matrix(Matrix3::Identity()),
+      quaternion(Quaternion::Identity()),
+      vectorSet(false),
+      matrixSet(false),
+      quaternionSet(false)
+    {
+    }
+
+    RotationCache::RotationCache(unsigned slotsNumber):
+      hits_(0),
+      misses_(0)
+    {
+      setSlotsNumber(slotsNumber);
+    }
+
+    void RotationCache::setSlotsNumber(unsigned slotsNumber)
+    {
+      slots_.assign(slotsNumber,Slot());
+    }
+
+    unsigned RotationCache::getSlotsNumber() const
+    {
+      return unsigned(slots_.size());
+    }
+
+    unsigned long RotationCache::getHits() const
+    {
+      return hits_;
+    }
+
+    unsigned long RotationCache::getMisses() const
+    {
+      return misses_;
+    }
+
+    double RotationCache::getHitRate() const
+    {
+      if (hits_+misses_>0)
+        return double(hits_)/double(hits_+misses_);
+      else
+        return 0;
+    }
+
+    void RotationCache::resetStatistics()
+    {
+      hits_=0;
+      misses_=0;
+    }
+
+    void RotationCache::clear()
+    {
+      for (unsigned i=0; i<slots_.size(); ++i)
+        slots_[i]=Slot();
+    }
+  }
+}
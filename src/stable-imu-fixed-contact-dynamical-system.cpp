@@ -11,8 +11,7 @@ namespace flexibilityEstimation
 
     StableIMUFixedContactDynamicalSystem::
     	StableIMUFixedContactDynamicalSystem(double dt):
-        processNoise_(0x0), dt_(dt),orientationVector_(Vector3::Zero()),
-        quaternion_(Quaternion::Identity()),
+        processNoise_(0x0), dt_(dt),rotationCache_(2),
         measurementSize_(measurementSizeBase_)
     {
 #ifdef STATEOBSERVATION_VERBOUS_CONSTRUCTORS
@@ -89,15 +88,9 @@ namespace flexibilityEstimation
     }
 
     Quaternion StableIMUFixedContactDynamicalSystem::computeQuaternion_
-                (const Vector3 & x)
+                (const Vector3 & x, unsigned slot)
     {
-        if (orientationVector_!=x)
-        {
-            orientationVector_ = x;
-            quaternion_ = kine::rotationVectorToAngleAxis(x);
-        }
-
-        return quaternion_;
+        return rotationCache_.getQuaternion(x,slot);
     }
 
     Vector StableIMUFixedContactDynamicalSystem::measureDynamics
@@ -126,7 +119,7 @@ namespace flexibilityEstimation
         Vector3 orientationControlV(u.segment(indexes::ori,3));
         Vector3 angularVelocityControl(u.segment(indexes::angVel,3));
 
-        Quaternion qControl(computeQuaternion_(orientationControlV));
+        Quaternion qControl(computeQuaternion_(orientationControlV,1));
 
         Quaternion q = qFlex * qControl;
 
@@ -203,6 +196,11 @@ namespace flexibilityEstimation
         return measurementSize_;
     }
 
+    const kine::RotationCache & StableIMUFixedContactDynamicalSystem::getRotationCache() const
+    {
+        return rotationCache_;
+    }
+
     NoiseBase * StableIMUFixedContactDynamicalSystem::getProcessNoise() const
     {
         return processNoise_;
@@ -0,0 +1,130 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+
+#include <state-observation/tools/stage-timings.hpp>
+
+namespace stateObservation
+{
+  namespace tools
+  {
+    DurationStatistics::DurationStatistics(TimeSize capacity):
+      samples_(capacity),
+      sorted_(capacity)
+    {
+      reset();
+    }
+
+    TimeSize DurationStatistics::getCount() const
+    {
+      return count_;
+    }
+
+    double DurationStatistics::getMin() const
+    {
+      if (count_>0)
+        return min_;
+      else
+        return 0;
+    }
+
+    double DurationStatistics::getMean() const
+    {
+      if (count_>0)
+        return sum_/double(count_);
+      else
+        return 0;
+    }
+
+    double DurationStatistics::getMax() const
+    {
+      return max_;
+    }
+
+    double DurationStatistics::getPercentile(double p) const
+    {
+      TimeSize n=std::min(count_,TimeSize(samples_.size()));
+      if (n==0)
+        return 0;
+
+      ///the buffer is already allocated, no allocation here
+      std::copy(samples_.begin(),samples_.begin()+n,sorted_.begin());
+
+      TimeSize i=TimeSize(p/100.*double(n-1)+0.5);
+      if (i>=n)
+        i=n-1;
+      std::nth_element(sorted_.begin(),sorted_.begin()+i,sorted_.begin()+n);
+      return sorted_[i];
+    }
+
+    void DurationStatistics::reset()
+    {
+      count_=0;
+      sum_=0;
+      min_=std::numeric_limits<double>::max();
+      max_=0;
+      next_=0;
+    }
+
+    StageTimings::StageTimings()
+    {
+    }
+
+    void StageTimings::setStages(const std::vector<std::string> & names, TimeSize capacity)
+    {
+      names_=names;
+      statistics_.assign(names.size(),DurationStatistics(capacity));
+      stopwatches_.assign(names.size(),SimplestStopwatch(CLOCK_MONOTONIC));
+    }
+
+    unsigned StageTimings::getStagesNumber() const
+    {
+      return unsigned(names_.size());
+    }
+
+    const std::string & StageTimings::getStageName(unsigned stage) const
+    {
+      BOOST_ASSERT(stage<names_.size() && "ERROR: The stage index is out of range");
+      return names_[stage];
+    }
+
+    const DurationStatistics & StageTimings::getStatistics(unsigned stage) const
+    {
+      BOOST_ASSERT(stage<statistics_.size() && "ERROR: The stage index is out of range");
+      return statistics_[stage];
+    }
+
+    void StageTimings::reset()
+    {
+      for (unsigned i=0; i<statistics_.size(); ++i)
+      {
+        statistics_[i].reset();
+      }
+    }
+
+    void StageTimings::writeInFile(const std::string & filename) const
+    {
+      std::ofstream f;
+      f.open(filename.c_str());
+
+      if (f.is_open())
+      {
+        for (unsigned i=0; i<statistics_.size(); ++i)
+        {
+          const DurationStatistics & s = statistics_[i];
+          f << names_[i] << " " << s.getCount() << " " << s.getMin() << " "
+            << s.getMean() << " " << s.getPercentile(99) << " " << s.getMax()
+            << std::endl;
+        }
+      }
+      else
+      {
+        std::stringstream ss;
+        ss<< "StageTimings: File " <<filename<<" could not be created/opened.";
+        std::runtime_error e(ss.str().c_str());
+        throw e;
+      }
+    }
+  }
+}
@@ -0,0 +1,178 @@
+#include <cmath>
+
+#include <state-observation/observer/tilt-estimator-batch.hpp>
+
+namespace stateObservation
+{
+
+  TiltEstimatorBatch::TiltEstimatorBatch(unsigned n, double alpha, double beta, double gamma)
+    : n_(n),
+      alpha_(Eigen::ArrayXd::Constant(n, alpha)),
+      beta_(Eigen::ArrayXd::Constant(n, beta)),
+      gamma_(Eigen::ArrayXd::Constant(n, gamma)),
+      dt_(0.005),
+      p_S_C_(n, Vector3::Zero()),
+      R_S_C_(n, Matrix3::Identity()),
+      v_S_C_(n, Vector3::Zero()),
+      w_S_C_(n, Vector3::Zero()),
+      v_C_(Vector3::Zero()),
+      p_(n, 3),
+      v_(n, 3),
+      w_(n, 3),
+      ya_(Array3::Zero(n, 3)),
+      yg_(Array3::Zero(n, 3)),
+      x1_hat_(Array3::Zero(n, 3)),
+      x2_hat_prime_(Array3::Zero(n, 3)),
+      x2_hat_(Array3::Zero(n, 3)),
+      x1_(n, 3),
+      a_(n, 3),
+      b_(n, 3),
+      dx1_hat_(n, 3),
+      dx2_hat_prime_(n, 3),
+      dx2_hat_(n, 3),
+      norm_(n)
+  {
+    x2_hat_.col(2).setOnes();
+
+    for (unsigned i = 0; i < n_; ++i)
+    {
+      updateKinematics_(i);
+    }
+  }
+
+  void TiltEstimatorBatch::setAlpha(unsigned i, double alpha)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    alpha_[i] = alpha;
+  }
+
+  void TiltEstimatorBatch::setBeta(unsigned i, double beta)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    beta_[i] = beta;
+  }
+
+  void TiltEstimatorBatch::setGamma(unsigned i, double gamma)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    gamma_[i] = gamma;
+  }
+
+  void TiltEstimatorBatch::setSensorPositionInC(unsigned i, const Vector3& p)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    p_S_C_[i] = p;
+    updateKinematics_(i);
+  }
+
+  void TiltEstimatorBatch::setSensorOrientationInC(unsigned i, const Matrix3& R)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    R_S_C_[i] = R;
+    updateKinematics_(i);
+  }
+
+  void TiltEstimatorBatch::setSensorLinearVelocityInC(unsigned i, const Vector3& v)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    v_S_C_[i] = v;
+    updateKinematics_(i);
+  }
+
+  void TiltEstimatorBatch::setSensorAngularVelocityInC(unsigned i, const Vector3& w)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    w_S_C_[i] = w;
+    updateKinematics_(i);
+  }
+
+  void TiltEstimatorBatch::setControlOriginVelocityInW(const Vector3& v)
+  {
+    v_C_ = v;
+    for (unsigned i = 0; i < n_; ++i)
+    {
+      updateKinematics_(i);
+    }
+  }
+
+  void TiltEstimatorBatch::setEstimation(unsigned i, const Vector3 & x1_hat,
+                                         const Vector3 & x2_hat_prime, const Vector3 & x2_hat)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    x1_hat_.row(i) = x1_hat.transpose();
+    x2_hat_prime_.row(i) = x2_hat_prime.transpose();
+    x2_hat_.row(i) = x2_hat.transpose();
+  }
+
+  void TiltEstimatorBatch::setMeasurement(unsigned i, const Vector3 & ya, const Vector3 & yg)
+  {
+    BOOST_ASSERT(i < n_ && "ERROR: The IMU index is out of range");
+    ya_.row(i) = ya.transpose();
+    yg_.row(i) = yg.transpose();
+  }
+
+  void TiltEstimatorBatch::updateKinematics_(unsigned i)
+  {
+    ///the same products as TiltEstimator, so that x1 is the same
+    Vector3 p = R_S_C_[i].transpose() * p_S_C_[i];
+    Vector3 v = R_S_C_[i].transpose() * (v_C_ + v_S_C_[i]);
+    Vector3 w = R_S_C_[i].transpose() * w_S_C_[i];
+
+    p_.row(i) = p.transpose();
+    v_.row(i) = v.transpose();
+    w_.row(i) = w.transpose();
+  }
+
+  void TiltEstimatorBatch::cross_(const Array3 & a, const Array3 & b, Array3 & c)
+  {
+    c.col(0) = a.col(1) * b.col(2) - a.col(2) * b.col(1);
+    c.col(1) = a.col(2) * b.col(0) - a.col(0) * b.col(2);
+    c.col(2) = a.col(0) * b.col(1) - a.col(1) * b.col(0);
+  }
+
+  void TiltEstimatorBatch::estimate()
+  {
+    ///x1 = R^T (v_C + v_S) + (yg - R^T w_S) x (R^T p_S)
+    a_ = yg_ - w_;
+    cross_(a_, p_, x1_);
+    x1_ = v_ + x1_;
+
+    ///the operations are in the order of TiltEstimator
+    cross_(x1_hat_, yg_, a_);
+    for (unsigned j = 0; j < 3; ++j)
+    {
+      dx1_hat_.col(j) = a_.col(j) - cst::gravityConstant * x2_hat_prime_.col(j) + ya_.col(j)
+                        + alpha_ * (x1_.col(j) - x1_hat_.col(j));
+    }
+
+    cross_(x2_hat_prime_, yg_, a_);
+    for (unsigned j = 0; j < 3; ++j)
+    {
+      dx2_hat_prime_.col(j) = a_.col(j) - beta_ * (x1_.col(j) - x1_hat_.col(j));
+    }
+
+    cross_(x2_hat_, x2_hat_prime_, a_);
+    for (unsigned j = 0; j < 3; ++j)
+    {
+      b_.col(j) = yg_.col(j) - gamma_ * a_.col(j);
+    }
+    cross_(x2_hat_, b_, dx2_hat_);
+
+    x1_hat_ += dx1_hat_ * dt_;
+    x2_hat_prime_ += dx2_hat_prime_ * dt_;
+    x2_hat_ += dx2_hat_ * dt_;
+
+    ///std::sqrt is correctly rounded as in the norm of TiltEstimator, the
+    ///packet square root of Eigen is not always (AVX512 with fast math)
+    norm_ = x2_hat_.col(0).square() + x2_hat_.col(1).square() + x2_hat_.col(2).square();
+    for (unsigned i = 0; i < n_; ++i)
+    {
+      norm_[i] = std::sqrt(norm_[i]);
+    }
+    for (unsigned j = 0; j < 3; ++j)
+    {
+      x2_hat_.col(j) /= norm_;
+    }
+  }
+
+}
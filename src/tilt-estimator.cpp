@@ -13,16 +13,53 @@ namespace stateObservation
       R_S_C_(Matrix3::Identity()), 
       v_S_C_(Vector3::Zero()), 
       w_S_C_(Vector3::Zero()), 
-      v_C_(Vector3::Zero())
+      v_C_(Vector3::Zero()),
+      x1_hat_(Vector3::Zero()),
+      x2_hat_prime_(Vector3::Zero()),
+      x2_hat_(Vector3::UnitZ()),
+      y_k_(6),
+      x_hat_(9)
   {
+    fs_.x1_hat.setZero();
+    fs_.x2_hat_prime.setZero();
+    fs_.x2_hat = Vector3::UnitZ();
   }
   
   void TiltEstimator::setMeasurement(const Vector3 ya_k, const Vector3 yg_k, TimeIndex k)
   {
-    ObserverBase::MeasureVector y_k(6);
-    y_k << ya_k, yg_k;
+    y_k_ << ya_k, yg_k;
 
-    ZeroDelayObserver::setMeasurement(y_k, k);
+    ZeroDelayObserver::setMeasurement(y_k_, k);
+  }
+
+  void TiltEstimator::setEstimation(const Vector3 & x1_hat, const Vector3 & x2_hat_prime,
+                                    const Vector3 & x2_hat)
+  {
+    fs_.x1_hat = x1_hat;
+    fs_.x2_hat_prime = x2_hat_prime;
+    fs_.x2_hat = x2_hat;
+  }
+
+  const Vector3 & TiltEstimator::estimate(const Vector3 & ya, const Vector3 & yg)
+  {
+    integrate_(fs_.x1_hat, fs_.x2_hat_prime, fs_.x2_hat, ya, yg);
+    return fs_.x2_hat;
+  }
+
+  void TiltEstimator::integrate_(Vector3 & x1_hat, Vector3 & x2_hat_prime, Vector3 & x2_hat,
+                                 const Vector3 & ya, const Vector3 & yg)
+  {
+    x1_ = R_S_C_.transpose() * (v_C_ + v_S_C_) + (yg - R_S_C_.transpose() * w_S_C_).cross(R_S_C_.transpose() * p_S_C_);
+
+    Vector3 dx1 = x1_hat.cross(yg) - cst::gravityConstant * x2_hat_prime + ya + alpha_ * (x1_ - x1_hat);
+    Vector3 dx2_prime = x2_hat_prime.cross(yg) - beta_ * (x1_ - x1_hat);
+    Vector3 dx2 = x2_hat.cross(yg - gamma_ * x2_hat.cross(x2_hat_prime));
+
+    x1_hat += dx1 * dt_;
+    x2_hat_prime += dx2_prime * dt_;
+    x2_hat += dx2 * dt_;
+
+    x2_hat /= x2_hat.norm();
   }
 
   ObserverBase::StateVector TiltEstimator::oneStepEstimation_()
@@ -31,28 +68,20 @@ namespace stateObservation
     
     BOOST_ASSERT(this->y_.size() > 0 && this->y_.checkIndex(k+1) && "ERROR: The measurement vector is not set");
 
-    Vector3 ya = getMeasurement(k+1).head<3>();
-    Vector3 yg = getMeasurement(k+1).tail<3>();
-    
-    x1_ = R_S_C_.transpose() * (v_C_ + v_S_C_) + (yg - R_S_C_.transpose() * w_S_C_).cross(R_S_C_.transpose() * p_S_C_);
+    const Vector & y = getMeasurement(k+1);
 
-    ObserverBase::StateVector x_hat = getEstimatedState(k);
+    const ObserverBase::StateVector & x_hat = getCurrentEstimatedState();
     x1_hat_ = x_hat.segment<3>(0);
     x2_hat_prime_ = x_hat.segment<3>(3);
     x2_hat_ = x_hat.segment<3>(6);
-    
-    Vector dx_hat(9);
-    dx_hat.segment<3>(0) = x1_hat_.cross(yg) - cst::gravityConstant * x2_hat_prime_ + ya + alpha_ * (x1_ - x1_hat_);
-    dx_hat.segment<3>(3) = x2_hat_prime_.cross(yg) - beta_ * (x1_ - x1_hat_);
-    dx_hat.segment<3>(6) = x2_hat_.cross(yg - gamma_ * x2_hat_.cross(x2_hat_prime_));
-    
-    x_hat += dx_hat * dt_;
 
-    x_hat.tail<3>() /= x_hat.tail<3>().norm();
-    
-    setState(x_hat, k+1);
+    integrate_(x1_hat_, x2_hat_prime_, x2_hat_, y.head<3>(), y.tail<3>());
+
+    x_hat_ << x1_hat_, x2_hat_prime_, x2_hat_;
+
+    setState(x_hat_, k+1);
     
-    return x_hat;
+    return x_hat_;
   }
 
   
@@ -1,5 +1,7 @@
 #include <state-observation/observer/zero-delay-observer.hpp>
 
+#include <algorithm>
+
 namespace stateObservation
 {
 
@@ -107,7 +109,12 @@ namespace stateObservation
         return x_.getTime();
     }
 
-    Vector ZeroDelayObserver::getInput(TimeIndex k) const
+    const ObserverBase::StateVector & ZeroDelayObserver::getCurrentEstimatedState() const
+    {
+        return x_();
+    }
+
+    const Vector & ZeroDelayObserver::getInput(TimeIndex k) const
     {
         return u_[k];
     }
@@ -129,7 +136,7 @@ namespace stateObservation
         }
     }
 
-    Vector ZeroDelayObserver::getMeasurement(TimeIndex k) const
+    const Vector & ZeroDelayObserver::getMeasurement(TimeIndex k) const
     {
         return y_[k];
     }
@@ -173,5 +180,53 @@ namespace stateObservation
             clearInputs();
         }
     }
+
+    void ZeroDelayObserver::convertMeasurements(unsigned m, unsigned tail)
+    {
+        if (m!=m_)
+        {
+            convertVectors_(y_,m,tail);
+            ObserverBase::setMeasureSize(m);
+        }
+    }
+
+    void ZeroDelayObserver::convertInputs(unsigned p, unsigned tail)
+    {
+        if (p!=p_)
+        {
+            if (p>0 && p_>0)
+                convertVectors_(u_,p,tail);
+            else
+                u_.reset();
+            ObserverBase::setInputSize(p);
+        }
+    }
+
+    void ZeroDelayObserver::convertVectors_
+                        (IndexedVectorArray & a, unsigned n, unsigned tail)
+    {
+        for (TimeIndex k=a.getFirstIndex(); k<a.getNextIndex(); ++k)
+        {
+            Vector & v=a[k];
+            const unsigned size=unsigned(v.size());
+
+            BOOST_ASSERT(tail<=size && tail<=n && "ERROR: The kept tail is too long");
+
+            std::size_t i=0;
+            while (i<spareVectors_.size() && spareVectors_[i].size()!=int(n))
+                ++i;
+            if (i==spareVectors_.size())
+                spareVectors_.push_back(Vector(n));
+
+            Vector & converted=spareVectors_[i];
+            const unsigned head=std::min(size,n)-tail;
+            converted.head(head)=v.head(head);
+            converted.segment(head,n-head-tail).setZero();
+            converted.tail(tail)=v.tail(tail);
+
+            ///the spare vector keeps the storage of the previous size
+            v.swap(converted);
+        }
+    }
 }
 
@@ -0,0 +1,238 @@
+#include <cstdlib>
+#include <new>
+
+#include "allocation-tracker.hpp"
+
+#ifdef __GLIBC__
+#   include <errno.h>
+#   include <execinfo.h>
+#   include <unistd.h>
+#endif
+
+namespace
+{
+  bool tracking=false;
+  bool backtraces=false;
+
+  ///avoids counting the allocations done by the tracker itself
+  bool inTracker=false;
+
+  std::size_t allocations=0;
+  std::size_t deallocations=0;
+  std::size_t bytes=0;
+
+  void countAllocation(std::size_t size)
+  {
+    if (!tracking || inTracker)
+      return;
+
+    inTracker=true;
+    ++allocations;
+    bytes+=size;
+
+#ifdef __GLIBC__
+    if (backtraces)
+    {
+      void * buffer[32];
+      int n=backtrace(buffer,32);
+      const char header[]="---- allocation\n";
+      if (write(2,header,sizeof(header)-1)<0)
+      {
+        ///nothing to do, the backtrace is a debug output
+      }
+      ///the first frames are the tracker itself
+      backtrace_symbols_fd(buffer+2,n-2,2);
+    }
+#endif
+    inTracker=false;
+  }
+
+  void countDeallocation(void * p)
+  {
+    if (p!=0x0 && tracking && !inTracker)
+      ++deallocations;
+  }
+}
+
+namespace stateObservation
+{
+  namespace unitTesting
+  {
+    void AllocationTracker::start()
+    {
+      backtraces=(std::getenv("STATEOBSERVATION_ALLOCATION_BACKTRACE")!=0x0);
+      tracking=true;
+    }
+
+    void AllocationTracker::stop()
+    {
+      tracking=false;
+    }
+
+    void AllocationTracker::reset()
+    {
+      allocations=0;
+      deallocations=0;
+      bytes=0;
+    }
+
+    std::size_t AllocationTracker::getAllocations()
+    {
+      return allocations;
+    }
+
+    std::size_t AllocationTracker::getDeallocations()
+    {
+      return deallocations;
+    }
+
+    std::size_t AllocationTracker::getBytes()
+    {
+      return bytes;
+    }
+
+    bool AllocationTracker::isMallocTracked()
+    {
+#ifdef __GLIBC__
+      return true;
+#else
+      return false;
+#endif
+    }
+  }
+}
+
+#ifdef __GLIBC__
+
+///The GNU C library allows the executable to replace malloc, the
+///original functions remain available under these names
+extern "C"
+{
+  void * __libc_malloc(size_t);
+  void __libc_free(void *);
+  void * __libc_calloc(size_t, size_t);
+  void * __libc_realloc(void *, size_t);
+  void * __libc_memalign(size_t, size_t);
+
+  void * malloc(size_t size)
+  {
+    countAllocation(size);
+    return __libc_malloc(size);
+  }
+
+  void free(void * p)
+  {
+    countDeallocation(p);
+    __libc_free(p);
+  }
+
+  void * calloc(size_t n, size_t size)
+  {
+    countAllocation(n*size);
+    return __libc_calloc(n,size);
+  }
+
+  void * realloc(void * p, size_t size)
+  {
+    countAllocation(size);
+    return __libc_realloc(p,size);
+  }
+
+  void * memalign(size_t alignment, size_t size)
+  {
+    countAllocation(size);
+    return __libc_memalign(alignment,size);
+  }
+
+  void * aligned_alloc(size_t alignment, size_t size)
+  {
+    countAllocation(size);
+    return __libc_memalign(alignment,size);
+  }
+
+  int posix_memalign(void ** p, size_t alignment, size_t size)
+  {
+    countAllocation(size);
+    *p=__libc_memalign(alignment,size);
+    return (*p==0x0) ? ENOMEM : 0;
+  }
+}
+
+#   define STATEOBSERVATION_RAW_MALLOC __libc_malloc
+#   define STATEOBSERVATION_RAW_FREE __libc_free
+#else
+#   define STATEOBSERVATION_RAW_MALLOC std::malloc
+#   define STATEOBSERVATION_RAW_FREE std::free
+#endif // __GLIBC__
+
+namespace
+{
+  void * trackedNew(std::size_t size)
+  {
+    countAllocation(size);
+    void * p=STATEOBSERVATION_RAW_MALLOC(size==0 ? 1 : size);
+    if (p==0x0)
+      throw std::bad_alloc();
+    return p;
+  }
+
+  void trackedDelete(void * p)
+  {
+    countDeallocation(p);
+    STATEOBSERVATION_RAW_FREE(p);
+  }
+}
+
+#if __cplusplus >= 201103L
+void * operator new(std::size_t size)
+{
+  return trackedNew(size);
+}
+
+void * operator new[](std::size_t size)
+{
+  return trackedNew(size);
+}
+
+void operator delete(void * p) noexcept
+{
+  trackedDelete(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+  trackedDelete(p);
+}
+#else
+void * operator new(std::size_t size) throw(std::bad_alloc)
+{
+  return trackedNew(size);
+}
+
+void * operator new[](std::size_t size) throw(std::bad_alloc)
+{
+  return trackedNew(size);
+}
+
+void operator delete(void * p) throw()
+{
+  trackedDelete(p);
+}
+
+void operator delete[](void * p) throw()
+{
+  trackedDelete(p);
+}
+#endif
+
+#if __cplusplus >= 201402L
+void operator delete(void * p, std::size_t) noexcept
+{
+  trackedDelete(p);
+}
+
+void operator delete[](void * p, std::size_t) noexcept
+{
+  trackedDelete(p);
+}
+#endif
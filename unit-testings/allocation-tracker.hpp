@@ -0,0 +1,79 @@
+/**
+ * \file      allocation-tracker.hpp
+ * \brief     Counts the heap allocations of a test executable.
+ *
+ * \details   allocation-tracker.cpp replaces the global operator new/delete
+ *            and, with the GNU C library, interposes malloc and its family
+ *            which are used by the Eigen aligned allocator. It has to be
+ *            compiled in the test executable, never in the library.
+ *
+ *            When the environment variable
+ *            STATEOBSERVATION_ALLOCATION_BACKTRACE is set, the backtrace of
+ *            every counted allocation is printed on the standard error,
+ *            which gives the call sites allocating in the tracked section.
+ *
+ */
+
+#ifndef STATEOBSERVATIONALLOCATIONTRACKER
+#define STATEOBSERVATIONALLOCATIONTRACKER
+
+#include <cstddef>
+
+namespace stateObservation
+{
+  namespace unitTesting
+  {
+    class AllocationTracker
+    {
+    public:
+      ///starts counting the allocations
+      static void start();
+
+      ///stops counting the allocations
+      static void stop();
+
+      ///sets the counters to zero
+      static void reset();
+
+      ///number of allocations counted
+      static std::size_t getAllocations();
+
+      ///number of deallocations counted
+      static std::size_t getDeallocations();
+
+      ///number of bytes allocated
+      static std::size_t getBytes();
+
+      ///false if the allocations of malloc cannot be tracked on this
+      ///platform (only operator new is tracked then)
+      static bool isMallocTracked();
+    };
+
+    /**
+     * \class  AllocationScope
+     * \brief  Counts the allocations done during its lifetime.
+     *
+     */
+    class AllocationScope
+    {
+    public:
+      AllocationScope()
+      {
+        AllocationTracker::reset();
+        AllocationTracker::start();
+      }
+
+      ~AllocationScope()
+      {
+        AllocationTracker::stop();
+      }
+
+      std::size_t getAllocations() const
+      {
+        return AllocationTracker::getAllocations();
+      }
+    };
+  }
+}
+
+#endif //STATEOBSERVATIONALLOCATIONTRACKER
@@ -0,0 +1,483 @@
+#include <iostream>
+#include <bitset>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/observer/extended-kalman-filter.hpp>
+#include <state-observation/observer/tilt-estimator.hpp>
+#include <state-observation/observer/tilt-estimator-batch.hpp>
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-imu.hpp>
+#include <state-observation/dynamic-estimators/kinetics-observer.hpp>
+
+#include "allocation-tracker.hpp"
+
+using namespace stateObservation;
+using stateObservation::unitTesting::AllocationScope;
+
+///Maximum number of heap allocations per estimation step in steady state.
+///These are the current values of the hot paths, they must only decrease
+///and be set to zero once a path is made allocation-free.
+///Run with STATEOBSERVATION_ALLOCATION_BACKTRACE=1 to get the call sites.
+const std::size_t extendedKalmanFilterBudget=18;
+const std::size_t tiltEstimatorBudget=4;
+const std::size_t tiltEstimatorFixedSizeBudget=0;
+const std::size_t tiltEstimatorBatchBudget=0;
+const std::size_t modelBaseFlexEstimatorBudget=25;
+const std::size_t kineticsObserverBudget=0;
+const std::size_t kineticsObserverSequentialBudget=0;
+
+///Maximum number of heap allocations of a change of the number of contacts
+///with force measurements, the containers of each number are preallocated.
+const std::size_t contactSwitchBudget=0;
+
+///Maximum number of heap allocations of the estimation step which follows a
+///change of the number of contacts, the pending samples are kept by the
+///switch so it is the same as in steady state.
+const std::size_t stepAfterContactSwitchBudget=25;
+
+///number of steps before the steady state
+const unsigned warmupSteps=10;
+
+///number of steps checked in steady state
+const unsigned steadySteps=100;
+
+///gives the maximum number of allocations of one step of the estimator
+template <typename Step>
+std::size_t maxAllocationsPerStep(Step & step)
+{
+  for (unsigned i=0; i<warmupSteps; ++i)
+    step();
+
+  std::size_t maxAllocations=0;
+  for (unsigned i=0; i<steadySteps; ++i)
+  {
+    AllocationScope scope;
+    step();
+    maxAllocations=std::max(maxAllocations,scope.getAllocations());
+  }
+  return maxAllocations;
+}
+
+///gives the maximum number of allocations of a switch of the number of
+///contacts and of the estimation step which follows it, counted separately
+template <typename Step>
+void maxAllocationsPerSwitch(Step & step, std::size_t & switchAllocations,
+                             std::size_t & stepAllocations)
+{
+  for (unsigned i=0; i<warmupSteps; ++i)
+  {
+    step.switchContacts();
+    step();
+  }
+
+  switchAllocations=0;
+  stepAllocations=0;
+  for (unsigned i=0; i<steadySteps; ++i)
+  {
+    {
+      AllocationScope scope;
+      step.switchContacts();
+      switchAllocations=std::max(switchAllocations,scope.getAllocations());
+    }
+    {
+      AllocationScope scope;
+      step();
+      stepAllocations=std::max(stepAllocations,scope.getAllocations());
+    }
+  }
+}
+
+class KalmanFunctor:
+  public DynamicalSystemFunctorBase
+{
+public:
+  KalmanFunctor()
+  {
+    a_=Matrix::Random(4,4)*0.15;
+    c_=Matrix::Random(3,4);
+  }
+
+  virtual Vector stateDynamics(const Vector& x, const Vector& u, TimeIndex k)
+  {
+    Vector xk1;
+    computeStateDynamics(x,u,k,xk1);
+    return xk1;
+  }
+
+  virtual void computeStateDynamics(const Vector& x, const Vector& u, TimeIndex, Vector& xk1)
+  {
+    xk1.noalias()=a_*x;
+    xk1.array()+=cos(x.array());
+    xk1[0]+=u[0];
+  }
+
+  virtual Vector measureDynamics(const Vector& x, const Vector& u, TimeIndex k)
+  {
+    Vector y;
+    computeMeasureDynamics(x,u,k,y);
+    return y;
+  }
+
+  virtual void computeMeasureDynamics(const Vector& x, const Vector& , TimeIndex, Vector& y)
+  {
+    y.noalias()=c_*x;
+  }
+
+  virtual unsigned getStateSize() const
+  {
+    return 4;
+  }
+
+  virtual unsigned getInputSize() const
+  {
+    return 1;
+  }
+
+  virtual unsigned getMeasurementSize() const
+  {
+    return 3;
+  }
+
+private:
+  Matrix a_;
+  Matrix c_;
+};
+
+class ExtendedKalmanFilterStep
+{
+public:
+  ExtendedKalmanFilterStep():
+    f_(4,3,1),
+    k_(0)
+  {
+    f_.setFunctor(&functor_);
+    f_.setQ(Matrix::Identity(4,4)*1e-4);
+    f_.setR(Matrix::Identity(3,3)*1e-2);
+    f_.setState(Vector::Zero(4),k_);
+    f_.setStateCovariance(Matrix::Identity(4,4));
+    dx_=Vector::Constant(4,1e-8);
+    y_=Vector::Random(3);
+    u_=Vector::Random(1);
+    f_.setInput(u_,k_);
+  }
+
+  void operator()()
+  {
+    f_.setMeasurement(y_,k_+1);
+    f_.setInput(u_,k_+1);
+    f_.setA(f_.getAMatrixFD(dx_));
+    f_.setC(f_.getCMatrixFD(dx_));
+    f_.getEstimatedState(++k_);
+  }
+
+private:
+  KalmanFunctor functor_;
+  ExtendedKalmanFilter f_;
+  Vector dx_;
+  Vector y_;
+  Vector u_;
+  TimeIndex k_;
+};
+
+class TiltEstimatorStep
+{
+public:
+  TiltEstimatorStep():
+    f_(5,1,2),
+    k_(0)
+  {
+    Vector x0=Vector::Zero(9);
+    x0[8]=1;
+    f_.setState(x0,k_);
+    ya_ << 0.1, -0.2, 9.8;
+    yg_ << 0.01, 0.02, -0.01;
+  }
+
+  void operator()()
+  {
+    f_.setMeasurement(ya_,yg_,k_+1);
+    f_.getEstimatedState(++k_);
+  }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+  TiltEstimator f_;
+  Vector3 ya_;
+  Vector3 yg_;
+  TimeIndex k_;
+};
+
+class TiltEstimatorFixedSizeStep
+{
+public:
+  TiltEstimatorFixedSizeStep():
+    f_(5,1,2)
+  {
+    f_.setEstimation(Vector3::Zero(),Vector3::Zero(),Vector3::UnitZ());
+    ya_ << 0.1, -0.2, 9.8;
+    yg_ << 0.01, 0.02, -0.01;
+  }
+
+  void operator()()
+  {
+    f_.estimate(ya_,yg_);
+  }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+  TiltEstimator f_;
+  Vector3 ya_;
+  Vector3 yg_;
+};
+
+class TiltEstimatorBatchStep
+{
+public:
+  TiltEstimatorBatchStep():
+    f_(100,5,1,2)
+  {
+    f_.accelerometers().col(2).setConstant(cst::gravityConstant);
+    f_.gyrometers().col(0).setConstant(0.01);
+  }
+
+  void operator()()
+  {
+    f_.estimate();
+  }
+
+private:
+  TiltEstimatorBatch f_;
+};
+
+class ModelBaseFlexEstimatorStep
+{
+public:
+  ModelBaseFlexEstimatorStep():
+    est_(5e-3)
+  {
+    typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+
+    est_.setRobotMass(hrp2::m);
+    est_.setContactModel(flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU::
+                         contactModel::elasticContact);
+    est_.setContactsNumber(2);
+    est_.setObservabilityMonitoring(true);
+
+    u_=Vector::Zero(est_.getInputSize());
+    u_.segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+    u_.segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+    u_.segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+    u_.segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+    u_.segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+
+    y_=Vector::Zero(est_.getMeasurementSize());
+    y_[2]=cst::gravityConstant;
+
+    est_.setInput(u_);
+    est_.setMeasurementInput(u_);
+  }
+
+  void operator()()
+  {
+    est_.setMeasurement(y_);
+    est_.setMeasurementInput(u_);
+    est_.getFlexibilityVector();
+  }
+
+private:
+  flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU est_;
+  Vector u_;
+  Vector y_;
+};
+
+///alternates between one and two contacts with force measurements
+class ContactSwitchStep
+{
+public:
+  ContactSwitchStep():
+    est_(5e-3),
+    contacts_(2)
+  {
+    typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+
+    est_.setRobotMass(hrp2::m);
+    est_.setContactModel(flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU::
+                         contactModel::elasticContact);
+    est_.setWithForcesMeasurements(true);
+
+    for (unsigned i=0; i<2; ++i)
+    {
+      est_.setContactsNumber(i+1);
+
+      u_[i]=Vector::Zero(est_.getInputSize());
+      u_[i].segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+      u_[i].segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+      u_[i].segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+      u_[i].segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+
+      y_[i]=Vector::Zero(est_.getMeasurementSize());
+      y_[i][2]=cst::gravityConstant;
+      y_[i][8]=0.5*hrp2::m*cst::gravityConstant;
+    }
+    u_[1].segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+    y_[1][14]=y_[1][8];
+    y_[0][8]=2*y_[0][8];
+
+    est_.setInput(u_[1]);
+    est_.setMeasurementInput(u_[1]);
+  }
+
+  void switchContacts()
+  {
+    contacts_=3-contacts_;
+    est_.setContactsNumber(contacts_);
+  }
+
+  void operator()()
+  {
+    est_.setInput(u_[contacts_-1]);
+    est_.setMeasurement(y_[contacts_-1]);
+    est_.setMeasurementInput(u_[contacts_-1]);
+    est_.getFlexibilityVector();
+  }
+
+private:
+  flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU est_;
+  unsigned contacts_;
+  Vector u_[2];
+  Vector y_[2];
+};
+
+///two contacts and two IMUs, the wrench sensor of the first contact is
+///measured every other step so that the measurement size changes
+class KineticsObserverStep
+{
+public:
+  explicit KineticsObserverStep(bool sequential=false):
+    obs_(4,2),
+    withSensor_(false)
+  {
+    obs_.setSequentialUpdate(sequential);
+    obs_.setMass(40);
+    obs_.setCenterOfMass(Vector3(0,0,0.05));
+    obs_.setCoMInertiaTensor(Vector3(10,10,2).asDiagonal());
+    obs_.setKinematics(Vector3(0,0,0.8),Matrix3::Identity(),Vector3::Zero(),Vector3::Zero());
+    obs_.addContact(0,Vector3(0,0.1,0),Matrix3::Identity());
+    obs_.addContact(1,Vector3(0,-0.1,0),Matrix3::Identity());
+
+    acc_ << 0, 0, cst::gravityConstant;
+    wrench_ << 0, 0, 20*cst::gravityConstant, 0, 0, 0;
+  }
+
+  void operator()()
+  {
+    withSensor_=!withSensor_;
+
+    obs_.setIMU(acc_,Vector3::Zero(),Vector3::Zero(),Matrix3::Identity(),
+                Vector3::Zero(),Vector3::Zero(),Vector3::Zero(),0);
+    obs_.setIMU(acc_,Vector3::Zero(),Vector3(0,0,0.3),Matrix3::Identity(),
+                Vector3::Zero(),Vector3::Zero(),Vector3::Zero(),1);
+    if (withSensor_)
+      obs_.updateContactWithWrenchSensor(0,wrench_,Vector3(0,0.1,-0.8),Matrix3::Identity());
+    else
+      obs_.updateContactWithNoSensor(0,Vector3(0,0.1,-0.8),Matrix3::Identity());
+    obs_.updateContactWithNoSensor(1,Vector3(0,-0.1,-0.8),Matrix3::Identity());
+    obs_.update();
+  }
+
+private:
+  kineticsObserver::KineticsObserver obs_;
+  Vector3 acc_;
+  Vector6 wrench_;
+  bool withSensor_;
+};
+
+bool check(const std::string & name, std::size_t allocations, std::size_t budget)
+{
+  std::cout << name << ": " << allocations << " allocations per step in steady state (budget "
+            << budget << ")";
+  if (allocations<=budget)
+  {
+    std::cout << " SUCCEEDED" << std::endl;
+    return true;
+  }
+  else
+  {
+    std::cout << " FAILED" << std::endl;
+    return false;
+  }
+}
+
+int main()
+{
+  int exit=0;
+
+  if (!unitTesting::AllocationTracker::isMallocTracked())
+  {
+    std::cout << "Only operator new is tracked on this platform, "
+              << "the Eigen allocations are not counted" << std::endl;
+  }
+
+  {
+    ExtendedKalmanFilterStep step;
+    if (!check("ExtendedKalmanFilter",maxAllocationsPerStep(step),extendedKalmanFilterBudget))
+      exit=exit | BOOST_BINARY( 1 );
+  }
+
+  {
+    TiltEstimatorStep step;
+    if (!check("TiltEstimator",maxAllocationsPerStep(step),tiltEstimatorBudget))
+      exit=exit | BOOST_BINARY( 10 );
+  }
+
+  {
+    TiltEstimatorFixedSizeStep step;
+    if (!check("TiltEstimator fixed-size",maxAllocationsPerStep(step),
+               tiltEstimatorFixedSizeBudget))
+      exit=exit | BOOST_BINARY( 1000000 );
+  }
+
+  {
+    TiltEstimatorBatchStep step;
+    if (!check("TiltEstimatorBatch",maxAllocationsPerStep(step),tiltEstimatorBatchBudget))
+      exit=exit | BOOST_BINARY( 10000000 );
+  }
+
+  {
+    ModelBaseFlexEstimatorStep step;
+    if (!check("ModelBaseEKFFlexEstimatorIMU",maxAllocationsPerStep(step),
+               modelBaseFlexEstimatorBudget))
+      exit=exit | BOOST_BINARY( 100 );
+  }
+
+  {
+    ContactSwitchStep step;
+    std::size_t switchAllocations, stepAllocations;
+    maxAllocationsPerSwitch(step,switchAllocations,stepAllocations);
+    if (!check("ModelBaseEKFFlexEstimatorIMU contact switch",switchAllocations,
+               contactSwitchBudget))
+      exit=exit | BOOST_BINARY( 1000 );
+    if (!check("ModelBaseEKFFlexEstimatorIMU step after a contact switch",stepAllocations,
+               stepAfterContactSwitchBudget))
+      exit=exit | BOOST_BINARY( 1 00000000 );
+  }
+
+  {
+    KineticsObserverStep step;
+    if (!check("KineticsObserver",maxAllocationsPerStep(step),kineticsObserverBudget))
+      exit=exit | BOOST_BINARY( 10000 );
+  }
+
+  {
+    KineticsObserverStep step(true);
+    if (!check("KineticsObserver sequential update",maxAllocationsPerStep(step),
+               kineticsObserverSequentialBudget))
+      exit=exit | BOOST_BINARY( 100000 );
+  }
+
+  std::cout<<"Test exit code "<< std::bitset< 16 >(exit) <<std::endl;
+
+  return exit;
+}
@@ -0,0 +1,164 @@
+#include <iostream>
+#include <bitset>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/dynamical-system/imu-dynamical-system.hpp>
+#include <state-observation/dynamical-system/bidim-elastic-inv-pendulum-dyn-sys.hpp>
+#include <state-observation/flexibility-estimation/imu-elastic-local-frame-dynamical-system.hpp>
+
+using namespace stateObservation;
+
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::contactModel contactModel;
+
+///number of states evaluated in a batch
+const unsigned batchSize=7;
+
+///tolerance between the batch and the one-at-a-time evaluations
+const double tolerance=1e-10;
+
+///gives the largest difference between the batch evaluation and the
+///evaluations of each column, for a shared input and for one input per state
+double batchError(DynamicalSystemFunctorBase & f, const Matrix & x, const Matrix & u,
+                  bool measurements)
+{
+  double error=0;
+
+  Matrix sharedInput(u.col(0));
+  const Matrix * inputs[2]={&sharedInput,&u};
+
+  for (unsigned j=0; j<2; ++j)
+  {
+    const Matrix & uj=*inputs[j];
+    Matrix batch;
+
+    if (measurements)
+      f.measureDynamicsBatch(x,uj,0,batch);
+    else
+      f.stateDynamicsBatch(x,uj,0,batch);
+
+    for (unsigned i=0; i<x.cols(); ++i)
+    {
+      Vector xi=x.col(i);
+      Vector ui=uj.col(uj.cols()==1 ? 0 : i);
+
+      Vector single= measurements ? f.measureDynamics(xi,ui,0) : f.stateDynamics(xi,ui,0);
+
+      if (single.size()!=batch.rows())
+        return 1e10;
+
+      error=std::max(error,(single-batch.col(i)).norm()/(1+single.norm()));
+    }
+  }
+
+  return error;
+}
+
+bool check(const std::string & name, double error)
+{
+  std::cout << name << ": largest error " << error;
+  if (error<tolerance)
+  {
+    std::cout << " SUCCEEDED" << std::endl;
+    return true;
+  }
+  else
+  {
+    std::cout << " FAILED" << std::endl;
+    return false;
+  }
+}
+
+Matrix getElasticInputs(unsigned contacts)
+{
+  Matrix u=Matrix::Zero(input::sizeBase+12*contacts,batchSize);
+
+  for (unsigned i=0; i<batchSize; ++i)
+  {
+    u.col(i).segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+    u.col(i).segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+    u.col(i).segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+    u.col(i).segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+    u.col(i).segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+  }
+
+  ///the inputs differ by their kinematics
+  u.middleRows<3>(input::velCom)+=Matrix::Random(3,batchSize)*0.01;
+  u.middleRows<3>(input::oriIMU)+=Matrix::Random(3,batchSize)*0.01;
+  u.middleRows<3>(input::angVelIMU)+=Matrix::Random(3,batchSize)*0.01;
+
+  return u;
+}
+
+int test()
+{
+  int errorcode=0;
+
+  {
+    IMUDynamicalSystem f;
+    f.setSamplingPeriod(5e-3);
+
+    Matrix x=Matrix::Random(f.getStateSize(),batchSize);
+    Matrix u=Matrix::Random(f.getInputSize(),batchSize);
+
+    if (!check("IMUDynamicalSystem state",batchError(f,x,u,false)))
+      errorcode = errorcode | BOOST_BINARY( 1 );
+
+    if (!check("IMUDynamicalSystem measurements",batchError(f,x,u,true)))
+      errorcode = errorcode | BOOST_BINARY( 10 );
+  }
+
+  {
+    flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem f(5e-3);
+    f.setContactModel(contactModel::elasticContact);
+    f.setContactsNumber(2);
+    f.setWithForceMeasurements(true);
+    f.setWithComBias(true);
+    f.setWithUnmodeledForces(true);
+
+    Matrix x=Matrix::Random(f.getStateSize(),batchSize)*0.01;
+    x.middleRows<1>(flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::state::fc+2).
+      setConstant(280);
+    Matrix u=getElasticInputs(2);
+
+    if (!check("IMUElasticLocalFrameDynamicalSystem state",batchError(f,x,u,false)))
+      errorcode = errorcode | BOOST_BINARY( 100 );
+
+    if (!check("IMUElasticLocalFrameDynamicalSystem measurements",batchError(f,x,u,true)))
+      errorcode = errorcode | BOOST_BINARY( 1000 );
+  }
+
+  {
+    ///default implementation of the base class
+    BidimElasticInvPendulum f;
+    f.setMass(50);
+    f.setHeight(1);
+    f.setElasticity(1000);
+    f.setSamplingPeriod(5e-3);
+
+    Matrix x=Matrix::Random(f.getStateSize(),batchSize)*0.1;
+    Matrix u=Matrix::Random(f.getInputSize(),batchSize);
+
+    if (!check("BidimElasticInvPendulum state",batchError(f,x,u,false)))
+      errorcode = errorcode | BOOST_BINARY( 10000 );
+  }
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
@@ -0,0 +1,191 @@
+#include <iostream>
+#include <bitset>
+#include <algorithm>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/flexibility-estimation/imu-elastic-local-frame-dynamical-system.hpp>
+
+using namespace stateObservation;
+
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::state state;
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::contactModel contactModel;
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::integrator integrator;
+
+const double dt=5e-3;
+
+///number of substeps of the reference integration
+const unsigned referenceSubsampling=200;
+
+Vector getState()
+{
+  Vector x=Vector::Zero(state::size);
+
+  x.segment<3>(state::pos) << 1.2e-3, -0.8e-3, -2.1e-3;
+  x.segment<3>(state::ori) << 1.5e-2, -2.3e-2, 0.7e-2;
+  x.segment<3>(state::linVel) << 0.02, -0.015, 0.01;
+  x.segment<3>(state::angVel) << -0.05, 0.08, 0.03;
+
+  return x;
+}
+
+Vector getInput()
+{
+  Vector u=Vector::Zero(input::sizeBase+24);
+
+  u.segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+  u.segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+  u.segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+  u.segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+  u.segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+
+  return u;
+}
+
+///the contact wrenches of the state are given by the kinematics
+///so that every scheme integrates the same dynamics
+Vector getConsistentState()
+{
+  flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem f(dt);
+  f.setContactModel(contactModel::elasticContact);
+  f.setContactsNumber(2);
+
+  Vector x=getState();
+  x.segment<12>(state::fc)=f.getForcesAndMoments(x,getInput());
+  return x;
+}
+
+///integrates one sampling period and gives the error on the kinematics
+///with respect to the reference
+double integrationError(unsigned integratorType, unsigned subsampling,
+                        const Vector & reference, unsigned & evaluations)
+{
+  flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem f(dt);
+  f.setContactModel(contactModel::elasticContact);
+  f.setContactsNumber(2);
+  f.setIntegrator(integratorType);
+  f.setIntegrationSubsampling(subsampling);
+
+  Vector x=f.stateDynamics(getConsistentState(),getInput(),0);
+  evaluations=f.getIntegrationEvaluationsNumber();
+
+  return (x.head<12>()-reference.head<12>()).norm();
+}
+
+int test()
+{
+  int errorcode=0;
+
+  Vector reference;
+  {
+    flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem f(dt);
+    f.setContactModel(contactModel::elasticContact);
+    f.setContactsNumber(2);
+    f.setIntegrator(integrator::rk4);
+    f.setIntegrationSubsampling(referenceSubsampling);
+    reference=f.stateDynamics(getConsistentState(),getInput(),0);
+  }
+
+  unsigned evaluations;
+
+  ///the contact forces are updated at each substep, so every scheme
+  ///converges to the reference with the number of substeps
+  const unsigned integrators[3]={integrator::euler, integrator::semiImplicitEuler, integrator::rk4};
+  const char * names[3]={"Euler", "Semi-implicit Euler", "RK4"};
+  const unsigned evaluationsPerStep[3]={1,1,4};
+
+  double error1[3];
+  double error8[3];
+
+  for (unsigned i=0; i<3; ++i)
+  {
+    error1[i]=integrationError(integrators[i],1,reference,evaluations);
+    unsigned evaluations1=evaluations;
+    error8[i]=integrationError(integrators[i],8,reference,evaluations);
+
+    std::cout << names[i] << " error " << error1[i] << " (" << evaluations1 << " evaluations) "
+              << error8[i] << " with 8 substeps (" << evaluations << " evaluations)" << std::endl;
+
+    if (evaluations1!=evaluationsPerStep[i] || evaluations!=8*evaluationsPerStep[i])
+      errorcode = errorcode | BOOST_BINARY( 1 );
+
+    if (!(error8[i]<0.25*error1[i]))
+      errorcode = errorcode | BOOST_BINARY( 10 );
+  }
+
+  ///the stages of RK4 recompute the contact wrenches, so it is
+  ///much more accurate than Euler with the same number of substeps
+  if (!(error1[2]<0.01*error1[0]) || !(error8[2]<0.01*error8[0]))
+    errorcode = errorcode | BOOST_BINARY( 100000 );
+
+  ///the adaptive integrator subdivides the period for stiff contacts
+  ///and remains stable where a single step diverges
+  {
+    flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem f(dt);
+    f.setContactModel(contactModel::elasticContact);
+    f.setContactsNumber(2);
+    f.setIntegrator(integrator::adaptive);
+
+    f.stateDynamics(getState(),getInput(),0);
+    unsigned softEvaluations=f.getIntegrationEvaluationsNumber();
+
+    f.setKfe(4e6*Matrix3::Identity());
+    f.setKfv(6e4*Matrix3::Identity());
+    f.setKte(6e4*Matrix3::Identity());
+    f.setKtv(6e3*Matrix3::Identity());
+
+    Vector x=getState();
+    Vector u=getInput();
+    unsigned stiffEvaluations=0;
+    for (unsigned k=0; k<200; ++k)
+    {
+      x=f.stateDynamics(x,u,k);
+      stiffEvaluations=std::max(stiffEvaluations,f.getIntegrationEvaluationsNumber());
+    }
+
+    std::cout << "Adaptive evaluations " << softEvaluations << " (soft contacts) "
+              << stiffEvaluations << " (stiff contacts), final kinematics "
+              << x.head<12>().norm() << std::endl;
+
+    if (softEvaluations!=1 || !(stiffEvaluations>softEvaluations))
+      errorcode = errorcode | BOOST_BINARY( 100 );
+
+    if (!(x.head<12>().norm()<1))
+      errorcode = errorcode | BOOST_BINARY( 1000 );
+  }
+
+  ///the jacobian falls back to finite differences for the other integrators
+  {
+    flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem f(dt);
+    f.setContactModel(contactModel::elasticContact);
+    f.setContactsNumber(2);
+    f.setIntegrator(integrator::rk4);
+    f.setFDstep(Vector::Constant(state::size,1e-6));
+
+    f.stateDynamics(getState(),getInput(),0);
+    Matrix A=f.stateDynamicsJacobian();
+    Matrix Afd=f.stateDynamicsJacobianFD();
+
+    if (!A.isApprox(Afd))
+      errorcode = errorcode | BOOST_BINARY( 10000 );
+  }
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
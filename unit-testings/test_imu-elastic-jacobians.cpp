@@ -0,0 +1,177 @@
+#include <iostream>
+#include <bitset>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/flexibility-estimation/imu-elastic-local-frame-dynamical-system.hpp>
+
+using namespace stateObservation;
+
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::state state;
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::contactModel contactModel;
+
+///finite differences step
+const double dx=1e-6;
+
+///relative tolerance between the closed-form and the finite differences
+///jacobians, on each column
+const double tolerance=1e-4;
+
+///gives the largest relative difference between the columns of two jacobians
+double maxColumnError(const Matrix & J, const Matrix & Jfd, unsigned & column)
+{
+  double maxError=0;
+  for (unsigned i=0; i<J.cols(); ++i)
+  {
+    double error=(J.col(i)-Jfd.col(i)).norm()/(1+Jfd.col(i).norm());
+    if (error>maxError)
+    {
+      maxError=error;
+      column=i;
+    }
+  }
+  return maxError;
+}
+
+Vector getState(unsigned contactsMaxNumber)
+{
+  Vector x=Vector::Zero(state::getSize(contactsMaxNumber));
+
+  x.segment<3>(state::pos) << 1.2e-3, -0.8e-3, -2.1e-3;
+  x.segment<3>(state::ori) << 1.5e-2, -2.3e-2, 0.7e-2;
+  x.segment<3>(state::linVel) << 0.02, -0.015, 0.01;
+  x.segment<3>(state::angVel) << -0.05, 0.08, 0.03;
+
+  x.segment<6>(state::fc) << 2.1, -3.4, 280.5, 1.2, -0.7, 0.3;
+  x.segment<6>(state::fc+6) << -1.7, 2.2, 275.3, -0.9, 1.1, -0.2;
+
+  for (unsigned i=hrp2::contact::nbModeledMax; i<contactsMaxNumber; ++i)
+  {
+    x.segment<6>(state::fcIndex(i)) << 1.1*i, -0.6, 35.2, 0.3, -0.2*i, 0.1;
+  }
+
+  x.segment<6>(state::unmodeledForces) << 3.2, -1.8, 2.5, 0.4, -0.6, 0.2;
+  x.segment<2>(state::comBias) << 0.012, -0.008;
+  x.segment<3>(state::drift) << 0.05, -0.03, 0.2;
+
+  return x;
+}
+
+Vector getInput(unsigned contacts)
+{
+  Vector u=Vector::Zero(input::sizeBase+12*contacts);
+
+  u.segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+  u.segment<3>(input::velCom) << 0.011, -0.023, 0.004;
+  u.segment<3>(input::accCom) << 0.13, 0.05, -0.07;
+  u.segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+  u.segment<3>(input::angMoment) << 0.31, -0.52, 0.12;
+  u.segment<6>(input::dotInertia) << 0.12, -0.31, 0.05, 0.01, -0.02, 0.03;
+  u.segment<3>(input::dotAngMoment) << 0.45, 0.27, -0.11;
+  u.segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+  u.segment<3>(input::oriIMU) << 0.02, -0.01, 0.03;
+  u.segment<3>(input::linVelIMU) << 0.03, 0.01, -0.02;
+  u.segment<3>(input::angVelIMU) << 0.04, -0.03, 0.01;
+  u.segment<3>(input::linAccIMU) << 0.2, -0.1, 0.05;
+  u.segment<6>(input::additionalForces) << 4.5, -2.1, 1.3, 0.6, 0.2, -0.4;
+
+  for (unsigned i=0; i<contacts; ++i)
+  {
+    double side = (i%2==0) ? -1 : 1;
+    if (i<hrp2::contact::nbModeledMax)
+      u.segment<3>(input::contacts+12*i) << 0.00949046, side*0.095, 1.98197e-07;
+    else //hands on a table
+      u.segment<3>(input::contacts+12*i) << 0.35, side*0.3, 0.85;
+    u.segment<3>(input::contacts+12*i+3) << 0.01, side*0.02, 0.005;
+    u.segment<3>(input::contacts+12*i+6) << 0.001, -0.002, 0.0005;
+    u.segment<3>(input::contacts+12*i+9) << 0.003, 0.001, -0.002;
+  }
+
+  return u;
+}
+
+int test()
+{
+  int errorcode=0;
+
+  for (unsigned contactsMaxNumber=hrp2::contact::nbModeledMax;
+       contactsMaxNumber<=hrp2::contact::nbMax; contactsMaxNumber+=2)
+  {
+    for (unsigned contacts=0; contacts<=contactsMaxNumber; ++contacts)
+    {
+      for (unsigned flags=0; flags<16; ++flags)
+      {
+        flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem f(5e-3,contactsMaxNumber);
+        unsigned stateSize=state::getSize(contactsMaxNumber);
+
+        f.setContactModel(contactModel::elasticContact);
+        f.setContactsNumber(contacts);
+        f.setWithForceMeasurements((flags & 1)!=0);
+        f.setWithComBias((flags & 2)!=0);
+        f.setWithUnmodeledForces((flags & 4)!=0);
+        f.setWithAbsolutePosition((flags & 8)!=0);
+        f.setFDstep(Vector::Constant(stateSize,dx));
+
+        Vector x=getState(contactsMaxNumber);
+        Vector u=getInput(contacts);
+
+        f.stateDynamics(x,u,0);
+        f.measureDynamics(x,u,0);
+
+        Matrix A=f.stateDynamicsJacobian();
+        Matrix Afd=f.stateDynamicsJacobianFD();
+
+        Matrix C=f.measureDynamicsJacobian();
+        Matrix Cfd=f.measureDynamicsJacobianFD();
+
+        unsigned columnA=0, columnC=0;
+        double errorA=maxColumnError(A,Afd,columnA);
+        double errorC=maxColumnError(C,Cfd,columnC);
+
+        std::cout << "contacts " << contacts << "/" << contactsMaxNumber << " flags " << std::bitset<4>(flags)
+                  << " state jacobian error " << errorA << " (column " << columnA << ")"
+                  << " measurement jacobian error " << errorC << " (column " << columnC << ")"
+                  << std::endl;
+
+        if (errorA>tolerance)
+          errorcode = errorcode | BOOST_BINARY( 1 );
+
+        if (errorC>tolerance)
+          errorcode = errorcode | BOOST_BINARY( 10 );
+
+        ///the inactive contacts are neither computed nor differentiated
+        for (unsigned i=contacts; i<contactsMaxNumber; ++i)
+        {
+          unsigned index=state::fcIndex(i);
+          if (!A.block(0,index,stateSize,6).isZero() ||
+              !A.block(index,0,6,stateSize).isZero() ||
+              !Afd.block(0,index,stateSize,6).isZero() ||
+              !C.block(0,index,C.rows(),6).isZero())
+          {
+            std::cout << "nonzero jacobian blocks for the inactive contact " << i << std::endl;
+            errorcode = errorcode | BOOST_BINARY( 100 );
+          }
+        }
+      }
+    }
+  }
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
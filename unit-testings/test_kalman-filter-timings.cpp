@@ -0,0 +1,165 @@
+#include <iostream>
+#include <bitset>
+#include <string>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/observer/extended-kalman-filter.hpp>
+
+///this test checks the instrumentation, it is meaningless without it
+#ifndef STATEOBSERVATION_WITH_TIMINGS
+#   error "test_kalman-filter-timings must be compiled with STATEOBSERVATION_WITH_TIMINGS"
+#endif
+
+using namespace stateObservation;
+
+const unsigned kmax=200;
+
+///a damped oscillator measured in position
+class OscillatorFunctor: public DynamicalSystemFunctorBase
+{
+public:
+  OscillatorFunctor()
+  {
+    a_ << 1, 0.01,
+          -0.01, 0.99;
+    c_ << 1, 0;
+  }
+
+  virtual Vector stateDynamics(const Vector& x, const Vector& u, TimeIndex k)
+  {
+    (void)u;//unused
+    (void)k;//unused
+
+    return a_*x;
+  }
+
+  virtual Vector measureDynamics(const Vector& x, const Vector& u, TimeIndex k)
+  {
+    (void)u;//unused
+    (void)k;//unused
+
+    return c_*x;
+  }
+
+  virtual unsigned getStateSize() const
+  {
+    return 2;
+  }
+
+  virtual unsigned getInputSize() const
+  {
+    return 0;
+  }
+
+  virtual unsigned getMeasurementSize() const
+  {
+    return 1;
+  }
+
+private:
+  Eigen::Matrix2d a_;
+  Eigen::Matrix<double,1,2> c_;
+};
+
+int test()
+{
+  int errorcode=0;
+
+  ExtendedKalmanFilter f(2,1,0);
+  OscillatorFunctor func;
+  f.setFunctor(&func);
+
+  Vector x=Eigen::Vector2d(1,0);
+  f.setState(Eigen::Vector2d(0.5,0.1),0);
+  f.setStateCovariance(Eigen::Matrix2d::Identity());
+  f.setQ(Eigen::Matrix2d::Identity()*1e-6);
+  f.setR(Matrix::Identity(1,1)*1e-4);
+
+  Vector dx=Eigen::Vector2d::Constant(1e-8);
+
+  for (unsigned i=1;i<=kmax;++i)
+  {
+    x=func.stateDynamics(x,Vector(),i-1);
+    f.setMeasurement(func.measureDynamics(x,Vector(),i),i);
+
+    f.setA(f.getAMatrixFD(dx));
+    f.setC(f.getCMatrixFD(dx));
+
+    f.getEstimatedState(i);
+  }
+
+  const tools::StageTimings & timings=f.getTimings();
+
+  ///all the stages are named
+  if (timings.getStagesNumber()!=KalmanFilterBase::timingStage::count ||
+      timings.getStageName(KalmanFilterBase::timingStage::prediction)!="prediction" ||
+      timings.getStageName(KalmanFilterBase::timingStage::jacobianA)!="jacobianA" ||
+      timings.getStageName(KalmanFilterBase::timingStage::jacobianC)!="jacobianC" ||
+      timings.getStageName(KalmanFilterBase::timingStage::covariancePropagation)
+                                                            !="covariancePropagation" ||
+      timings.getStageName(KalmanFilterBase::timingStage::gain)!="gain" ||
+      timings.getStageName(KalmanFilterBase::timingStage::update)!="update")
+  {
+    std::cout << "The stages are not named" << std::endl;
+    return BOOST_BINARY( 1 );
+  }
+
+  ///one sample per step and per stage
+  for (unsigned s=0; s<timings.getStagesNumber(); ++s)
+  {
+    if (timings.getStatistics(s).getCount()!=kmax)
+    {
+      std::cout << timings.getStageName(s) << ": " << timings.getStatistics(s).getCount()
+                << " samples instead of " << kmax << std::endl;
+      errorcode = errorcode | BOOST_BINARY( 10 );
+    }
+  }
+
+  ///the statistics are consistent
+  for (unsigned s=0; s<timings.getStagesNumber(); ++s)
+  {
+    const tools::DurationStatistics & d=timings.getStatistics(s);
+    if (d.getMin()<0 || d.getMin()>d.getMean() || d.getMean()>d.getMax() ||
+        d.getPercentile(99)<d.getMin() || d.getPercentile(99)>d.getMax() ||
+        d.getPercentile(50)>d.getPercentile(99))
+    {
+      std::cout << timings.getStageName(s) << ": inconsistent statistics, min " << d.getMin()
+                << " mean " << d.getMean() << " p50 " << d.getPercentile(50)
+                << " p99 " << d.getPercentile(99) << " max " << d.getMax() << std::endl;
+      errorcode = errorcode | BOOST_BINARY( 100 );
+    }
+  }
+
+  ///the whole step takes some time
+  double total=0;
+  for (unsigned s=0; s<timings.getStagesNumber(); ++s)
+  {
+    total+=timings.getStatistics(s).getMax();
+  }
+  if (total<=0)
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  ///the statistics are cleared
+  f.getTimings().reset();
+  if (timings.getStatistics(KalmanFilterBase::timingStage::gain).getCount()!=0)
+    errorcode = errorcode | BOOST_BINARY( 10000 );
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
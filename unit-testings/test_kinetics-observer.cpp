@@ -0,0 +1,223 @@
+#include <iostream>
+#include <bitset>
+#include <stdexcept>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/dynamic-estimators/kinetics-observer.hpp>
+
+using namespace stateObservation;
+
+typedef kineticsObserver::KineticsObserver Observer;
+typedef kineticsObserver::KineticsDynamicalSystem System;
+typedef Observer::state state;
+
+const double dt=1e-3;
+const unsigned steps=2000;
+const double mass=40;
+
+const Vector3 imuPosition0(0,0,0.3);
+const Vector3 imuPosition1(-0.1,0,0);
+
+///the contacts are under the base which is 0.8 m above the ground
+Vector3 contactPosition(unsigned i)
+{
+  return Vector3(0,i==0 ? 0.1 : -0.1,-0.8);
+}
+
+void setInputs(Observer & o)
+{
+  o.setSamplingTime(dt);
+  o.setMass(mass);
+  o.setCenterOfMass(Vector3(0.01,0,0.05));
+  Matrix3 inertia;
+  inertia << 10, 0.1, 0,
+             0.1, 10, 0,
+             0,   0,  2;
+  o.setCoMInertiaTensor(inertia);
+}
+
+///sets the measurements of the sensors from the vector of the dynamical
+///system (the two IMUs then the wrench of the first contact)
+void setMeasurements(Observer & o, const Vector & y)
+{
+  o.setIMU(y.segment<3>(0),y.segment<3>(3),imuPosition0,Matrix3::Identity(),
+           Vector3::Zero(),Vector3::Zero(),Vector3::Zero(),0);
+  o.setIMU(y.segment<3>(6),y.segment<3>(9),imuPosition1,Matrix3::Identity(),
+           Vector3::Zero(),Vector3::Zero(),Vector3::Zero(),1);
+  o.updateContactWithWrenchSensor(0,y.segment<6>(12),contactPosition(0),Matrix3::Identity());
+  o.updateContactWithNoSensor(1,contactPosition(1),Matrix3::Identity());
+}
+
+int test()
+{
+  int errorcode=0;
+
+  Observer observer(3,2);
+  Observer fdObserver(3,2);
+  fdObserver.setFiniteDifferencesJacobians(true);
+  Observer sequentialObserver(3,2);
+  sequentialObserver.setSequentialUpdate(true);
+
+  Observer * observers[3]={&observer,&fdObserver,&sequentialObserver};
+  for (unsigned o=0; o<3; ++o)
+  {
+    setInputs(*observers[o]);
+    for (unsigned i=0; i<2; ++i)
+    {
+      observers[o]->addContact(i,contactPosition(i)+Vector3(0,0,0.8),Matrix3::Identity());
+    }
+    observers[o]->setKinematics(Vector3(0,0,0.8),Matrix3::Identity(),
+                                Vector3::Zero(),Vector3::Zero());
+  }
+
+  ///a contact cannot be set twice
+  try
+  {
+    observer.addContact(0,Vector3::Zero(),Matrix3::Identity());
+    errorcode = errorcode | BOOST_BINARY( 1 );
+  }
+  catch (const std::invalid_argument &)
+  {
+  }
+
+  ///the true system oscillates on the two contacts from an initial tilt
+  System system(dt,3,2);
+  system.setMass(mass);
+  system.setContact(0,true);
+  system.setContact(1,true);
+  system.setIMUSensors(0,true,true);
+  system.setIMUSensors(1,true,true);
+  system.setContactWrenchSensor(0,true);
+
+  Vector x=observer.getState();
+  x.segment<3>(state::ori) << 0.02, -0.03, 0;
+  for (unsigned i=0; i<2; ++i)
+  {
+    x[state::contactIndex(i)+state::contactForce+2]=0.5*mass*cst::gravityConstant;
+  }
+
+  setMeasurements(observer,Vector::Zero(18));
+  const Vector u=observer.getInput();
+
+  observer.setWithAccelerationEstimation();
+  observer.setWithFilteringMeasurements();
+
+  if (observer.getMeasurementSize()!=18 || observer.getContactsNumber()!=2)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  double fdDifference=0;
+  double sequentialDifference=0;
+  Vector y;
+  for (unsigned k=0; k<steps; ++k)
+  {
+    x=system.stateDynamics(x,u,k);
+    y=system.measureDynamics(x,u,k+1);
+
+    for (unsigned o=0; o<3; ++o)
+    {
+      setMeasurements(*observers[o],y);
+      observers[o]->update();
+    }
+
+    Vector difference;
+    System::stateDifference(observer.getState(),fdObserver.getState(),difference);
+    fdDifference=std::max(fdDifference,difference.norm()/observer.getState().norm());
+    System::stateDifference(observer.getState(),sequentialObserver.getState(),difference);
+    sequentialDifference=std::max(sequentialDifference,
+                                  difference.norm()/observer.getState().norm());
+  }
+
+  Vector error;
+  System::stateDifference(observer.getState(),x,error);
+
+  const double oriError=error.segment<3>(state::ori).norm();
+  const double forceError=error.segment<3>(state::contactIndex(1)+state::contactForce).norm();
+
+  std::cout << "orientation error " << oriError << std::endl;
+  std::cout << "force error of the contact without sensor " << forceError << std::endl;
+  std::cout << "relative difference with the finite differences jacobians " << fdDifference << std::endl;
+  std::cout << "relative difference with the sequential update " << sequentialDifference << std::endl;
+
+  ///the tilt and the wrench of the contact without sensor converge
+  if (oriError>1e-3)
+    errorcode = errorcode | BOOST_BINARY( 100 );
+
+  if (forceError>1)
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  ///the closed form jacobians give the same estimation
+  if (fdDifference>1e-3)
+    errorcode = errorcode | BOOST_BINARY( 10000 );
+
+  ///the sensors fused one by one give the same estimation, up to the
+  ///rounding errors of the covariance whose variances span 12 orders of
+  ///magnitude
+  if (sequentialDifference>1e-4 ||
+      (observer.getStateCovariance()-sequentialObserver.getStateCovariance()).norm()>
+      1e-4*observer.getStateCovariance().norm())
+    errorcode = errorcode | BOOST_BINARY( 1 00000000 );
+
+  ///the kinematics of a frame of the base, the external forces and the
+  ///filtered measurements
+  Vector3 linAcc;
+  Vector3 angAcc;
+  observer.estimateAccelerations(linAcc,angAcc);
+  Vector localKinematics(Vector::Zero(18));
+  localKinematics.head<3>()=imuPosition0;
+  const Vector kinematics=observer.getKinematics(localKinematics);
+  const Vector3 leverArm=observer.getOrientation()*imuPosition0;
+  const Vector3 angVel=observer.getAngularVelocity();
+  const Vector filteringError=observer.getFilteredMeasurements()-y;
+  std::cout << "relative error of the filtered measurements "
+            << filteringError.norm()/y.norm() << std::endl;
+  if (observer.getKinematics().size()!=18 ||
+      observer.getKinematics().head<12>()!=observer.getState().head<12>() ||
+      !kinematics.head<3>().isApprox(observer.getPosition()+leverArm) ||
+      !kinematics.segment<3>(6).isApprox(observer.getLinearVelocity()+angVel.cross(leverArm)) ||
+      !kinematics.segment<3>(12).isApprox(linAcc+angAcc.cross(leverArm)+
+                                          angVel.cross(angVel.cross(leverArm))) ||
+      observer.getExternalForces().segment<6>(6)!=observer.getContactWrench(0) ||
+      observer.getFilteredMeasurements().size()!=18 ||
+      filteringError.norm()>1e-2*y.norm() || observer.getTime()!=steps*dt)
+    errorcode = errorcode | BOOST_BINARY( 10 00000000 );
+
+  ///the removed contact does not use its slot any more
+  observer.removeContact(1);
+  if (observer.getContactsNumber()!=1 || observer.getContactWrench(1)!=Vector6::Zero())
+    errorcode = errorcode | BOOST_BINARY( 100000 );
+
+  try
+  {
+    observer.updateContactWithNoSensor(1,contactPosition(1),Matrix3::Identity());
+    errorcode = errorcode | BOOST_BINARY( 1000000 );
+  }
+  catch (const std::invalid_argument &)
+  {
+  }
+
+  ///without sensors the estimation is only a prediction
+  const Matrix3 orientation=observer.getOrientation();
+  observer.update();
+  if (observer.getCurrentTime()!=steps+1 ||
+      !observer.getOrientation().isApprox(orientation,1e-3))
+    errorcode = errorcode | BOOST_BINARY( 10000000 );
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
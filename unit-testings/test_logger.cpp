@@ -0,0 +1,124 @@
+#include <iostream>
+#include <bitset>
+#include <stdexcept>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/tools/logger.hpp>
+
+using namespace stateObservation;
+
+const unsigned samples=10;
+
+int test()
+{
+  int errorcode=0;
+
+  ///the capacity is smaller than the number of samples, the buffers grow
+  tools::Logger logger(4);
+
+  Vector6 v=Vector6::Zero();
+  Matrix m=Matrix::Zero(2,3);
+  Quaternion q(1,0,0,0);
+  double d=0;
+
+  tools::LogChannel<Vector6> * channel=logger.record(v);
+  logger.record(&m);
+  logger.record(q);
+  logger.record(d);
+
+  for (unsigned i=0; i<samples; ++i)
+  {
+    v[i%6]=i;
+    m(1,2)=i;
+    q=Quaternion(Eigen::AngleAxisd(0.1*i,Vector3::UnitZ()));
+    d=0.5*i;
+
+    channel->push();
+    logger.push(m);
+    logger.push(q);
+    logger.push(d);
+  }
+
+  ///the records are the pushed values
+  const IndexedMatrixArray & vRecord=logger.getRecord(&v);
+  const IndexedMatrixArray & mRecord=logger.getRecord(&m);
+  const IndexedMatrixArray & qRecord=logger.getRecord(&q);
+  const IndexedMatrixArray & dRecord=logger.getRecord(&d);
+
+  if (channel->size()!=samples || vRecord.size()!=samples || mRecord.size()!=samples ||
+      qRecord.size()!=samples || dRecord.size()!=samples)
+    errorcode = errorcode | BOOST_BINARY( 1 );
+
+  const TimeIndex last=vRecord.getLastIndex();
+  if (vRecord[last]!=Matrix(v) || mRecord[last]!=m ||
+      qRecord[last]!=Matrix(q.coeffs()) || dRecord[last](0,0)!=d ||
+      mRecord[mRecord.getFirstIndex()](1,2)!=0)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  ///a value of another size is rejected and not recorded
+  tools::LogChannel<Matrix> * mChannel=
+                static_cast<tools::LogChannel<Matrix> *>(logger.getChannel(&m));
+  try
+  {
+    mChannel->push(Matrix::Zero(3,2));
+    errorcode = errorcode | BOOST_BINARY( 100 );
+  }
+  catch (const std::invalid_argument &)
+  {
+  }
+
+  mChannel->push(Matrix::Ones(2,3));
+  if (mChannel->size()!=samples+1 ||
+      logger.getRecord(&m)[logger.getRecord(&m).getLastIndex()]!=Matrix::Ones(2,3))
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  ///the recording continues on the new address
+  Vector6 w=Vector6::Ones();
+  logger.updateAddress(&v,&w);
+  logger.push(w);
+  if (logger.getRecord(&w).size()!=samples+1 ||
+      logger.getRecord(&w)[logger.getRecord(&w).getLastIndex()]!=Matrix(w))
+    errorcode = errorcode | BOOST_BINARY( 10000 );
+
+  ///an address cannot be recorded twice, the channels are unchanged
+  try
+  {
+    logger.record(d);
+    errorcode = errorcode | BOOST_BINARY( 1000000 );
+  }
+  catch (const std::invalid_argument &)
+  {
+  }
+
+  ///the non-const record is a copy of the log
+  IndexedMatrixArray & dRecordCopy=logger.getRecord(&d);
+  dRecordCopy.reset();
+  if (logger.getRecord(&d).size()!=samples)
+    errorcode = errorcode | BOOST_BINARY( 10000000 );
+
+  ///the logs are cleared, the time indexation is kept
+  logger.clearLogs();
+  logger.push(d);
+  if (logger.getChannel(&d)->size()!=1 || logger.getChannel(&w)->size()!=0 ||
+      logger.getChannel(&d)->getFirstIndex()!=TimeIndex(samples))
+    errorcode = errorcode | BOOST_BINARY( 100000 );
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <bitset>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-bank.hpp>
+
+using namespace stateObservation;
+
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem System;
+typedef System::input input;
+typedef System::state state;
+typedef flexibilityEstimation::ModelBaseEKFFlexEstimatorBank Bank;
+
+const double dt=5e-3;
+const unsigned steps=200;
+
+///the hypotheses are one and two contacts
+void addHypotheses(Bank & bank)
+{
+  for (unsigned contacts=1; contacts<=2; ++contacts)
+  {
+    unsigned i=bank.addHypothesis(contacts);
+    bank.getEstimator(i).setRobotMass(hrp2::m);
+    bank.getEstimator(i).setContactModel(flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU::
+                                         contactModel::elasticContact);
+  }
+}
+
+int test()
+{
+  int errorcode=0;
+
+  Vector u=Vector::Zero(input::sizeBase+24);
+  u.segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+  u.segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+  u.segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+  u.segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+  u.segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+  const Vector u1=u.head(input::sizeBase+12);
+
+  ///the robot is actually on two contacts and oscillates from an initial
+  ///flexibility
+  System system(dt);
+  system.setRobotMass(hrp2::m);
+  system.setContactModel(System::contactModel::elasticContact);
+  system.setContactsNumber(2);
+
+  Vector x=Vector::Zero(system.getStateSize());
+  x.segment<3>(state::ori) << 0.01, -0.02, 0;
+
+  Bank bank(dt);
+  addHypotheses(bank);
+
+  Bank sequential(dt);
+  addHypotheses(sequential);
+  sequential.setThreadsNumber(0);
+
+  ///a worker thread runs the second hypothesis, even on a single core
+  bank.setThreadsNumber(1);
+  if (bank.getThreadsNumber()!=1 || bank.getHypothesesNumber()!=2)
+    errorcode = errorcode | BOOST_BINARY( 1 );
+
+  Bank * banks[2]={&bank,&sequential};
+  for (unsigned b=0; b<2; ++b)
+  {
+    banks[b]->setInput(0,u1);
+    banks[b]->setMeasurementInput(0,u1);
+    banks[b]->setInput(1,u);
+    banks[b]->setMeasurementInput(1,u);
+  }
+
+  double difference=0;
+  for (unsigned k=0; k<steps; ++k)
+  {
+    x=system.stateDynamics(x,u,k);
+    Vector y=system.measureDynamics(x,u,k+1);
+
+    for (unsigned b=0; b<2; ++b)
+    {
+      banks[b]->setMeasurement(y);
+      banks[b]->setMeasurementInput(0,u1);
+      banks[b]->setMeasurementInput(1,u);
+    }
+
+    const Vector & xb=bank.getFlexibilityVector();
+    const Vector & xs=sequential.getFlexibilityVector();
+    difference=std::max(difference,(xb-xs).norm());
+    difference=std::max(difference,(bank.getProbabilities()-sequential.getProbabilities()).norm());
+  }
+
+  std::cout << "probabilities " << bank.getProbabilities().transpose() << std::endl;
+  std::cout << "difference between the threads and the sequential run " << difference << std::endl;
+
+  ///the threads do not change the estimation
+  if (difference>0)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  ///the hypothesis of two contacts is the most likely
+  if (bank.getMostLikelyHypothesis()!=1 || bank.getProbabilities()[1]<0.9)
+    errorcode = errorcode | BOOST_BINARY( 100 );
+
+  if (bank.getFlexibilityVector()!=bank.getEstimator(1).getFlexibilityVector())
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  ///the mixture is weighted by the probabilities
+  bank.setSelection(Bank::selection::mixture);
+  const Vector & mixture=bank.getFlexibilityVector();
+  Vector expected=bank.getProbabilities()[0]*bank.getEstimator(0).getFlexibilityVector()+
+                  bank.getProbabilities()[1]*bank.getEstimator(1).getFlexibilityVector();
+  if (!mixture.isApprox(expected))
+    errorcode = errorcode | BOOST_BINARY( 10000 );
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
@@ -0,0 +1,218 @@
+#include <iostream>
+#include <sstream>
+#include <bitset>
+#include <cstring>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-imu.hpp>
+
+using namespace stateObservation;
+
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+typedef flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU Estimator;
+
+///number of samples which are pending when the checkpoint is saved
+const unsigned pendingSamples=3;
+
+Vector getInput(unsigned contacts)
+{
+  Vector u=Vector::Zero(input::sizeBase+12*contacts);
+  u.segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+  u.segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+  u.segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+  u.segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+  u.segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+  return u;
+}
+
+Vector getMeasurement(const Estimator & est, unsigned k)
+{
+  Vector y=Vector::Zero(est.getMeasurementSize());
+  y[0]=0.01*sin(0.1*k);
+  y[2]=cst::gravityConstant;
+  y[3]=0.01*cos(0.1*k);
+  if (y.size()>6)
+  {
+    y[8]=0.5*hrp2::m*cst::gravityConstant;
+    y[14]=0.5*hrp2::m*cst::gravityConstant;
+  }
+  return y;
+}
+
+///gives the pending samples to the estimator, starting at the sample k
+void setPendingSamples(Estimator & est, const Vector & u, unsigned k)
+{
+  ExtendedKalmanFilter & ekf=est.getEKF();
+  TimeIndex k0=ekf.getCurrentTime();
+
+  for (unsigned j=1; j<=pendingSamples; ++j)
+  {
+    ekf.setMeasurement(getMeasurement(est,k+j),k0+j);
+    ekf.setInput(u,k0+j);
+  }
+}
+
+int test()
+{
+  int errorcode=0;
+
+  Estimator est(5e-3);
+  est.setRobotMass(hrp2::m);
+  est.setContactModel(Estimator::contactModel::elasticContact);
+  est.setContactsNumber(2);
+  est.setWithForcesMeasurements(true);
+  est.setForceVariance(1e-3);
+  est.setKfe(Matrix3::Identity()*30000);
+  est.setKte(Matrix3::Identity()*400);
+
+  Vector u=getInput(2);
+
+  est.setInput(u);
+  est.setMeasurementInput(u);
+
+  for (unsigned k=0; k<20; ++k)
+  {
+    est.setMeasurement(getMeasurement(est,k));
+    est.setMeasurementInput(u);
+    est.getFlexibilityVector();
+  }
+
+  setPendingSamples(est,u,20);
+
+  tools::Checkpoint checkpoint;
+  est.saveCheckpoint(checkpoint);
+
+  ///binary serialization round trip
+  std::stringstream stream;
+  checkpoint.save(stream);
+
+  tools::Checkpoint loaded;
+  loaded.load(stream);
+  if (loaded.getData()!=checkpoint.getData())
+    errorcode = errorcode | BOOST_BINARY( 1 );
+
+  std::cout << "checkpoint of " << checkpoint.size() << " bytes" << std::endl;
+
+  ///a fresh estimator with another configuration gives the same estimations
+  ///after the restoration
+  Estimator restored(1e-2);
+  restored.setContactsNumber(1);
+
+  tools::SimplestStopwatch stopwatch;
+  stopwatch.start();
+  restored.restoreCheckpoint(loaded);
+  std::cout << "restoration duration " << 1e-3*stopwatch.stop() << " us" << std::endl;
+
+  if (restored.getContactsNumber()!=2 || !restored.getWithForcesMeasurements() ||
+      restored.getKfe()!=est.getKfe() || restored.getKte()!=est.getKte() ||
+      restored.getMeasurementSize()!=est.getMeasurementSize() ||
+      restored.getProcessNoiseCovariance()!=est.getProcessNoiseCovariance() ||
+      restored.getMeasurementNoiseCovariance()!=est.getMeasurementNoiseCovariance() ||
+      restored.getEKF().getStateCovariance()!=est.getEKF().getStateCovariance())
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  double error=0;
+  for (unsigned k=20+pendingSamples; k<40; ++k)
+  {
+    error=std::max(error,(est.getFlexibilityVector()-restored.getFlexibilityVector()).norm());
+
+    est.setMeasurement(getMeasurement(est,k));
+    est.setMeasurementInput(u);
+    restored.setMeasurement(getMeasurement(restored,k));
+    restored.setMeasurementInput(u);
+  }
+
+  std::cout << "state difference after restoration " << error << std::endl;
+  if (error>0 || restored.getEKF().getCurrentTime()!=est.getEKF().getCurrentTime())
+    errorcode = errorcode | BOOST_BINARY( 100 );
+
+  ///a truncated checkpoint is rejected and the estimator is not modified
+  std::vector<char> data=checkpoint.getData();
+  data.resize(data.size()/2);
+  tools::Checkpoint truncated;
+  truncated.setData(data);
+
+  const Vector x=restored.getFlexibilityVector();
+  const TimeIndex time=restored.getEKF().getCurrentTime();
+  try
+  {
+    restored.restoreCheckpoint(truncated);
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+  }
+  catch (const std::runtime_error &)
+  {
+  }
+  if (restored.getFlexibilityVector()!=x || restored.getContactsNumber()!=2)
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  ///a checkpoint with an invalid configuration is rejected and the
+  ///estimator is not modified: too many contacts, then an unknown integrator
+  const std::size_t contactsNumberOffset=4*sizeof(unsigned);
+  const std::size_t integratorOffset=5*sizeof(unsigned)+4;
+  const unsigned invalid=100;
+  for (unsigned i=0; i<2; ++i)
+  {
+    data=checkpoint.getData();
+    std::memcpy(&data[i==0 ? contactsNumberOffset : integratorOffset],&invalid,sizeof(invalid));
+    tools::Checkpoint corrupted;
+    corrupted.setData(data);
+
+    try
+    {
+      restored.restoreCheckpoint(corrupted);
+      errorcode = errorcode | BOOST_BINARY( 100000 );
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+    if (restored.getFlexibilityVector()!=x || restored.getContactsNumber()!=2 ||
+        restored.getEKF().getCurrentTime()!=time)
+      errorcode = errorcode | BOOST_BINARY( 100000 );
+  }
+
+  ///a stream announcing a huge checkpoint is rejected before any allocation
+  std::stringstream large;
+  checkpoint.save(large);
+  std::string header=large.str().substr(0,sizeof(unsigned));
+  const TimeSize bytes=tools::Checkpoint::defaultMaxBytes+1;
+  header.append(reinterpret_cast<const char *>(&bytes),sizeof(bytes));
+  std::stringstream tooLarge(header);
+  try
+  {
+    loaded.load(tooLarge);
+    errorcode = errorcode | BOOST_BINARY( 1000000 );
+  }
+  catch (const std::runtime_error &)
+  {
+  }
+
+  ///the estimators must model the same number of contacts
+  Estimator other(5e-3,hrp2::contact::nbModeledMax+1);
+  try
+  {
+    other.restoreCheckpoint(checkpoint);
+    errorcode = errorcode | BOOST_BINARY( 10000 );
+  }
+  catch (const std::invalid_argument &)
+  {
+  }
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
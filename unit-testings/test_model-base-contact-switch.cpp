@@ -0,0 +1,185 @@
+#include <iostream>
+#include <bitset>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-imu.hpp>
+
+using namespace stateObservation;
+
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+typedef flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU Estimator;
+
+///number of samples which are pending when the contacts change
+const unsigned pendingSamples=3;
+
+Vector getInput(unsigned contacts)
+{
+  Vector u=Vector::Zero(input::sizeBase+12*contacts);
+  u.segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+  u.segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+  u.segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+  u.segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+  if (contacts>1)
+    u.segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+  return u;
+}
+
+///the IMU, the wrenches of the contacts and the absolute position
+Vector getMeasurement(unsigned contacts, unsigned k)
+{
+  Vector y=Vector::Zero(6+6*contacts+6);
+  y[0]=0.01*sin(0.1*k);
+  y[2]=cst::gravityConstant;
+  for (unsigned i=0; i<contacts; ++i)
+    y[6*i+8]=hrp2::m*cst::gravityConstant/contacts;
+  y.tail<6>().setConstant(0.001*k);
+  return y;
+}
+
+void configure(Estimator & est, unsigned contacts)
+{
+  est.setRobotMass(hrp2::m);
+  est.setContactModel(Estimator::contactModel::elasticContact);
+  est.setWithForcesMeasurements(true);
+  est.setWithAbsolutePos(true);
+  est.setContactsNumber(contacts);
+}
+
+///the filter only estimates the slots of the active contacts
+int testActiveContacts()
+{
+  int errorcode=0;
+
+  {
+    Estimator est(5e-3,hrp2::contact::nbMax);
+    configure(est,1);
+    const unsigned n=est.getStateSize();
+    for (unsigned i=1; i<=hrp2::contact::nbMax; ++i)
+    {
+      est.setContactsNumber(i);
+      unsigned active=est.getEKF().getActiveTangentSize();
+      std::cout << i << " contacts: " << active << " estimated components out of " << n << std::endl;
+      if (active!=n-6*(hrp2::contact::nbMax-i))
+        errorcode = errorcode | BOOST_BINARY( 10000 );
+    }
+  }
+
+  ///and gives the same estimation as the filter of the whole state
+  Estimator reduced(5e-3);
+  Estimator full(5e-3);
+  configure(reduced,1);
+  configure(full,1);
+  full.getEKF().setActiveTangentRanges(KalmanFilterBase::IndexRanges());
+
+  const Vector u=getInput(1);
+  for (unsigned k=0; k<20; ++k)
+  {
+    reduced.setInput(u);
+    full.setInput(u);
+    reduced.setMeasurement(getMeasurement(1,k));
+    full.setMeasurement(getMeasurement(1,k));
+    reduced.setMeasurementInput(u);
+    full.setMeasurementInput(u);
+    reduced.getFlexibilityVector();
+    full.getFlexibilityVector();
+  }
+
+  if (!reduced.getFlexibilityVector().isApprox(full.getFlexibilityVector(),1e-9) ||
+      !reduced.getEKF().getStateCovariance().isApprox(full.getEKF().getStateCovariance(),1e-9))
+  {
+    std::cout << "The estimation of the active contacts differs from the whole state" << std::endl;
+    errorcode = errorcode | BOOST_BINARY( 100000 );
+  }
+
+  return errorcode;
+}
+
+int test()
+{
+  int errorcode=0;
+
+  Estimator est(5e-3);
+  est.setRobotMass(hrp2::m);
+  est.setContactModel(Estimator::contactModel::elasticContact);
+  est.setWithForcesMeasurements(true);
+  est.setWithAbsolutePos(true);
+  est.setContactsNumber(2);
+
+  Vector u=getInput(2);
+  est.setInput(u);
+  est.setMeasurementInput(u);
+
+  for (unsigned k=0; k<10; ++k)
+  {
+    est.setMeasurement(getMeasurement(2,k));
+    est.setMeasurementInput(u);
+    est.getFlexibilityVector();
+  }
+
+  ///samples which are given but not estimated yet
+  ExtendedKalmanFilter & ekf=est.getEKF();
+  const TimeIndex k0=ekf.getCurrentTime();
+  for (unsigned j=1; j<=pendingSamples; ++j)
+  {
+    ekf.setMeasurement(getMeasurement(2,10+j),k0+j);
+    ekf.setInput(u,k0+j);
+  }
+  const TimeSize inputs=ekf.getInputsNumber();
+
+  ///the pending samples are converted by the switch to one contact
+  est.setContactsNumber(1);
+
+  if (ekf.getMeasurementsNumber()!=pendingSamples || ekf.getInputsNumber()!=inputs)
+  {
+    std::cout << "The pending samples are lost" << std::endl;
+    errorcode = errorcode | BOOST_BINARY( 1 );
+  }
+
+  const Vector u1=getInput(1);
+  for (unsigned j=1; j<=pendingSamples; ++j)
+  {
+    const Vector y=getMeasurement(2,10+j);
+    const Vector & y1=ekf.getMeasurement(k0+j);
+
+    ///the IMU, the first wrench and the absolute position are kept
+    if (y1.size()!=6+6+6 || y1.head<12>()!=y.head<12>() || y1.tail<6>()!=y.tail<6>() ||
+        ekf.getInput(k0+j)!=u1)
+      errorcode = errorcode | BOOST_BINARY( 10 );
+  }
+
+  ///and back to two contacts, the wrench of the second contact is zero
+  est.setContactsNumber(2);
+  for (unsigned j=1; j<=pendingSamples; ++j)
+  {
+    Vector y=getMeasurement(2,10+j);
+    y.segment<6>(12).setZero();
+
+    if (ekf.getMeasurement(k0+j)!=y || ekf.getInput(k0+j).size()!=u.size() ||
+        ekf.getInput(k0+j).segment<12>(input::contacts+12)!=Vector::Zero(12))
+      errorcode = errorcode | BOOST_BINARY( 100 );
+  }
+
+  ///the pending samples are estimated
+  const Vector & x=est.getFlexibilityVector();
+  if (ekf.getCurrentTime()!=k0+TimeIndex(pendingSamples) || x.hasNaN())
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test() | testActiveContacts();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <bitset>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-imu.hpp>
+
+using namespace stateObservation;
+
+typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+typedef flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU::degradation degradation;
+
+///number of samples which are pending when the flexibility is asked
+const unsigned pendingSamples=10;
+
+///gives the samples to the filter without estimating them and gets the
+///flexibility, returns the degradations
+unsigned estimatePendingSamples(flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU & est,
+                                const Vector & u, const Vector & y, int & errorcode)
+{
+  ExtendedKalmanFilter & ekf=est.getEKF();
+  TimeIndex k0=ekf.getCurrentTime();
+
+  for (unsigned j=1; j<=pendingSamples; ++j)
+  {
+    ekf.setMeasurement(y,k0+j);
+    ekf.setInput(u,k0+j);
+  }
+
+  const Vector & x=est.getFlexibilityVector();
+
+  ///all the samples are consumed
+  if (ekf.getCurrentTime()!=k0+TimeIndex(pendingSamples) || x.hasNaN())
+    errorcode = errorcode | BOOST_BINARY( 1 );
+
+  std::cout << "degradations " << std::bitset<3>(est.getDegradations()) << std::endl;
+
+  return est.getDegradations();
+}
+
+int test()
+{
+  int errorcode=0;
+
+  flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU est(5e-3);
+  est.setRobotMass(hrp2::m);
+  est.setContactModel(flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU::
+                      contactModel::elasticContact);
+  est.setContactsNumber(2);
+
+  Vector u=Vector::Zero(est.getInputSize());
+  u.segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+  u.segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+  u.segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+  u.segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+  u.segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+
+  Vector y=Vector::Zero(est.getMeasurementSize());
+  y[2]=cst::gravityConstant;
+
+  est.setInput(u);
+  est.setMeasurementInput(u);
+
+  for (unsigned k=0; k<5; ++k)
+  {
+    est.setMeasurement(y);
+    est.setMeasurementInput(u);
+    est.getFlexibilityVector();
+  }
+
+  ///without deadline all the samples are fully estimated
+  if (estimatePendingSamples(est,u,y,errorcode)!=degradation::none)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  ///a large deadline is not reached
+  est.setDeadline(10);
+  if (estimatePendingSamples(est,u,y,errorcode)!=degradation::none)
+    errorcode = errorcode | BOOST_BINARY( 100 );
+
+  ///with a deadline which cannot be met, the intermediate samples only
+  ///predict the mean and the last one reuses the Jacobians
+  est.setDeadline(1e-9);
+  unsigned degradations=estimatePendingSamples(est,u,y,errorcode);
+  if (degradations!=(degradation::meanOnly | degradation::reusedJacobians |
+                     degradation::deadlineExceeded))
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  ///the Jacobians are recomputed after a contact change
+  est.setContactsNumber(1);
+  est.setContactsNumber(2);
+  est.setInput(u);
+  degradations=estimatePendingSamples(est,u,y,errorcode);
+  if (degradations & degradation::reusedJacobians)
+    errorcode = errorcode | BOOST_BINARY( 10000 );
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
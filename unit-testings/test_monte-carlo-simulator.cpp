@@ -0,0 +1,281 @@
+#include <iostream>
+#include <bitset>
+#include <cmath>
+#include <stdexcept>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/dynamical-system/monte-carlo-simulator.hpp>
+#include <state-observation/noise/gaussian-white-noise.hpp>
+#include <state-observation/observer/linear-kalman-filter.hpp>
+
+using namespace stateObservation;
+
+const double dt=0.01;
+const unsigned trajectories=200;
+const unsigned steps=200;
+
+///a point moving along a line, its acceleration is the input and its
+///position is measured
+class ConstantVelocity : public DynamicalSystemFunctorBase
+{
+public:
+  ConstantVelocity():
+    a_(2,2),
+    b_(2,1),
+    c_(1,2),
+    processNoise_(2),
+    measurementNoise_(1)
+  {
+    a_ << 1, dt,
+          0, 1;
+    b_ << 0.5*dt*dt, dt;
+    c_ << 1, 0;
+    processNoise_.setCovarianceMatrix(getQ());
+    measurementNoise_.setCovarianceMatrix(getR());
+  }
+
+  virtual Vector stateDynamics(const Vector& x, const Vector& u, TimeIndex)
+  {
+    return processNoise_.addNoise(a_*x+b_*u);
+  }
+
+  virtual Vector measureDynamics(const Vector& x, const Vector&, TimeIndex)
+  {
+    return measurementNoise_.addNoise(c_*x);
+  }
+
+  virtual unsigned getStateSize() const { return 2; }
+  virtual unsigned getInputSize() const { return 1; }
+  virtual unsigned getMeasurementSize() const { return 1; }
+
+  ///the noises of the trajectory draw from the streams 3i and 3i+1
+  void setSeed(boost::uint64_t seed, unsigned trajectory)
+  {
+    processNoise_.setSeed(seed,3*trajectory);
+    measurementNoise_.setSeed(seed,3*trajectory+1);
+  }
+
+  const Matrix & getA() const { return a_; }
+  const Matrix & getB() const { return b_; }
+  const Matrix & getC() const { return c_; }
+
+  ///white acceleration noise
+  static Matrix getQ()
+  {
+    Matrix q(2,2);
+    q << dt*dt*dt/3, dt*dt/2,
+         dt*dt/2,    dt;
+    return 0.1*q;
+  }
+
+  static Matrix getR()
+  {
+    return Matrix::Constant(1,1,1e-4);
+  }
+
+private:
+  Matrix a_;
+  Matrix b_;
+  Matrix c_;
+  GaussianWhiteNoise processNoise_;
+  GaussianWhiteNoise measurementNoise_;
+};
+
+///a linear Kalman filter of the model of the system
+class KalmanWorker : public MonteCarloSimulator::Worker
+{
+public:
+  KalmanWorker():
+    filter_(2,1,1),
+    initialNoise_(2)
+  {
+    filter_.setA(system_.getA());
+    filter_.setB(system_.getB());
+    filter_.setC(system_.getC());
+    filter_.setD(Matrix::Zero(1,1));
+    filter_.setQ(ConstantVelocity::getQ());
+    filter_.setR(ConstantVelocity::getR());
+    initialNoise_.setCovarianceMatrix(getInitialCovariance());
+  }
+
+  virtual Worker * clone() const
+  {
+    return new KalmanWorker;
+  }
+
+  virtual DynamicalSystemFunctorBase & getFunctor()
+  {
+    return system_;
+  }
+
+  ///the initial state is drawn around the initial estimation with its
+  ///covariance
+  virtual void initialize(boost::uint64_t seed, unsigned trajectory, Vector & x0)
+  {
+    system_.setSeed(seed,trajectory);
+    initialNoise_.setSeed(seed,3*trajectory+2);
+
+    filter_.clearMeasurements();
+    filter_.clearInputs();
+    filter_.setState(Vector::Zero(2),0);
+    filter_.setStateCovariance(getInitialCovariance());
+    x0=initialNoise_.addNoise(Vector::Zero(2));
+  }
+
+  virtual void estimate(const Vector & y, const Vector & u, TimeIndex k,
+                        Vector & xHat, Matrix & covariance, double & nis)
+  {
+    filter_.setInput(u,k);
+    filter_.setMeasurement(y,k+1);
+    xHat=filter_.getEstimatedState(k+1);
+    covariance=filter_.getStateCovariance();
+    nis=filter_.getNormalizedInnovationSquared();
+  }
+
+  static Matrix getInitialCovariance()
+  {
+    return 1e-2*Matrix::Identity(2,2);
+  }
+
+protected:
+  ConstantVelocity system_;
+  LinearKalmanFilter filter_;
+  GaussianWhiteNoise initialNoise_;
+};
+
+///gives a covariance of the wrong size
+class WrongWorker : public KalmanWorker
+{
+public:
+  virtual Worker * clone() const
+  {
+    return new WrongWorker;
+  }
+
+  virtual void estimate(const Vector & y, const Vector & u, TimeIndex k,
+                        Vector & xHat, Matrix & covariance, double & nis)
+  {
+    KalmanWorker::estimate(y,u,k,xHat,covariance,nis);
+    covariance.resize(1,1);
+  }
+};
+
+///gives a covariance which is not positive definite
+class IndefiniteWorker : public KalmanWorker
+{
+public:
+  virtual Worker * clone() const
+  {
+    return new IndefiniteWorker;
+  }
+
+  virtual void estimate(const Vector & y, const Vector & u, TimeIndex k,
+                        Vector & xHat, Matrix & covariance, double & nis)
+  {
+    KalmanWorker::estimate(y,u,k,xHat,covariance,nis);
+    covariance=-covariance;
+  }
+};
+
+int test()
+{
+  int errorcode=0;
+
+  Matrix u(1,steps);
+  for (unsigned k=0; k<steps; ++k)
+  {
+    u(0,k)=std::sin(0.05*k);
+  }
+
+  MonteCarloSimulator simulator;
+  simulator.setInputs(u);
+  simulator.setThreadsNumber(3);
+  simulator.run(KalmanWorker(),trajectories,steps);
+
+  std::cout << "mean NEES " << simulator.getMeanNEES() << std::endl;
+  std::cout << "mean NIS " << simulator.getMeanNIS() << std::endl;
+  std::cout << "final RMSE " << simulator.getRMSE()[steps-1] << std::endl;
+
+  if (simulator.getTrajectoriesNumber()!=trajectories || simulator.getDuration()!=steps ||
+      simulator.getNEES().cols()!=trajectories || simulator.getRMSE().size()!=steps ||
+      simulator.getComponentsRMSE().size()!=2)
+    errorcode = errorcode | BOOST_BINARY( 1 );
+
+  ///the filter is consistent: the NEES and the NIS average to the sizes of
+  ///the state and of the measurement
+  if (std::abs(simulator.getMeanNEES()-2)>0.2 || std::abs(simulator.getMeanNIS()-1)>0.1)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  ///the statistics are the ones of the results of the trajectories
+  const double meanSquaredError=simulator.getSquaredErrors().mean();
+  if (std::abs(simulator.getRMSE().squaredNorm()/steps-meanSquaredError)>1e-12*meanSquaredError ||
+      std::abs(simulator.getComponentsRMSE().squaredNorm()-meanSquaredError)>
+      1e-12*meanSquaredError ||
+      std::abs(simulator.getMeanNIS()-simulator.getNIS().mean())>1e-12)
+    errorcode = errorcode | BOOST_BINARY( 100 );
+
+  ///the same trajectories in the calling thread only
+  MonteCarloSimulator sequential;
+  sequential.setInputs(u);
+  sequential.setThreadsNumber(0);
+  sequential.run(KalmanWorker(),trajectories,steps);
+
+  ///the noises are drawn from the streams of the trajectories, the
+  ///results are the same whatever the number of threads
+  if (sequential.getSquaredErrors()!=simulator.getSquaredErrors() ||
+      sequential.getNEES()!=simulator.getNEES() || sequential.getNIS()!=simulator.getNIS() ||
+      sequential.getComponentsRMSE()!=simulator.getComponentsRMSE())
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  sequential.setSeed(1);
+  sequential.run(KalmanWorker(),trajectories,steps);
+  if (sequential.getSquaredErrors()==simulator.getSquaredErrors())
+    errorcode = errorcode | BOOST_BINARY( 1000000 );
+
+  ///the errors of the workers are given to the calling thread
+  try
+  {
+    simulator.run(WrongWorker(),trajectories,steps);
+    errorcode = errorcode | BOOST_BINARY( 10000 );
+  }
+  catch (const std::runtime_error &)
+  {
+  }
+
+  try
+  {
+    simulator.run(IndefiniteWorker(),trajectories,steps);
+    errorcode = errorcode | BOOST_BINARY( 10000000 );
+  }
+  catch (const std::runtime_error &)
+  {
+  }
+
+  try
+  {
+    simulator.run(KalmanWorker(),0,steps);
+    errorcode = errorcode | BOOST_BINARY( 100000 );
+  }
+  catch (const std::invalid_argument &)
+  {
+  }
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
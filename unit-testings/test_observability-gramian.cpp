@@ -0,0 +1,190 @@
+#include <iostream>
+#include <bitset>
+#include <limits>
+
+#include <boost/utility/binary.hpp>
+
+#include <Eigen/Eigenvalues>
+
+#include <state-observation/tools/observability-gramian.hpp>
+#include <state-observation/flexibility-estimation/model-base-ekf-flex-estimator-imu.hpp>
+
+using namespace stateObservation;
+
+const unsigned n=6;
+const unsigned m=2;
+const unsigned steps=50;
+const double windowLength=10;
+
+///the incremental Gramian is the weighted sum of the local observability
+///Gramians computed from scratch
+int testIncrementalUpdate()
+{
+  int errorcode=0;
+
+  tools::ObservabilityGramian gramian(n,windowLength);
+  const double lambda=1-1/windowLength;
+
+  Matrix reference=Matrix::Zero(n,n);
+  Matrix O(2*m,n);
+
+  for (unsigned k=0; k<steps; ++k)
+  {
+    Matrix A=Matrix::Identity(n,n)+Matrix::Random(n,n)*0.1;
+    Matrix C=Matrix::Random(m,n);
+
+    gramian.update(A,C);
+
+    O << C, C*A;
+    reference=lambda*reference+O.transpose()*O;
+  }
+
+  double error=(gramian.getGramian()-reference).norm()/reference.norm();
+  std::cout << "Gramian relative error " << error << std::endl;
+  if (error>1e-12 || gramian.getUpdatesNumber()!=steps)
+    errorcode = errorcode | BOOST_BINARY( 1 );
+
+  ///the estimation of the condition number converges to the exact one
+  double condition=0;
+  for (unsigned i=0; i<100; ++i)
+    condition=gramian.estimateConditionNumber(10);
+
+  Eigen::SelfAdjointEigenSolver<Matrix> eigen(reference);
+  double exact=eigen.eigenvalues().maxCoeff()/eigen.eigenvalues().minCoeff();
+
+  std::cout << "condition number estimate " << condition << " exact " << exact << std::endl;
+  if (std::abs(condition-exact)>1e-6*exact)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  return errorcode;
+}
+
+///a state which neither is measured nor influences the measured ones is
+///not observable
+int testUnobservable()
+{
+  tools::ObservabilityGramian gramian(n,windowLength);
+
+  if (gramian.estimateConditionNumber()!=std::numeric_limits<double>::infinity())
+    return BOOST_BINARY( 100 );
+
+  for (unsigned k=0; k<steps; ++k)
+  {
+    Matrix A=Matrix::Identity(n,n)+Matrix::Random(n,n)*0.1;
+    A.col(n-1).setZero();
+    A(n-1,n-1)=1;
+    Matrix C=Matrix::Random(m,n);
+    C.col(n-1).setZero();
+
+    gramian.update(A,C);
+  }
+
+  double condition=gramian.estimateConditionNumber();
+  std::cout << "unobservable condition number estimate " << condition << std::endl;
+  if (condition!=std::numeric_limits<double>::infinity())
+    return BOOST_BINARY( 1000 );
+
+  return 0;
+}
+
+///between two factorizations, the estimation follows the Gramian with the
+///previous factorization
+int testFactorizationPeriod()
+{
+  int errorcode=0;
+
+  tools::ObservabilityGramian gramian(n,tools::ObservabilityGramian::defaultWindowLength);
+  gramian.setFactorizationPeriod(20);
+
+  for (unsigned k=0; k<steps; ++k)
+  {
+    gramian.update(Matrix::Identity(n,n)+Matrix::Random(n,n)*0.1,Matrix::Random(m,n));
+  }
+  for (unsigned i=0; i<100; ++i)
+    gramian.estimateConditionNumber(10);
+
+  double maxError=0;
+  for (unsigned k=0; k<gramian.getFactorizationPeriod(); ++k)
+  {
+    gramian.update(Matrix::Identity(n,n)+Matrix::Random(n,n)*0.1,Matrix::Random(m,n));
+    double condition=gramian.estimateConditionNumber();
+
+    Eigen::SelfAdjointEigenSolver<Matrix> eigen(gramian.getGramian());
+    double exact=eigen.eigenvalues().maxCoeff()/eigen.eigenvalues().minCoeff();
+    maxError=std::max(maxError,std::abs(condition-exact)/exact);
+  }
+
+  std::cout << "condition number relative error between factorizations " << maxError << std::endl;
+  if (maxError>5e-2)
+    errorcode = errorcode | BOOST_BINARY( 100000 );
+
+  return errorcode;
+}
+
+///the flexibility estimator updates the Gramian with the Jacobians of the
+///filter at each step
+int testFlexibilityEstimator()
+{
+  typedef flexibilityEstimation::IMUElasticLocalFrameDynamicalSystem::input input;
+
+  flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU est(5e-3);
+  est.setRobotMass(hrp2::m);
+  est.setContactModel(flexibilityEstimation::ModelBaseEKFFlexEstimatorIMU::
+                      contactModel::elasticContact);
+  est.setContactsNumber(2);
+  est.setObservabilityMonitoring(true);
+
+  Vector u=Vector::Zero(est.getInputSize());
+  u.segment<3>(input::posCom) << 0.0135673, 0.001536, 0.80771;
+  u.segment<6>(input::inertia) << 48.1348, 46.9498, 1.76068, -0.0863332, -0.594871, -0.0402246;
+  u.segment<3>(input::posIMU) << -0.098, -6.23712e-11, 1.1174;
+  u.segment<3>(input::contacts) << 0.00949046, -0.095, 1.98197e-07;
+  u.segment<3>(input::contacts+12) << 0.00949046, 0.095, 1.98197e-07;
+
+  Vector y=Vector::Zero(est.getMeasurementSize());
+  y[2]=cst::gravityConstant;
+
+  est.setInput(u);
+  est.setMeasurementInput(u);
+
+  for (unsigned k=0; k<10; ++k)
+  {
+    est.setMeasurement(y);
+    est.setMeasurementInput(u);
+    est.getFlexibilityVector();
+  }
+
+  const tools::ObservabilityGramian & gramian=est.getObservabilityGramian();
+
+  Matrix C=est.getCMatrix();
+  Matrix O(2*C.rows(),C.cols());
+  O << C, C*est.getAMatrix();
+
+  double error=(est.computeLocalObservationMatrix()-O).norm()/O.norm();
+  std::cout << "flexibility estimator: " << gramian.getUpdatesNumber() << " updates, "
+            << "local observation matrix error " << error << ", condition number estimate "
+            << est.getObservabilityConditionNumber() << std::endl;
+
+  if (gramian.getUpdatesNumber()!=10 || error>1e-12 ||
+      gramian.getGramian().rows()!=int(est.getStateSize()))
+    return BOOST_BINARY( 10000 );
+
+  return 0;
+}
+
+int main()
+{
+  int returnVal = testIncrementalUpdate() | testUnobservable() | testFactorizationPeriod() |
+                  testFlexibilityEstimator();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <bitset>
+#include <cmath>
+#include <algorithm>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/tools/random-stream.hpp>
+#include <state-observation/noise/gaussian-white-noise.hpp>
+
+using namespace stateObservation;
+
+using tools::RandomStream;
+
+const unsigned draws=100000;
+
+///the known answers of the Philox4x32-10 function
+bool checkKnownAnswers()
+{
+  const boost::uint32_t counters[3][4]={{0,0,0,0},
+                                        {0xffffffff,0xffffffff,0xffffffff,0xffffffff},
+                                        {0x243f6a88,0x85a308d3,0x13198a2e,0x03707344}};
+  const boost::uint32_t keys[3][2]={{0,0},
+                                    {0xffffffff,0xffffffff},
+                                    {0xa4093822,0x299f31d0}};
+  const boost::uint32_t answers[3][4]={{0x6627e8d5,0xe169c58d,0xbc57ac4c,0x9b00dbd8},
+                                       {0x408f276d,0x41c83b0e,0xa20bc7c6,0x6d5451fd},
+                                       {0xd16cfe09,0x94fdcceb,0x5001e420,0x24126ea1}};
+
+  for (unsigned i=0; i<3; ++i)
+  {
+    boost::uint32_t result[4];
+    RandomStream::philox(counters[i],keys[i],result);
+    for (unsigned j=0; j<4; ++j)
+    {
+      if (result[j]!=answers[i][j])
+        return false;
+    }
+  }
+  return true;
+}
+
+int test()
+{
+  int errorcode=0;
+
+  if (!checkKnownAnswers())
+    errorcode = errorcode | BOOST_BINARY( 1 );
+
+  ///a stream is given by its seed and its id only
+  RandomStream a(42,7);
+  RandomStream b(42,7);
+  RandomStream otherStream(42,8);
+  RandomStream otherSeed(43,7);
+
+  unsigned differences=0;
+  unsigned sameOther=0;
+  double mean=0;
+  double variance=0;
+  for (unsigned i=0; i<draws; ++i)
+  {
+    double x=a.normal();
+    if (x!=b.normal())
+      ++differences;
+    if (x==otherStream.normal() || x==otherSeed.normal())
+      ++sameOther;
+    mean+=x;
+    variance+=x*x;
+  }
+  mean/=draws;
+  variance=variance/draws-mean*mean;
+
+  std::cout << "mean " << mean << " variance " << variance << std::endl;
+
+  if (differences>0)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  if (sameOther>0)
+    errorcode = errorcode | BOOST_BINARY( 100 );
+
+  if (std::abs(mean)>0.02 || std::abs(variance-1)>0.02)
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  ///any position of the stream can be reached directly
+  RandomStream skip(42,7);
+  skip.setCounter(draws/2);
+  b.setSeed(42,7);
+  for (unsigned i=0; i<draws; ++i)
+  {
+    b.uniform();
+  }
+  if (skip.uniform()!=b.uniform() || skip.getCounter()!=b.getCounter())
+    errorcode = errorcode | BOOST_BINARY( 10000 );
+
+  ///the uniform numbers are in (0,1]
+  double minimum=1;
+  double maximum=0;
+  for (unsigned i=0; i<draws; ++i)
+  {
+    double u=a.uniform();
+    minimum=std::min(minimum,u);
+    maximum=std::max(maximum,u);
+  }
+  if (!(minimum>0) || maximum>1 || minimum>1e-3 || maximum<1-1e-3)
+    errorcode = errorcode | BOOST_BINARY( 100000 );
+
+  ///the noises have their own streams, and give the same numbers with the
+  ///same seed
+  GaussianWhiteNoise noise1(3);
+  GaussianWhiteNoise noise2(3);
+  if (noise1.getRandomStream().getStream()==noise2.getRandomStream().getStream() ||
+      noise1.addNoise(Vector::Zero(3))==noise2.addNoise(Vector::Zero(3)))
+    errorcode = errorcode | BOOST_BINARY( 1000000 );
+
+  noise1.setSeed(5,3);
+  noise2.setSeed(5,3);
+  if (noise1.addNoise(Vector::Zero(3))!=noise2.addNoise(Vector::Zero(3)))
+    errorcode = errorcode | BOOST_BINARY( 10000000 );
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
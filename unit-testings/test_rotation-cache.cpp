@@ -0,0 +1,95 @@
+#include <iostream>
+#include <bitset>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/tools/rotation-cache.hpp>
+#include <state-observation/dynamical-system/imu-dynamical-system.hpp>
+
+using namespace stateObservation;
+
+int testConversions()
+{
+  int errorcode=0;
+
+  kine::RotationCache cache(2);
+
+  Vector3 v1(0.3,-0.2,0.5);
+  Vector3 v2(-0.1,0.4,0.2);
+
+  Matrix3 R1=kine::rotationVectorToAngleAxis(v1).toRotationMatrix();
+  Quaternion q2(kine::rotationVectorToAngleAxis(v2));
+
+  ///two misses then hits while the vectors do not change
+  for (unsigned i=0; i<5; ++i)
+  {
+    if (!cache.getMatrix(v1,0).isApprox(R1) ||
+        !cache.getQuaternion(v2,1).coeffs().isApprox(q2.coeffs()))
+      errorcode = errorcode | BOOST_BINARY( 1 );
+  }
+
+  std::cout << "hits " << cache.getHits() << " misses " << cache.getMisses() << std::endl;
+  if (cache.getMisses()!=2 || cache.getHits()!=8)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  ///a different vector in the slot is a miss
+  if (!cache.getMatrix(v2,0).isApprox(q2.toRotationMatrix()) || cache.getMisses()!=3)
+    errorcode = errorcode | BOOST_BINARY( 100 );
+
+  cache.resetStatistics();
+  if (cache.getHitRate()!=0)
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  return errorcode;
+}
+
+///the finite differences on the states do not recompute the rotations of
+///the columns which do not change them
+int testFiniteDifferencesSweep()
+{
+  IMUDynamicalSystem f;
+  f.setSamplingPeriod(5e-3);
+
+  const unsigned n=f.getStateSize();
+
+  Vector x=Vector::Random(n)*0.1;
+  Matrix X=x.replicate(1,n+1);
+  X.block(0,1,n,n)+=Matrix::Identity(n,n)*1e-6;
+
+  Matrix u=Vector::Random(f.getInputSize());
+  Matrix xk1;
+
+  f.stateDynamicsBatch(X,u,0,xk1);
+
+  const kine::RotationCache & cache=f.getRotationCache();
+
+  std::cout << "finite differences: hits " << cache.getHits() << " misses "
+            << cache.getMisses() << " hit rate " << cache.getHitRate() << std::endl;
+
+  ///a rotation is computed only when its vector differs from the previous
+  ///column: the orientation at the nominal state, its 3 perturbations and
+  ///the return to the nominal value, the rotation increment at the nominal
+  ///state, the 3 perturbations of the angular velocity, the return to the
+  ///nominal value (linear acceleration columns) and the 3 perturbations of
+  ///the angular acceleration
+  if (cache.getMisses()!=5+8)
+    return BOOST_BINARY( 10000 );
+
+  return 0;
+}
+
+int main()
+{
+  int returnVal = testConversions() | testFiniteDifferencesSweep();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}
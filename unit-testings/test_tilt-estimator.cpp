@@ -0,0 +1,171 @@
+#include <iostream>
+#include <bitset>
+
+#include <boost/utility/binary.hpp>
+
+#include <state-observation/observer/tilt-estimator.hpp>
+#include <state-observation/observer/tilt-estimator-batch.hpp>
+#include <state-observation/tools/rigid-body-kinematics.hpp>
+
+using namespace stateObservation;
+
+const unsigned steps=10000;
+const unsigned batchSize=37;
+const unsigned batchSteps=1000;
+
+void setParameters(TiltEstimator & f)
+{
+  f.setSamplingTime(0.005);
+  f.setSensorPositionInC(Vector3(0.1,-0.05,0.8));
+  f.setSensorOrientationInC(kine::rotationVectorToRotationMatrix(Vector3(0.1,0.2,-0.3)));
+  f.setSensorLinearVelocityInC(Vector3(0.01,0,-0.02));
+  f.setSensorAngularVelocityInC(Vector3(0,0.05,0.01));
+  f.setControlOriginVelocityInW(Vector3(0.2,0,0));
+}
+
+int test()
+{
+  int errorcode=0;
+
+  TiltEstimator observer(5,1,2);
+  TiltEstimator fixedSize(5,1,2);
+  TiltEstimator mixed(5,1,2);
+  setParameters(observer);
+  setParameters(fixedSize);
+  setParameters(mixed);
+
+  Vector x0=Vector::Zero(9);
+  x0.segment<3>(3) << 0, 0.1, 0.9;
+  x0[8]=1;
+  observer.setState(x0,0);
+  fixedSize.setEstimation(x0.segment<3>(0),x0.segment<3>(3),x0.segment<3>(6));
+  mixed.setState(x0,0);
+  mixed.setEstimation(x0.segment<3>(0),x0.segment<3>(3),x0.segment<3>(6));
+
+  ///the IMU is tilted and shakes
+  const Vector3 tilt=kine::rotationVectorToRotationMatrix(Vector3(0.2,-0.1,0)).transpose()
+                     *Vector3::UnitZ();
+
+  srand(1);
+  unsigned differences=0;
+  unsigned mixedDifferences=0;
+  for (unsigned k=0; k<steps; ++k)
+  {
+    Vector3 ya=cst::gravityConstant*tilt+0.1*Vector3::Random();
+    Vector3 yg=0.01*Vector3::Random();
+
+    observer.setMeasurement(ya,yg,k+1);
+    Vector x=observer.getEstimatedState(k+1);
+    fixedSize.estimate(ya,yg);
+
+    if (x.segment<3>(0)!=fixedSize.getX1Hat() || x.segment<3>(3)!=fixedSize.getX2HatPrime() ||
+        x.segment<3>(6)!=fixedSize.getTilt())
+      ++differences;
+
+    ///both paths on the same estimator
+    mixed.setMeasurement(ya,yg,k+1);
+    if (mixed.getEstimatedState(k+1)!=x || mixed.estimate(ya,yg)!=fixedSize.getTilt())
+      ++mixedDifferences;
+  }
+
+  std::cout << "steps where the two paths differ " << differences << std::endl;
+  std::cout << "tilt error " << (fixedSize.getTilt()-tilt).norm() << std::endl;
+
+  ///the fixed-size path is bitwise identical to the observer
+  if (differences>0)
+    errorcode = errorcode | BOOST_BINARY( 1 );
+
+  ///the two paths do not share their state
+  std::cout << "steps where the paths of the same estimator interfere " << mixedDifferences
+            << std::endl;
+  if (mixedDifferences>0)
+    errorcode = errorcode | BOOST_BINARY( 1000 );
+
+  ///and the tilt converges
+  if ((fixedSize.getTilt()-tilt).norm()>1e-2)
+    errorcode = errorcode | BOOST_BINARY( 10 );
+
+  ///a batch of IMUs with different parameters gives the same estimations
+  ///as one estimator per IMU
+  TiltEstimatorBatch batch(batchSize,5,1,2);
+  std::vector<TiltEstimator *> estimators;
+  const Vector3 controlVelocity(0.1,-0.2,0.05);
+  batch.setControlOriginVelocityInW(controlVelocity);
+  for (unsigned i=0; i<batchSize; ++i)
+  {
+    estimators.push_back(new TiltEstimator(5+0.1*i,1+0.05*i,2-0.02*i));
+    TiltEstimator & f=*estimators[i];
+    batch.setAlpha(i,f.getAlpha());
+    batch.setBeta(i,f.getBeta());
+    batch.setGamma(i,f.getGamma());
+
+    Vector3 p=Vector3::Random();
+    Matrix3 R=kine::rotationVectorToRotationMatrix(Vector3::Random());
+    Vector3 v=0.1*Vector3::Random();
+    Vector3 w=0.1*Vector3::Random();
+    f.setSensorPositionInC(p);
+    f.setSensorOrientationInC(R);
+    f.setSensorLinearVelocityInC(v);
+    f.setSensorAngularVelocityInC(w);
+    f.setControlOriginVelocityInW(controlVelocity);
+    batch.setSensorPositionInC(i,p);
+    batch.setSensorOrientationInC(i,R);
+    batch.setSensorLinearVelocityInC(i,v);
+    batch.setSensorAngularVelocityInC(i,w);
+
+    Vector3 x1=Vector3::Random();
+    Vector3 x2prime=Vector3::Random();
+    Vector3 x2=Vector3::Random().normalized();
+    f.setEstimation(x1,x2prime,x2);
+    batch.setEstimation(i,x1,x2prime,x2);
+  }
+
+  unsigned batchDifferences=0;
+  for (unsigned k=0; k<batchSteps; ++k)
+  {
+    for (unsigned i=0; i<batchSize; ++i)
+    {
+      Vector3 ya=Vector3::Random()+cst::gravityConstant*Vector3::UnitZ();
+      Vector3 yg=0.3*Vector3::Random();
+      estimators[i]->estimate(ya,yg);
+      batch.setMeasurement(i,ya,yg);
+    }
+    batch.estimate();
+
+    for (unsigned i=0; i<batchSize; ++i)
+    {
+      if (batch.getX1Hat(i)!=estimators[i]->getX1Hat() ||
+          batch.getX2HatPrime(i)!=estimators[i]->getX2HatPrime() ||
+          batch.getTilt(i)!=estimators[i]->getTilt())
+        ++batchDifferences;
+    }
+  }
+
+  for (unsigned i=0; i<batchSize; ++i)
+  {
+    delete estimators[i];
+  }
+
+  std::cout << "estimations of the batch which differ " << batchDifferences << std::endl;
+
+  if (batchDifferences>0)
+    errorcode = errorcode | BOOST_BINARY( 100 );
+
+  return errorcode;
+}
+
+int main()
+{
+  int returnVal = test();
+
+  if (returnVal != 0)
+  {
+    std::cout << "Test failed, code : " << std::bitset<16>(returnVal) << std::endl;
+    return returnVal;
+  }
+  else
+  {
+    std::cout << "Test succeeded" << std::endl;
+    return 0;
+  }
+}